@@ -0,0 +1,626 @@
+/*************************************************************************
+    > File Name: bench_inotify.cc
+    > Author: hsz
+    > Brief: inotify_tool性能测试: 生成目录树, 多线程制造事件风暴, 统计注册耗时/吞吐/延迟/内存/丢失事件
+    > Created Time: 2026年10月17日 星期六 20时05分37秒
+ ************************************************************************/
+
+#include "inotify_tool/inotify_event.h"
+#include "inotify_tool/inotify_tool.h"
+
+#include <utils/errors.h>
+#include <log/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <unordered_map>
+
+#define LOG_TAG "Bench-Inotify"
+
+struct BenchOptions
+{
+    std::string root;               // 测试目录, 为空时在/tmp下创建
+    uint32_t    depth = 3;          // 目录深度
+    uint32_t    fanout = 4;         // 每个目录的子目录数
+    uint32_t    files = 8;          // 每个目录的文件数
+    uint32_t    threads = 4;        // 产生事件的线程数
+    uint32_t    ops = 10000;        // 每个线程的操作轮数, 每轮 create/write/rename/delete
+    uint32_t    walkThreads = 1;    // 遍历线程数
+    uint32_t    drainMs = 1000;     // 风暴结束后无事件多久视为收完
+    uint32_t    windowMs = 0;       // waitCompleteEvent的批处理窗口
+    uint32_t    windowEvents = 0;   // 批处理窗口的事件数上限
+    bool        batch = false;      // 使用getEventBatch代替getEventItem
+    bool        keep = false;       // 保留测试目录
+    std::string output;             // JSON输出文件, 为空时输出到stdout
+    std::string record;             // 录制风暴期间的原始事件流
+    std::string replay;             // 重放录制文件, 不生成目录树
+    bool        realtime = false;   // 按录制时的时间间隔重放
+};
+
+// 一次期望产生的事件, key = 目录 + '\0' + 文件名 + '\0' + 事件
+struct ExpectedEvent
+{
+    std::string key;
+    uint64_t    ns;
+};
+
+struct DeliveredEvent
+{
+    std::string key;
+    uint64_t    ns;
+};
+
+static uint64_t NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string MakeKey(std::string_view path, std::string_view name, uint32_t event)
+{
+    std::string key;
+    key.reserve(path.size() + name.size() + 16);
+    key.append(path);
+    if (key.empty() || key.back() != '/')
+    {
+        key.push_back('/');
+    }
+    key.push_back('\0');
+    key.append(name);
+    key.push_back('\0');
+    key.append(std::to_string(event));
+    return key;
+}
+
+static uint64_t ReadRssBytes()
+{
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp == nullptr)
+    {
+        return 0;
+    }
+
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    if (fscanf(fp, "%lu %lu", &size, &resident) != 2)
+    {
+        resident = 0;
+    }
+    fclose(fp);
+
+    return static_cast<uint64_t>(resident) * sysconf(_SC_PAGESIZE);
+}
+
+static bool TouchFile(const std::string &path)
+{
+    int32_t fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    close(fd);
+    return true;
+}
+
+static bool GenerateTree(const std::string &dir, uint32_t depth, const BenchOptions &opts,
+                         std::vector<std::string> &dirVec, uint64_t &fileCount)
+{
+    dirVec.push_back(dir);
+    for (uint32_t i = 0; i < opts.files; ++i)
+    {
+        if (!TouchFile(dir + "f" + std::to_string(i)))
+        {
+            fprintf(stderr, "create file in %s error: %s\n", dir.c_str(), strerror(errno));
+            return false;
+        }
+        ++fileCount;
+    }
+
+    if (depth == 0)
+    {
+        return true;
+    }
+
+    for (uint32_t i = 0; i < opts.fanout; ++i)
+    {
+        std::string subDir = dir + "d" + std::to_string(i) + "/";
+        if (mkdir(subDir.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            fprintf(stderr, "mkdir %s error: %s\n", subDir.c_str(), strerror(errno));
+            return false;
+        }
+
+        if (!GenerateTree(subDir, depth - 1, opts, dirVec, fileCount))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief 事件风暴线程. 每轮在随机目录中 创建 -> 写入 -> 重命名 -> 删除 一个文件,
+ * 在系统调用前记录时间戳
+ */
+static void StormThread(uint32_t id, const BenchOptions &opts, const std::vector<std::string> &dirVec,
+                        std::vector<ExpectedEvent> &expectedVec)
+{
+    std::mt19937 rng(id * 2654435761u + 1);
+    std::uniform_int_distribution<size_t> dist(0, dirVec.size() - 1);
+    static const char data[] = "bench_inotify";
+
+    expectedVec.reserve(opts.ops * 4);
+    for (uint32_t i = 0; i < opts.ops; ++i)
+    {
+        const std::string &dir = dirVec[dist(rng)];
+        std::string name = "s" + std::to_string(id) + "_" + std::to_string(i);
+        std::string newName = name + ".mv";
+        std::string path = dir + name;
+        std::string newPath = dir + newName;
+
+        expectedVec.push_back({MakeKey(dir, name, EV_IN_CREATE), NowNs()});
+        int32_t fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            expectedVec.pop_back();
+            continue;
+        }
+        close(fd);
+
+        expectedVec.push_back({MakeKey(dir, name, EV_IN_MODIFY_OVER), NowNs()});
+        fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd >= 0)
+        {
+            if (write(fd, data, sizeof(data)) < 0)
+            {
+                expectedVec.pop_back();
+            }
+            close(fd);
+        }
+        else
+        {
+            expectedVec.pop_back();
+        }
+
+        expectedVec.push_back({MakeKey(dir, newName, EV_IN_MOVE), NowNs()});
+        if (rename(path.c_str(), newPath.c_str()) != 0)
+        {
+            expectedVec.pop_back();
+            newPath = path;
+            newName = name;
+        }
+
+        expectedVec.push_back({MakeKey(dir, newName, EV_IN_DELETE), NowNs()});
+        if (unlink(newPath.c_str()) != 0)
+        {
+            expectedVec.pop_back();
+        }
+    }
+}
+
+static bool RemoveTree(const std::vector<std::string> &dirVec, const BenchOptions &opts)
+{
+    // dirVec为先序, 逆序删除即可保证子目录先于父目录
+    bool ok = true;
+    for (auto it = dirVec.rbegin(); it != dirVec.rend(); ++it)
+    {
+        for (uint32_t i = 0; i < opts.files; ++i)
+        {
+            unlink((*it + "f" + std::to_string(i)).c_str());
+        }
+        ok = (rmdir(it->c_str()) == 0) && ok;
+    }
+
+    return ok;
+}
+
+static double Percentile(const std::vector<uint64_t> &sortedVec, double p)
+{
+    if (sortedVec.empty())
+    {
+        return 0;
+    }
+
+    size_t index = static_cast<size_t>(p * (sortedVec.size() - 1) + 0.5);
+    return sortedVec[std::min(index, sortedVec.size() - 1)] / 1000.0;
+}
+
+static void Usage(const char *prog)
+{
+    printf("usage: %s [options]\n"
+           "  -r, --root DIR          test directory (default: mkdtemp under /tmp)\n"
+           "  -d, --depth N           tree depth (default: 3)\n"
+           "  -f, --fanout N          sub directories per directory (default: 4)\n"
+           "  -n, --files N           files per directory (default: 8)\n"
+           "  -t, --threads N         storm threads (default: 4)\n"
+           "  -o, --ops N             create/write/rename/delete rounds per thread (default: 10000)\n"
+           "  -w, --walk-threads N    directory walk threads (default: 1)\n"
+           "  -D, --drain-ms N        idle time before the storm is considered drained (default: 1000)\n"
+           "  -W, --window MS[:N]     batch window for waitCompleteEvent, optional event limit (default: 0)\n"
+           "  -b, --batch             read events through getEventBatch\n"
+           "  -k, --keep              keep the generated tree\n"
+           "  -j, --json FILE         write JSON result to FILE (default: stdout)\n"
+           "  -R, --record FILE       record the raw inotify event stream of the storm to FILE\n"
+           "  -P, --replay FILE       replay a recorded stream through the parser instead of running a storm\n"
+           "  -T, --realtime          replay with the recorded timing instead of as fast as possible\n"
+           "  -h, --help\n", prog);
+}
+
+static bool ParseOptions(int argc, char *argv[], BenchOptions &opts)
+{
+    static const struct option longOptions[] = {
+        {"root",         required_argument, nullptr, 'r'},
+        {"depth",        required_argument, nullptr, 'd'},
+        {"fanout",       required_argument, nullptr, 'f'},
+        {"files",        required_argument, nullptr, 'n'},
+        {"threads",      required_argument, nullptr, 't'},
+        {"ops",          required_argument, nullptr, 'o'},
+        {"walk-threads", required_argument, nullptr, 'w'},
+        {"drain-ms",     required_argument, nullptr, 'D'},
+        {"window",       required_argument, nullptr, 'W'},
+        {"batch",        no_argument,       nullptr, 'b'},
+        {"keep",         no_argument,       nullptr, 'k'},
+        {"json",         required_argument, nullptr, 'j'},
+        {"record",       required_argument, nullptr, 'R'},
+        {"replay",       required_argument, nullptr, 'P'},
+        {"realtime",     no_argument,       nullptr, 'T'},
+        {"help",         no_argument,       nullptr, 'h'},
+        {nullptr,        0,                 nullptr, 0},
+    };
+
+    int32_t opt = 0;
+    while ((opt = getopt_long(argc, argv, "r:d:f:n:t:o:w:D:W:bkj:R:P:Th", longOptions, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'r': opts.root = optarg; break;
+        case 'd': opts.depth = strtoul(optarg, nullptr, 10); break;
+        case 'f': opts.fanout = strtoul(optarg, nullptr, 10); break;
+        case 'n': opts.files = strtoul(optarg, nullptr, 10); break;
+        case 't': opts.threads = std::max(1ul, strtoul(optarg, nullptr, 10)); break;
+        case 'o': opts.ops = strtoul(optarg, nullptr, 10); break;
+        case 'w': opts.walkThreads = std::max(1ul, strtoul(optarg, nullptr, 10)); break;
+        case 'D': opts.drainMs = strtoul(optarg, nullptr, 10); break;
+        case 'W':
+        {
+            char *pEnd = nullptr;
+            opts.windowMs = strtoul(optarg, &pEnd, 10);
+            opts.windowEvents = (*pEnd == ':') ? strtoul(pEnd + 1, nullptr, 10) : 0;
+            break;
+        }
+        case 'b': opts.batch = true; break;
+        case 'k': opts.keep = true; break;
+        case 'j': opts.output = optarg; break;
+        case 'R': opts.record = optarg; break;
+        case 'P': opts.replay = optarg; break;
+        case 'T': opts.realtime = true; break;
+        default:
+            Usage(argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static FILE *OpenOutput(const BenchOptions &opts)
+{
+    if (opts.output.empty())
+    {
+        return stdout;
+    }
+
+    FILE *fp = fopen(opts.output.c_str(), "w");
+    if (fp == nullptr)
+    {
+        perror("open output error");
+    }
+    return fp;
+}
+
+// 重放录制的事件流, 只测量解析和交付, 结果与文件系统和调度无关
+static int32_t RunReplay(const BenchOptions &opts)
+{
+    eular::InotifyTool::SP spInotifyTool = std::make_shared<eular::InotifyTool>();
+    uint64_t overflowCount = 0;
+    int32_t status = spInotifyTool->replay(opts.replay, opts.realtime, [&] (const eular::InotifyEventBatch &batch) {
+        for (const auto &it : batch)
+        {
+            overflowCount += (it.event & EV_IN_Q_OVERFLOW) ? 1 : 0;
+        }
+    });
+    if (status != NO_ERROR)
+    {
+        fprintf(stderr, "replay %s error: %d\n", opts.replay.c_str(), status);
+        return -1;
+    }
+
+    eular::ReplayStats replayStats = spInotifyTool->getReplayStats();
+    eular::InotifyStats toolStats = spInotifyTool->getStats();
+    FILE *fp = OpenOutput(opts);
+    if (fp == nullptr)
+    {
+        return -1;
+    }
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"replay\": {\"file\": \"%s\", \"realtime\": %s, \"reads\": %lu, \"bytes\": %lu, "
+                "\"kernel_events\": %lu, \"events\": %lu, \"overflows\": %lu, \"elapsed_ms\": %.3f, "
+                "\"kernel_events_per_sec\": %.1f, \"events_per_sec\": %.1f},\n",
+        opts.replay.c_str(), opts.realtime ? "true" : "false", replayStats.records, replayStats.bytes,
+        replayStats.kernelEvents, replayStats.events, overflowCount, replayStats.elapsedNs / 1e6,
+        replayStats.kernelEventsPerSec, replayStats.eventsPerSec);
+    fprintf(fp, "  \"internal\": {\"parse_us_p50\": %.1f, \"parse_us_p99\": %.1f, \"parse_us_max\": %.1f, "
+                "\"batch_mean\": %.1f, \"batch_max\": %lu}\n",
+        toolStats.parseNs.percentile(0.5) / 1e3, toolStats.parseNs.percentile(0.99) / 1e3,
+        toolStats.parseNs.max / 1e3, toolStats.batchSize.mean(), toolStats.batchSize.max);
+    fprintf(fp, "}\n");
+
+    if (fp != stdout)
+    {
+        fclose(fp);
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions opts;
+    if (!ParseOptions(argc, argv, opts))
+    {
+        return 0;
+    }
+
+    if (!opts.replay.empty())
+    {
+        return RunReplay(opts);
+    }
+
+    bool createdRoot = false;
+    if (opts.root.empty())
+    {
+        char tmpl[] = "/tmp/bench_inotify_XXXXXX";
+        if (mkdtemp(tmpl) == nullptr)
+        {
+            perror("mkdtemp error");
+            return -1;
+        }
+        opts.root = tmpl;
+        createdRoot = true;
+    }
+    else if (mkdir(opts.root.c_str(), 0755) == 0)
+    {
+        createdRoot = true;
+    }
+    if (opts.root.back() != '/')
+    {
+        opts.root.push_back('/');
+    }
+
+    // 生成目录树
+    std::vector<std::string> dirVec;
+    uint64_t fileCount = 0;
+    uint64_t beginNs = NowNs();
+    if (!GenerateTree(opts.root, opts.depth, opts, dirVec, fileCount))
+    {
+        return -1;
+    }
+    uint64_t generateNs = NowNs() - beginNs;
+
+    // 注册watch
+    eular::InotifyTool::SP spInotifyTool = std::make_shared<eular::InotifyTool>();
+    if (!spInotifyTool->createInotify())
+    {
+        perror("createInotify error");
+        return -1;
+    }
+    spInotifyTool->setWalkThreads(opts.walkThreads);
+    spInotifyTool->setBatchWindow(opts.windowMs, opts.windowEvents);
+
+    uint64_t rssBefore = ReadRssBytes();
+    beginNs = NowNs();
+    int32_t status = spInotifyTool->watchRecursive(opts.root, EV_IN_ALL);
+    uint64_t watchNs = NowNs() - beginNs;
+    uint64_t rssAfter = ReadRssBytes();
+    if (status != NO_ERROR)
+    {
+        fprintf(stderr, "watchRecursive %s error: %d\n", opts.root.c_str(), status);
+        return -1;
+    }
+
+    if (!opts.record.empty() && spInotifyTool->startRecording(opts.record) != NO_ERROR)
+    {
+        fprintf(stderr, "startRecording %s error\n", opts.record.c_str());
+        return -1;
+    }
+
+    size_t watchCount = spInotifyTool->getWatchCount();
+    eular::DirWalkerStats walkStats = spInotifyTool->getWalkStats();
+
+    // 事件风暴
+    std::vector<std::vector<ExpectedEvent>> expectedVecs(opts.threads);
+    std::vector<std::thread> threadVec;
+    std::atomic<bool> stormDone(false);
+    uint64_t stormBeginNs = NowNs();
+    uint64_t stormEndNs = 0;
+    std::thread stormMain([&] () {
+        for (uint32_t i = 0; i < opts.threads; ++i)
+        {
+            threadVec.emplace_back(StormThread, i, std::cref(opts), std::cref(dirVec), std::ref(expectedVecs[i]));
+        }
+        for (auto &it : threadVec)
+        {
+            it.join();
+        }
+        stormEndNs = NowNs();
+        stormDone.store(true, std::memory_order_release);
+    });
+
+    // 消费事件: 每次读取后统一打时间戳, 与系统调用前的时间戳之差即端到端延迟
+    std::vector<DeliveredEvent> deliveredVec;
+    deliveredVec.reserve(static_cast<size_t>(opts.threads) * opts.ops * 4);
+    uint64_t totalEvents = 0;
+    uint64_t overflowCount = 0;
+    uint64_t readCount = 0;
+    uint64_t lastEventNs = stormBeginNs;
+    std::list<InotifyEventItem> eventItemVec;
+    while (true)
+    {
+        status = spInotifyTool->waitCompleteEvent(50);
+        if (status != Status::OK && status != Status::TIMED_OUT)
+        {
+            fprintf(stderr, "waitCompleteEvent error: %d\n", status);
+            break;
+        }
+
+        uint64_t nowNs = NowNs();
+        size_t count = 0;
+        if (status == Status::OK)
+        {
+            ++readCount;
+            if (opts.batch)
+            {
+                const eular::InotifyEventBatch &batch = spInotifyTool->getEventBatch();
+                for (const auto &it : batch)
+                {
+                    overflowCount += (it.event & EV_IN_Q_OVERFLOW) ? 1 : 0;
+                    deliveredVec.push_back({MakeKey(it.path, it.name, it.event), nowNs});
+                }
+                count = batch.size();
+            }
+            else
+            {
+                eventItemVec.clear();
+                spInotifyTool->getEventItem(eventItemVec);
+                for (const auto &it : eventItemVec)
+                {
+                    overflowCount += (it.event & EV_IN_Q_OVERFLOW) ? 1 : 0;
+                    deliveredVec.push_back({MakeKey(it.path, it.name, it.event), nowNs});
+                }
+                count = eventItemVec.size();
+            }
+        }
+
+        if (count > 0)
+        {
+            totalEvents += count;
+            lastEventNs = nowNs;
+        }
+        else if (stormDone.load(std::memory_order_acquire) && nowNs - std::max(lastEventNs, stormEndNs) >= opts.drainMs * 1000000ull)
+        {
+            break;
+        }
+    }
+    stormMain.join();
+
+    // 离线匹配期望事件与收到的事件, 同一key按先后顺序配对
+    std::unordered_map<std::string, std::deque<uint64_t>> expectedMap;
+    uint64_t expectedCount = 0;
+    for (const auto &vec : expectedVecs)
+    {
+        for (const auto &it : vec)
+        {
+            expectedMap[it.key].push_back(it.ns);
+            ++expectedCount;
+        }
+    }
+
+    // 未配对的事件包括EV_IN_MOVED_OUT等不计延迟的事件
+    std::vector<uint64_t> latencyVec;
+    latencyVec.reserve(expectedCount);
+    uint64_t unmatchedCount = 0;
+    for (const auto &it : deliveredVec)
+    {
+        auto expectedIt = expectedMap.find(it.key);
+        if (expectedIt == expectedMap.end() || expectedIt->second.empty())
+        {
+            ++unmatchedCount;
+            continue;
+        }
+
+        uint64_t sentNs = expectedIt->second.front();
+        expectedIt->second.pop_front();
+        latencyVec.push_back(it.ns > sentNs ? it.ns - sentNs : 0);
+    }
+    std::sort(latencyVec.begin(), latencyVec.end());
+
+    uint64_t matchedCount = latencyVec.size();
+    uint64_t lostCount = expectedCount - matchedCount;
+    uint64_t deliverNs = lastEventNs > stormBeginNs ? lastEventNs - stormBeginNs : 0;
+    uint64_t stormNs = stormEndNs - stormBeginNs;
+    eular::ResyncStats resyncStats = spInotifyTool->getResyncStats();
+    eular::KernelEventStats kernelStats = spInotifyTool->getKernelEventStats();
+    eular::InotifyStats toolStats = spInotifyTool->getStats();
+    eular::InotifyLimits limits = spInotifyTool->getInotifyLimits();
+
+    spInotifyTool->destroyInotify();
+    if (!opts.keep && createdRoot)
+    {
+        RemoveTree(dirVec, opts);
+    }
+
+    FILE *fp = OpenOutput(opts);
+    if (fp == nullptr)
+    {
+        return -1;
+    }
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"config\": {\"depth\": %u, \"fanout\": %u, \"files\": %u, \"threads\": %u, \"ops\": %u, "
+                "\"walk_threads\": %u, \"batch\": %s, \"window_ms\": %u, \"window_events\": %u, "
+                "\"max_queued_events\": %u, \"max_user_watches\": %u},\n",
+        opts.depth, opts.fanout, opts.files, opts.threads, opts.ops, opts.walkThreads,
+        opts.batch ? "true" : "false", opts.windowMs, opts.windowEvents, limits.maxQueuedEvents, limits.maxUserWatches);
+    fprintf(fp, "  \"tree\": {\"dirs\": %zu, \"files\": %lu, \"generate_ms\": %.3f},\n",
+        dirVec.size(), fileCount, generateNs / 1e6);
+    fprintf(fp, "  \"watch\": {\"watches\": %zu, \"polled_dirs\": %zu, \"register_ms\": %.3f, \"us_per_watch\": %.3f, "
+                "\"walk_entries\": %lu, \"walk_stat_calls\": %lu, \"rss_before_kb\": %lu, \"rss_after_kb\": %lu, "
+                "\"rss_bytes_per_watch\": %.1f},\n",
+        watchCount, spInotifyTool->getPolledDirCount(), watchNs / 1e6, watchCount ? watchNs / 1e3 / watchCount : 0.0,
+        walkStats.entries, walkStats.statCalls, rssBefore / 1024, rssAfter / 1024,
+        watchCount ? static_cast<double>(rssAfter > rssBefore ? rssAfter - rssBefore : 0) / watchCount : 0.0);
+    fprintf(fp, "  \"storm\": {\"syscalls\": %lu, \"storm_ms\": %.3f, \"syscalls_per_sec\": %.1f},\n",
+        expectedCount, stormNs / 1e6, stormNs ? expectedCount * 1e9 / stormNs : 0.0);
+    fprintf(fp, "  \"delivery\": {\"events\": %lu, \"reads\": %lu, \"events_per_sec\": %.1f, \"matched\": %lu, "
+                "\"lost\": %lu, \"unmatched\": %lu, \"overflows\": %lu, \"resyncs\": %lu, \"resync_events\": %lu, "
+                "\"kernel_events\": %lu, \"kernel_ignored\": %lu, \"wakeups\": %lu, \"wakeups_per_sec\": %.1f, "
+                "\"syscalls_per_event\": %.4f},\n",
+        totalEvents, readCount, deliverNs ? totalEvents * 1e9 / deliverNs : 0.0, matchedCount,
+        lostCount, unmatchedCount, overflowCount, resyncStats.count, resyncStats.events,
+        kernelStats.events, kernelStats.ignored, kernelStats.wakeups, kernelStats.wakeupsPerSec,
+        kernelStats.syscallsPerEvent);
+    fprintf(fp, "  \"internal\": {\"parse_us_p50\": %.1f, \"parse_us_p99\": %.1f, \"residence_us_p50\": %.1f, "
+                "\"residence_us_p99\": %.1f, \"batch_mean\": %.1f, \"batch_max\": %lu, \"pending_modify\": %zu},\n",
+        toolStats.parseNs.percentile(0.5) / 1e3, toolStats.parseNs.percentile(0.99) / 1e3,
+        toolStats.residenceNs.percentile(0.5) / 1e3, toolStats.residenceNs.percentile(0.99) / 1e3,
+        toolStats.batchSize.mean(), toolStats.batchSize.max, toolStats.pendingModify);
+    fprintf(fp, "  \"latency_us\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f}\n",
+        Percentile(latencyVec, 0.5), Percentile(latencyVec, 0.9), Percentile(latencyVec, 0.99),
+        Percentile(latencyVec, 0.999), Percentile(latencyVec, 1.0));
+    fprintf(fp, "}\n");
+
+    if (fp != stdout)
+    {
+        fclose(fp);
+    }
+
+    return 0;
+}
@@ -0,0 +1,342 @@
+/*************************************************************************
+    > File Name: bench_sha1.cc
+    > Author: hsz
+    > Brief: sha1性能测试: 各实现的单核内存吞吐, 以及HashService并发计算多个文件的吞吐和每核GB/s, 同时校验结果
+    > Created Time: 2026年10月18日 星期日 04时48分05秒
+ ************************************************************************/
+
+#include "httpd/sha1.h"
+#include "httpd/hash_service.h"
+
+#include <utils/errors.h>
+#include <log/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <string>
+#include <vector>
+#include <future>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#define LOG_TAG "Bench-Sha1"
+
+struct BenchOptions
+{
+    std::string root;               // 测试目录, 为空时在/tmp下创建
+    uint32_t    memMB = 256;        // 内存吞吐测试的数据量
+    uint32_t    files = 64;         // 文件数
+    uint32_t    fileMB = 16;        // 平均文件大小, 实际大小在0.5~1.5倍之间随机
+    uint32_t    threads = 0;        // HashService线程数, 0为CPU核数
+    uint32_t    readKB = 1024;      // 每次读取的大小
+    bool        keep = false;       // 保留测试文件
+};
+
+struct CpuClock
+{
+    double  wall = 0;
+    double  cpu = 0;
+};
+
+static CpuClock Now()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    CpuClock clock;
+    clock.wall = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    clock.cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    return clock;
+}
+
+static std::string HashScalar(const uint8_t *data, size_t size)
+{
+    eular::Sha1 sha1(eular::Sha1Backend::SCALAR);
+    sha1.update(data, size);
+    return sha1.finalHex(true);
+}
+
+/**
+ * @brief 单线程内存吞吐. 八路实现将数据均分为8段同时计算
+ *
+ * @return 是否与标量结果一致
+ */
+static bool BenchMemory(eular::Sha1Backend backend, const std::vector<uint8_t> &data)
+{
+    std::vector<std::string> hashVec;
+    size_t laneSize = data.size() / SHA1_MB_LANES / SHA1_BLOCK_SIZE * SHA1_BLOCK_SIZE;
+    CpuClock begin = Now();
+    if (backend == eular::Sha1Backend::AVX2_MB)
+    {
+        alignas(32) uint32_t state[5][SHA1_MB_LANES];
+        const uint8_t *dataVec[SHA1_MB_LANES];
+        for (uint32_t lane = 0; lane < SHA1_MB_LANES; ++lane)
+        {
+            uint32_t laneState[5];
+            eular::Sha1Init(laneState);
+            for (int32_t i = 0; i < 5; ++i)
+            {
+                state[i][lane] = laneState[i];
+            }
+            dataVec[lane] = data.data() + lane * laneSize;
+        }
+
+        eular::Sha1CompressX8(state, dataVec, laneSize / SHA1_BLOCK_SIZE);
+        for (uint32_t lane = 0; lane < SHA1_MB_LANES; ++lane)
+        {
+            uint32_t laneState[5];
+            uint8_t digest[SHA1_DIGEST_SIZE];
+            for (int32_t i = 0; i < 5; ++i)
+            {
+                laneState[i] = state[i][lane];
+            }
+            eular::Sha1Finish(backend, laneState, nullptr, 0, laneSize, digest);
+            hashVec.push_back(eular::Sha1Hex(digest, true));
+        }
+    }
+    else
+    {
+        eular::Sha1 sha1(backend);
+        sha1.update(data.data(), data.size());
+        hashVec.push_back(sha1.finalHex(true));
+    }
+    CpuClock end = Now();
+
+    bool ok = true;
+    size_t bytes = data.size();
+    if (backend == eular::Sha1Backend::AVX2_MB)
+    {
+        bytes = laneSize * SHA1_MB_LANES;
+        for (uint32_t lane = 0; lane < SHA1_MB_LANES; ++lane)
+        {
+            ok &= hashVec[lane] == HashScalar(data.data() + lane * laneSize, laneSize);
+        }
+    }
+    else if (backend != eular::Sha1Backend::SCALAR)
+    {
+        ok = hashVec.front() == HashScalar(data.data(), data.size());
+    }
+
+    double seconds = end.wall - begin.wall;
+    printf("memory  %-8s %8.1f MB %8.3f s %8.3f GB/s/core  %s\n", eular::Sha1BackendName(backend), bytes / 1048576.0,
+        seconds, bytes / seconds / 1e9, ok ? "OK" : "MISMATCH");
+    return ok;
+}
+
+/**
+ * @brief HashService并发计算所有文件
+ */
+static bool BenchService(const BenchOptions &opts, eular::Sha1Backend backend, bool useMmap,
+                         const std::vector<std::string> &pathVec, const std::vector<std::string> &expectVec)
+{
+    eular::HashOptions options;
+    options.threads = opts.threads;
+    options.read_size = opts.readKB * 1024;
+    options.use_mmap = useMmap;
+    options.backend = backend;
+    eular::HashService service(options);
+    service.start();
+
+    CpuClock begin = Now();
+    std::vector<std::future<eular::HashResult>> futureVec;
+    for (const auto &path : pathVec)
+    {
+        futureVec.push_back(service.submit(path));
+    }
+
+    bool ok = true;
+    uint64_t bytes = 0;
+    double maxLatency = 0;
+    for (size_t i = 0; i < futureVec.size(); ++i)
+    {
+        eular::HashResult result = futureVec[i].get();
+        ok &= result.status == NO_ERROR && result.content_hash == expectVec[i];
+        bytes += result.size;
+        maxLatency = std::max(maxLatency, result.elapsed_us / 1e6);
+    }
+    CpuClock end = Now();
+    service.stop();
+
+    double wall = end.wall - begin.wall;
+    double cpu = std::max(end.cpu - begin.cpu, 1e-9);
+    eular::HashService::Stats stats = service.stats();
+    printf("service %-8s %-5s %2u threads %8.1f MB %8.3f s %8.3f GB/s %8.3f GB/s/core", eular::Sha1BackendName(service.backend()),
+        useMmap ? "mmap" : "read", service.threads(), bytes / 1048576.0, wall, bytes / wall / 1e9, bytes / cpu / 1e9);
+    if (stats.mb_blocks > 0)
+    {
+        printf("  lanes %.2f/%d", static_cast<double>(stats.mb_lane_blocks) / stats.mb_blocks, SHA1_MB_LANES);
+    }
+    printf("  max latency %.3f s  %s\n", maxLatency, ok ? "OK" : "MISMATCH");
+    return ok;
+}
+
+static void Usage(const char *prog)
+{
+    printf("usage: %s [options]\n"
+           "  -r, --root DIR          test directory (default: mkdtemp under /tmp)\n"
+           "  -m, --mem MB            in-memory data per backend (default: 256)\n"
+           "  -n, --files N           number of files hashed by the service (default: 64)\n"
+           "  -s, --size MB           average file size, each file is 0.5x~1.5x (default: 16)\n"
+           "  -t, --threads N         hash service threads (default: number of cores)\n"
+           "  -b, --read-kb N         read size in KB (default: 1024)\n"
+           "  -k, --keep              keep the generated files\n"
+           "  -h, --help\n", prog);
+}
+
+static bool ParseOptions(int argc, char *argv[], BenchOptions &opts)
+{
+    static const struct option longOptions[] = {
+        {"root",    required_argument, nullptr, 'r'},
+        {"mem",     required_argument, nullptr, 'm'},
+        {"files",   required_argument, nullptr, 'n'},
+        {"size",    required_argument, nullptr, 's'},
+        {"threads", required_argument, nullptr, 't'},
+        {"read-kb", required_argument, nullptr, 'b'},
+        {"keep",    no_argument,       nullptr, 'k'},
+        {"help",    no_argument,       nullptr, 'h'},
+        {nullptr,   0,                 nullptr, 0},
+    };
+
+    int32_t opt = 0;
+    while ((opt = getopt_long(argc, argv, "r:m:n:s:t:b:kh", longOptions, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'r': opts.root = optarg; break;
+        case 'm': opts.memMB = std::max(1ul, strtoul(optarg, nullptr, 10)); break;
+        case 'n': opts.files = strtoul(optarg, nullptr, 10); break;
+        case 's': opts.fileMB = std::max(1ul, strtoul(optarg, nullptr, 10)); break;
+        case 't': opts.threads = strtoul(optarg, nullptr, 10); break;
+        case 'b': opts.readKB = std::max(4ul, strtoul(optarg, nullptr, 10)); break;
+        case 'k': opts.keep = true; break;
+        default:
+            Usage(argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions opts;
+    if (!ParseOptions(argc, argv, opts))
+    {
+        return 0;
+    }
+
+    printf("cpu: sha-ni %s, avx2 %s, auto => %s\n", eular::Sha1HasShaNi() ? "yes" : "no",
+        eular::Sha1HasAvx2() ? "yes" : "no", eular::Sha1BackendName(eular::Sha1ResolveBackend(eular::Sha1Backend::AUTO)));
+
+    std::vector<eular::Sha1Backend> backendVec = { eular::Sha1Backend::SCALAR };
+    if (eular::Sha1HasShaNi())
+    {
+        backendVec.push_back(eular::Sha1Backend::SHANI);
+    }
+    if (eular::Sha1HasAvx2())
+    {
+        backendVec.push_back(eular::Sha1Backend::AVX2_MB);
+    }
+
+    // 1、单核内存吞吐
+    std::mt19937_64 random(20261018);
+    std::vector<uint8_t> data(static_cast<size_t>(opts.memMB) * 1024 * 1024 + 1234);
+    for (auto &byte : data)
+    {
+        byte = static_cast<uint8_t>(random());
+    }
+
+    bool ok = true;
+    for (auto backend : backendVec)
+    {
+        ok &= BenchMemory(backend, data);
+    }
+    data.clear();
+    data.shrink_to_fit();
+
+    // 2、生成大小不一的文件, 覆盖尾块不足64字节和多缓冲各路长度不等的情况
+    bool createdRoot = false;
+    if (opts.root.empty())
+    {
+        char tmpl[] = "/tmp/bench_sha1_XXXXXX";
+        if (mkdtemp(tmpl) == nullptr)
+        {
+            perror("mkdtemp error");
+            return -1;
+        }
+        opts.root = tmpl;
+        createdRoot = true;
+    }
+    else if (mkdir(opts.root.c_str(), 0755) == 0)
+    {
+        createdRoot = true;
+    }
+    if (opts.root.back() != '/')
+    {
+        opts.root.push_back('/');
+    }
+
+    std::vector<std::string> pathVec;
+    std::vector<std::string> expectVec;
+    uint64_t totalBytes = 0;
+    uint64_t averageSize = static_cast<uint64_t>(opts.fileMB) * 1024 * 1024;
+    for (uint32_t i = 0; i < opts.files; ++i)
+    {
+        size_t size = static_cast<size_t>(averageSize / 2 + random() % (averageSize + 1) + random() % SHA1_BLOCK_SIZE);
+        if (i == 0)
+        {
+            size = 0;
+        }
+
+        std::vector<uint8_t> content(size);
+        for (auto &byte : content)
+        {
+            byte = static_cast<uint8_t>(random());
+        }
+
+        std::string path = opts.root + "file_" + std::to_string(i);
+        int32_t fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || (size > 0 && ::write(fd, content.data(), size) != static_cast<ssize_t>(size)))
+        {
+            perror("write error");
+            return -1;
+        }
+        ::close(fd);
+
+        pathVec.push_back(path);
+        expectVec.push_back(HashScalar(content.data(), content.size()));
+        totalBytes += size;
+    }
+    printf("files: %u, %.1f MB in %s (page cache warm)\n", opts.files, totalBytes / 1048576.0, opts.root.c_str());
+
+    // 3、HashService吞吐
+    for (auto backend : backendVec)
+    {
+        ok &= BenchService(opts, backend, false, pathVec, expectVec);
+        ok &= BenchService(opts, backend, true, pathVec, expectVec);
+    }
+
+    if (!opts.keep)
+    {
+        for (const auto &path : pathVec)
+        {
+            ::unlink(path.c_str());
+        }
+        if (createdRoot)
+        {
+            ::rmdir(opts.root.c_str());
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,356 @@
+/*************************************************************************
+    > File Name: test_download.cc
+    > Author: hsz
+    > Brief: 下载流水线测试: 本地模拟getDownloadUrl及文件GET接口, 校验多个小文件, 拆分成多个区间的大文件以及中断后续传的文件下载后内容一致
+    > Created Time: 2026年10月18日 星期日 11时26分07秒
+ ************************************************************************/
+
+#include "httpd/sync_thread.h"
+#include "httpd/global_resource_management.h"
+#include "httpd/api_config.h"
+
+#include <hv/HttpServer.h>
+#include <hv/hv.h>
+
+#include <utils/errors.h>
+#include <log/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
+
+#define LOG_TAG "Test-Download"
+
+#define TEST_PORT           18651
+#define TEST_TOKEN_TYPE     "Bearer"
+#define TEST_ACCESS_TOKEN   "test-access-token"
+#define TEST_DIR            "/tmp/test_download/"
+#define TEST_WAIT_MS        30000
+#define TEST_LARGE_SIZE     (96 * 1024 * 1024 + 12345)  // 大于两倍最小区间(32MB), 拆成多个区间
+#define TEST_BLOCK_SIZE     (4 * 1024 * 1024)           // 断点状态的块大小
+#define TEST_FAIL_FROM      (32 * 1024 * 1024)          // 续传测试中第一次下载从该位置开始的请求失败, 只有第一个区间成功
+#define TEST_FAIL_DELAY_MS  300
+
+/**
+ * @brief 模拟云盘的下载接口. 文件以file_id为键, GET支持单个Range
+ */
+class LocalCloud
+{
+public:
+    struct Request {
+        std::string file_id;
+        uint64_t    begin = 0;
+        uint64_t    end = 0;    // 不含
+        bool        range = false;
+    };
+
+    void registerRouter(hv::HttpService &router)
+    {
+        router.POST(OPENAPI_FILE_DOWNLOAD_URL, [this] (HttpRequest *req, HttpResponse *resp) {
+            return this->getDownloadUrl(req, resp);
+        });
+        router.GET("/file/:file_id", [this] (HttpRequest *req, HttpResponse *resp) {
+            return this->getFile(req, resp);
+        });
+    }
+
+    int32_t getDownloadUrl(HttpRequest *req, HttpResponse *resp)
+    {
+        if (req->GetHeader("Authorization") != TEST_TOKEN_TYPE " " TEST_ACCESS_TOKEN) {
+            return HTTP_STATUS_UNAUTHORIZED;
+        }
+
+        nlohmann::json body = nlohmann::json::parse(req->body);
+        std::string fileId = body["file_id"].get<std::string>();
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = files.find(fileId);
+        if (it == files.end()) {
+            return HTTP_STATUS_NOT_FOUND;
+        }
+
+        resp->Json(nlohmann::json{{"url", "http://127.0.0.1:" + std::to_string(TEST_PORT) + "/file/" + fileId},
+            {"size", it->second.size()}, {"method", "GET"}});
+        return HTTP_STATUS_OK;
+    }
+
+    int32_t getFile(HttpRequest *req, HttpResponse *resp)
+    {
+        // 模拟服务端故障: 从fail_from开始的请求延迟后失败, 使之前的区间先完成
+        unsigned long long begin = 0;
+        sscanf(req->GetHeader("Range").c_str(), "bytes=%llu-", &begin);
+        if (begin >= failFrom.load()) {
+            ++failedRequests;
+            std::this_thread::sleep_for(std::chrono::milliseconds(TEST_FAIL_DELAY_MS));
+            return HTTP_STATUS_SERVICE_UNAVAILABLE;
+        }
+
+        Request request;
+        request.file_id = req->GetParam("file_id");
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = files.find(request.file_id);
+        if (it == files.end()) {
+            return HTTP_STATUS_NOT_FOUND;
+        }
+
+        const std::string &content = it->second;
+        request.end = content.size();
+        std::string range = req->GetHeader("Range");
+        if (!range.empty()) {
+            unsigned long long begin = 0;
+            unsigned long long last = 0;
+            int32_t count = sscanf(range.c_str(), "bytes=%llu-%llu", &begin, &last);
+            if (count < 1 || begin >= content.size()) {
+                return HTTP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE;
+            }
+            request.begin = begin;
+            request.end = count == 2 ? std::min<uint64_t>(last + 1, content.size()) : content.size();
+            request.range = true;
+        }
+        requestVec.push_back(request);
+
+        resp->body = content.substr(request.begin, request.end - request.begin);
+        if (!request.range) {
+            return HTTP_STATUS_OK;
+        }
+
+        resp->SetHeader("Content-Range", "bytes " + std::to_string(request.begin) + "-" +
+            std::to_string(request.end - 1) + "/" + std::to_string(content.size()));
+        return HTTP_STATUS_PARTIAL_CONTENT;
+    }
+
+    std::mutex  mutex;
+    std::map<std::string, std::string>  files;      // file_id -> 内容
+    std::vector<Request>                requestVec; // 收到的文件GET请求, 不含模拟失败的请求
+    std::atomic<uint64_t>   failFrom{UINT64_MAX};
+    std::atomic<uint32_t>   failedRequests{0};
+};
+
+static std::string RandomContent(std::mt19937_64 &random, size_t size)
+{
+    std::string content(size, '\0');
+    for (char &c : content) {
+        c = static_cast<char>(random());
+    }
+    return content;
+}
+
+static std::string ReadFile(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+/**
+ * @brief 等待下载完成或失败的文件数达到count
+ */
+static bool Wait(eular::SyncThread &syncThread, uint64_t count)
+{
+    for (uint32_t waitMs = 0; waitMs < TEST_WAIT_MS; waitMs += 10) {
+        eular::SyncThread::Stats stats = syncThread.stats();
+        if (stats.files + stats.failed_files >= count) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    printf("wait for %" PRIu64 " files timeout\n", count);
+    return false;
+}
+
+static eular::FileDownloadItemNode Item(const std::string &fileId, const std::string &name)
+{
+    eular::FileDownloadItemNode item;
+    item.drive_id = "drive";
+    item.file_id = fileId.c_str();
+    item.file_path = TEST_DIR;
+    item.file_name = name.c_str();
+    return item;
+}
+
+/**
+ * @brief 多个小文件依次经过网络阶段和I/O阶段, 每个文件一个不带Range的请求
+ */
+static bool RunPipeline(LocalCloud &cloud, std::mt19937_64 &random)
+{
+    const size_t sizeArray[] = {1, 4096, 1024 * 1024, 1024 * 1024 + 7, 3 * 1024 * 1024 + 12345, 5 * 1024 * 1024};
+    const size_t count = sizeof(sizeArray) / sizeof(sizeArray[0]);
+    {
+        std::lock_guard<std::mutex> lock(cloud.mutex);
+        cloud.requestVec.clear();
+        for (size_t i = 0; i < count; ++i) {
+            cloud.files["pipeline-" + std::to_string(i)] = RandomContent(random, sizeArray[i]);
+        }
+    }
+
+    eular::SyncThread syncThread("http://127.0.0.1:" + std::to_string(TEST_PORT));
+    syncThread.start();
+    for (size_t i = 0; i < count; ++i) {
+        syncThread.enqueue(Item("pipeline-" + std::to_string(i), "pipeline_" + std::to_string(i)));
+    }
+    bool ok = Wait(syncThread, count);
+    syncThread.stop();
+
+    eular::SyncThread::Stats stats = syncThread.stats();
+    ok &= stats.files == count && stats.failed_files == 0 && stats.bytes_received == stats.bytes_written;
+
+    std::lock_guard<std::mutex> lock(cloud.mutex);
+    ok &= cloud.requestVec.size() == count;
+    for (const auto &request : cloud.requestVec) {
+        ok &= !request.range;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        std::string path = TEST_DIR "pipeline_" + std::to_string(i);
+        ok &= ReadFile(path) == cloud.files["pipeline-" + std::to_string(i)];
+        ok &= access((path + ".download").c_str(), F_OK) != 0;
+    }
+
+    printf("%-24s files=%" PRIu64 " failed=%" PRIu64 " requests=%zu bytes=%" PRIu64 " push_waits=%" PRIu64 " %s\n",
+        "pipeline", stats.files, stats.failed_files, cloud.requestVec.size(), stats.bytes_written,
+        stats.content_queue.pushWaits, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+/**
+ * @brief 大于两倍最小区间的文件拆成多个区间并发Range请求, 各区间拼接后与原文件一致
+ */
+static bool RunRangeSplit(LocalCloud &cloud, std::mt19937_64 &random)
+{
+    {
+        std::lock_guard<std::mutex> lock(cloud.mutex);
+        cloud.requestVec.clear();
+        cloud.files["range"] = RandomContent(random, TEST_LARGE_SIZE);
+    }
+
+    eular::SyncThread syncThread("http://127.0.0.1:" + std::to_string(TEST_PORT));
+    syncThread.start();
+    syncThread.enqueue(Item("range", "range"));
+    bool ok = Wait(syncThread, 1);
+    syncThread.stop();
+
+    eular::SyncThread::Stats stats = syncThread.stats();
+    ok &= stats.files == 1 && stats.failed_files == 0 && stats.bytes_written == TEST_LARGE_SIZE;
+
+    // 每个请求都是Range请求, 合起来覆盖整个文件
+    std::lock_guard<std::mutex> lock(cloud.mutex);
+    std::vector<std::pair<uint64_t, uint64_t>> rangeVec;
+    for (const auto &request : cloud.requestVec) {
+        ok &= request.range;
+        rangeVec.emplace_back(request.begin, request.end);
+    }
+    std::sort(rangeVec.begin(), rangeVec.end());
+    ok &= rangeVec.size() >= 2 && rangeVec.front().first == 0 && rangeVec.back().second == TEST_LARGE_SIZE;
+    ok &= ReadFile(TEST_DIR "range") == cloud.files["range"];
+
+    printf("%-24s requests=%zu bytes=%" PRIu64 " connections=%u %s\n", "range split", cloud.requestVec.size(),
+        stats.bytes_written, stats.connections, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+/**
+ * @brief 第一次下载只完成第一个区间, 保留临时文件和断点状态; 损坏其中一块后第二次下载只请求损坏的块和未完成的区间
+ */
+static bool RunResume(LocalCloud &cloud, std::mt19937_64 &random)
+{
+    {
+        std::lock_guard<std::mutex> lock(cloud.mutex);
+        cloud.requestVec.clear();
+        cloud.files["resume"] = RandomContent(random, TEST_LARGE_SIZE);
+    }
+
+    cloud.failFrom = TEST_FAIL_FROM;
+    cloud.failedRequests = 0;
+    eular::SyncThread first("http://127.0.0.1:" + std::to_string(TEST_PORT));
+    first.start();
+    first.enqueue(Item("resume", "resume"));
+    bool ok = Wait(first, 1);
+    first.stop();
+
+    std::string tempPath = TEST_DIR "resume.download";
+    eular::SyncThread::Stats stats = first.stats();
+    uint64_t completed = stats.bytes_written;  // 第一个区间, 按块对齐
+    bool kept = access(tempPath.c_str(), F_OK) == 0 && access((tempPath + ".state").c_str(), F_OK) == 0;
+    ok &= stats.failed_files == 1 && cloud.failedRequests > 0 && kept && access(TEST_DIR "resume", F_OK) != 0 &&
+          completed >= 2 * TEST_BLOCK_SIZE && completed % TEST_BLOCK_SIZE == 0;
+    printf("%-24s failed=%" PRIu64 " failed_requests=%u bytes=%" PRIu64 " kept=%d %s\n", "resume: interrupted",
+        stats.failed_files, cloud.failedRequests.load(), stats.bytes_written, kept, ok ? "OK" : "FAILED");
+    if (!ok) {
+        return false;
+    }
+
+    // 损坏第二块的一个字节, 校验失败的块重新下载
+    FILE *fp = fopen(tempPath.c_str(), "r+b");
+    fseek(fp, TEST_BLOCK_SIZE + 100, SEEK_SET);
+    fputc(~cloud.files["resume"][TEST_BLOCK_SIZE + 100], fp);
+    fclose(fp);
+
+    {
+        std::lock_guard<std::mutex> lock(cloud.mutex);
+        cloud.requestVec.clear();
+    }
+    cloud.failFrom = UINT64_MAX;
+    eular::SyncThread second("http://127.0.0.1:" + std::to_string(TEST_PORT));
+    second.start();
+    second.enqueue(Item("resume", "resume"));
+    ok = Wait(second, 1);
+    second.stop();
+
+    // 第一块和[2块, completed)已校验, 不再请求
+    stats = second.stats();
+    uint64_t expectBytes = TEST_LARGE_SIZE - completed + TEST_BLOCK_SIZE;
+    ok &= stats.files == 1 && stats.failed_files == 0 && stats.bytes_received == expectBytes;
+
+    std::lock_guard<std::mutex> lock(cloud.mutex);
+    for (const auto &request : cloud.requestVec) {
+        ok &= request.range && !(request.begin < TEST_BLOCK_SIZE) &&
+              !(request.begin < completed && request.end > 2 * TEST_BLOCK_SIZE);
+    }
+    ok &= ReadFile(TEST_DIR "resume") == cloud.files["resume"];
+    ok &= access(tempPath.c_str(), F_OK) != 0 && access((tempPath + ".state").c_str(), F_OK) != 0;
+
+    printf("%-24s requests=%zu bytes=%" PRIu64 " expect=%" PRIu64 " %s\n", "resume: continued",
+        cloud.requestVec.size(), stats.bytes_received, expectBytes, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+int main()
+{
+    LocalCloud cloud;
+    hv::HttpService router;
+    cloud.registerRouter(router);
+    hv::HttpServer server;
+    server.registerHttpService(&router);
+    server.setPort(TEST_PORT);
+    server.setThreadNum(8);
+    server.start();
+
+    eular::GlobalResourceInstance::Get()->token_type = TEST_TOKEN_TYPE;
+    eular::GlobalResourceInstance::Get()->token = TEST_ACCESS_TOKEN;
+
+    std::filesystem::remove_all(TEST_DIR);
+    std::mt19937_64 random(42);
+    bool ok = true;
+    ok &= RunPipeline(cloud, random);
+    ok &= RunRangeSplit(cloud, random);
+    ok &= RunResume(cloud, random);
+
+    std::filesystem::remove_all(TEST_DIR);
+    server.stop();
+    return ok ? 0 : 1;
+}
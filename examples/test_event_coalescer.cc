@@ -0,0 +1,214 @@
+/*************************************************************************
+    > File Name: test_event_coalescer.cc
+    > Author: hsz
+    > Brief: 事件合并规则测试, 使用固定的时间调用push/drain, 结果确定
+    > Created Time: 2026年10月18日 星期日 10时05分18秒
+ ************************************************************************/
+
+#include "inotify_tool/event_coalescer.h"
+#include "inotify_tool/inotify_event.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <list>
+
+#define QUIET_WINDOW_MS 100
+#define PUSH_MS         1000
+#define DRAIN_MS        (PUSH_MS + QUIET_WINDOW_MS)
+
+struct Expected
+{
+    uint32_t    event;
+    std::string path;       // path + name
+    std::string fromPath;   // fromPath + fromName, EV_IN_MOVE时
+};
+
+static InotifyEventItem Item(uint32_t event, const char *path, const char *name, uint32_t cookie = 0,
+                             const char *fromPath = "", const char *fromName = "")
+{
+    InotifyEventItem item;
+    item.event = event;
+    item.path = path;
+    item.name = name;
+    item.cookie = cookie;
+    item.fromPath = fromPath;
+    item.fromName = fromName;
+    return item;
+}
+
+static bool Expect(const char *caseName, const std::list<InotifyEventItem> &eventList, const std::vector<Expected> &expectVec)
+{
+    bool ok = eventList.size() == expectVec.size();
+    auto it = eventList.begin();
+    for (size_t i = 0; ok && i < expectVec.size(); ++i, ++it)
+    {
+        ok = it->event == expectVec[i].event && it->path + it->name == expectVec[i].path &&
+             it->fromPath + it->fromName == expectVec[i].fromPath;
+    }
+
+    printf("%-40s %s\n", caseName, ok ? "OK" : "FAILED");
+    if (!ok)
+    {
+        for (const auto &item : eventList)
+        {
+            printf("    got    %s %s%s <- %s%s\n", Event2String(item.event).c_str(), item.path.c_str(), item.name.c_str(),
+                   item.fromPath.c_str(), item.fromName.c_str());
+        }
+        for (const auto &expect : expectVec)
+        {
+            printf("    expect %s %s <- %s\n", Event2String(expect.event).c_str(), expect.path.c_str(), expect.fromPath.c_str());
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief 同一时间输入所有事件, 静默后取出
+ */
+static bool Run(const char *caseName, std::list<InotifyEventItem> inputList, const std::vector<Expected> &expectVec)
+{
+    eular::EventCoalescer coalescer(QUIET_WINDOW_MS);
+    coalescer.push(inputList, PUSH_MS);
+
+    std::list<InotifyEventItem> outputList;
+    coalescer.drain(outputList, DRAIN_MS);
+    return Expect(caseName, outputList, expectVec);
+}
+
+static bool RunQuietWindow()
+{
+    eular::EventCoalescer coalescer(QUIET_WINDOW_MS);
+    std::list<InotifyEventItem> inputList = { Item(EV_IN_MODIFY_OVER, "/r/", "a") };
+    coalescer.push(inputList, PUSH_MS);
+
+    // 静默期间的修改推迟输出
+    std::list<InotifyEventItem> outputList;
+    coalescer.drain(outputList, DRAIN_MS - 1);
+    bool ok = Expect("quiet window: not yet quiet", outputList, {});
+    ok &= coalescer.nextTimeout(DRAIN_MS - 1) == 1;
+
+    inputList = { Item(EV_IN_MODIFY_OVER, "/r/", "a") };
+    coalescer.push(inputList, DRAIN_MS - 1);
+    coalescer.drain(outputList, DRAIN_MS);
+    ok &= Expect("quiet window: extended by new event", outputList, {});
+
+    coalescer.drain(outputList, DRAIN_MS - 1 + QUIET_WINDOW_MS);
+    ok &= Expect("quiet window: quiet", outputList, {
+        {EV_IN_MODIFY_OVER, "/r/a", ""},
+    });
+    return ok && coalescer.pending() == 0 && coalescer.nextTimeout(DRAIN_MS + QUIET_WINDOW_MS) == -1;
+}
+
+int main()
+{
+    bool ok = true;
+    ok &= Run("create + delete", {
+        Item(EV_IN_CREATE, "/r/", "a"),
+        Item(EV_IN_MODIFY_OVER, "/r/", "a"),
+        Item(EV_IN_DELETE, "/r/", "a"),
+    }, {});
+
+    ok &= Run("modify x3", {
+        Item(EV_IN_MODIFY_OVER, "/r/", "a"),
+        Item(EV_IN_CLOSE_WRITE, "/r/", "a"),
+        Item(EV_IN_MODIFY_OVER, "/r/", "a"),
+    }, {
+        {EV_IN_MODIFY_OVER, "/r/a", ""},
+    });
+
+    ok &= Run("rename chain", {
+        Item(EV_IN_MOVE, "/r/", "b", 1, "/r/", "a"),
+        Item(EV_IN_MOVE, "/r/", "c", 2, "/r/", "b"),
+    }, {
+        {EV_IN_MOVE, "/r/c", "/r/a"},
+    });
+
+    ok &= Run("rename chain, unpaired input", {
+        Item(EV_IN_MOVED_OUT, "/r/", "a", 1),
+        Item(EV_IN_MOVED_IN, "/r/", "b", 1),
+        Item(EV_IN_MOVED_OUT, "/r/", "b", 2),
+        Item(EV_IN_MOVED_IN, "/r/", "c", 2),
+    }, {
+        {EV_IN_MOVE, "/r/c", "/r/a"},
+    });
+
+    ok &= Run("rename back", {
+        Item(EV_IN_MOVE, "/r/", "b", 1, "/r/", "a"),
+        Item(EV_IN_MOVE, "/r/", "a", 2, "/r/", "b"),
+    }, {});
+
+    ok &= Run("rename, modify, rename back", {
+        Item(EV_IN_MOVE, "/r/", "b", 1, "/r/", "a"),
+        Item(EV_IN_MODIFY_OVER, "/r/", "b"),
+        Item(EV_IN_MOVE, "/r/", "a", 2, "/r/", "b"),
+    }, {
+        {EV_IN_MODIFY_OVER, "/r/a", ""},
+    });
+
+    ok &= Run("editor save", {
+        Item(EV_IN_CREATE, "/r/", "a.tmp"),
+        Item(EV_IN_MODIFY_OVER, "/r/", "a.tmp"),
+        Item(EV_IN_MOVED_OUT, "/r/", "a.tmp", 7),
+        Item(EV_IN_MOVED_IN, "/r/", "a", 7),
+    }, {
+        {EV_IN_CREATE, "/r/a", ""},
+    });
+
+    ok &= Run("copy then modify", {
+        Item(EV_IN_CREATE | EV_IN_COPY, "/r/", "b", 0, "/r/", "a"),
+        Item(EV_IN_MODIFY_OVER, "/r/", "b"),
+    }, {
+        {EV_IN_CREATE, "/r/b", ""},
+    });
+
+    ok &= Run("copy", {
+        Item(EV_IN_CREATE | EV_IN_COPY, "/r/", "b", 0, "/r/", "a"),
+    }, {
+        {EV_IN_CREATE | EV_IN_COPY, "/r/b", "/r/a"},
+    });
+
+    ok &= Run("delete then recreate", {
+        Item(EV_IN_DELETE, "/r/", "a"),
+        Item(EV_IN_CREATE, "/r/", "a"),
+    }, {
+        {EV_IN_MODIFY_OVER, "/r/a", ""},
+    });
+
+    ok &= Run("dir create + child + rm", {
+        Item(EV_IN_CREATE | EV_IN_ISDIR, "/r/", "d"),
+        Item(EV_IN_CREATE, "/r/d/", "f"),
+        Item(EV_IN_DELETE, "/r/d/", "f"),
+        Item(EV_IN_DELETE | EV_IN_ISDIR, "/r/", "d"),
+    }, {});
+
+    // 就绪队列中的无关事件不应让已抵消的目录输出删除
+    ok &= Run("overflow, then dir create + rm", {
+        Item(EV_IN_Q_OVERFLOW, "", ""),
+        Item(EV_IN_CREATE | EV_IN_ISDIR, "/r/", "d"),
+        Item(EV_IN_DELETE | EV_IN_ISDIR, "/r/", "d"),
+    }, {
+        {EV_IN_Q_OVERFLOW, "", ""},
+    });
+
+    ok &= Run("dir create, leftover child event, rm", {
+        Item(EV_IN_CREATE | EV_IN_ISDIR, "/r/", "d"),
+        Item(EV_IN_MODIFY_OVER, "/r/d/", "f"),
+        Item(EV_IN_DELETE | EV_IN_ISDIR, "/r/", "d"),
+    }, {
+        {EV_IN_MODIFY_OVER, "/r/d/f", ""},
+        {EV_IN_DELETE | EV_IN_ISDIR, "/r/d", ""},
+    });
+
+    ok &= Run("dir rename flushes children first", {
+        Item(EV_IN_MODIFY_OVER, "/r/d/", "f"),
+        Item(EV_IN_MOVE | EV_IN_ISDIR, "/r/", "e", 3, "/r/", "d"),
+    }, {
+        {EV_IN_MODIFY_OVER, "/r/d/f", ""},
+        {EV_IN_MOVE | EV_IN_ISDIR, "/r/e", "/r/d"},
+    });
+
+    ok &= RunQuietWindow();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/*************************************************************************
+    > File Name: test_event_dispatcher.cc
+    > Author: hsz
+    > Brief: 事件订阅测试: 队列满时各溢出策略保留的事件和统计, 以及满队列的订阅者不影响其他订阅者
+    > Created Time: 2026年10月18日 星期日 12时47分26秒
+ ************************************************************************/
+
+#include "inotify_tool/event_dispatcher.h"
+#include "inotify_tool/event_batch.h"
+#include "inotify_tool/inotify_event.h"
+
+#include <utils/errors.h>
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <list>
+
+#define TEST_CAPACITY   4
+#define TEST_EVENTS     10
+
+struct Expected
+{
+    uint32_t    event;
+    std::string path;   // path + name
+};
+
+static bool Expect(const char *caseName, const std::list<InotifyEventItem> &eventList, const std::vector<Expected> &expectVec)
+{
+    bool ok = eventList.size() == expectVec.size();
+    auto it = eventList.begin();
+    for (size_t i = 0; ok && i < expectVec.size(); ++i, ++it)
+    {
+        ok = it->event == expectVec[i].event && it->path + it->name == expectVec[i].path;
+    }
+
+    printf("%-40s %s\n", caseName, ok ? "OK" : "FAILED");
+    if (!ok)
+    {
+        for (const auto &item : eventList)
+        {
+            printf("    got    %s %s%s\n", Event2String(item.event).c_str(), item.path.c_str(), item.name.c_str());
+        }
+        for (const auto &expect : expectVec)
+        {
+            printf("    expect %s %s\n", Event2String(expect.event).c_str(), expect.path.c_str());
+        }
+    }
+    return ok;
+}
+
+static bool ExpectStats(const char *caseName, const eular::Subscription::Stats &stats, uint64_t delivered, uint64_t dropped,
+                        uint64_t overflows)
+{
+    bool ok = stats.delivered == delivered && stats.dropped == dropped && stats.overflows == overflows;
+    if (!ok)
+    {
+        printf("    %s: delivered %llu, dropped %llu, overflows %llu, expect %llu %llu %llu\n", caseName,
+               (unsigned long long)stats.delivered, (unsigned long long)stats.dropped, (unsigned long long)stats.overflows,
+               (unsigned long long)delivered, (unsigned long long)dropped, (unsigned long long)overflows);
+    }
+    return ok;
+}
+
+/**
+ * @brief /r/0 ~ /r/(count - 1)的修改事件
+ */
+static void MakeBatch(eular::InotifyEventBatch &batch, uint32_t count)
+{
+    batch.clear();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        batch.push(EV_IN_MODIFY_OVER, 0, "/r/", std::to_string(i));
+    }
+}
+
+static std::vector<Expected> Range(uint32_t begin, uint32_t end)
+{
+    std::vector<Expected> expectVec;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        expectVec.push_back({EV_IN_MODIFY_OVER, "/r/" + std::to_string(i)});
+    }
+    return expectVec;
+}
+
+/**
+ * @brief 一次分发超过容量的事件后取走
+ */
+static bool RunPolicy(const char *caseName, eular::OverflowPolicy policy, const std::vector<Expected> &expectVec,
+                      uint64_t delivered, uint64_t dropped, uint64_t overflows)
+{
+    eular::EventDispatcher dispatcher;
+    eular::SubscribeOptions options;
+    options.capacity = TEST_CAPACITY;
+    options.policy = policy;
+    eular::Subscription::SP subscription = dispatcher.subscribe(options, nullptr);
+
+    eular::InotifyEventBatch batch;
+    MakeBatch(batch, TEST_EVENTS);
+    dispatcher.dispatch(batch, 0);
+
+    std::list<InotifyEventItem> eventList;
+    subscription->poll(eventList);
+    bool ok = Expect(caseName, eventList, expectVec);
+    return ExpectStats(caseName, subscription->stats(), delivered, dropped, overflows) && ok;
+}
+
+/**
+ * @brief RESYNC: 溢出事件取走前后续事件都丢弃, 取走后恢复正常入队
+ */
+static bool RunResync()
+{
+    eular::EventDispatcher dispatcher;
+    eular::SubscribeOptions options;
+    options.prefix = "/r";
+    options.capacity = TEST_CAPACITY;
+    options.policy = eular::OverflowPolicy::RESYNC;
+    eular::Subscription::SP subscription = dispatcher.subscribe(options, nullptr);
+
+    eular::InotifyEventBatch batch;
+    MakeBatch(batch, TEST_EVENTS);
+    dispatcher.dispatch(batch, 0);
+    dispatcher.dispatch(batch, 0);
+
+    std::list<InotifyEventItem> eventList;
+    bool ok = subscription->wait(eventList, 100) == NO_ERROR;
+    ok &= Expect("resync: overflow event only", eventList, {
+        {EV_IN_Q_OVERFLOW, "/r/"},
+    });
+    ok &= ExpectStats("resync", subscription->stats(), TEST_CAPACITY, 2 * TEST_EVENTS, 1);
+
+    eventList.clear();
+    MakeBatch(batch, 2);
+    dispatcher.dispatch(batch, 0);
+    subscription->poll(eventList);
+    ok &= Expect("resync: queued again after taken", eventList, Range(0, 2));
+    return ok;
+}
+
+/**
+ * @brief 解析线程从不等待订阅者: 一个订阅者队列满时, 同一批次仍完整投递给其他订阅者
+ */
+static bool RunIsolation()
+{
+    eular::EventDispatcher dispatcher;
+    eular::SubscribeOptions options;
+    options.capacity = 1;
+    options.policy = eular::OverflowPolicy::DROP_NEWEST;
+    eular::Subscription::SP slow = dispatcher.subscribe(options, nullptr);
+
+    std::list<InotifyEventItem> callbackList;
+    dispatcher.subscribe(eular::SubscribeOptions(), [&callbackList] (std::list<InotifyEventItem> &eventList) {
+        callbackList.splice(callbackList.end(), eventList);
+    });
+
+    options.capacity = TEST_EVENTS;
+    eular::Subscription::SP fast = dispatcher.subscribe(options, nullptr);
+
+    eular::InotifyEventBatch batch;
+    MakeBatch(batch, TEST_EVENTS);
+    dispatcher.dispatch(batch, 0);
+
+    std::list<InotifyEventItem> eventList;
+    slow->poll(eventList);
+    bool ok = Expect("isolation: full queue", eventList, Range(0, 1));
+    ok &= Expect("isolation: callback", callbackList, Range(0, TEST_EVENTS));
+
+    eventList.clear();
+    fast->poll(eventList);
+    ok &= Expect("isolation: queue with room", eventList, Range(0, TEST_EVENTS));
+
+    // 取消订阅后wait立即返回
+    ok &= slow->wait(eventList, 10) == TIMED_OUT;
+    ok &= dispatcher.unsubscribe(slow->id()) && slow->wait(eventList, 0) == NO_INIT;
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    // 保留最早的事件, 之后的都丢弃
+    ok &= RunPolicy("drop newest", eular::OverflowPolicy::DROP_NEWEST, Range(0, TEST_CAPACITY),
+                    TEST_CAPACITY, TEST_EVENTS - TEST_CAPACITY, TEST_EVENTS - TEST_CAPACITY);
+
+    // 保留最新的事件
+    ok &= RunPolicy("drop oldest", eular::OverflowPolicy::DROP_OLDEST, Range(TEST_EVENTS - TEST_CAPACITY, TEST_EVENTS),
+                    TEST_EVENTS, TEST_EVENTS - TEST_CAPACITY, TEST_EVENTS - TEST_CAPACITY);
+
+    ok &= RunResync();
+    ok &= RunIsolation();
+    return ok ? 0 : 1;
+}
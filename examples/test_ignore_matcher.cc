@@ -0,0 +1,133 @@
+/*************************************************************************
+    > File Name: test_ignore_matcher.cc
+    > Author: hsz
+    > Brief: 忽略规则测试: 取反, 只匹配目录, 相对根目录的路径规则及最后一条规则优先
+    > Created Time: 2026年10月18日 星期日 11时58分33秒
+ ************************************************************************/
+
+#include "inotify_tool/ignore_matcher.h"
+
+#include <utils/errors.h>
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#define TEST_ROOT "/r/"
+
+struct Check
+{
+    const char *path;   // 根目录下的相对路径
+    bool        isDir;
+    bool        ignored;
+};
+
+/**
+ * @brief 用同一组规则检查多个路径, 两个ignored重载的结果都需与预期一致
+ */
+static bool Run(const char *caseName, const std::vector<std::string> &rules, const std::vector<Check> &checkVec)
+{
+    eular::IgnoreMatcher matcher(TEST_ROOT);
+    bool ok = matcher.add(rules) == NO_ERROR;
+    for (const auto &check : checkVec)
+    {
+        std::string path = std::string(TEST_ROOT) + check.path;
+        size_t pos = path.rfind('/');
+        std::string dirPath = path.substr(0, pos + 1);
+        std::string name = path.substr(pos + 1);
+
+        bool byPath = matcher.ignored(path, check.isDir);
+        bool byName = matcher.ignored(dirPath, name, check.isDir);
+        if (byPath != check.ignored || byName != check.ignored)
+        {
+            printf("    %s%s ignored %d/%d, expect %d\n", path.c_str(), check.isDir ? "/" : "", byPath, byName,
+                   check.ignored);
+            ok = false;
+        }
+    }
+
+    printf("%-40s %s\n", caseName, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+static bool RunInvalid()
+{
+    // 有无效规则时整组不添加
+    eular::IgnoreMatcher matcher(TEST_ROOT);
+    bool ok = matcher.add(std::vector<std::string>{"*.log", "/"}) == INVALID_PARAM && matcher.empty();
+    ok &= matcher.add("!") == INVALID_PARAM && matcher.empty();
+    ok &= matcher.add("# comment") == NO_ERROR && matcher.empty();
+    ok &= !matcher.ignored(TEST_ROOT "a.log", false);
+
+    printf("%-40s %s\n", "invalid rules", ok ? "OK" : "FAILED");
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    ok &= Run("negate", {"*.log", "!keep.log"}, {
+        {"a.log", false, true},
+        {"keep.log", false, false},
+        {"sub/keep.log", false, false},
+        {"sub/b.log", false, true},
+    });
+
+    ok &= Run("negate, last rule wins", {"!keep.log", "*.log"}, {
+        {"keep.log", false, true},
+    });
+
+    ok &= Run("negate glob", {"*", "!*.cc"}, {
+        {"a.cc", false, false},
+        {"a.h", false, true},
+        {"src", true, true},
+    });
+
+    ok &= Run("negate literal name", {"build", "!build"}, {
+        {"build", true, false},
+        {"sub/build", false, false},
+    });
+
+    ok &= Run("dir only", {"build/"}, {
+        {"build", true, true},
+        {"build", false, false},
+        {"src/build", true, true},
+        {"src/build", false, false},
+    });
+
+    ok &= Run("dir only, negate dir", {"*.tmp", "!cache.tmp/"}, {
+        {"a.tmp", false, true},
+        {"cache.tmp", false, true},
+        {"cache.tmp", true, false},
+    });
+
+    ok &= Run("negate file of ignored dir name", {"logs/", "!logs"}, {
+        {"logs", true, false},
+        {"logs", false, false},
+    });
+
+    ok &= Run("dir only path", {"doc/out/"}, {
+        {"doc/out", true, true},
+        {"doc/out", false, false},
+        {"src/doc/out", true, false},
+    });
+
+    ok &= Run("anchored", {"/build", "doc/*.txt"}, {
+        {"build", false, true},
+        {"src/build", false, false},
+        {"doc/a.txt", false, true},
+        {"doc/sub/a.txt", false, false},
+    });
+
+    ok &= Run("double star", {"**/foo", "a/**/b", "!a/x/b"}, {
+        {"foo", false, true},
+        {"x/y/foo", true, true},
+        {"a/b", false, true},
+        {"a/x/y/b", false, true},
+        {"a/x/b", false, false},
+    });
+
+    ok &= RunInvalid();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+/*************************************************************************
+    > File Name: test_inotify_move.cc
+    > Author: hsz
+    > Brief: 目录移动配对测试: 移出监视范围的目录子树中的事件不输出, 配对前的子树事件按新路径在移动之后输出
+    > Created Time: 2026年10月18日 星期日 09时12分40秒
+ ************************************************************************/
+
+#include "inotify_tool/inotify_event.h"
+#include "inotify_tool/inotify_tool.h"
+#include "inotify_tool/event_batch.h"
+#include "inotify_tool/event_log.h"
+
+#include <utils/errors.h>
+#include <log/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include <string>
+#include <vector>
+#include <list>
+
+#define LOG_TAG "Test-InotifyMove"
+
+#define TEST_COOKIE 0x5A5A
+
+static std::string Format(const InotifyEventItem &item)
+{
+    std::string text = Event2String(item.event) + " " + item.path + item.name;
+    if (!item.fromName.empty())
+    {
+        text += " <- " + item.fromPath + item.fromName;
+    }
+    return text;
+}
+
+/**
+ * @brief 按顺序比较事件, 只比较事件类型和路径
+ */
+static bool Expect(const char *caseName, const std::vector<InotifyEventItem> &eventVec,
+                   const std::vector<std::pair<uint32_t, std::string>> &expectVec)
+{
+    bool ok = eventVec.size() == expectVec.size();
+    for (size_t i = 0; ok && i < eventVec.size(); ++i)
+    {
+        ok = eventVec[i].event == expectVec[i].first && eventVec[i].path + eventVec[i].name == expectVec[i].second;
+    }
+
+    printf("%-32s %s\n", caseName, ok ? "OK" : "FAILED");
+    if (!ok)
+    {
+        for (const auto &item : eventVec)
+        {
+            printf("    got    %s\n", Format(item).c_str());
+        }
+        for (const auto &expect : expectVec)
+        {
+            printf("    expect %s %s\n", Event2String(expect.first).c_str(), expect.second.c_str());
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief 取出事件直到静默, 等待时间超过配对超时, 未配对的IN_MOVED_FROM会被输出
+ */
+static std::vector<InotifyEventItem> Drain(eular::InotifyTool &tool)
+{
+    std::vector<InotifyEventItem> eventVec;
+    while (true)
+    {
+        int32_t status = tool.waitCompleteEvent(300);
+        std::list<InotifyEventItem> itemList;
+        tool.getEventItem(itemList);
+        eventVec.insert(eventVec.end(), itemList.begin(), itemList.end());
+        if (status != Status::OK)
+        {
+            break;
+        }
+    }
+    return eventVec;
+}
+
+static void Run(const std::string &command)
+{
+    if (system(command.c_str()) != 0)
+    {
+        printf("command failed: %s\n", command.c_str());
+    }
+}
+
+/**
+ * @brief 实际文件系统: 目录移出后在其中创建文件, 以及监视范围内改名后在其中创建文件
+ */
+static bool RunLive(const std::string &root, const std::string &outside)
+{
+    Run("mkdir -p " + root + "a/b " + root + "d/e " + outside);
+
+    eular::InotifyTool tool;
+    tool.createInotify();
+    if (tool.watchRecursive(root, EV_IN_ALL) != NO_ERROR)
+    {
+        printf("watch %s failed\n", root.c_str());
+        return false;
+    }
+
+    bool ok = true;
+    Run("mv " + root + "a " + outside + "a && touch " + outside + "a/b/g");
+    ok &= Expect("dir moved out, create inside", Drain(tool), {
+        {EV_IN_MOVED_OUT | EV_IN_ISDIR, root + "a"},
+    });
+
+    Run("mv " + root + "d " + root + "f && touch " + root + "f/e/g");
+    ok &= Expect("dir renamed, create inside", Drain(tool), {
+        {EV_IN_MOVE | EV_IN_ISDIR, root + "f"},
+        {EV_IN_CREATE, root + "f/e/g"},
+    });
+
+    Run("touch " + outside + "a/b/h");
+    ok &= Expect("moved-out dir no longer watched", Drain(tool), {});
+
+    tool.removeWatch(root);
+    return ok;
+}
+
+static void AppendEvent(std::vector<uint8_t> &data, int32_t wd, uint32_t mask, uint32_t cookie, const char *name)
+{
+    // 与内核相同, name以'\0'填充到16字节的整数倍
+    uint32_t len = static_cast<uint32_t>((strlen(name) + 1 + 15) / 16 * 16);
+    std::vector<uint8_t> buffer(sizeof(struct inotify_event) + len, 0);
+    struct inotify_event *pEvent = reinterpret_cast<struct inotify_event *>(buffer.data());
+    pEvent->wd = wd;
+    pEvent->mask = mask;
+    pEvent->cookie = cookie;
+    pEvent->len = len;
+    memcpy(pEvent->name, name, strlen(name));
+    data.insert(data.end(), buffer.begin(), buffer.end());
+}
+
+/**
+ * @brief 构造录制文件: 根目录/r/(wd 1), /r/a/(wd 2), /r/a/b/(wd 3). IN_MOVED_FROM和IN_MOVED_TO在不同的read中,
+ * 中间为移动后的目录中的事件
+ */
+static bool RunReplay(const std::string &file, bool paired)
+{
+    eular::EventLogWriter writer;
+    if (writer.open(file) != NO_ERROR)
+    {
+        return false;
+    }
+
+    uint64_t ns = 1000000000ULL;
+    writer.writeWatch(ns, {1, -1, EV_IN_ALL, true, true, "/r/"});
+    writer.writeWatch(ns, {2, 1, EV_IN_ALL, true, true, "a"});
+    writer.writeWatch(ns, {3, 2, EV_IN_ALL, true, true, "b"});
+
+    std::vector<uint8_t> data;
+    AppendEvent(data, 1, IN_MOVED_FROM | IN_ISDIR, TEST_COOKIE, "a");
+    writer.writeData(ns, data.data(), data.size());
+
+    data.clear();
+    AppendEvent(data, 3, IN_CREATE, 0, "g");
+    AppendEvent(data, 3, IN_CLOSE_WRITE, 0, "g");
+    writer.writeData(ns + 5000000, data.data(), data.size());
+
+    if (paired)
+    {
+        data.clear();
+        AppendEvent(data, 1, IN_MOVED_TO | IN_ISDIR, TEST_COOKIE, "c");
+        writer.writeData(ns + 10000000, data.data(), data.size());
+    }
+    writer.close();
+
+    std::vector<InotifyEventItem> eventVec;
+    eular::InotifyTool tool;
+    int32_t status = tool.replay(file, false, [&eventVec] (const eular::InotifyEventBatch &batch) {
+        for (const auto &view : batch)
+        {
+            eventVec.push_back(view.toItem());
+        }
+    });
+    unlink(file.c_str());
+    if (status != NO_ERROR)
+    {
+        printf("replay failed: %d\n", status);
+        return false;
+    }
+
+    if (paired)
+    {
+        bool ok = Expect("replay: paired across reads", eventVec, {
+            {EV_IN_MOVE | EV_IN_ISDIR, "/r/c"},
+            {EV_IN_CREATE, "/r/c/b/g"},
+        });
+
+        // 暂存后按新路径解析的事件不重复统计
+        uint64_t events = tool.getKernelEventStats().events;
+        if (events != 4)
+        {
+            printf("    kernel events %llu, expect 4\n", (unsigned long long)events);
+            return false;
+        }
+        return ok;
+    }
+
+    bool ok = Expect("replay: unpaired", eventVec, {
+        {EV_IN_MOVED_OUT | EV_IN_ISDIR, "/r/a"},
+    });
+    uint64_t dropped = tool.getKernelEventStats().movedOutDropped;
+    if (dropped != 2)
+    {
+        printf("    movedOutDropped %llu, expect 2\n", (unsigned long long)dropped);
+        return false;
+    }
+    return ok;
+}
+
+int main()
+{
+    char tmpl[] = "/tmp/test_inotify_move_XXXXXX";
+    if (mkdtemp(tmpl) == nullptr)
+    {
+        perror("mkdtemp error");
+        return -1;
+    }
+
+    std::string base = tmpl;
+    bool ok = RunLive(base + "/watch/", base + "/outside/");
+    ok &= RunReplay(base + "/paired.log", true);
+    ok &= RunReplay(base + "/unpaired.log", false);
+
+    Run("rm -rf " + base);
+    return ok ? 0 : 1;
+}
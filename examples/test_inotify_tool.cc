@@ -7,6 +7,7 @@
 
 #include "inotify_tool/inotify_event.h"
 #include "inotify_tool/inotify_tool.h"
+#include "inotify_tool/event_coalescer.h"
 
 #include <utils/errors.h>
 #include <log/log.h>
@@ -39,10 +40,13 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    eular::EventCoalescer coalescer;
     while (true)
     {
-        int32_t errorCode = spInotifyTool->waitCompleteEvent(0);
-        if (errorCode != Status::OK)
+        // 有积压事件时等到最近一个路径静默
+        int64_t timeout = coalescer.nextTimeout();
+        int32_t errorCode = spInotifyTool->waitCompleteEvent(timeout < 0 ? 0 : (timeout > 0 ? timeout : 1));
+        if (errorCode != Status::OK && errorCode != Status::TIMED_OUT)
         {
             perror("waitCompleteEvent error");
             continue;
@@ -50,10 +54,18 @@ int main(int argc, char *argv[])
 
         std::list<InotifyEventItem> eventItemVec;
         spInotifyTool->getEventItem(eventItemVec);
+        coalescer.push(eventItemVec);
+        coalescer.drain(eventItemVec);
 
         for (const auto &it : eventItemVec)
         {
             const std::string &event = Event2String(it.event);
+            if ((it.event & EV_IN_MOVE) == EV_IN_MOVE)
+            {
+                LOGI("path: %s, name: %s <- %s%s: %s\n", it.path.c_str(), it.name.c_str(),
+                    it.fromPath.c_str(), it.fromName.c_str(), event.c_str());
+                continue;
+            }
             LOGI("path: %s, name: %s: %s\n", it.path.c_str(), it.name.c_str(), event.c_str());
         }
     }
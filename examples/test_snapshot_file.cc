@@ -0,0 +1,211 @@
+/*************************************************************************
+    > File Name: test_snapshot_file.cc
+    > Author: hsz
+    > Brief: 快照文件测试: 保存后读取一致, 截断, 任意字节损坏及校验和正确但结构错误的文件都被拒绝
+    > Created Time: 2026年10月18日 星期日 12时21分09秒
+ ************************************************************************/
+
+#include "inotify_tool/snapshot_file.h"
+
+#include <utils/errors.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#define TEST_CONSISTENT_NS  1700000000123456789LL
+#define HEADER_SIZE         40  // magic[8] version dirCount consistentNs payloadSize checksum
+#define CONSISTENT_OFFSET   16
+#define CHECKSUM_OFFSET     32
+
+static std::vector<eular::PersistedDir> MakeDirs()
+{
+    std::vector<eular::PersistedDir> dirVec(2);
+    dirVec[0].parent = SNAPSHOT_NO_PARENT;
+    dirVec[0].ev = 0xFFF;
+    dirVec[0].recursion = true;
+    dirVec[0].name = "/r/";
+    dirVec[0].snapshot.ino = 100;
+    dirVec[0].snapshot.mtimeNs = 1700000000000000001LL;
+    dirVec[0].snapshot.entries = {{"a.txt", 101, false}, {"sub", 102, true}};
+
+    dirVec[1].parent = 0;
+    dirVec[1].ev = 0xFFF;
+    dirVec[1].recursion = true;
+    dirVec[1].name = "sub";
+    dirVec[1].snapshot.ino = 102;
+    dirVec[1].snapshot.mtimeNs = 1700000000000000002LL;
+    dirVec[1].snapshot.entries = {{"b", 103, false}};
+    return dirVec;
+}
+
+static bool Equal(const std::vector<eular::PersistedDir> &left, const std::vector<eular::PersistedDir> &right)
+{
+    if (left.size() != right.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < left.size(); ++i)
+    {
+        const eular::PersistedDir &l = left[i];
+        const eular::PersistedDir &r = right[i];
+        if (l.parent != r.parent || l.ev != r.ev || l.recursion != r.recursion || l.name != r.name ||
+            l.snapshot.ino != r.snapshot.ino || l.snapshot.mtimeNs != r.snapshot.mtimeNs ||
+            l.snapshot.entries.size() != r.snapshot.entries.size())
+        {
+            return false;
+        }
+
+        for (size_t j = 0; j < l.snapshot.entries.size(); ++j)
+        {
+            const eular::DirSnapshotEntry &le = l.snapshot.entries[j];
+            const eular::DirSnapshotEntry &re = r.snapshot.entries[j];
+            if (le.name != re.name || le.ino != re.ino || le.isDir != re.isDir)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static std::string ReadFile(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+static void WriteFile(const std::string &path, const std::string &content)
+{
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs.write(content.data(), content.size());
+}
+
+/**
+ * @brief 与快照文件相同的FNV-1a, 用于构造校验和正确的文件
+ */
+static uint64_t Checksum(const std::string &data, size_t offset, size_t size, uint64_t hash = 14695981039346656037ULL)
+{
+    for (size_t i = offset; i < offset + size; ++i)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void FixChecksum(std::string &content)
+{
+    uint64_t hash = Checksum(content, CONSISTENT_OFFSET, sizeof(int64_t));
+    hash = Checksum(content, HEADER_SIZE, content.size() - HEADER_SIZE, hash);
+    memcpy(&content[CHECKSUM_OFFSET], &hash, sizeof(hash));
+}
+
+/**
+ * @brief 读取content, 预期被拒绝且不输出任何目录
+ */
+static bool ExpectRejected(const std::string &path, const std::string &content)
+{
+    WriteFile(path, content);
+    int64_t consistentNs = 0;
+    std::vector<eular::PersistedDir> dirVec;
+    int32_t status = eular::SnapshotFile::Load(path, consistentNs, dirVec);
+    return status == UNKNOWN_ERROR && dirVec.empty();
+}
+
+int main()
+{
+    char tmpl[] = "/tmp/test_snapshot_file_XXXXXX";
+    if (mkdtemp(tmpl) == nullptr)
+    {
+        perror("mkdtemp error");
+        return -1;
+    }
+
+    std::string base = tmpl;
+    std::string file = base + "/snapshot";
+    std::string damaged = base + "/damaged";
+    std::vector<eular::PersistedDir> dirVec = MakeDirs();
+
+    // 保存后读取一致
+    int64_t consistentNs = 0;
+    std::vector<eular::PersistedDir> loadVec;
+    bool ok = eular::SnapshotFile::Save(file, TEST_CONSISTENT_NS, dirVec) == NO_ERROR &&
+        eular::SnapshotFile::Load(file, consistentNs, loadVec) == NO_ERROR &&
+        consistentNs == TEST_CONSISTENT_NS && Equal(dirVec, loadVec);
+    printf("%-40s %s\n", "round trip", ok ? "OK" : "FAILED");
+
+    bool caseOk = eular::SnapshotFile::Load(base + "/missing", consistentNs, loadVec) == NAME_NOT_FOUND && loadVec.empty();
+    printf("%-40s %s\n", "missing", caseOk ? "OK" : "FAILED");
+    ok &= caseOk;
+
+    // 截断到任意长度及尾部多出数据
+    std::string content = ReadFile(file);
+    caseOk = true;
+    for (size_t size = 0; size < content.size(); ++size)
+    {
+        if (!ExpectRejected(damaged, content.substr(0, size)))
+        {
+            printf("    truncated to %zu bytes accepted\n", size);
+            caseOk = false;
+        }
+    }
+    caseOk &= ExpectRejected(damaged, content + '\0');
+    printf("%-40s %s\n", "truncated or extended", caseOk ? "OK" : "FAILED");
+    ok &= caseOk;
+
+    // 任意一个字节损坏, 包括文件头中的consistentNs
+    caseOk = true;
+    for (size_t i = 0; i < content.size(); ++i)
+    {
+        std::string corrupted = content;
+        corrupted[i] ^= 0x01;
+        if (!ExpectRejected(damaged, corrupted))
+        {
+            printf("    bit flip at offset %zu accepted\n", i);
+            caseOk = false;
+        }
+    }
+    printf("%-40s %s\n", "single bit flip", caseOk ? "OK" : "FAILED");
+    ok &= caseOk;
+
+    // 校验和正确但结构错误: 父目录不在子目录之前, 子项数超出负载, 目录数与负载不符
+    dirVec[1].parent = 1;
+    caseOk = eular::SnapshotFile::Save(file, TEST_CONSISTENT_NS, dirVec) == NO_ERROR &&
+        ExpectRejected(damaged, ReadFile(file));
+    dirVec[1].parent = 0;
+
+    std::string forged = content;
+    uint32_t entryCount = 3;
+    memcpy(&forged[HEADER_SIZE + 12], &entryCount, sizeof(entryCount));
+    FixChecksum(forged);
+    caseOk &= ExpectRejected(damaged, forged);
+
+    forged = content;
+    uint32_t dirCount = 1;
+    memcpy(&forged[12], &dirCount, sizeof(dirCount));
+    FixChecksum(forged);
+    caseOk &= ExpectRejected(damaged, forged);
+
+    // 构造方法本身正确: 只重算校验和的文件可以读取
+    forged = content;
+    FixChecksum(forged);
+    WriteFile(damaged, forged);
+    caseOk &= eular::SnapshotFile::Load(damaged, consistentNs, loadVec) == NO_ERROR && Equal(MakeDirs(), loadVec);
+    printf("%-40s %s\n", "valid checksum, invalid structure", caseOk ? "OK" : "FAILED");
+    ok &= caseOk;
+
+    unlink(file.c_str());
+    unlink(damaged.c_str());
+    rmdir(base.c_str());
+    return ok ? 0 : 1;
+}
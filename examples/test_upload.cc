@@ -0,0 +1,360 @@
+/*************************************************************************
+    > File Name: test_upload.cc
+    > Author: hsz
+    > Brief: 上传引擎测试: 本地模拟create/getUploadUrl/complete/delete及分片PUT接口, 校验分片上传, 秒传, pre_hash误匹配, 分片地址过期和失败时放弃上传
+    > Created Time: 2026年10月18日 星期日 03时20分41秒
+ ************************************************************************/
+
+#include "httpd/upload_engine.h"
+#include "httpd/api_config.h"
+
+#include <hv/HttpServer.h>
+#include <hv/hv.h>
+#include <hv/sha1.h>
+#include <hv/md5.h>
+#include <hv/base64.h>
+
+#include <utils/errors.h>
+#include <log/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include <string>
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <random>
+
+#define LOG_TAG "Test-Upload"
+
+#define TEST_PORT           18650
+#define TEST_TOKEN_TYPE     "Bearer"
+#define TEST_ACCESS_TOKEN   "test-access-token"
+#define TEST_PART_SIZE      (4 * 1024 * 1024)
+
+static std::string Sha1(const std::string &data, uint32_t size, bool upper)
+{
+    char hex[41] = {0};
+    hv_sha1_hex((unsigned char *)data.data(), size, hex, sizeof(hex));
+    std::string result(hex);
+    for (char &c : result) {
+        c = upper ? toupper(c) : tolower(c);
+    }
+    return result;
+}
+
+/**
+ * @brief 模拟云盘的上传接口. 云端文件以content_hash为键, 完成上传时校验分片拼接后的sha1
+ */
+class LocalCloud
+{
+public:
+    struct Session {
+        std::string file_id;
+        std::string name;
+        uint64_t    size = 0;
+        uint32_t    parts = 0;
+        std::map<uint32_t, std::string> partMap;
+    };
+
+    void registerRouter(hv::HttpService &router)
+    {
+        router.POST(OPENAPI_FILE_CREATE, [this] (HttpRequest *req, HttpResponse *resp) {
+            return this->create(req, resp);
+        });
+        router.POST(OPENAPI_FILE_UPLOAD_URL, [this] (HttpRequest *req, HttpResponse *resp) {
+            return this->getUploadUrl(req, resp);
+        });
+        router.POST(OPENAPI_FILE_COMPLETE, [this] (HttpRequest *req, HttpResponse *resp) {
+            return this->complete(req, resp);
+        });
+        router.POST(OPENAPI_FILE_DELETE, [this] (HttpRequest *req, HttpResponse *resp) {
+            return this->deleteFile(req, resp);
+        });
+        router.PUT("/upload/:upload_id/:part_number/:sign", [this] (HttpRequest *req, HttpResponse *resp) {
+            return this->putPart(req, resp);
+        });
+    }
+
+    int32_t create(HttpRequest *req, HttpResponse *resp)
+    {
+        ++apiCalls;
+        nlohmann::json body = nlohmann::json::parse(req->body);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (body.contains("pre_hash")) {
+            if (preHashes.count(body["pre_hash"].get<std::string>()) > 0) {
+                resp->Json(nlohmann::json{{"code", UPLOAD_PRE_HASH_MATCHED}, {"message", "pre hash matched"}});
+                return HTTP_STATUS_CONFLICT;
+            }
+        } else if (body.contains("content_hash")) {
+            auto it = files.find(body["content_hash"].get<std::string>());
+            if (it != files.end()) {
+                // proof_code取云端文件内容
+                const std::string &content = it->second;
+                std::string expect = ExpectedProof(content);
+                if (body.value("proof_code", "") != expect) {
+                    resp->Json(nlohmann::json{{"code", "InvalidProofCode"}});
+                    return HTTP_STATUS_BAD_REQUEST;
+                }
+
+                resp->Json(nlohmann::json{{"file_id", "rapid-" + std::to_string(++fileId)},
+                    {"file_name", body["name"]}, {"rapid_upload", true}});
+                return HTTP_STATUS_OK;
+            }
+        }
+
+        std::string uploadId = "upload-" + std::to_string(++fileId);
+        Session &session = sessions[uploadId];
+        session.file_id = "file-" + std::to_string(fileId);
+        session.name = body["name"].get<std::string>();
+        session.size = body["size"].get<uint64_t>();
+        session.parts = static_cast<uint32_t>(body["part_info_list"].size());
+
+        nlohmann::json partList = nlohmann::json::array();
+        for (const auto &part : body["part_info_list"]) {
+            uint32_t partNumber = part["part_number"].get<uint32_t>();
+            partList.push_back({{"part_number", partNumber}, {"upload_url", uploadUrl(uploadId, partNumber, "create")}});
+        }
+
+        resp->Json(nlohmann::json{{"file_id", session.file_id}, {"file_name", session.name},
+            {"upload_id", uploadId}, {"rapid_upload", false}, {"part_info_list", partList}});
+        return HTTP_STATUS_OK;
+    }
+
+    int32_t getUploadUrl(HttpRequest *req, HttpResponse *resp)
+    {
+        ++apiCalls;
+        ++urlRefreshes;
+        nlohmann::json body = nlohmann::json::parse(req->body);
+        std::string uploadId = body["upload_id"].get<std::string>();
+        nlohmann::json partList = nlohmann::json::array();
+        for (const auto &part : body["part_info_list"]) {
+            uint32_t partNumber = part["part_number"].get<uint32_t>();
+            partList.push_back({{"part_number", partNumber}, {"upload_url", uploadUrl(uploadId, partNumber, "refresh")}});
+        }
+
+        resp->Json(nlohmann::json{{"upload_id", uploadId}, {"part_info_list", partList}});
+        return HTTP_STATUS_OK;
+    }
+
+    int32_t putPart(HttpRequest *req, HttpResponse *resp)
+    {
+        uint32_t current = ++inflight;
+        uint32_t expected = maxInflight.load();
+        while (current > expected && !maxInflight.compare_exchange_weak(expected, current)) {
+        }
+
+        // 模拟网络耗时, 使并发可见
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (expireUrls && req->GetParam("sign") == "create") {
+            --inflight;
+            resp->body = "<Error><Code>AccessDenied</Code><Message>Request has expired.</Message></Error>";
+            return HTTP_STATUS_FORBIDDEN;
+        }
+        if (failParts) {
+            --inflight;
+            return HTTP_STATUS_INTERNAL_SERVER_ERROR;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = sessions.find(req->GetParam("upload_id"));
+            if (it != sessions.end()) {
+                it->second.partMap[atoi(req->GetParam("part_number").c_str())] = req->body;
+                ++partsUploaded;
+            }
+        }
+        --inflight;
+        return HTTP_STATUS_OK;
+    }
+
+    int32_t complete(HttpRequest *req, HttpResponse *resp)
+    {
+        ++apiCalls;
+        nlohmann::json body = nlohmann::json::parse(req->body);
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = sessions.find(body["upload_id"].get<std::string>());
+        if (it == sessions.end() || it->second.partMap.size() != it->second.parts) {
+            resp->Json(nlohmann::json{{"code", "PartNotFound"}});
+            return HTTP_STATUS_BAD_REQUEST;
+        }
+
+        std::string content;
+        for (const auto &part : it->second.partMap) {
+            content += part.second;
+        }
+        if (content.size() != it->second.size) {
+            resp->Json(nlohmann::json{{"code", "SizeMismatch"}});
+            return HTTP_STATUS_BAD_REQUEST;
+        }
+
+        std::string contentHash = Sha1(content, content.size(), true);
+        preHashes.insert(Sha1(content, std::min<size_t>(content.size(), UPLOAD_PRE_HASH_SIZE), false));
+        files[contentHash] = content;
+        resp->Json(nlohmann::json{{"file_id", body["file_id"]}, {"name", it->second.name}, {"size", content.size()},
+            {"content_hash", contentHash}});
+        sessions.erase(it);
+        return HTTP_STATUS_OK;
+    }
+
+    int32_t deleteFile(HttpRequest *req, HttpResponse *resp)
+    {
+        ++apiCalls;
+        nlohmann::json body = nlohmann::json::parse(req->body);
+        std::string fileId = body["file_id"].get<std::string>();
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = sessions.begin(); it != sessions.end(); ++it) {
+            if (it->second.file_id == fileId) {
+                sessions.erase(it);
+                ++deletes;
+                resp->Json(nlohmann::json{{"drive_id", body["drive_id"]}, {"file_id", fileId}});
+                return HTTP_STATUS_OK;
+            }
+        }
+
+        resp->Json(nlohmann::json{{"code", "NotFound.File"}});
+        return HTTP_STATUS_NOT_FOUND;
+    }
+
+    // sign区分分片地址的来源, 用于模拟create返回的地址过期
+    std::string uploadUrl(const std::string &uploadId, uint32_t partNumber, const char *sign) const
+    {
+        return "http://127.0.0.1:" + std::to_string(TEST_PORT) + "/upload/" + uploadId + "/" + std::to_string(partNumber) +
+            "/" + sign;
+    }
+
+    static std::string ExpectedProof(const std::string &content)
+    {
+        if (content.empty()) {
+            return "";
+        }
+
+        char md5Hex[33] = {0};
+        hv_md5_hex((unsigned char *)TEST_ACCESS_TOKEN, strlen(TEST_ACCESS_TOKEN), md5Hex, sizeof(md5Hex));
+        uint64_t begin = strtoull(std::string(md5Hex, 16).c_str(), nullptr, 16) % content.size();
+        uint64_t end = std::min<uint64_t>(begin + 8, content.size());
+        return hv::Base64Encode((const unsigned char *)content.data() + begin, end - begin);
+    }
+
+    std::mutex  mutex;
+    std::map<std::string, Session>      sessions;
+    std::map<std::string, std::string>  files;      // content_hash -> 内容
+    std::set<std::string>               preHashes;
+    uint32_t                fileId = 0;
+    std::atomic<uint32_t>   apiCalls{0};
+    std::atomic<uint32_t>   partsUploaded{0};
+    std::atomic<uint32_t>   inflight{0};
+    std::atomic<uint32_t>   maxInflight{0};
+    std::atomic<uint32_t>   urlRefreshes{0};
+    std::atomic<uint32_t>   deletes{0};
+    std::atomic<bool>       expireUrls{false};  // create返回的分片地址已过期, PUT返回403
+    std::atomic<bool>       failParts{false};   // 所有分片PUT失败
+};
+
+static std::string WriteFile(const std::string &path, const std::string &content)
+{
+    FILE *fp = fopen(path.c_str(), "wb");
+    fwrite(content.data(), 1, content.size(), fp);
+    fclose(fp);
+    return path;
+}
+
+static bool RunCase(LocalCloud &cloud, eular::UploadEngine &engine, const char *caseName, const std::string &path,
+                    bool expectRapid, uint32_t expectParts, int32_t expectStatus = NO_ERROR)
+{
+    cloud.apiCalls = 0;
+    cloud.partsUploaded = 0;
+    cloud.maxInflight = 0;
+    cloud.urlRefreshes = 0;
+    cloud.deletes = 0;
+
+    eular::UploadFileItem item;
+    item.local_path = path;
+    item.drive_id = "drive";
+    item.parent_file_id = "root";
+    item.name = caseName;
+
+    eular::UploadResult result;
+    int32_t status = engine.upload(item, result);
+    bool ok = status == expectStatus && result.rapid_upload == expectRapid && cloud.partsUploaded == expectParts;
+
+    // 失败时删除未完成的文件, 云端不留下上传会话
+    {
+        std::lock_guard<std::mutex> lock(cloud.mutex);
+        ok &= cloud.sessions.empty() && cloud.deletes == (status == NO_ERROR ? 0 : 1);
+    }
+    printf("%-24s status=%d rapid=%d parts=%u api_calls=%u max_inflight=%u refreshes=%u deletes=%u %" PRIu64 " ms %s\n",
+        caseName, status, result.rapid_upload, cloud.partsUploaded.load(), cloud.apiCalls.load(), cloud.maxInflight.load(),
+        cloud.urlRefreshes.load(), cloud.deletes.load(), result.elapsed_ms, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t sizeMB = argc > 1 ? atoi(argv[1]) : 64;
+
+    LocalCloud cloud;
+    hv::HttpService router;
+    cloud.registerRouter(router);
+    hv::HttpServer server;
+    server.registerHttpService(&router);
+    server.setPort(TEST_PORT);
+    server.setThreadNum(8);
+    server.start();
+
+    eular::UploadOptions options;
+    options.domain = "http://127.0.0.1:" + std::to_string(TEST_PORT);
+    options.token_type = TEST_TOKEN_TYPE;
+    options.access_token = TEST_ACCESS_TOKEN;
+    options.part_size = TEST_PART_SIZE;
+    options.concurrency = 4;
+    eular::UploadEngine engine(options);
+
+    std::mt19937_64 random(42);
+    std::string content(sizeMB * 1024 * 1024 + 4321, '\0');
+    for (char &c : content) {
+        c = static_cast<char>(random());
+    }
+    uint32_t parts = (content.size() + TEST_PART_SIZE - 1) / TEST_PART_SIZE;
+
+    // 前1KB相同, 其余不同: pre_hash匹配但content_hash不匹配, 需完整上传
+    std::string similar = content;
+    similar[similar.size() / 2] ^= 0x5A;
+
+    // 前1KB不同, 直接分片上传
+    std::string expired = content;
+    expired[0] ^= 0x5A;
+    std::string failed = content;
+    failed[1] ^= 0x5A;
+
+    bool ok = true;
+    ok &= RunCase(cloud, engine, "multipart", WriteFile("/tmp/test_upload_a", content), false, parts);
+    ok &= RunCase(cloud, engine, "rapid", WriteFile("/tmp/test_upload_b", content), true, 0);
+    ok &= RunCase(cloud, engine, "pre_hash_only", WriteFile("/tmp/test_upload_c", similar), false, parts);
+    ok &= RunCase(cloud, engine, "empty", WriteFile("/tmp/test_upload_d", ""), false, 1);
+
+    // create返回的分片地址已过期, 每个分片403后重新获取地址再上传
+    cloud.expireUrls = true;
+    ok &= RunCase(cloud, engine, "expired_url", WriteFile("/tmp/test_upload_e", expired), false, parts);
+    ok &= cloud.urlRefreshes == parts;
+    cloud.expireUrls = false;
+
+    cloud.failParts = true;
+    ok &= RunCase(cloud, engine, "abort", WriteFile("/tmp/test_upload_f", failed), false, 0, UNKNOWN_ERROR);
+    cloud.failParts = false;
+
+    unlink("/tmp/test_upload_a");
+    unlink("/tmp/test_upload_b");
+    unlink("/tmp/test_upload_c");
+    unlink("/tmp/test_upload_d");
+    unlink("/tmp/test_upload_e");
+    unlink("/tmp/test_upload_f");
+    server.stop();
+    return ok ? 0 : 1;
+}
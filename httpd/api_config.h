@@ -13,7 +13,18 @@
 #define OPENAPI_USER_INFO       "/oauth/users/info"                 // GET
 #define OPENAPI_DRIVE_INFO      "/adrive/v1.0/user/getDriveInfo"    // POST
 #define OPENAPI_FILE_LIST       "/adrive/v1.0/openFile/list"        // POST
+#define OPENAPI_FILE_DOWNLOAD_URL "/adrive/v1.0/openFile/getDownloadUrl" // POST
+#define OPENAPI_FILE_CREATE     "/adrive/v1.0/openFile/create"      // POST
+#define OPENAPI_FILE_UPLOAD_URL "/adrive/v1.0/openFile/getUploadUrl" // POST
+#define OPENAPI_FILE_COMPLETE   "/adrive/v1.0/openFile/complete"    // POST
+#define OPENAPI_FILE_DELETE     "/adrive/v1.0/openFile/delete"      // POST
 
 #define FILE_LIST_API_REQ_LIMIT 250 // 10 秒 40 次
 
+#define DOWNLOAD_URL_EXPIRE_SEC 14400 // 下载地址有效期, 最长4小时
+
+#define UPLOAD_PRE_HASH_SIZE    1024    // pre_hash为文件前1KB的sha1
+#define UPLOAD_MAX_PARTS        10000   // 分片数上限
+#define UPLOAD_PRE_HASH_MATCHED "PreHashMatched" // pre_hash匹配时create返回的code, 需再提交content_hash
+
 #endif // __HTTPD_API_CONFIG_H__
@@ -21,6 +21,7 @@
 #include "httpd/http_handler.h"
 #include "application.h"
 #include "thread_pool.h"
+#include "hash_service.h"
 
 #define LOG_TAG     "Application"
 #define HV_LOG_TAG  "libhv"
@@ -165,6 +166,7 @@ void Application::run()
 void Application::stop()
 {
     ThreadPoolInstance::Get()->stop();
+    HashServiceInstance::Get()->stop();
     m_httpServer->stop();
     if (m_upnp->hasValidIGD()) {
         uint16_t externalPort = YamlReaderInstance::Get()->lookup<uint16_t>("upnp.mapping.external_port", 8080);
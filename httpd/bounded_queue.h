@@ -0,0 +1,209 @@
+/*************************************************************************
+    > File Name: bounded_queue.h
+    > Author: hsz
+    > Brief: 有界阻塞队列, 连接下载流水线的各阶段
+    > Created Time: 2026年10月18日 星期日 01时02分15秒
+ ************************************************************************/
+
+#ifndef __HTTPD_BOUNDED_QUEUE_H__
+#define __HTTPD_BOUNDED_QUEUE_H__
+
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+namespace eular {
+
+/**
+ * @brief 有界阻塞队列. 队列满时push阻塞(反压), 消费者一次取走多个元素以减少加锁和唤醒次数.
+ * close后push失败, pop取完剩余元素后返回0
+ */
+template <typename T>
+class BoundedBlockingQueue
+{
+public:
+    struct Stats {
+        uint64_t    pushed = 0;
+        uint64_t    popped = 0;
+        uint64_t    pushWaits = 0;  // 因队列满而阻塞的push次数, 即下游较慢的次数
+        uint64_t    popWaits = 0;   // 因队列空而阻塞的pop次数, 即上游较慢的次数
+        size_t      maxSize = 0;    // 队列长度的最大值
+    };
+
+    explicit BoundedBlockingQueue(size_t capacity) :
+        m_capacity(capacity > 0 ? capacity : 1),
+        m_closed(false)
+    {
+    }
+
+    ~BoundedBlockingQueue() = default;
+
+    BoundedBlockingQueue(const BoundedBlockingQueue &) = delete;
+    BoundedBlockingQueue &operator=(const BoundedBlockingQueue &) = delete;
+
+    /**
+     * @brief 放入一个元素, 队列满时阻塞
+     *
+     * @return true 成功
+     * @return false 队列已关闭
+     */
+    bool push(T &&item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_queue.size() >= m_capacity && !m_closed) {
+            ++m_stats.pushWaits;
+            m_notFull.wait(lock, [this] () { return m_queue.size() < m_capacity || m_closed; });
+        }
+
+        if (m_closed) {
+            return false;
+        }
+
+        m_queue.push_back(std::move(item));
+        ++m_stats.pushed;
+        m_stats.maxSize = std::max(m_stats.maxSize, m_queue.size());
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief 不阻塞地放入一个元素
+     *
+     * @return true 成功
+     * @return false 队列已满或已关闭
+     */
+    bool tryPush(T &&item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_closed || m_queue.size() >= m_capacity) {
+                return false;
+            }
+
+            m_queue.push_back(std::move(item));
+            ++m_stats.pushed;
+            m_stats.maxSize = std::max(m_stats.maxSize, m_queue.size());
+        }
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief 取走最多maxItems个元素追加到out, 队列空时等待
+     *
+     * @param out 输出
+     * @param maxItems 最多取走的元素数
+     * @param timeoutMs 等待时间, 0表示一直等待
+     * @return size_t 取走的元素数, 超时或已关闭且为空时返回0
+     */
+    size_t popBulk(std::vector<T> &out, size_t maxItems, uint32_t timeoutMs = 0)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_queue.empty() && !m_closed) {
+            ++m_stats.popWaits;
+            auto ready = [this] () { return !m_queue.empty() || m_closed; };
+            if (timeoutMs > 0) {
+                m_notEmpty.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready);
+            } else {
+                m_notEmpty.wait(lock, ready);
+            }
+        }
+
+        size_t count = std::min(maxItems, m_queue.size());
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(std::move(m_queue.front()));
+            m_queue.pop_front();
+        }
+        m_stats.popped += count;
+        lock.unlock();
+
+        // 一次腾出多个位置, 唤醒所有等待的生产者
+        if (count > 0) {
+            m_notFull.notify_all();
+        }
+        return count;
+    }
+
+    /**
+     * @brief 不阻塞地取走最多maxItems个元素追加到out
+     *
+     * @return size_t 取走的元素数, 队列为空时返回0
+     */
+    size_t tryPopBulk(std::vector<T> &out, size_t maxItems)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        size_t count = std::min(maxItems, m_queue.size());
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(std::move(m_queue.front()));
+            m_queue.pop_front();
+        }
+        m_stats.popped += count;
+        lock.unlock();
+
+        if (count > 0) {
+            m_notFull.notify_all();
+        }
+        return count;
+    }
+
+    /**
+     * @brief 关闭队列, 唤醒所有等待者. 已放入的元素仍可取出
+     */
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+    /**
+     * @brief 重新打开已关闭的队列, 丢弃剩余元素
+     */
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.clear();
+        m_closed = false;
+    }
+
+    bool closed() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.size();
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+private:
+    const size_t            m_capacity;
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+    std::deque<T>           m_queue;
+    Stats                   m_stats;
+    bool                    m_closed;
+};
+
+} // namespace eular
+
+#endif // __HTTPD_BOUNDED_QUEUE_H__
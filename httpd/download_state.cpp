@@ -0,0 +1,336 @@
+/*************************************************************************
+    > File Name: download_state.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月18日 星期日 02时10分34秒
+ ************************************************************************/
+
+#include "download_state.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include <log/log.h>
+
+#define LOG_TAG "DownloadState"
+
+#define DOWNLOAD_STATE_MAGIC    "ADLSTATE"
+#define DOWNLOAD_STATE_VERSION  1
+#define DOWNLOAD_STATE_TEMP     ".tmp"
+
+namespace eular {
+
+struct DownloadStateHeader {
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    block_size;
+    uint64_t    file_size;
+    uint32_t    id_size;
+    uint32_t    reserved;
+};
+
+static uint32_t gCrc32cTable[256];
+
+static bool InitCrc32cTable()
+{
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int32_t j = 0; j < 8; ++j) {
+            crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+        }
+        gCrc32cTable[i] = crc;
+    }
+    return true;
+}
+
+static uint32_t Crc32cSoftware(uint32_t crc, const uint8_t *data, size_t size)
+{
+    static bool inited = InitCrc32cTable();
+    (void)inited;
+    for (size_t i = 0; i < size; ++i) {
+        crc = gCrc32cTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t Crc32cHardware(uint32_t crc, const uint8_t *data, size_t size)
+{
+    uint64_t crc64 = crc;
+    while (size >= sizeof(uint64_t)) {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+        data += sizeof(value);
+        size -= sizeof(value);
+    }
+
+    crc = static_cast<uint32_t>(crc64);
+    while (size > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+        --size;
+    }
+    return crc;
+}
+#endif
+
+uint32_t Crc32c(uint32_t crc, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+#if defined(__x86_64__)
+    static bool hardware = __builtin_cpu_supports("sse4.2");
+    if (hardware) {
+        return ~Crc32cHardware(crc, bytes, size);
+    }
+#endif
+    return ~Crc32cSoftware(crc, bytes, size);
+}
+
+DownloadState::DownloadState() :
+    m_fileSize(0),
+    m_blockSize(0),
+    m_completedBytes(0),
+    m_unsavedBytes(0)
+{
+}
+
+bool DownloadState::load(const std::string &path, const std::string &fileId, uint64_t fileSize, uint32_t blockSize)
+{
+    m_path = path;
+    m_fileId = fileId;
+    m_fileSize = fileSize;
+    m_blockSize = blockSize;
+    reset();
+
+    FILE *fp = fopen(path.c_str(), "rbe");
+    if (fp == nullptr) {
+        return false;
+    }
+
+    std::vector<uint8_t> content;
+    uint8_t block[16 * 1024];
+    size_t readSize = 0;
+    while ((readSize = fread(block, 1, sizeof(block), fp)) > 0) {
+        content.insert(content.end(), block, block + readSize);
+    }
+    fclose(fp);
+
+    // 任何不匹配都视为新下载
+    DownloadStateHeader header;
+    size_t blocks = m_crcVec.size();
+    size_t expectSize = sizeof(header) + fileId.size() + m_bitmap.size() + blocks * sizeof(uint32_t) + sizeof(uint32_t);
+    if (content.size() != expectSize) {
+        LOGW("discard state %s: size %zu, expect %zu", path.c_str(), content.size(), expectSize);
+        return false;
+    }
+
+    memcpy(&header, content.data(), sizeof(header));
+    uint32_t crc = 0;
+    memcpy(&crc, content.data() + content.size() - sizeof(crc), sizeof(crc));
+    if (memcmp(header.magic, DOWNLOAD_STATE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != DOWNLOAD_STATE_VERSION || header.block_size != blockSize ||
+        header.file_size != fileSize || header.id_size != fileId.size() ||
+        memcmp(content.data() + sizeof(header), fileId.data(), fileId.size()) != 0 ||
+        Crc32c(0, content.data(), content.size() - sizeof(crc)) != crc) {
+        LOGW("discard state %s: not match", path.c_str());
+        return false;
+    }
+
+    const uint8_t *pBitmap = content.data() + sizeof(header) + fileId.size();
+    memcpy(m_bitmap.data(), pBitmap, m_bitmap.size());
+    memcpy(m_crcVec.data(), pBitmap + m_bitmap.size(), blocks * sizeof(uint32_t));
+    for (size_t i = 0; i < blocks; ++i) {
+        if (isComplete(i)) {
+            m_completedBytes += blockLength(i);
+            m_progressVec[i].bytes = blockLength(i);
+        }
+    }
+
+    return true;
+}
+
+uint64_t DownloadState::verify(int32_t fd)
+{
+    size_t failedBlocks = 0;
+    for (size_t i = 0; i < m_crcVec.size(); ++i) {
+        if (!isComplete(i)) {
+            continue;
+        }
+
+        uint32_t crc = 0;
+        if (!readCrc(fd, i, crc) || crc != m_crcVec[i]) {
+            m_bitmap[i / 8] &= ~(1 << (i % 8));
+            m_crcVec[i] = 0;
+            m_progressVec[i] = BlockProgress();
+            m_completedBytes -= blockLength(i);
+            ++failedBlocks;
+        }
+    }
+
+    if (failedBlocks > 0) {
+        LOGW("%s: %zu blocks failed verification", m_path.c_str(), failedBlocks);
+    }
+    return m_completedBytes;
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> DownloadState::missingRanges() const
+{
+    std::vector<std::pair<uint64_t, uint64_t>> rangeVec;
+    for (size_t i = 0; i < m_crcVec.size(); ++i) {
+        if (isComplete(i)) {
+            continue;
+        }
+
+        uint64_t begin = static_cast<uint64_t>(i) * m_blockSize;
+        uint64_t end = begin + blockLength(i);
+        if (!rangeVec.empty() && rangeVec.back().second == begin) {
+            rangeVec.back().second = end;
+        } else {
+            rangeVec.emplace_back(begin, end);
+        }
+    }
+
+    return rangeVec;
+}
+
+void DownloadState::onWrite(int32_t fd, uint64_t offset, const uint8_t *data, size_t size)
+{
+    // 一次写入可能跨块(连接断开重试后块内偏移不再对齐)
+    while (size > 0) {
+        size_t index = offset / m_blockSize;
+        if (index >= m_progressVec.size()) {
+            return;
+        }
+
+        uint64_t blockBegin = static_cast<uint64_t>(index) * m_blockSize;
+        uint64_t length = std::min<uint64_t>(size, blockBegin + blockLength(index) - offset);
+        BlockProgress &progress = m_progressVec[index];
+        if (progress.ordered && offset == blockBegin + progress.bytes) {
+            progress.crc = Crc32c(progress.crc, data, length);
+        } else {
+            progress.ordered = false;
+        }
+        progress.bytes += length;
+
+        if (!isComplete(index) && progress.bytes >= blockLength(index)) {
+            uint32_t crc = progress.crc;
+            if (progress.ordered || readCrc(fd, index, crc)) {
+                setComplete(index, crc);
+            }
+        }
+
+        offset += length;
+        data += length;
+        size -= length;
+    }
+}
+
+bool DownloadState::save()
+{
+    if (m_path.empty()) {
+        return false;
+    }
+
+    DownloadStateHeader header;
+    memcpy(header.magic, DOWNLOAD_STATE_MAGIC, sizeof(header.magic));
+    header.version = DOWNLOAD_STATE_VERSION;
+    header.block_size = m_blockSize;
+    header.file_size = m_fileSize;
+    header.id_size = static_cast<uint32_t>(m_fileId.size());
+    header.reserved = 0;
+
+    std::vector<uint8_t> content;
+    content.reserve(sizeof(header) + m_fileId.size() + m_bitmap.size() + m_crcVec.size() * sizeof(uint32_t) + sizeof(uint32_t));
+    const uint8_t *pHeader = reinterpret_cast<const uint8_t *>(&header);
+    const uint8_t *pCrc = reinterpret_cast<const uint8_t *>(m_crcVec.data());
+    content.insert(content.end(), pHeader, pHeader + sizeof(header));
+    content.insert(content.end(), m_fileId.begin(), m_fileId.end());
+    content.insert(content.end(), m_bitmap.begin(), m_bitmap.end());
+    content.insert(content.end(), pCrc, pCrc + m_crcVec.size() * sizeof(uint32_t));
+    uint32_t crc = Crc32c(0, content.data(), content.size());
+    content.insert(content.end(), reinterpret_cast<const uint8_t *>(&crc), reinterpret_cast<const uint8_t *>(&crc) + sizeof(crc));
+
+    std::string tempPath = m_path + DOWNLOAD_STATE_TEMP;
+    FILE *fp = fopen(tempPath.c_str(), "wbe");
+    if (fp == nullptr) {
+        LOGE("fopen %s error. [%d, %s]", tempPath.c_str(), errno, strerror(errno));
+        return false;
+    }
+
+    bool ok = fwrite(content.data(), content.size(), 1, fp) == 1;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || ::rename(tempPath.c_str(), m_path.c_str()) != 0) {
+        LOGE("save %s error. [%d, %s]", m_path.c_str(), errno, strerror(errno));
+        ::unlink(tempPath.c_str());
+        return false;
+    }
+
+    m_unsavedBytes = 0;
+    return true;
+}
+
+void DownloadState::remove()
+{
+    if (!m_path.empty()) {
+        ::unlink(m_path.c_str());
+    }
+}
+
+uint64_t DownloadState::blockLength(size_t index) const
+{
+    uint64_t begin = static_cast<uint64_t>(index) * m_blockSize;
+    return std::min<uint64_t>(m_blockSize, m_fileSize - begin);
+}
+
+void DownloadState::setComplete(size_t index, uint32_t crc)
+{
+    m_bitmap[index / 8] |= 1 << (index % 8);
+    m_crcVec[index] = crc;
+    m_completedBytes += blockLength(index);
+    m_unsavedBytes += blockLength(index);
+}
+
+void DownloadState::reset()
+{
+    size_t blocks = m_blockSize > 0 ? (m_fileSize + m_blockSize - 1) / m_blockSize : 0;
+    m_bitmap.assign((blocks + 7) / 8, 0);
+    m_crcVec.assign(blocks, 0);
+    m_progressVec.assign(blocks, BlockProgress());
+    m_completedBytes = 0;
+    m_unsavedBytes = 0;
+}
+
+bool DownloadState::readCrc(int32_t fd, size_t index, uint32_t &crc) const
+{
+    std::vector<uint8_t> buffer(std::min<uint64_t>(blockLength(index), 1024 * 1024));
+    uint64_t offset = static_cast<uint64_t>(index) * m_blockSize;
+    uint64_t remain = blockLength(index);
+    crc = 0;
+    while (remain > 0) {
+        ssize_t readSize = ::pread(fd, buffer.data(), std::min<uint64_t>(remain, buffer.size()), static_cast<off_t>(offset));
+        if (readSize < 0 && errno == EINTR) {
+            continue;
+        }
+        if (readSize <= 0) {
+            return false;
+        }
+
+        crc = Crc32c(crc, buffer.data(), readSize);
+        offset += readSize;
+        remain -= readSize;
+    }
+
+    return true;
+}
+
+} // namespace eular
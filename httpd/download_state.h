@@ -0,0 +1,108 @@
+/*************************************************************************
+    > File Name: download_state.h
+    > Author: hsz
+    > Brief: 下载的断点状态, 按块记录完成情况和校验值
+    > Created Time: 2026年10月18日 星期日 02时10分27秒
+ ************************************************************************/
+
+#ifndef __HTTPD_DOWNLOAD_STATE_H__
+#define __HTTPD_DOWNLOAD_STATE_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace eular {
+
+/**
+ * @brief 计算CRC32C, 支持SSE4.2时使用crc32指令
+ *
+ * @param crc 上一段的结果, 首段为0
+ */
+uint32_t Crc32c(uint32_t crc, const void *data, size_t size);
+
+/**
+ * @brief 临时文件旁的状态文件: 每个固定大小的块一位完成标记和一个CRC32C.
+ * 块的数据按偏移顺序写入时增量计算CRC, 否则完成时回读计算.
+ * 保存状态前不对临时文件做fdatasync, 重启后由verify回读校验, 丢失或损坏的块重新下载
+ *
+ * 格式(本机字节序): magic[8] version(u32) block_size(u32) file_size(u64) id_size(u32) reserved(u32)
+ *  file_id 位图[(blocks + 7) / 8] crc[blocks](u32) 以上内容的crc(u32)
+ */
+class DownloadState
+{
+public:
+    DownloadState();
+    ~DownloadState() = default;
+
+    /**
+     * @brief 加载状态文件, 不存在或与本次下载不匹配时从头开始
+     *
+     * @param path 状态文件
+     * @param fileId 云盘文件ID
+     * @param fileSize 文件大小
+     * @param blockSize 块大小
+     * @return true 加载了已有的状态
+     * @return false 从头开始
+     */
+    bool load(const std::string &path, const std::string &fileId, uint64_t fileSize, uint32_t blockSize);
+
+    /**
+     * @brief 回读临时文件校验已完成的块, 校验失败的块标记为未完成
+     *
+     * @return uint64_t 校验通过的字节数
+     */
+    uint64_t verify(int32_t fd);
+
+    /**
+     * @brief 未完成的连续块, 按偏移排序
+     */
+    std::vector<std::pair<uint64_t, uint64_t>> missingRanges() const;
+
+    /**
+     * @brief 记录已写入临时文件的数据
+     */
+    void onWrite(int32_t fd, uint64_t offset, const uint8_t *data, size_t size);
+
+    /**
+     * @brief 写入临时状态文件后重命名, 保证状态文件完整
+     */
+    bool save();
+    void remove();
+
+    uint64_t completedBytes() const { return m_completedBytes; }
+    uint64_t unsavedBytes() const { return m_unsavedBytes; }
+
+protected:
+    uint64_t blockLength(size_t index) const;
+    bool     isComplete(size_t index) const { return (m_bitmap[index / 8] >> (index % 8)) & 1; }
+    void     setComplete(size_t index, uint32_t crc);
+    void     reset();
+
+    /**
+     * @brief 从临时文件回读计算块的CRC
+     */
+    bool     readCrc(int32_t fd, size_t index, uint32_t &crc) const;
+
+private:
+    struct BlockProgress {
+        uint64_t    bytes = 0;      // 已顺序写入的字节数
+        uint32_t    crc = 0;
+        bool        ordered = true; // 是否按偏移顺序写入
+    };
+
+    std::string             m_path;
+    std::string             m_fileId;
+    uint64_t                m_fileSize;
+    uint32_t                m_blockSize;
+    std::vector<uint8_t>    m_bitmap;
+    std::vector<uint32_t>   m_crcVec;
+    std::vector<BlockProgress>  m_progressVec;
+    uint64_t                m_completedBytes;
+    uint64_t                m_unsavedBytes;
+};
+
+} // namespace eular
+
+#endif // __HTTPD_DOWNLOAD_STATE_H__
@@ -0,0 +1,475 @@
+/*************************************************************************
+    > File Name: hash_service.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月18日 星期日 04时16分44秒
+ ************************************************************************/
+
+#include "hash_service.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <utils/errors.h>
+#include <log/log.h>
+
+#define LOG_TAG "HashService"
+
+#define HASH_MAX_THREADS    16
+#define HASH_IO_ALIGN       4096            // 读缓冲区及读取大小的对齐
+#define HASH_MIN_READ_SIZE  (64 * 1024)
+
+namespace eular {
+
+static uint64_t NowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint8_t *AllocAligned(size_t size)
+{
+    void *ptr = nullptr;
+    if (::posix_memalign(&ptr, HASH_IO_ALIGN, size) != 0) {
+        return nullptr;
+    }
+    return static_cast<uint8_t *>(ptr);
+}
+
+/**
+ * @brief 顺序读取文件的[0, size), 每段为readSize(最后一段除外), 因此除最后一段外都是64字节的整数倍
+ */
+class HashService::FileReader
+{
+public:
+    FileReader() = default;
+    ~FileReader() { close(); }
+
+    FileReader(const FileReader &) = delete;
+    FileReader &operator=(const FileReader &) = delete;
+
+    int32_t open(const std::string &path, uint64_t limit, size_t readSize, bool useMmap, uint8_t *buffer)
+    {
+        close();
+        m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd < 0) {
+            LOGW("open %s error. [%d, %s]", path.c_str(), errno, strerror(errno));
+            return errno == ENOENT ? NAME_NOT_FOUND : UNKNOWN_ERROR;
+        }
+
+        struct stat st;
+        if (::fstat(m_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            LOGW("%s is not a regular file", path.c_str());
+            close();
+            return UNKNOWN_ERROR;
+        }
+
+        m_size = std::min<uint64_t>(limit, static_cast<uint64_t>(st.st_size));
+        m_offset = 0;
+        m_readSize = readSize;
+        m_buffer = buffer;
+        ::posix_fadvise(m_fd, 0, static_cast<off_t>(m_size), POSIX_FADV_SEQUENTIAL);
+
+        // mmap失败时退回read
+        if (useMmap && m_size > 0) {
+            void *addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+            if (addr != MAP_FAILED) {
+                m_map = static_cast<uint8_t *>(addr);
+                ::madvise(m_map, m_size, MADV_SEQUENTIAL);
+            }
+        }
+
+        return NO_ERROR;
+    }
+
+    /**
+     * @brief 读取下一段
+     *
+     * @param data 输出数据地址, 在下一次next前有效
+     * @param size 输出长度, 只有last为true时可能为0
+     * @param last 输出是否为最后一段
+     * @return false 读取失败
+     */
+    bool next(const uint8_t *&data, size_t &size, bool &last)
+    {
+        size_t length = static_cast<size_t>(std::min<uint64_t>(m_readSize, m_size - m_offset));
+        if (m_map != nullptr) {
+            data = m_map + m_offset;
+            // 预读下一段, 计算当前段时内核并行读盘
+            uint64_t ahead = m_offset + length;
+            if (ahead < m_size) {
+                ::madvise(m_map + ahead, std::min<uint64_t>(m_readSize, m_size - ahead), MADV_WILLNEED);
+            }
+        } else {
+            size_t readTotal = 0;
+            while (readTotal < length) {
+                ssize_t readSize = ::pread(m_fd, m_buffer + readTotal, length - readTotal,
+                                           static_cast<off_t>(m_offset + readTotal));
+                if (readSize < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (readSize < 0) {
+                    LOGE("pread error. [%d, %s]", errno, strerror(errno));
+                    return false;
+                }
+                if (readSize == 0) {
+                    // 文件在计算过程中变短, 按实际内容计算
+                    m_size = m_offset + readTotal;
+                    break;
+                }
+                readTotal += readSize;
+            }
+            length = readTotal;
+            data = m_buffer;
+        }
+
+        m_offset += length;
+        size = length;
+        last = m_offset >= m_size;
+        return true;
+    }
+
+    void close()
+    {
+        if (m_map != nullptr) {
+            ::munmap(m_map, m_size);
+            m_map = nullptr;
+        }
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    uint64_t offset() const { return m_offset; }
+
+private:
+    int32_t     m_fd = -1;
+    uint64_t    m_size = 0;
+    uint64_t    m_offset = 0;
+    size_t      m_readSize = 0;
+    uint8_t    *m_buffer = nullptr;
+    uint8_t    *m_map = nullptr;
+};
+
+/**
+ * @brief 多缓冲计算中的一路. data/size为当前段中未压缩的部分
+ */
+struct HashService::HashLane {
+    HashJob         job;
+    FileReader      reader;
+    bool            active = false;
+    const uint8_t  *data = nullptr;
+    size_t          size = 0;
+    bool            last = false;
+};
+
+HashService::HashService() :
+    HashService(HashOptions())
+{
+}
+
+HashService::HashService(const HashOptions &options) :
+    m_options(options),
+    m_backend(Sha1ResolveBackend(options.backend)),
+    m_threads(options.threads),
+    m_started(false),
+    m_stopped(false),
+    m_jobQueue(options.queue_size)
+{
+    if (m_threads == 0) {
+        m_threads = std::min<uint32_t>(std::max<uint32_t>(std::thread::hardware_concurrency(), 1), HASH_MAX_THREADS);
+    }
+
+    uint32_t readSize = std::max<uint32_t>(m_options.read_size, HASH_MIN_READ_SIZE);
+    m_options.read_size = (readSize + HASH_IO_ALIGN - 1) / HASH_IO_ALIGN * HASH_IO_ALIGN;
+}
+
+HashService::~HashService()
+{
+    stop();
+}
+
+void HashService::start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_started || m_stopped) {
+        return;
+    }
+
+    m_started = true;
+    for (uint32_t i = 0; i < m_threads; ++i) {
+        m_threadVec.push_back(std::make_shared<Thread>([this] () {
+            if (m_backend == Sha1Backend::AVX2_MB) {
+                this->multiBufferLoop();
+            } else {
+                this->singleLoop();
+            }
+        }, "HASH"));
+    }
+
+    LOGI("hash service started: %u threads, %s, read %u bytes%s", m_threads, Sha1BackendName(m_backend),
+        m_options.read_size, m_options.use_mmap ? ", mmap" : "");
+}
+
+void HashService::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+    }
+
+    // 队列中剩余的任务由计算线程以INVALID_OPERATION完成
+    m_jobQueue.close();
+    for (auto &thread : m_threadVec) {
+        thread->join();
+    }
+    m_threadVec.clear();
+}
+
+std::future<HashResult> HashService::submit(const std::string &path, uint64_t limit)
+{
+    HashJob job;
+    job.path = path;
+    job.limit = limit;
+    job.submit_us = NowUs();
+    std::future<HashResult> future = job.promise.get_future();
+
+    start();
+    // push失败时不会移走job
+    if (m_stopped || !m_jobQueue.push(std::move(job))) {
+        finishJob(job, INVALID_OPERATION, "", 0);
+    }
+    return future;
+}
+
+HashResult HashService::hash(const std::string &path, uint64_t limit)
+{
+    return submit(path, limit).get();
+}
+
+HashService::Stats HashService::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
+
+void HashService::singleLoop()
+{
+    uint8_t *buffer = m_options.use_mmap ? nullptr : AllocAligned(m_options.read_size);
+    std::vector<HashJob> jobVec;
+    Sha1 sha1(m_backend);
+    while (true) {
+        jobVec.clear();
+        if (m_jobQueue.popBulk(jobVec, 1) == 0) {
+            break;
+        }
+
+        HashJob &job = jobVec.front();
+        FileReader reader;
+        int32_t status = m_stopped ? INVALID_OPERATION :
+            reader.open(job.path, job.limit, m_options.read_size, m_options.use_mmap, buffer);
+        if (status == NO_ERROR && !m_options.use_mmap && buffer == nullptr) {
+            status = NO_MEMORY;
+        }
+
+        sha1.reset();
+        while (status == NO_ERROR) {
+            const uint8_t *data = nullptr;
+            size_t size = 0;
+            bool last = false;
+            if (m_stopped) {
+                status = INVALID_OPERATION;
+                break;
+            }
+            if (!reader.next(data, size, last)) {
+                status = UNKNOWN_ERROR;
+                break;
+            }
+
+            sha1.update(data, size);
+            if (last) {
+                break;
+            }
+        }
+
+        finishJob(job, status, status == NO_ERROR ? sha1.finalHex(true) : "", reader.offset());
+    }
+
+    free(buffer);
+}
+
+void HashService::multiBufferLoop()
+{
+    const size_t readSize = m_options.read_size;
+    std::vector<uint8_t *> bufferVec(SHA1_MB_LANES, nullptr);
+    if (!m_options.use_mmap) {
+        for (auto &buffer : bufferVec) {
+            buffer = AllocAligned(readSize);
+        }
+    }
+    // 空闲路的输入, 结果丢弃
+    std::vector<uint8_t> padding(readSize, 0);
+
+    HashLane lanes[SHA1_MB_LANES];
+    alignas(32) uint32_t state[5][SHA1_MB_LANES];
+    std::vector<HashJob> jobVec;
+    uint32_t active = 0;
+
+    auto finishLane = [&] (uint32_t index, int32_t status) {
+        HashLane &lane = lanes[index];
+        std::string hash;
+        if (status == NO_ERROR) {
+            uint32_t laneState[5];
+            uint8_t digest[SHA1_DIGEST_SIZE];
+            for (int32_t i = 0; i < 5; ++i) {
+                laneState[i] = state[i][index];
+            }
+            Sha1Finish(m_backend, laneState, lane.data, lane.size, lane.reader.offset(), digest);
+            hash = Sha1Hex(digest, true);
+        }
+
+        finishJob(lane.job, status, hash, lane.reader.offset());
+        lane.reader.close();
+        lane.active = false;
+        --active;
+    };
+
+    while (true) {
+        // 1、补充空闲路. 全部空闲时阻塞等待, 否则不等待, 避免拖慢正在计算的文件
+        if (active < SHA1_MB_LANES) {
+            jobVec.clear();
+            if (active == 0) {
+                if (m_jobQueue.popBulk(jobVec, SHA1_MB_LANES) == 0) {
+                    break;
+                }
+            } else {
+                m_jobQueue.tryPopBulk(jobVec, SHA1_MB_LANES - active);
+            }
+
+            uint32_t index = 0;
+            for (auto &job : jobVec) {
+                while (lanes[index].active) {
+                    ++index;
+                }
+
+                HashLane &lane = lanes[index];
+                int32_t status = m_stopped ? INVALID_OPERATION :
+                    lane.reader.open(job.path, job.limit, readSize, m_options.use_mmap, bufferVec[index]);
+                if (status == NO_ERROR && !m_options.use_mmap && bufferVec[index] == nullptr) {
+                    status = NO_MEMORY;
+                }
+                if (status != NO_ERROR) {
+                    finishJob(job, status, "", 0);
+                    continue;
+                }
+
+                uint32_t laneState[5];
+                Sha1Init(laneState);
+                for (int32_t i = 0; i < 5; ++i) {
+                    state[i][index] = laneState[i];
+                }
+                lane.job = std::move(job);
+                lane.active = true;
+                lane.data = nullptr;
+                lane.size = 0;
+                lane.last = false;
+                ++active;
+            }
+        }
+
+        // 2、当前段用完的路读取下一段, 剩余不足一块的路完成计算
+        size_t blocks = SIZE_MAX;
+        for (uint32_t i = 0; i < SHA1_MB_LANES; ++i) {
+            HashLane &lane = lanes[i];
+            if (!lane.active) {
+                continue;
+            }
+            if (m_stopped) {
+                finishLane(i, INVALID_OPERATION);
+                continue;
+            }
+            if (lane.size == 0 && !lane.last && !lane.reader.next(lane.data, lane.size, lane.last)) {
+                finishLane(i, UNKNOWN_ERROR);
+                continue;
+            }
+            if (lane.last && lane.size < SHA1_BLOCK_SIZE) {
+                finishLane(i, NO_ERROR);
+                continue;
+            }
+
+            blocks = std::min(blocks, lane.size / SHA1_BLOCK_SIZE);
+        }
+
+        if (active == 0) {
+            continue;
+        }
+
+        // 3、只剩一路时单路计算, 否则八路各压缩blocks块
+        if (active == 1) {
+            for (uint32_t i = 0; i < SHA1_MB_LANES; ++i) {
+                HashLane &lane = lanes[i];
+                if (!lane.active) {
+                    continue;
+                }
+
+                uint32_t laneState[5];
+                for (int32_t j = 0; j < 5; ++j) {
+                    laneState[j] = state[j][i];
+                }
+                Sha1Compress(Sha1Backend::SCALAR, laneState, lane.data, blocks);
+                for (int32_t j = 0; j < 5; ++j) {
+                    state[j][i] = laneState[j];
+                }
+            }
+        } else {
+            const uint8_t *dataVec[SHA1_MB_LANES];
+            for (uint32_t i = 0; i < SHA1_MB_LANES; ++i) {
+                dataVec[i] = lanes[i].active ? lanes[i].data : padding.data();
+            }
+            Sha1CompressX8(state, dataVec, blocks);
+
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_stats.mb_blocks += blocks;
+            m_stats.mb_lane_blocks += blocks * active;
+        }
+
+        for (auto &lane : lanes) {
+            if (lane.active) {
+                lane.data += blocks * SHA1_BLOCK_SIZE;
+                lane.size -= blocks * SHA1_BLOCK_SIZE;
+            }
+        }
+    }
+
+    for (auto &buffer : bufferVec) {
+        free(buffer);
+    }
+}
+
+void HashService::finishJob(HashJob &job, int32_t status, const std::string &hash, uint64_t size)
+{
+    HashResult result;
+    result.status = status;
+    result.content_hash = hash;
+    result.size = size;
+    result.elapsed_us = NowUs() - job.submit_us;
+    if (status == NO_ERROR) {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        ++m_stats.files;
+        m_stats.bytes += size;
+    }
+
+    job.promise.set_value(std::move(result));
+}
+
+} // namespace eular
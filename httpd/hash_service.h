@@ -0,0 +1,120 @@
+/*************************************************************************
+    > File Name: hash_service.h
+    > Author: hsz
+    > Brief: 文件sha1计算服务: 线程池并发计算多个文件的content_hash
+    > Created Time: 2026年10月18日 星期日 04时16分37秒
+ ************************************************************************/
+
+#ifndef __HTTPD_HASH_SERVICE_H__
+#define __HTTPD_HASH_SERVICE_H__
+
+#include <stdint.h>
+#include <memory>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <future>
+
+#include <utils/thread.h>
+#include <utils/singleton.h>
+
+#include "bounded_queue.h"
+#include "sha1.h"
+
+namespace eular {
+
+struct HashOptions {
+    uint32_t    threads = 0;                    // 计算线程数, 0表示CPU核数(最多HASH_MAX_THREADS)
+    uint32_t    read_size = 1024 * 1024;        // 每次读取的大小, 向上对齐到4KB. 多缓冲时每个线程占用8倍
+    bool        use_mmap = false;               // 使用mmap代替read
+    Sha1Backend backend = Sha1Backend::AUTO;
+    uint32_t    queue_size = 4096;              // 等待计算的文件数上限, 满时submit阻塞
+};
+
+struct HashResult {
+    int32_t     status = 0;         // 成功为0, 文件不存在为NAME_NOT_FOUND, 读取失败为UNKNOWN_ERROR, 服务已停止为INVALID_OPERATION
+    std::string content_hash;       // 大写十六进制
+    uint64_t    size = 0;           // 参与计算的字节数
+    uint64_t    elapsed_us = 0;     // 从提交到完成的耗时
+};
+
+/**
+ * @brief 文件sha1计算服务. 每个线程按页对齐的大块读取(或mmap)文件并posix_fadvise顺序读.
+ * 有SHA-NI时每个线程逐个文件单路计算; 否则有AVX2时每个线程同时计算最多8个文件, 每轮按各路可用的最少块数
+ * 八路并行压缩, 空闲路填充无效数据. 结果通过future返回
+ */
+class HashService
+{
+public:
+    struct Stats {
+        uint64_t    files = 0;
+        uint64_t    bytes = 0;
+        uint64_t    mb_blocks = 0;      // 八路压缩的轮数(每轮每路一块)
+        uint64_t    mb_lane_blocks = 0; // 八路压缩中有效数据的块数, 除以mb_blocks为平均并行路数
+    };
+
+    using SP = std::shared_ptr<HashService>;
+
+    HashService();
+    explicit HashService(const HashOptions &options);
+    ~HashService();
+
+    /**
+     * @brief 启动计算线程. submit时未启动会自动启动
+     */
+    void start();
+    void stop();
+
+    /**
+     * @brief 提交文件, 计算[0, limit)的sha1
+     *
+     * @param path 文件路径
+     * @param limit 最多计算的字节数, 默认整个文件
+     * @return std::future<HashResult> 已停止时立即返回INVALID_OPERATION
+     */
+    std::future<HashResult> submit(const std::string &path, uint64_t limit = UINT64_MAX);
+
+    /**
+     * @brief 同步计算, 等价于submit(path, limit).get()
+     */
+    HashResult hash(const std::string &path, uint64_t limit = UINT64_MAX);
+
+    Sha1Backend backend() const { return m_backend; }
+    uint32_t    threads() const { return m_threads; }
+    Stats       stats() const;
+
+protected:
+    struct HashJob {
+        std::string path;
+        uint64_t    limit = UINT64_MAX;
+        uint64_t    submit_us = 0;
+        std::promise<HashResult> promise;
+    };
+
+    class FileReader;
+    struct HashLane;
+
+    void    singleLoop();
+    void    multiBufferLoop();
+    void    finishJob(HashJob &job, int32_t status, const std::string &hash, uint64_t size);
+
+private:
+    HashOptions     m_options;
+    Sha1Backend     m_backend;
+    uint32_t        m_threads;
+    std::mutex      m_mutex;
+    bool            m_started;
+    std::atomic<bool>   m_stopped;
+    std::vector<Thread::SP>         m_threadVec;
+    BoundedBlockingQueue<HashJob>   m_jobQueue;
+
+    mutable std::mutex  m_statsMutex;
+    Stats               m_stats;
+};
+
+using HashServiceInstance = Singleton<HashService>;
+
+} // namespace eular
+
+#endif // __HTTPD_HASH_SERVICE_H__
@@ -0,0 +1,465 @@
+/*************************************************************************
+    > File Name: sha1.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月18日 星期日 03时52分24秒
+ ************************************************************************/
+
+#include "sha1.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace eular {
+
+static const uint32_t gSha1InitState[5] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+static inline uint32_t Rotl32(uint32_t value, int32_t bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static inline uint32_t LoadBe32(const uint8_t *data)
+{
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+static void Sha1CompressScalar(uint32_t state[5], const uint8_t *data, size_t blocks)
+{
+    uint32_t w[16];
+    while (blocks-- > 0) {
+        for (int32_t i = 0; i < 16; ++i) {
+            w[i] = LoadBe32(data + i * 4);
+        }
+
+        uint32_t a = state[0];
+        uint32_t b = state[1];
+        uint32_t c = state[2];
+        uint32_t d = state[3];
+        uint32_t e = state[4];
+        // 四个阶段分开循环, 避免每轮判断f和k
+#define SHA1_ROUND(t, f, k)                                                                         \
+        do {                                                                                        \
+            if ((t) >= 16) {                                                                        \
+                w[(t) & 15] = Rotl32(w[((t) - 3) & 15] ^ w[((t) - 8) & 15] ^ w[((t) - 14) & 15] ^ w[(t) & 15], 1); \
+            }                                                                                       \
+            uint32_t temp = Rotl32(a, 5) + (f) + e + (k) + w[(t) & 15];                             \
+            e = d;                                                                                  \
+            d = c;                                                                                  \
+            c = Rotl32(b, 30);                                                                      \
+            b = a;                                                                                  \
+            a = temp;                                                                               \
+        } while (0)
+
+        for (int32_t t = 0; t < 20; ++t) {
+            SHA1_ROUND(t, d ^ (b & (c ^ d)), 0x5A827999);
+        }
+        for (int32_t t = 20; t < 40; ++t) {
+            SHA1_ROUND(t, b ^ c ^ d, 0x6ED9EBA1);
+        }
+        for (int32_t t = 40; t < 60; ++t) {
+            SHA1_ROUND(t, (b & c) | (d & (b | c)), 0x8F1BBCDC);
+        }
+        for (int32_t t = 60; t < 80; ++t) {
+            SHA1_ROUND(t, b ^ c ^ d, 0xCA62C1D6);
+        }
+#undef SHA1_ROUND
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        data += SHA1_BLOCK_SIZE;
+    }
+}
+
+#if defined(__x86_64__)
+// 每4轮: 用上一组的E和本组消息算出E, 同时扩展后续消息. M0为本组消息, M1~M3依次为后续三组
+#define SHA1_NI_ROUNDS4(ECUR, EOTHER, M0, M1, M2, M3, FUNC)     \
+    ECUR = _mm_sha1nexte_epu32(ECUR, M0);                       \
+    EOTHER = abcd;                                              \
+    M1 = _mm_sha1msg2_epu32(M1, M0);                            \
+    abcd = _mm_sha1rnds4_epu32(abcd, ECUR, FUNC);               \
+    M3 = _mm_sha1msg1_epu32(M3, M0);                            \
+    M2 = _mm_xor_si128(M2, M0)
+
+__attribute__((target("sha,sse4.1")))
+static void Sha1CompressShaNi(uint32_t state[5], const uint8_t *data, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0x1B);
+    __m128i e0 = _mm_set_epi32(static_cast<int32_t>(state[4]), 0, 0, 0);
+    __m128i e1;
+    __m128i msg0, msg1, msg2, msg3;
+
+    while (blocks-- > 0) {
+        __m128i abcdSave = abcd;
+        __m128i e0Save = e0;
+
+        // 0~15轮: 载入消息
+        msg0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0)), mask);
+        e0 = _mm_add_epi32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        msg1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16)), mask);
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+        msg2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 32)), mask);
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        msg3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 48)), mask);
+        SHA1_NI_ROUNDS4(e1, e0, msg3, msg0, msg1, msg2, 0);
+
+        // 16~79轮. 最后几组多余的消息扩展结果不再使用
+        SHA1_NI_ROUNDS4(e0, e1, msg0, msg1, msg2, msg3, 0);
+        SHA1_NI_ROUNDS4(e1, e0, msg1, msg2, msg3, msg0, 1);
+        SHA1_NI_ROUNDS4(e0, e1, msg2, msg3, msg0, msg1, 1);
+        SHA1_NI_ROUNDS4(e1, e0, msg3, msg0, msg1, msg2, 1);
+        SHA1_NI_ROUNDS4(e0, e1, msg0, msg1, msg2, msg3, 1);
+        SHA1_NI_ROUNDS4(e1, e0, msg1, msg2, msg3, msg0, 1);
+        SHA1_NI_ROUNDS4(e0, e1, msg2, msg3, msg0, msg1, 2);
+        SHA1_NI_ROUNDS4(e1, e0, msg3, msg0, msg1, msg2, 2);
+        SHA1_NI_ROUNDS4(e0, e1, msg0, msg1, msg2, msg3, 2);
+        SHA1_NI_ROUNDS4(e1, e0, msg1, msg2, msg3, msg0, 2);
+        SHA1_NI_ROUNDS4(e0, e1, msg2, msg3, msg0, msg1, 2);
+        SHA1_NI_ROUNDS4(e1, e0, msg3, msg0, msg1, msg2, 3);
+        SHA1_NI_ROUNDS4(e0, e1, msg0, msg1, msg2, msg3, 3);
+        SHA1_NI_ROUNDS4(e1, e0, msg1, msg2, msg3, msg0, 3);
+        SHA1_NI_ROUNDS4(e0, e1, msg2, msg3, msg0, msg1, 3);
+        SHA1_NI_ROUNDS4(e1, e0, msg3, msg0, msg1, msg2, 3);
+
+        e0 = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+        data += SHA1_BLOCK_SIZE;
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+#undef SHA1_NI_ROUNDS4
+
+__attribute__((target("avx2")))
+static inline __m256i Rotl32x8(__m256i value, int32_t bits)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(value, bits), _mm256_srli_epi32(value, 32 - bits));
+}
+
+/**
+ * @brief 8路各32字节转置为8个字, 第i个结果为各路的第i个32位字
+ */
+__attribute__((target("avx2")))
+static inline void Transpose8x8(__m256i row[8])
+{
+    __m256i t0 = _mm256_unpacklo_epi32(row[0], row[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(row[0], row[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(row[2], row[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(row[2], row[3]);
+    __m256i t4 = _mm256_unpacklo_epi32(row[4], row[5]);
+    __m256i t5 = _mm256_unpackhi_epi32(row[4], row[5]);
+    __m256i t6 = _mm256_unpacklo_epi32(row[6], row[7]);
+    __m256i t7 = _mm256_unpackhi_epi32(row[6], row[7]);
+
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    row[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    row[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    row[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    row[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    row[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    row[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    row[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    row[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+__attribute__((target("avx2")))
+static void Sha1CompressAvx2(uint32_t state[5][SHA1_MB_LANES], const uint8_t *const data[SHA1_MB_LANES], size_t blocks)
+{
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    const __m256i k[4] = {
+        _mm256_set1_epi32(0x5A827999), _mm256_set1_epi32(0x6ED9EBA1),
+        _mm256_set1_epi32(static_cast<int32_t>(0x8F1BBCDC)), _mm256_set1_epi32(static_cast<int32_t>(0xCA62C1D6))
+    };
+
+    __m256i h[5];
+    for (int32_t i = 0; i < 5; ++i) {
+        h[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(state[i]));
+    }
+
+    __m256i w[16];
+    for (size_t block = 0; block < blocks; ++block) {
+        size_t offset = block * SHA1_BLOCK_SIZE;
+        for (int32_t half = 0; half < 2; ++half) {
+            for (int32_t lane = 0; lane < SHA1_MB_LANES; ++lane) {
+                w[half * 8 + lane] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data[lane] + offset + half * 32));
+            }
+            Transpose8x8(w + half * 8);
+            for (int32_t i = 0; i < 8; ++i) {
+                w[half * 8 + i] = _mm256_shuffle_epi8(w[half * 8 + i], bswap);
+            }
+        }
+
+        __m256i a = h[0];
+        __m256i b = h[1];
+        __m256i c = h[2];
+        __m256i d = h[3];
+        __m256i e = h[4];
+        for (int32_t t = 0; t < 80; ++t) {
+            if (t >= 16) {
+                __m256i x = _mm256_xor_si256(_mm256_xor_si256(w[(t - 3) & 15], w[(t - 8) & 15]),
+                                             _mm256_xor_si256(w[(t - 14) & 15], w[t & 15]));
+                w[t & 15] = Rotl32x8(x, 1);
+            }
+
+            __m256i f;
+            if (t < 20) {
+                f = _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+            } else if (t < 40 || t >= 60) {
+                f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+            } else {
+                f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+            }
+
+            __m256i temp = _mm256_add_epi32(_mm256_add_epi32(Rotl32x8(a, 5), f),
+                                            _mm256_add_epi32(_mm256_add_epi32(e, k[t / 20]), w[t & 15]));
+            e = d;
+            d = c;
+            c = Rotl32x8(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        h[0] = _mm256_add_epi32(h[0], a);
+        h[1] = _mm256_add_epi32(h[1], b);
+        h[2] = _mm256_add_epi32(h[2], c);
+        h[3] = _mm256_add_epi32(h[3], d);
+        h[4] = _mm256_add_epi32(h[4], e);
+    }
+
+    for (int32_t i = 0; i < 5; ++i) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(state[i]), h[i]);
+    }
+}
+#endif
+
+bool Sha1HasShaNi()
+{
+#if defined(__x86_64__)
+    static bool supported = [] () {
+        uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        // SHA-NI: CPUID.(EAX=7,ECX=0):EBX[29], 另需SSE4.1
+        return (ebx & (1u << 29)) != 0 && __builtin_cpu_supports("sse4.1");
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+bool Sha1HasAvx2()
+{
+#if defined(__x86_64__)
+    static bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+Sha1Backend Sha1ResolveBackend(Sha1Backend backend)
+{
+    switch (backend) {
+    case Sha1Backend::AUTO:
+        if (Sha1HasShaNi()) {
+            return Sha1Backend::SHANI;
+        }
+        return Sha1HasAvx2() ? Sha1Backend::AVX2_MB : Sha1Backend::SCALAR;
+    case Sha1Backend::SHANI:
+        return Sha1HasShaNi() ? Sha1Backend::SHANI : Sha1Backend::SCALAR;
+    case Sha1Backend::AVX2_MB:
+        return Sha1HasAvx2() ? Sha1Backend::AVX2_MB : Sha1Backend::SCALAR;
+    default:
+        break;
+    }
+
+    return Sha1Backend::SCALAR;
+}
+
+const char *Sha1BackendName(Sha1Backend backend)
+{
+    switch (backend) {
+    case Sha1Backend::AUTO:
+        return "auto";
+    case Sha1Backend::SCALAR:
+        return "scalar";
+    case Sha1Backend::SHANI:
+        return "sha-ni";
+    case Sha1Backend::AVX2_MB:
+        return "avx2-x8";
+    }
+
+    return "unknown";
+}
+
+void Sha1Compress(Sha1Backend backend, uint32_t state[5], const uint8_t *data, size_t blocks)
+{
+#if defined(__x86_64__)
+    if (Sha1ResolveBackend(backend) == Sha1Backend::SHANI) {
+        Sha1CompressShaNi(state, data, blocks);
+        return;
+    }
+#endif
+    Sha1CompressScalar(state, data, blocks);
+}
+
+void Sha1CompressX8(uint32_t state[5][SHA1_MB_LANES], const uint8_t *const data[SHA1_MB_LANES], size_t blocks)
+{
+#if defined(__x86_64__)
+    if (Sha1HasAvx2()) {
+        Sha1CompressAvx2(state, data, blocks);
+        return;
+    }
+#endif
+
+    // 无AVX2时逐路计算, 仅为保证结果正确
+    for (int32_t lane = 0; lane < SHA1_MB_LANES; ++lane) {
+        uint32_t laneState[5];
+        for (int32_t i = 0; i < 5; ++i) {
+            laneState[i] = state[i][lane];
+        }
+        Sha1CompressScalar(laneState, data[lane], blocks);
+        for (int32_t i = 0; i < 5; ++i) {
+            state[i][lane] = laneState[i];
+        }
+    }
+}
+
+void Sha1Finish(Sha1Backend backend, uint32_t state[5], const uint8_t *tail, size_t tailSize,
+                uint64_t totalSize, uint8_t digest[SHA1_DIGEST_SIZE])
+{
+    // 0x80和8字节长度放不下时需要两块
+    uint8_t block[SHA1_BLOCK_SIZE * 2] = {0};
+    size_t blocks = tailSize + 1 + sizeof(uint64_t) > SHA1_BLOCK_SIZE ? 2 : 1;
+    if (tailSize > 0) {
+        memcpy(block, tail, tailSize);
+    }
+    block[tailSize] = 0x80;
+
+    uint64_t bits = totalSize * 8;
+    uint8_t *pLength = block + blocks * SHA1_BLOCK_SIZE - sizeof(uint64_t);
+    for (int32_t i = 0; i < 8; ++i) {
+        pLength[i] = static_cast<uint8_t>(bits >> (56 - i * 8));
+    }
+    Sha1Compress(backend, state, block, blocks);
+
+    for (int32_t i = 0; i < 5; ++i) {
+        digest[i * 4 + 0] = static_cast<uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
+
+void Sha1Init(uint32_t state[5])
+{
+    memcpy(state, gSha1InitState, sizeof(gSha1InitState));
+}
+
+std::string Sha1Hex(const uint8_t digest[SHA1_DIGEST_SIZE], bool upper)
+{
+    const char *table = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    std::string hex(SHA1_DIGEST_SIZE * 2, '0');
+    for (int32_t i = 0; i < SHA1_DIGEST_SIZE; ++i) {
+        hex[i * 2] = table[digest[i] >> 4];
+        hex[i * 2 + 1] = table[digest[i] & 0x0F];
+    }
+    return hex;
+}
+
+Sha1::Sha1(Sha1Backend backend) :
+    m_backend(Sha1ResolveBackend(backend))
+{
+    reset();
+}
+
+void Sha1::reset()
+{
+    Sha1Init(m_state);
+    m_size = 0;
+    m_bufferSize = 0;
+}
+
+void Sha1::update(const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    m_size += size;
+    if (m_bufferSize > 0) {
+        size_t length = std::min<size_t>(size, SHA1_BLOCK_SIZE - m_bufferSize);
+        memcpy(m_buffer + m_bufferSize, bytes, length);
+        m_bufferSize += length;
+        bytes += length;
+        size -= length;
+        if (m_bufferSize < SHA1_BLOCK_SIZE) {
+            return;
+        }
+
+        Sha1Compress(m_backend, m_state, m_buffer, 1);
+        m_bufferSize = 0;
+    }
+
+    size_t blocks = size / SHA1_BLOCK_SIZE;
+    if (blocks > 0) {
+        Sha1Compress(m_backend, m_state, bytes, blocks);
+        bytes += blocks * SHA1_BLOCK_SIZE;
+        size -= blocks * SHA1_BLOCK_SIZE;
+    }
+
+    if (size > 0) {
+        memcpy(m_buffer, bytes, size);
+        m_bufferSize = size;
+    }
+}
+
+void Sha1::final(uint8_t digest[SHA1_DIGEST_SIZE])
+{
+    Sha1Finish(m_backend, m_state, m_buffer, m_bufferSize, m_size, digest);
+    reset();
+}
+
+std::string Sha1::finalHex(bool upper)
+{
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    final(digest);
+    return Sha1Hex(digest, upper);
+}
+
+} // namespace eular
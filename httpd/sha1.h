@@ -0,0 +1,83 @@
+/*************************************************************************
+    > File Name: sha1.h
+    > Author: hsz
+    > Brief: sha1: 标量, SHA-NI单路及AVX2八路多缓冲实现
+    > Created Time: 2026年10月18日 星期日 03时52分18秒
+ ************************************************************************/
+
+#ifndef __HTTPD_SHA1_H__
+#define __HTTPD_SHA1_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#define SHA1_BLOCK_SIZE     64
+#define SHA1_DIGEST_SIZE    20
+#define SHA1_MB_LANES       8   // AVX2多缓冲的路数
+
+namespace eular {
+
+enum class Sha1Backend {
+    AUTO,       // 有SHA-NI时单路SHA-NI, 否则有AVX2时八路多缓冲, 否则标量
+    SCALAR,
+    SHANI,
+    AVX2_MB,
+};
+
+bool Sha1HasShaNi();
+bool Sha1HasAvx2();
+
+/**
+ * @brief AUTO解析为当前CPU支持的实现, 不支持的实现降级为标量
+ */
+Sha1Backend Sha1ResolveBackend(Sha1Backend backend);
+const char *Sha1BackendName(Sha1Backend backend);
+
+/**
+ * @brief 单路压缩blocks个64字节块. backend为AVX2_MB时单路使用标量
+ */
+void Sha1Compress(Sha1Backend backend, uint32_t state[5], const uint8_t *data, size_t blocks);
+
+/**
+ * @brief 八路同时压缩blocks个块, state[i][lane]为第lane路的第i个字. 需要AVX2
+ */
+void Sha1CompressX8(uint32_t state[5][SHA1_MB_LANES], const uint8_t *const data[SHA1_MB_LANES], size_t blocks);
+
+/**
+ * @brief 填充剩余不足一块的数据并输出摘要
+ *
+ * @param tail 剩余数据, 小于64字节
+ * @param totalSize 消息总字节数
+ */
+void Sha1Finish(Sha1Backend backend, uint32_t state[5], const uint8_t *tail, size_t tailSize,
+                uint64_t totalSize, uint8_t digest[SHA1_DIGEST_SIZE]);
+
+void Sha1Init(uint32_t state[5]);
+std::string Sha1Hex(const uint8_t digest[SHA1_DIGEST_SIZE], bool upper = true);
+
+/**
+ * @brief 流式sha1. 输入为64字节整数倍时直接压缩, 不经过内部缓冲
+ */
+class Sha1
+{
+public:
+    explicit Sha1(Sha1Backend backend = Sha1Backend::AUTO);
+    ~Sha1() = default;
+
+    void reset();
+    void update(const void *data, size_t size);
+    void final(uint8_t digest[SHA1_DIGEST_SIZE]);
+    std::string finalHex(bool upper = true);
+
+private:
+    Sha1Backend m_backend;
+    uint32_t    m_state[5];
+    uint64_t    m_size;
+    uint8_t     m_buffer[SHA1_BLOCK_SIZE];
+    size_t      m_bufferSize;
+};
+
+} // namespace eular
+
+#endif // __HTTPD_SHA1_H__
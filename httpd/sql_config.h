@@ -35,7 +35,7 @@
 #define TABLE_DOWNLOAD_FILE_NAME    TABLE_INFO_FILE_NAME
 #define TABLE_DOWNLOAD_FILE_PATH    TABLE_INFO_FILE_PATH
 #define TABLE_DOWNLOAD_HASH         TABLE_INFO_HASH
-#define TABLE_DOWNLOAD_TEMP_NAME    "temp_file_name"    // TEXT 临时文件名称
+#define TABLE_DOWNLOAD_TEMP_NAME    "temp_file_name"    // TEXT 临时文件名称, 已完成的块记录在临时文件旁的.state文件
 
 // TODO 注意的点
 // 尤其注意
@@ -7,26 +7,657 @@
 
 #include "sync_thread.h"
 
+#include <filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include <hv/requests.h>
+#include <hv/hv.h>
+
+#include <utils/errors.h>
+#include <config/YamlConfig.h>
+#include <log/log.h>
+
+#include "global_resource_management.h"
+#include "api_config.h"
+
+#define LOG_TAG "SyncThread"
+
+#define DOWNLOAD_QUEUE_SIZE     1024                // 等待下载的文件数
+#define CONTENT_CHUNK_SIZE      (1024 * 1024)       // 内容块大小
+#define CONTENT_QUEUE_SIZE      64                  // 内容队列的块数, 即每个流水线最多缓存64MB
+#define IO_BULK_ITEMS           16                  // I/O线程一次取出的块数
+#define DOWNLOAD_CONNECT_TIMEOUT_S  10            // 建立连接的超时时间
+#define DOWNLOAD_IDLE_TIMEOUT_S 30                  // 可续传区间的单个请求时长, 期间没有收到数据视为连接空闲超时
+#define DOWNLOAD_REQ_TIMEOUT_S  3600                // 大小未知(无法续传)的文件的请求超时时间
+#define DOWNLOAD_TEMP_SUFFIX    ".download"         // 临时文件后缀
+#define DOWNLOAD_STATE_SUFFIX   ".state"            // 断点状态文件后缀, 位于临时文件旁
+#define DOWNLOAD_BLOCK_SIZE     (4 * 1024 * 1024)   // 断点状态的块大小, 区间按块对齐
+#define STATE_SAVE_BYTES        (64 * 1024 * 1024)  // 新完成的字节数达到时保存断点状态
+#define STATE_SAVE_INTERVAL_MS  1000                // 保存断点状态的最长间隔
+#define RANGE_MIN_SIZE          (32 * 1024 * 1024)  // 每个连接的最小区间, 小于2倍的文件使用单连接
+#define RANGE_SPLIT_MIN_SIZE    (8 * 1024 * 1024)   // 剩余不足2倍时不再拆分区间
+#define RANGE_MAX_CONNECTIONS   8                   // 每个文件的最大连接数, 可由download.max_connections配置
+#define RANGE_INIT_CONNECTIONS  4
+#define RANGE_RETRY_TIMES       3                   // 区间连续失败的重试次数
+
 namespace eular {
-SyncThread::SyncThread()
+SyncThread::SyncThread(const std::string &domain) :
+    m_domain(domain.empty() ? OPENAPI_DOMAIN_NAME : domain),
+    m_running(false),
+    m_fileDownloadQueue(DOWNLOAD_QUEUE_SIZE),
+    m_fileContentQueue(CONTENT_QUEUE_SIZE),
+    m_files(0),
+    m_failedFiles(0),
+    m_bytesReceived(0),
+    m_bytesWritten(0),
+    m_connectionStep(1),
+    m_lastThroughput(0)
 {
+    m_maxConnections = YamlReaderInstance::Get()->lookup("download.max_connections", RANGE_MAX_CONNECTIONS);
+    m_maxConnections = std::max<uint32_t>(m_maxConnections, 1);
+    m_connections = std::min<uint32_t>(RANGE_INIT_CONNECTIONS, m_maxConnections);
 }
 
 SyncThread::~SyncThread()
 {
+    stop();
 }
 
 void SyncThread::start()
 {
+    if (m_running.exchange(true)) {
+        return;
+    }
+
+    m_fileDownloadQueue.reset();
+    m_fileContentQueue.reset();
+    m_httpDownloadThread = std::make_shared<Thread>([this] () {
+        this->downloadLoop();
+    }, "HTTP-DOWNLOAD");
+    m_fileIoThread = std::make_shared<Thread>([this] () {
+        this->fileIoLoop();
+    }, "FILE-IO");
 }
 
 void SyncThread::stop()
 {
+    if (!m_running.exchange(false)) {
+        return;
+    }
+
+    // 网络线程放弃正在下载的文件, I/O线程写完已收到的块后退出.
+    // 被取消的请求在下一次收到数据或请求超时(可续传区间最多DOWNLOAD_IDLE_TIMEOUT_S)时返回
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        for (HttpRequest *pReq : m_requestSet) {
+            pReq->Cancel();
+        }
+    }
+    m_fileDownloadQueue.close();
+    m_httpDownloadThread->join();
+    m_fileContentQueue.close();
+    m_fileIoThread->join();
+    m_httpDownloadThread.reset();
+    m_fileIoThread.reset();
 }
 
 int32_t SyncThread::enqueue(const FileDownloadItemNode &itemReq)
 {
-    return 0;
+    FileDownloadItemNode node = itemReq;
+    if (!m_fileDownloadQueue.push(std::move(node))) {
+        return INVALID_OPERATION;
+    }
+
+    return NO_ERROR;
+}
+
+SyncThread::Stats SyncThread::stats() const
+{
+    Stats stats;
+    stats.files = m_files.load(std::memory_order_relaxed);
+    stats.failed_files = m_failedFiles.load(std::memory_order_relaxed);
+    stats.bytes_received = m_bytesReceived.load(std::memory_order_relaxed);
+    stats.bytes_written = m_bytesWritten.load(std::memory_order_relaxed);
+    stats.content_queue = m_fileContentQueue.stats();
+    stats.connections = m_connections.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::vector<SyncThread::FileProgress> SyncThread::progress() const
+{
+    std::vector<FileProgress> progressVec;
+    std::lock_guard<std::mutex> lock(m_activeMutex);
+    for (const auto &file : m_activeFiles) {
+        FileProgress progress;
+        progress.target_path = file->target_path;
+        progress.file_size = file->file_size;
+        progress.received = file->received.load(std::memory_order_relaxed);
+        progress.written = file->written.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> rangeLock(file->range_mutex);
+            progress.ranges = file->ranges;
+        }
+        progressVec.push_back(std::move(progress));
+    }
+
+    return progressVec;
+}
+
+void SyncThread::downloadLoop()
+{
+    std::vector<FileDownloadItemNode> itemVec;
+    while (m_running.load(std::memory_order_relaxed)) {
+        itemVec.clear();
+        if (m_fileDownloadQueue.popBulk(itemVec, 1) == 0) {
+            break;
+        }
+
+        download(itemVec.front());
+    }
+}
+
+void SyncThread::fileIoLoop()
+{
+    // 关闭后仍需写完队列中的块, 每个块都持有文件的引用
+    std::vector<FileContentItemNode> nodeVec;
+    nodeVec.reserve(IO_BULK_ITEMS);
+    while (true) {
+        nodeVec.clear();
+        if (m_fileContentQueue.popBulk(nodeVec, IO_BULK_ITEMS) == 0) {
+            break;
+        }
+
+        for (auto &node : nodeVec) {
+            writeRange(node);
+            release(node.file);
+        }
+    }
+}
+
+void SyncThread::download(const FileDownloadItemNode &item)
+{
+    std::string url;
+    int64_t fileSize = -1;
+    if (!getDownloadUrl(item, url, fileSize)) {
+        ++m_failedFiles;
+        return;
+    }
+
+    std::string dirPath = item.file_path.toStdString();
+    if (!dirPath.empty() && dirPath.back() != '/') {
+        dirPath.push_back('/');
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dirPath, ec);
+
+    auto file = std::make_shared<DownloadFile>();
+    file->item = item;
+    file->url = url;
+    file->target_path = dirPath + item.file_name.toStdString();
+    file->temp_path = file->target_path + DOWNLOAD_TEMP_SUFFIX;
+    file->file_size = fileSize;
+    file->begin_ms = gettimeofday_ms();
+    file->fd = ::open(file->temp_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (file->fd < 0) {
+        LOGE("open %s error. [%d, %s]", file->temp_path.c_str(), errno, strerror(errno));
+        file->failed = true;
+        release(file);
+        return;
+    }
+
+    // 已有临时文件时校验已完成的块, 只下载缺失的块
+    file->resumable = fileSize > 0;
+    if (file->resumable &&
+        file->state.load(file->temp_path + DOWNLOAD_STATE_SUFFIX, item.file_id.toStdString(), fileSize, DOWNLOAD_BLOCK_SIZE)) {
+        uint64_t verified = file->state.verify(file->fd);
+        LOGI("resume %s: %" PRIu64 " of %" PRId64 " bytes verified", file->target_path.c_str(), verified, fileSize);
+    }
+    if (file->state.completedBytes() == 0 && ::ftruncate(file->fd, 0) != 0) {
+        LOGE("ftruncate %s error. [%d, %s]", file->temp_path.c_str(), errno, strerror(errno));
+        file->failed = true;
+        release(file);
+        return;
+    }
+    file->state_save_ms = gettimeofday_ms();
+
+    // 预分配: 多个区间乱序写入时不产生空洞和碎片, 磁盘空间不足时在下载前失败
+    if (fileSize > 0 && ::fallocate(file->fd, 0, 0, fileSize) != 0 && errno != EOPNOTSUPP) {
+        LOGE("fallocate %s %" PRId64 " error. [%d, %s]", file->temp_path.c_str(), fileSize, errno, strerror(errno));
+        file->failed = true;
+        release(file);
+        return;
+    }
+
+    // 缺失的连续块作为初始区间, 不足连接数时拆分最大的区间
+    uint32_t count = 1;
+    if (fileSize < 0) {
+        file->ranges.push_back(DownloadRange{0, UINT64_MAX, 0});
+    } else {
+        for (const auto &missing : file->state.missingRanges()) {
+            file->ranges.push_back(DownloadRange{missing.first, missing.second, missing.first});
+        }
+
+        count = rangeCount(fileSize - file->state.completedBytes());
+        std::lock_guard<std::mutex> lock(file->range_mutex);
+        while (file->ranges.size() < count && splitRange(*file) >= 0) {
+        }
+        count = std::min<uint32_t>(count, std::max<size_t>(file->ranges.size(), 1));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_activeMutex);
+        m_activeFiles.push_back(file);
+    }
+
+    // 当前线程作为第一个连接, 其余连接各用一个线程
+    std::vector<Thread::SP> workerVec;
+    for (uint32_t i = 1; i < count; ++i) {
+        workerVec.push_back(std::make_shared<Thread>([this, file] () {
+            this->rangeWorker(file);
+        }, "HTTP-RANGE"));
+    }
+    rangeWorker(file);
+    for (auto &worker : workerVec) {
+        worker->join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_activeMutex);
+        m_activeFiles.remove(file);
+    }
+
+    uint64_t received = file->received.load();
+    if (!m_running.load(std::memory_order_relaxed)) {
+        file->failed = true;
+    } else if (fileSize >= 0) {
+        std::lock_guard<std::mutex> lock(file->range_mutex);
+        for (const auto &range : file->ranges) {
+            if (range.offset < range.end) {
+                LOGE("%s [%" PRIu64 ", %" PRIu64 ") incomplete", file->target_path.c_str(), range.offset, range.end);
+                file->failed = true;
+                break;
+            }
+        }
+    }
+
+    if (count > 1 && !file->failed) {
+        adaptConnections(count, received, gettimeofday_ms() - file->begin_ms);
+    }
+
+    release(file);
+}
+
+void SyncThread::rangeWorker(const std::shared_ptr<DownloadFile> &file)
+{
+    int32_t index = nextRange(*file);
+    uint32_t retry = 0;
+    while (index >= 0 && !file->failed && m_running.load(std::memory_order_relaxed)) {
+        uint64_t offset = 0;
+        {
+            std::lock_guard<std::mutex> lock(file->range_mutex);
+            offset = file->ranges[index].offset;
+        }
+
+        // 连接断开或请求到达时长时从已收到的位置继续, 有进展的请求不计入失败次数
+        if (!fetchRange(file, index)) {
+            {
+                std::lock_guard<std::mutex> lock(file->range_mutex);
+                if (file->ranges[index].offset > offset) {
+                    retry = 0;
+                    continue;
+                }
+            }
+            if (++retry > RANGE_RETRY_TIMES) {
+                file->failed = true;
+                break;
+            }
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(file->range_mutex);
+            file->ranges[index].active = false;
+        }
+        retry = 0;
+        index = nextRange(*file);
+    }
+}
+
+bool SyncThread::fetchRange(const std::shared_ptr<DownloadFile> &file, size_t index)
+{
+    uint64_t offset = 0;
+    uint64_t end = 0;
+    {
+        std::lock_guard<std::mutex> lock(file->range_mutex);
+        offset = file->ranges[index].offset;
+        end = file->ranges[index].end;
+    }
+    if (offset >= end) {
+        return true;
+    }
+
+    auto newNode = [&] (uint64_t begin) {
+        FileContentItemNode node{file->item.file_path, file->item.file_name, ByteBuffer(CONTENT_CHUNK_SIZE), begin, begin, file};
+        return node;
+    };
+
+    FileContentItemNode node = newNode(offset);
+
+    // 块满时放入内容队列, 队列满时阻塞在此, 不再从socket读取
+    auto flush = [&] () {
+        if (node.range_buffer.size() == 0) {
+            return;
+        }
+
+        uint64_t nextBegin = node.range_begin + node.range_buffer.size();
+        node.range_end = nextBegin;
+        file->refs.fetch_add(1, std::memory_order_relaxed);
+        if (!m_fileContentQueue.push(std::move(node))) {
+            file->refs.fetch_sub(1, std::memory_order_relaxed);
+            file->failed = true;
+        }
+        node = newNode(nextBegin);
+    };
+
+    // 不是整个文件时使用Range请求
+    auto req = std::make_shared<HttpRequest>();
+    bool useRange = offset > 0 || end != (file->file_size < 0 ? UINT64_MAX : static_cast<uint64_t>(file->file_size));
+    bool statusOk = false;
+    bool rangeDone = false;
+    uint64_t requestBytes = 0;
+    req->method = HTTP_GET;
+    req->url = file->url;
+    req->connect_timeout = DOWNLOAD_CONNECT_TIMEOUT_S;
+    // NOTE 同步客户端的timeout是整个请求的时长, 没有读空闲超时. 可续传的区间使用较短的时长, 到达时从已收到的位置
+    // 发起新请求, 期间没有数据才算失败; 大文件不会因整体超时而失败, 停止时也不会长时间阻塞在接收上
+    req->timeout = file->file_size < 0 ? DOWNLOAD_REQ_TIMEOUT_S : DOWNLOAD_IDLE_TIMEOUT_S;
+    if (useRange) {
+        req->headers["Range"] = "bytes=" + std::to_string(offset) + "-" + (end == UINT64_MAX ? "" : std::to_string(end - 1));
+    }
+    req->http_cb = [&] (HttpMessage *resp, http_parser_state state, const char *data, size_t size) {
+        if (state == HP_HEADERS_COMPLETE) {
+            int32_t statusCode = static_cast<HttpResponse *>(resp)->status_code;
+            statusOk = statusCode == (useRange ? HTTP_STATUS_PARTIAL_CONTENT : HTTP_STATUS_OK);
+            if (!statusOk) {
+                LOGE("GET %s [%" PRIu64 ", %" PRIu64 ") => %d", file->target_path.c_str(), offset, end, statusCode);
+                req->Cancel();
+            }
+        } else if (state == HP_BODY && data != nullptr && size > 0) {
+            if (!statusOk || file->failed || !m_running.load(std::memory_order_relaxed)) {
+                req->Cancel();
+                return;
+            }
+
+            while (size > 0) {
+                size_t copySize = 0;
+                {
+                    // 区间被拆分后, 超出end的数据属于其他连接
+                    std::lock_guard<std::mutex> lock(file->range_mutex);
+                    DownloadRange &range = file->ranges[index];
+                    copySize = std::min<uint64_t>(size, range.end - range.offset);
+                    copySize = std::min<size_t>(copySize, CONTENT_CHUNK_SIZE - node.range_buffer.size());
+                    range.offset += copySize;
+                }
+
+                if (copySize == 0) {
+                    rangeDone = true;
+                    req->Cancel();
+                    return;
+                }
+
+                node.range_buffer.append(reinterpret_cast<const uint8_t *>(data), copySize);
+                data += copySize;
+                size -= copySize;
+                requestBytes += copySize;
+                file->received.fetch_add(copySize, std::memory_order_relaxed);
+                m_bytesReceived.fetch_add(copySize, std::memory_order_relaxed);
+                if (node.range_buffer.size() >= CONTENT_CHUNK_SIZE) {
+                    flush();
+                }
+            }
+        }
+    };
+
+    {
+        // 与stop的取消互斥: 之后才注册的请求不会发出
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        if (!m_running.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        m_requestSet.insert(req.get());
+    }
+    auto resp = requests::request(req);
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_requestSet.erase(req.get());
+    }
+    flush();
+
+    if (rangeDone) {
+        return true;
+    }
+    if (!m_running.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    if (resp == nullptr && statusOk && requestBytes > 0) {
+        LOGD("GET %s [%" PRIu64 ", %" PRIu64 ") ended after %" PRIu64 " bytes, continue", file->target_path.c_str(),
+            offset, end, requestBytes);
+        return false;
+    }
+    if (resp == nullptr || !statusOk) {
+        LOGW("GET %s [%" PRIu64 ", %" PRIu64 ") failed", file->target_path.c_str(), offset, end);
+        return false;
+    }
+
+    // 未知大小的文件以响应结束为准
+    std::lock_guard<std::mutex> lock(file->range_mutex);
+    const DownloadRange &range = file->ranges[index];
+    return range.end == UINT64_MAX || range.offset >= range.end;
+}
+
+int32_t SyncThread::nextRange(DownloadFile &file)
+{
+    std::lock_guard<std::mutex> lock(file.range_mutex);
+    for (size_t i = 0; i < file.ranges.size(); ++i) {
+        DownloadRange &range = file.ranges[i];
+        if (!range.active && range.offset < range.end) {
+            range.active = true;
+            return static_cast<int32_t>(i);
+        }
+    }
+
+    int32_t index = splitRange(file);
+    if (index >= 0) {
+        file.ranges[index].active = true;
+    }
+    return index;
+}
+
+int32_t SyncThread::splitRange(DownloadFile &file)
+{
+    if (file.file_size < 0) {
+        return -1;
+    }
+
+    size_t maxIndex = 0;
+    uint64_t maxRemain = 0;
+    for (size_t i = 0; i < file.ranges.size(); ++i) {
+        uint64_t remain = file.ranges[i].end - file.ranges[i].offset;
+        if (remain > maxRemain) {
+            maxRemain = remain;
+            maxIndex = i;
+        }
+    }
+
+    // 剩余太少时新建连接的开销大于收益
+    if (maxRemain < 2 * RANGE_SPLIT_MIN_SIZE) {
+        return -1;
+    }
+
+    DownloadRange &range = file.ranges[maxIndex];
+    uint64_t middle = range.offset + maxRemain / 2;
+    middle -= middle % DOWNLOAD_BLOCK_SIZE;
+    if (middle <= range.offset) {
+        return -1;
+    }
+
+    DownloadRange tail{middle, range.end, middle, false};
+    range.end = middle;
+    file.ranges.push_back(tail);
+    return static_cast<int32_t>(file.ranges.size() - 1);
+}
+
+uint32_t SyncThread::rangeCount(int64_t fileSize) const
+{
+    if (fileSize < 2 * RANGE_MIN_SIZE) {
+        return 1;
+    }
+
+    uint64_t count = fileSize / RANGE_MIN_SIZE;
+    return static_cast<uint32_t>(std::min<uint64_t>(count, m_connections.load(std::memory_order_relaxed)));
+}
+
+void SyncThread::adaptConnections(uint32_t ranges, uint64_t bytes, uint64_t elapsedMs)
+{
+    // 区间数少于连接数的文件不能反映当前连接数的效果
+    uint32_t connections = m_connections.load(std::memory_order_relaxed);
+    if (ranges < connections || elapsedMs == 0) {
+        return;
+    }
+
+    double throughput = bytes * 1000.0 / elapsedMs;
+    if (m_lastThroughput > 0 && throughput < m_lastThroughput * 1.05) {
+        m_connectionStep = -m_connectionStep;
+    }
+    m_lastThroughput = throughput;
+
+    int64_t next = static_cast<int64_t>(connections) + m_connectionStep;
+    next = std::max<int64_t>(1, std::min<int64_t>(next, m_maxConnections));
+    m_connections.store(static_cast<uint32_t>(next), std::memory_order_relaxed);
+    LOGD("%u connections: %.2f MB/s, next %" PRId64, connections, throughput / 1024 / 1024, next);
+}
+
+bool SyncThread::getDownloadUrl(const FileDownloadItemNode &item, std::string &url, int64_t &size)
+{
+    const std::string &tokenType = GlobalResourceInstance::Get()->token_type;
+    const std::string &accessToken = GlobalResourceInstance::Get()->token;
+
+    http_headers reqHeader;
+    reqHeader["Authorization"] = tokenType + " " + accessToken;
+    reqHeader["Content-Type"] = "application/json";
+
+    nlohmann::json reqBody;
+    reqBody["drive_id"] = item.drive_id.toStdString();
+    reqBody["file_id"] = item.file_id.toStdString();
+    reqBody["expire_sec"] = DOWNLOAD_URL_EXPIRE_SEC;
+
+    std::string apiUrl = m_domain + OPENAPI_FILE_DOWNLOAD_URL;
+    auto resp = requests::post(apiUrl.c_str(), reqBody.dump(), reqHeader);
+    if (resp == nullptr || resp->status_code != HTTP_STATUS_OK) {
+        LOGE("POST [%s] %s => %d", apiUrl.c_str(), item.file_name.c_str(), resp == nullptr ? -1 : resp->status_code);
+        return false;
+    }
+
+    try {
+        nlohmann::json respJson = nlohmann::json::parse(resp->body);
+        url = respJson.at("url").get<std::string>();
+        size = respJson.contains("size") ? respJson.at("size").get<int64_t>() : -1;
+    } catch (const std::exception &e) {
+        LOGE("invalid " OPENAPI_FILE_DOWNLOAD_URL " response: %s. %s", e.what(), resp->body.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void SyncThread::writeRange(FileContentItemNode &node)
+{
+    DownloadFile &file = *node.file;
+    if (file.failed) {
+        return;
+    }
+
+    const uint8_t *data = node.range_buffer.const_data();
+    size_t size = node.range_buffer.size();
+    uint64_t offset = node.range_begin;
+    while (size > 0) {
+        ssize_t writeSize = ::pwrite(file.fd, data, size, static_cast<off_t>(offset));
+        if (writeSize < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            LOGE("pwrite %s error. [%d, %s]", file.temp_path.c_str(), errno, strerror(errno));
+            file.failed = true;
+            return;
+        }
+
+        data += writeSize;
+        size -= writeSize;
+        offset += writeSize;
+    }
+
+    file.written += node.range_buffer.size();
+    m_bytesWritten += node.range_buffer.size();
+
+    // 断点状态只由I/O线程更新
+    if (file.resumable) {
+        file.state.onWrite(file.fd, node.range_begin, node.range_buffer.const_data(), node.range_buffer.size());
+        uint64_t nowMs = gettimeofday_ms();
+        if (file.state.unsavedBytes() >= STATE_SAVE_BYTES ||
+            (file.state.unsavedBytes() > 0 && nowMs - file.state_save_ms >= STATE_SAVE_INTERVAL_MS)) {
+            file.state.save();
+            file.state_save_ms = nowMs;
+        }
+    }
+}
+
+void SyncThread::release(const std::shared_ptr<DownloadFile> &file)
+{
+    if (file->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        finish(*file);
+    }
+}
+
+void SyncThread::finish(DownloadFile &file)
+{
+    if (file.fd >= 0) {
+        ::close(file.fd);
+        file.fd = -1;
+    }
+
+    // 可续传的文件保留临时文件和断点状态, 下次只下载缺失的块
+    if (file.failed) {
+        if (file.resumable && file.state.completedBytes() > 0 && file.state.save()) {
+            LOGI("keep %s for resume: %" PRIu64 " of %" PRId64 " bytes", file.temp_path.c_str(),
+                file.state.completedBytes(), file.file_size);
+        } else {
+            ::unlink(file.temp_path.c_str());
+            file.state.remove();
+        }
+        ++m_failedFiles;
+        return;
+    }
+
+    if (::rename(file.temp_path.c_str(), file.target_path.c_str()) != 0) {
+        LOGE("rename %s error. [%d, %s]", file.temp_path.c_str(), errno, strerror(errno));
+        ::unlink(file.temp_path.c_str());
+        file.state.remove();
+        ++m_failedFiles;
+        return;
+    }
+    file.state.remove();
+
+    uint64_t elapsedMs = gettimeofday_ms() - file.begin_ms;
+    LOGI("download %s: %" PRIu64 " bytes, %" PRIu64 " ms, %.2f MB/s", file.target_path.c_str(), file.written.load(),
+        elapsedMs, elapsedMs > 0 ? file.written.load() / 1024.0 / 1024.0 * 1000 / elapsedMs : 0.0);
+    ++m_files;
 }
 
 } // namespace eular
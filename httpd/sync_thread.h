@@ -9,6 +9,12 @@
 #define __HTTPD_SYNC_THREAD_H__
 
 #include <memory>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <list>
+#include <unordered_set>
 
 #include <hv/json.hpp>
 
@@ -17,16 +23,25 @@
 #include <utils/string8.h>
 #include <utils/buffer.h>
 
-#include "concurrentqueue.h"
+#include "bounded_queue.h"
+#include "download_state.h"
+
+class HttpRequest;
 
 namespace eular {
 
+struct DownloadFile;
+
+/**
+ * @brief 网络阶段收到的一段文件内容, 由I/O阶段写入临时文件的[range_begin, range_end)
+ */
 struct FileContentItemNode {
     eular::String8  file_path;
     eular::String8  file_name;
     ByteBuffer      range_buffer;
     uint64_t        range_begin;
     uint64_t        range_end;
+    std::shared_ptr<DownloadFile> file;
 };
 
 struct FileDownloadItemNode {
@@ -36,25 +51,189 @@ struct FileDownloadItemNode {
     eular::String8  file_name;
 };
 
+/**
+ * @brief 需要下载的字节区间[begin, end). 空闲连接会拆走其他区间剩余部分的后一半, 此时end变小
+ */
+struct DownloadRange {
+    uint64_t    begin = 0;
+    uint64_t    end = 0;
+    uint64_t    offset = 0;     // 已收到的位置
+    bool        active = false; // 是否有连接在下载
+};
+
+/**
+ * @brief 下载中的文件, 网络阶段和I/O阶段共享. refs为队列中未写入的内容块数加上网络阶段自身,
+ * 减到0时(数据全部落盘)关闭文件并将临时文件重命名为目标文件
+ */
+struct DownloadFile {
+    FileDownloadItemNode    item;
+    std::string             url;
+    std::string             temp_path;      // 临时文件, 与目标文件在同一目录
+    std::string             target_path;    // 目标文件
+    int32_t                 fd = -1;
+    int64_t                 file_size = -1; // 文件大小, 未知时为-1
+    uint64_t                begin_ms = 0;
+    std::atomic<uint64_t>   received{0};    // 网络阶段收到的字节数
+    std::atomic<uint64_t>   written{0};     // I/O阶段写入的字节数
+    std::atomic<int32_t>    refs{1};
+    std::atomic<bool>       failed{false};
+
+    std::mutex                  range_mutex;
+    std::vector<DownloadRange>  ranges;
+
+    bool            resumable = false;  // 大小已知时可断点续传, 由I/O阶段维护state
+    DownloadState   state;
+    uint64_t        state_save_ms = 0;
+};
+
+/**
+ * @brief 下载流水线: 网络线程将文件内容按块放入有界队列, I/O线程批量取出并pwrite到range_begin.
+ * 队列满时网络线程阻塞(TCP反压), 磁盘慢不会导致内存无限增长; 网络慢时I/O线程阻塞等待, 不占用CPU
+ */
 class SyncThread
 {
 public:
     using SP = std::shared_ptr<SyncThread>;
 
-    SyncThread();
+    struct Stats {
+        uint64_t    files = 0;          // 完成的文件数
+        uint64_t    failed_files = 0;   // 失败的文件数
+        uint64_t    bytes_received = 0; // 收到的字节数
+        uint64_t    bytes_written = 0;  // 写入的字节数
+        BoundedBlockingQueue<FileContentItemNode>::Stats content_queue; // pushWaits为磁盘较慢, popWaits为网络较慢
+        uint32_t    connections = 0;    // 当前大文件使用的连接数
+    };
+
+    struct FileProgress {
+        std::string target_path;
+        int64_t     file_size = -1;
+        uint64_t    received = 0;
+        uint64_t    written = 0;
+        std::vector<DownloadRange> ranges;
+    };
+
+    /**
+     * @param domain 接口地址, 为空时使用OPENAPI_DOMAIN_NAME, 测试时指向本地模拟服务
+     */
+    explicit SyncThread(const std::string &domain = "");
     ~SyncThread();
 
     void start();
+
+    /**
+     * @brief 停止下载, 取消进行中的请求. 正在下载的可续传文件保留临时文件和断点状态
+     */
     void stop();
 
+    /**
+     * @brief 加入下载队列, 队列满时阻塞
+     *
+     * @param itemReq 下载的文件
+     * @return int32_t 成功返回0, 已停止返回INVALID_OPERATION
+     */
     int32_t enqueue(const FileDownloadItemNode &itemReq);
 
+    Stats stats() const;
+
+    /**
+     * @brief 获取正在下载的文件及其各区间的进度
+     */
+    std::vector<FileProgress> progress() const;
+
+protected:
+    void downloadLoop();
+    void fileIoLoop();
+
+    /**
+     * @brief 网络阶段: 获取下载地址, 大文件拆成多个区间并发请求, 流式接收文件内容并按块放入内容队列
+     *
+     * @param item 下载的文件
+     */
+    void download(const FileDownloadItemNode &item);
+
+    /**
+     * @brief 一个连接: 依次下载未分配的区间, 之后拆分其他区间的剩余部分, 直到没有可下载的区间
+     */
+    void rangeWorker(const std::shared_ptr<DownloadFile> &file);
+
+    /**
+     * @brief 下载一个区间
+     *
+     * @return true 区间下载完成
+     * @return false 失败
+     */
+    bool fetchRange(const std::shared_ptr<DownloadFile> &file, size_t index);
+
+    /**
+     * @brief 分配一个区间给连接: 优先未分配的区间, 其次拆分其他区间
+     *
+     * @return int32_t 区间的下标, 没有可下载的区间返回-1
+     */
+    int32_t nextRange(DownloadFile &file);
+
+    /**
+     * @brief 将剩余字节最多的区间按块拆成两半, 后一半作为新区间. 调用者需持有range_mutex
+     *
+     * @return int32_t 新区间的下标, 没有可拆分的区间返回-1
+     */
+    int32_t splitRange(DownloadFile &file);
+
+    /**
+     * @brief 根据文件大小和当前连接数决定区间数
+     */
+    uint32_t rangeCount(int64_t fileSize) const;
+
+    /**
+     * @brief 根据本次下载的吞吐调整连接数(爬山法): 吞吐下降时反向调整
+     */
+    void adaptConnections(uint32_t ranges, uint64_t bytes, uint64_t elapsedMs);
+
+    /**
+     * @brief 获取文件的下载地址
+     *
+     * @param item 下载的文件
+     * @param url 输出下载地址
+     * @param size 输出文件大小, 接口未返回时为-1
+     * @return true 成功
+     * @return false 失败
+     */
+    bool getDownloadUrl(const FileDownloadItemNode &item, std::string &url, int64_t &size);
+
+    /**
+     * @brief I/O阶段: 将内容块写入临时文件
+     */
+    void writeRange(FileContentItemNode &node);
+
+    /**
+     * @brief 释放文件的一个引用, 最后一个引用释放时完成文件
+     */
+    void release(const std::shared_ptr<DownloadFile> &file);
+    void finish(DownloadFile &file);
+
 private:
+    std::string m_domain;
     Thread::SP  m_httpDownloadThread;
     Thread::SP  m_fileIoThread;
+    std::atomic<bool>   m_running;
+
+    BoundedBlockingQueue<FileDownloadItemNode>  m_fileDownloadQueue;    // 文件下载队列
+    BoundedBlockingQueue<FileContentItemNode>   m_fileContentQueue;     // 文件内容队列
+
+    std::mutex                          m_requestMutex;
+    std::unordered_set<HttpRequest *>   m_requestSet;   // 进行中的请求, stop时取消
+
+    std::atomic<uint64_t>   m_files;
+    std::atomic<uint64_t>   m_failedFiles;
+    std::atomic<uint64_t>   m_bytesReceived;
+    std::atomic<uint64_t>   m_bytesWritten;
+
+    mutable std::mutex                          m_activeMutex;
+    std::list<std::shared_ptr<DownloadFile>>    m_activeFiles;  // 正在下载的文件
 
-    moodycamel::ConcurrentQueue<FileDownloadItemNode>   m_fileDownloadQueue;    // 文件下载队列
-    moodycamel::ConcurrentQueue<FileContentItemNode>    m_fileContentQueue;     // 文件
+    uint32_t                m_maxConnections;
+    std::atomic<uint32_t>   m_connections;      // 大文件的连接数, 由网络线程调整
+    int32_t                 m_connectionStep;
+    double                  m_lastThroughput;   // 上一个大文件的吞吐, 字节/秒
 };
 
 } // namespace eular
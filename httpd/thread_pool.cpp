@@ -66,6 +66,7 @@ bool ThreadPool::start()
         m_syncThreadVec.resize(cpuCores);
         for (uint16_t i = 0; i < cpuCores; ++i) {
             m_syncThreadVec[i] = std::make_shared<SyncThread>();
+            m_syncThreadVec[i]->start();
             m_syncThreadHashMap.insertNode(std::to_string(i), m_syncThreadVec[i].get());
         }
 
@@ -84,6 +85,10 @@ bool ThreadPool::start()
 
 void ThreadPool::stop()
 {
+    for (auto &syncThread : m_syncThreadVec) {
+        syncThread->stop();
+    }
+
     if (!GlobalResourceInstance::Get()->logged_in) {
         return;
     }
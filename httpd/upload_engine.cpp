@@ -0,0 +1,459 @@
+/*************************************************************************
+    > File Name: upload_engine.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月18日 星期日 02时48分13秒
+ ************************************************************************/
+
+#include "upload_engine.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#include <hv/requests.h>
+#include <hv/hv.h>
+#include <hv/md5.h>
+#include <hv/base64.h>
+
+#include <utils/errors.h>
+#include <utils/thread.h>
+#include <log/log.h>
+
+#include "global_resource_management.h"
+#include "api_config.h"
+#include "hash_service.h"
+#include "sha1.h"
+
+#define LOG_TAG "UploadEngine"
+
+#define UPLOAD_REQ_TIMEOUT_S    600                 // 单个分片的超时时间
+#define UPLOAD_PART_RETRY_TIMES 3                   // 分片失败的重试次数
+
+namespace eular {
+
+static bool ReadFull(int32_t fd, uint8_t *buffer, uint64_t size, uint64_t offset)
+{
+    while (size > 0) {
+        ssize_t readSize = ::pread(fd, buffer, size, static_cast<off_t>(offset));
+        if (readSize < 0 && errno == EINTR) {
+            continue;
+        }
+        if (readSize <= 0) {
+            return false;
+        }
+
+        buffer += readSize;
+        size -= readSize;
+        offset += readSize;
+    }
+
+    return true;
+}
+
+/**
+ * @brief 计算文件前size字节(不超过UPLOAD_PRE_HASH_SIZE)的sha1十六进制字符串
+ */
+static bool PreHash(int32_t fd, uint64_t size, std::string &hex)
+{
+    uint8_t buffer[UPLOAD_PRE_HASH_SIZE];
+    size = std::min<uint64_t>(size, sizeof(buffer));
+    if (!ReadFull(fd, buffer, size, 0)) {
+        return false;
+    }
+
+    Sha1 sha1;
+    sha1.update(buffer, size);
+    hex = sha1.finalHex(false);
+    return true;
+}
+
+static uint32_t BufferCount(const UploadOptions &options)
+{
+    uint32_t concurrency = std::max<uint32_t>(options.concurrency, 1);
+    return std::max<uint32_t>(options.buffers > 0 ? options.buffers : concurrency + 2, concurrency);
+}
+
+UploadEngine::UploadEngine(const UploadOptions &options) :
+    m_options(options),
+    m_domain(options.domain.empty() ? OPENAPI_DOMAIN_NAME : options.domain),
+    m_freeBuffers(BufferCount(options)),
+    m_partQueue(BufferCount(options))
+{
+    m_options.concurrency = std::max<uint32_t>(m_options.concurrency, 1);
+    m_options.buffers = BufferCount(options);
+    m_options.part_size = std::max<uint64_t>(m_options.part_size, 1);
+}
+
+int32_t UploadEngine::upload(const UploadFileItem &item, UploadResult &result)
+{
+    result = UploadResult();
+    int32_t fd = ::open(item.local_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return NAME_NOT_FOUND;
+        }
+
+        LOGE("open %s error. [%d, %s]", item.local_path.c_str(), errno, strerror(errno));
+        return UNKNOWN_ERROR;
+    }
+
+    int32_t status = uploadFile(fd, item, result);
+    ::close(fd);
+    return status;
+}
+
+int32_t UploadEngine::uploadFile(int32_t fd, const UploadFileItem &item, UploadResult &result)
+{
+    uint64_t beginMs = gettimeofday_ms();
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        LOGE("fstat %s error. [%d, %s]", item.local_path.c_str(), errno, strerror(errno));
+        return UNKNOWN_ERROR;
+    }
+
+    uint64_t fileSize = static_cast<uint64_t>(st.st_size);
+    UploadContext ctx;
+    ctx.item = item;
+    ctx.part_size = std::max<uint64_t>(m_options.part_size, (fileSize + UPLOAD_MAX_PARTS - 1) / UPLOAD_MAX_PARTS);
+    uint32_t parts = static_cast<uint32_t>(std::max<uint64_t>((fileSize + ctx.part_size - 1) / ctx.part_size, 1));
+    result.size = fileSize;
+
+    nlohmann::json body;
+    body["drive_id"] = item.drive_id;
+    body["parent_file_id"] = item.parent_file_id;
+    body["name"] = item.name;
+    body["type"] = "file";
+    body["check_name_mode"] = item.check_name_mode;
+    body["size"] = fileSize;
+    body["part_info_list"] = nlohmann::json::array();
+    for (uint32_t i = 1; i <= parts; ++i) {
+        body["part_info_list"].push_back({{"part_number", i}});
+    }
+
+    // 1、前1KB的sha1不匹配时直接上传, 避免读取整个文件
+    std::string hash;
+    bool rapidUpload = m_options.rapid_upload && fileSize > 0;
+    if (rapidUpload) {
+        if (!PreHash(fd, fileSize, hash)) {
+            LOGE("read %s error. [%d, %s]", item.local_path.c_str(), errno, strerror(errno));
+            return UNKNOWN_ERROR;
+        }
+        body["pre_hash"] = hash;
+    }
+
+    nlohmann::json resp;
+    int32_t statusCode = createFile(body, resp);
+
+    // 2、pre_hash匹配, 提交整个文件的sha1和proof_code
+    if (rapidUpload && statusCode == HTTP_STATUS_CONFLICT && resp.value("code", "") == UPLOAD_PRE_HASH_MATCHED) {
+        // 整个文件的sha1交给计算服务, 与其他文件的计算并行
+        HashService *hashService = m_options.hash_service != nullptr ? m_options.hash_service : HashServiceInstance::Get();
+        HashResult hashResult = hashService->hash(item.local_path, fileSize);
+        if (hashResult.status != NO_ERROR || hashResult.size != fileSize) {
+            LOGE("hash %s error: %d, %" PRIu64 "/%" PRIu64, item.local_path.c_str(), hashResult.status, hashResult.size, fileSize);
+            return UNKNOWN_ERROR;
+        }
+        hash = hashResult.content_hash;
+
+        const std::string &accessToken = m_options.access_token.empty() ?
+            GlobalResourceInstance::Get()->token : m_options.access_token;
+        body.erase("pre_hash");
+        body["content_hash_name"] = "sha1";
+        body["content_hash"] = hash;
+        body["proof_code"] = ProofCode(fd, fileSize, accessToken);
+        body["proof_version"] = "v1";
+        statusCode = createFile(body, resp);
+    }
+
+    if (statusCode != HTTP_STATUS_OK && statusCode != HTTP_STATUS_CREATED) {
+        LOGE("create %s => %d %s", item.name.c_str(), statusCode, resp.value("message", "").c_str());
+        return UNKNOWN_ERROR;
+    }
+
+    try {
+        ctx.file_id = resp.at("file_id").get<std::string>();
+        result.file_id = ctx.file_id;
+        result.file_name = resp.value("file_name", item.name);
+        if (resp.value("exist", false)) {
+            LOGW("%s already exists", item.name.c_str());
+            return ALREADY_EXISTS;
+        }
+
+        if (resp.value("rapid_upload", false)) {
+            result.rapid_upload = true;
+            result.elapsed_ms = gettimeofday_ms() - beginMs;
+            LOGI("rapid upload %s: %" PRIu64 " bytes, %" PRIu64 " ms", item.local_path.c_str(), fileSize, result.elapsed_ms);
+            return NO_ERROR;
+        }
+
+        ctx.upload_id = resp.at("upload_id").get<std::string>();
+    } catch (const std::exception &e) {
+        LOGE("invalid " OPENAPI_FILE_CREATE " response: %s. %s", e.what(), resp.dump().c_str());
+        return UNKNOWN_ERROR;
+    }
+
+    // 3、并发上传分片后合并, 失败时放弃本次上传
+    ctx.upload_urls.resize(parts);
+    if (!parseUploadUrls(resp, ctx) || !uploadParts(fd, fileSize, ctx) || !completeFile(ctx, result)) {
+        abortUpload(ctx);
+        return UNKNOWN_ERROR;
+    }
+
+    result.parts = parts;
+    result.elapsed_ms = gettimeofday_ms() - beginMs;
+    LOGI("upload %s: %" PRIu64 " bytes, %u parts, %" PRIu64 " ms, %.2f MB/s", item.local_path.c_str(), fileSize, parts,
+        result.elapsed_ms, result.elapsed_ms > 0 ? fileSize / 1024.0 / 1024.0 * 1000 / result.elapsed_ms : 0.0);
+    return NO_ERROR;
+}
+
+std::string UploadEngine::ProofCode(int32_t fd, uint64_t fileSize, const std::string &accessToken)
+{
+    if (fileSize == 0) {
+        return "";
+    }
+
+    char md5Hex[33] = {0};
+    hv_md5_hex((unsigned char *)accessToken.data(), static_cast<unsigned int>(accessToken.size()), md5Hex, sizeof(md5Hex));
+    uint64_t value = strtoull(std::string(md5Hex, 16).c_str(), nullptr, 16);
+    uint64_t begin = value % fileSize;
+    uint64_t end = std::min<uint64_t>(begin + 8, fileSize);
+
+    uint8_t bytes[8] = {0};
+    if (!ReadFull(fd, bytes, end - begin, begin)) {
+        LOGE("read proof code error. [%d, %s]", errno, strerror(errno));
+        return "";
+    }
+
+    return hv::Base64Encode(bytes, static_cast<unsigned int>(end - begin));
+}
+
+int32_t UploadEngine::createFile(const nlohmann::json &body, nlohmann::json &resp)
+{
+    return post(OPENAPI_FILE_CREATE, body, resp);
+}
+
+int32_t UploadEngine::post(const char *path, const nlohmann::json &body, nlohmann::json &respJson)
+{
+    const std::string &tokenType = m_options.token_type.empty() ?
+        GlobalResourceInstance::Get()->token_type : m_options.token_type;
+    const std::string &accessToken = m_options.access_token.empty() ?
+        GlobalResourceInstance::Get()->token : m_options.access_token;
+
+    http_headers reqHeader;
+    reqHeader["Authorization"] = tokenType + " " + accessToken;
+    reqHeader["Content-Type"] = "application/json";
+
+    std::string url = m_domain + path;
+    auto resp = requests::post(url.c_str(), body.dump(), reqHeader);
+    if (resp == nullptr) {
+        LOGE("POST [%s] failed", url.c_str());
+        return -1;
+    }
+
+    try {
+        respJson = nlohmann::json::parse(resp->body);
+    } catch (const std::exception &e) {
+        LOGE("POST [%s] => %d invalid response: %s", url.c_str(), resp->status_code, e.what());
+        respJson = nlohmann::json::object();
+    }
+
+    return resp->status_code;
+}
+
+bool UploadEngine::parseUploadUrls(const nlohmann::json &resp, UploadContext &ctx)
+{
+    try {
+        std::lock_guard<std::mutex> lock(ctx.url_mutex);
+        for (const auto &partInfo : resp.at("part_info_list")) {
+            uint32_t partNumber = partInfo.at("part_number").get<uint32_t>();
+            if (partNumber == 0 || partNumber > ctx.upload_urls.size()) {
+                continue;
+            }
+            ctx.upload_urls[partNumber - 1] = partInfo.at("upload_url").get<std::string>();
+        }
+    } catch (const std::exception &e) {
+        LOGE("invalid part_info_list: %s", e.what());
+        return false;
+    }
+
+    return true;
+}
+
+bool UploadEngine::refreshUploadUrl(UploadContext &ctx, uint32_t partNumber)
+{
+    nlohmann::json body;
+    body["drive_id"] = ctx.item.drive_id;
+    body["file_id"] = ctx.file_id;
+    body["upload_id"] = ctx.upload_id;
+    body["part_info_list"] = nlohmann::json::array({{{"part_number", partNumber}}});
+
+    nlohmann::json resp;
+    int32_t statusCode = post(OPENAPI_FILE_UPLOAD_URL, body, resp);
+    if (statusCode != HTTP_STATUS_OK) {
+        LOGE("getUploadUrl %s part %u => %d", ctx.item.name.c_str(), partNumber, statusCode);
+        return false;
+    }
+
+    return parseUploadUrls(resp, ctx);
+}
+
+bool UploadEngine::uploadParts(int32_t fd, uint64_t fileSize, UploadContext &ctx)
+{
+    uint32_t parts = static_cast<uint32_t>(ctx.upload_urls.size());
+    uint32_t concurrency = std::min<uint32_t>(m_options.concurrency, parts);
+
+    // 缓冲区在多次上传间复用, 分片变大时才重新分配
+    uint64_t bufferSize = std::min<uint64_t>(ctx.part_size, std::max<uint64_t>(fileSize, 1));
+    m_bufferVec.resize(m_options.buffers);
+    for (auto &buffer : m_bufferVec) {
+        if (buffer.size() < bufferSize) {
+            buffer.assign(bufferSize, 0);
+        }
+    }
+    m_freeBuffers.reset();
+    m_partQueue.reset();
+    for (size_t i = 0; i < m_bufferVec.size(); ++i) {
+        m_freeBuffers.tryPush(size_t(i));
+    }
+
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    std::vector<Thread::SP> workerVec;
+    for (uint32_t i = 0; i < concurrency; ++i) {
+        workerVec.push_back(std::make_shared<Thread>([this, &ctx] () {
+            this->partWorker(ctx);
+        }, "UPLOAD-PART"));
+    }
+
+    // 读取阶段: 没有空闲缓冲区时阻塞, 读取领先上传最多buffers个分片
+    std::vector<size_t> freeVec;
+    for (uint32_t i = 0; i < parts && !ctx.failed; ++i) {
+        freeVec.clear();
+        if (m_freeBuffers.popBulk(freeVec, 1) == 0) {
+            break;
+        }
+
+        PartTask task;
+        task.part_number = i + 1;
+        task.offset = static_cast<uint64_t>(i) * ctx.part_size;
+        task.size = std::min<uint64_t>(ctx.part_size, fileSize - task.offset);
+        task.buffer = freeVec.front();
+        if (!ReadFull(fd, m_bufferVec[task.buffer].data(), task.size, task.offset)) {
+            LOGE("read %s error. [%d, %s]", ctx.item.local_path.c_str(), errno, strerror(errno));
+            ctx.failed = true;
+            break;
+        }
+
+        if (!m_partQueue.push(std::move(task))) {
+            break;
+        }
+    }
+
+    m_partQueue.close();
+    for (auto &worker : workerVec) {
+        worker->join();
+    }
+    m_freeBuffers.close();
+
+    return !ctx.failed;
+}
+
+void UploadEngine::partWorker(UploadContext &ctx)
+{
+    std::vector<PartTask> taskVec;
+    while (true) {
+        taskVec.clear();
+        if (m_partQueue.popBulk(taskVec, 1) == 0) {
+            break;
+        }
+
+        const PartTask &task = taskVec.front();
+        if (!ctx.failed && !putPart(ctx, task)) {
+            // 唤醒等待缓冲区的读取阶段
+            ctx.failed = true;
+            m_freeBuffers.close();
+        }
+        m_freeBuffers.tryPush(size_t(task.buffer));
+    }
+}
+
+bool UploadEngine::putPart(UploadContext &ctx, const PartTask &task)
+{
+    for (uint32_t retry = 0; retry <= UPLOAD_PART_RETRY_TIMES && !ctx.failed; ++retry) {
+        std::string url;
+        {
+            std::lock_guard<std::mutex> lock(ctx.url_mutex);
+            url = ctx.upload_urls[task.part_number - 1];
+        }
+
+        // 直接引用缓冲区, 不拷贝到body
+        auto req = std::make_shared<HttpRequest>();
+        req->method = HTTP_PUT;
+        req->url = url;
+        req->timeout = UPLOAD_REQ_TIMEOUT_S;
+        req->content = m_bufferVec[task.buffer].data();
+        req->content_length = task.size;
+
+        auto resp = requests::request(req);
+        if (resp != nullptr && resp->status_code == HTTP_STATUS_OK) {
+            return true;
+        }
+
+        // 重试时分片可能已上传成功
+        if (resp != nullptr && resp->status_code == HTTP_STATUS_CONFLICT &&
+            resp->body.find("PartAlreadyExist") != std::string::npos) {
+            return true;
+        }
+
+        LOGW("PUT %s part %u => %d", ctx.item.name.c_str(), task.part_number, resp == nullptr ? -1 : resp->status_code);
+        if (resp != nullptr && resp->status_code == HTTP_STATUS_FORBIDDEN) {
+            // 分片地址过期
+            refreshUploadUrl(ctx, task.part_number);
+        }
+    }
+
+    return false;
+}
+
+bool UploadEngine::completeFile(UploadContext &ctx, UploadResult &result)
+{
+    nlohmann::json body;
+    body["drive_id"] = ctx.item.drive_id;
+    body["file_id"] = ctx.file_id;
+    body["upload_id"] = ctx.upload_id;
+
+    nlohmann::json resp;
+    int32_t statusCode = post(OPENAPI_FILE_COMPLETE, body, resp);
+    if (statusCode != HTTP_STATUS_OK) {
+        LOGE("complete %s => %d %s", ctx.item.name.c_str(), statusCode, resp.value("message", "").c_str());
+        return false;
+    }
+
+    result.file_id = resp.value("file_id", ctx.file_id);
+    result.file_name = resp.value("name", result.file_name);
+    return true;
+}
+
+void UploadEngine::abortUpload(UploadContext &ctx)
+{
+    nlohmann::json body;
+    body["drive_id"] = ctx.item.drive_id;
+    body["file_id"] = ctx.file_id;
+
+    nlohmann::json resp;
+    int32_t statusCode = post(OPENAPI_FILE_DELETE, body, resp);
+    if (statusCode < HTTP_STATUS_OK || statusCode >= 300) {
+        LOGW("abort %s: delete %s => %d %s", ctx.item.name.c_str(), ctx.file_id.c_str(), statusCode,
+            resp.value("message", "").c_str());
+        return;
+    }
+
+    LOGI("abort %s: upload %s deleted", ctx.item.name.c_str(), ctx.upload_id.c_str());
+}
+
+} // namespace eular
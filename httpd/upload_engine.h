@@ -0,0 +1,134 @@
+/*************************************************************************
+    > File Name: upload_engine.h
+    > Author: hsz
+    > Brief: 文件上传: 秒传校验及并发分片上传
+    > Created Time: 2026年10月18日 星期日 02时48分06秒
+ ************************************************************************/
+
+#ifndef __HTTPD_UPLOAD_ENGINE_H__
+#define __HTTPD_UPLOAD_ENGINE_H__
+
+#include <stdint.h>
+#include <memory>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include <hv/json.hpp>
+
+#include "bounded_queue.h"
+
+namespace eular {
+
+class HashService;
+
+struct UploadOptions {
+    std::string domain;             // 接口地址, 为空时使用OPENAPI_DOMAIN_NAME, 测试时指向本地模拟服务
+    std::string token_type;         // 为空时使用全局资源中的token
+    std::string access_token;
+    uint64_t    part_size = 16 * 1024 * 1024;   // 分片大小, 分片数超过上限时自动增大
+    uint32_t    concurrency = 4;    // 并发上传的分片数
+    uint32_t    buffers = 0;        // 分片缓冲区数, 0表示concurrency + 2. 内存占用为buffers * part_size
+    bool        rapid_upload = true; // 是否尝试秒传
+    HashService *hash_service = nullptr; // 计算content_hash的服务, 为空时使用HashServiceInstance
+};
+
+struct UploadFileItem {
+    std::string local_path;         // 本地文件
+    std::string drive_id;
+    std::string parent_file_id;
+    std::string name;               // 云盘上的文件名
+    std::string check_name_mode = "auto_rename"; // 同名时的处理: auto_rename, refuse, ignore
+};
+
+struct UploadResult {
+    std::string file_id;
+    std::string file_name;          // 云盘上的文件名, auto_rename时可能与请求的不同
+    bool        rapid_upload = false;
+    uint64_t    size = 0;
+    uint32_t    parts = 0;          // 上传的分片数, 秒传时为0
+    uint64_t    elapsed_ms = 0;
+};
+
+/**
+ * @brief 上传引擎, 同一时间只上传一个文件. 先用文件前1KB的sha1(pre_hash)询问云端, 匹配时再计算整个文件的sha1和proof_code,
+ * 云端已有相同内容时无需上传数据. 否则读取线程将分片读入有界缓冲池, 多个线程并发PUT到分片地址,
+ * 缓冲区用完时读取阻塞, 内存占用固定. 分片地址过期时重新获取, 上传失败时删除未完成的文件
+ */
+class UploadEngine
+{
+public:
+    using SP = std::shared_ptr<UploadEngine>;
+
+    explicit UploadEngine(const UploadOptions &options = UploadOptions());
+    ~UploadEngine() = default;
+
+    /**
+     * @brief 上传文件, 阻塞到完成
+     *
+     * @param item 上传的文件
+     * @param result 输出结果
+     * @return int32_t 成功返回0, 文件不存在返回NAME_NOT_FOUND, 同名文件已存在(refuse)返回ALREADY_EXISTS,
+     *  其他失败返回UNKNOWN_ERROR
+     */
+    int32_t upload(const UploadFileItem &item, UploadResult &result);
+
+    /**
+     * @brief 计算proof_code(v1): 以access_token的md5前16位十六进制数对文件大小取模为起点, 取8字节的base64
+     */
+    static std::string ProofCode(int32_t fd, uint64_t fileSize, const std::string &accessToken);
+
+protected:
+    struct PartTask {
+        uint32_t    part_number = 0;    // 从1开始
+        uint64_t    offset = 0;
+        uint64_t    size = 0;
+        size_t      buffer = 0;         // 缓冲池下标
+    };
+
+    struct UploadContext {
+        UploadFileItem  item;
+        std::string     file_id;
+        std::string     upload_id;
+        uint64_t        part_size = 0;
+        std::mutex      url_mutex;
+        std::vector<std::string>    upload_urls;    // 下标为part_number - 1
+        std::atomic<bool>           failed{false};
+    };
+
+    int32_t uploadFile(int32_t fd, const UploadFileItem &item, UploadResult &result);
+
+    /**
+     * @brief 调用create接口
+     *
+     * @param body 请求体
+     * @param resp 输出响应
+     * @return int32_t http状态码, 请求失败返回-1
+     */
+    int32_t createFile(const nlohmann::json &body, nlohmann::json &resp);
+    int32_t post(const char *path, const nlohmann::json &body, nlohmann::json &resp);
+
+    bool    parseUploadUrls(const nlohmann::json &resp, UploadContext &ctx);
+    bool    refreshUploadUrl(UploadContext &ctx, uint32_t partNumber);
+    bool    uploadParts(int32_t fd, uint64_t fileSize, UploadContext &ctx);
+    void    partWorker(UploadContext &ctx);
+    bool    putPart(UploadContext &ctx, const PartTask &task);
+    bool    completeFile(UploadContext &ctx, UploadResult &result);
+
+    /**
+     * @brief 放弃分片上传: 删除create得到的未完成文件, 不在云端留下残缺的文件
+     */
+    void    abortUpload(UploadContext &ctx);
+
+private:
+    UploadOptions   m_options;
+    std::string     m_domain;
+    std::vector<std::vector<uint8_t>>   m_bufferVec;
+    BoundedBlockingQueue<size_t>        m_freeBuffers;
+    BoundedBlockingQueue<PartTask>      m_partQueue;
+};
+
+} // namespace eular
+
+#endif // __HTTPD_UPLOAD_ENGINE_H__
@@ -0,0 +1,257 @@
+/*************************************************************************
+    > File Name: dir_snapshot.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 18时02分21秒
+ ************************************************************************/
+
+#include "inotify_tool/dir_snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <utils/sysdef.h>
+#include <utils/errors.h>
+
+#ifdef OS_LINUX
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#define GETDENTS_BUF_SIZE   (32 * 1024)
+
+namespace eular {
+
+namespace {
+
+struct LinuxDirent64
+{
+    ino64_t         d_ino;
+    off64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[];
+};
+
+bool EntryLess(const DirSnapshotEntry &entry, std::string_view name)
+{
+    return std::string_view(entry.name) < name;
+}
+
+} // namespace
+
+void DirSnapshot::insert(std::string_view name, uint64_t entryIno, bool isDir)
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), name, EntryLess);
+    if (it != entries.end() && it->name == name)
+    {
+        it->ino = entryIno;
+        it->isDir = isDir;
+        return;
+    }
+
+    entries.insert(it, DirSnapshotEntry{std::string(name), entryIno, isDir});
+}
+
+void DirSnapshot::erase(std::string_view name)
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), name, EntryLess);
+    if (it != entries.end() && it->name == name)
+    {
+        entries.erase(it);
+    }
+}
+
+const DirSnapshotEntry *DirSnapshot::find(std::string_view name) const
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), name, EntryLess);
+    if (it != entries.end() && it->name == name)
+    {
+        return &(*it);
+    }
+
+    return nullptr;
+}
+
+void DirSnapshot::sort()
+{
+    std::sort(entries.begin(), entries.end(), [] (const DirSnapshotEntry &left, const DirSnapshotEntry &right) {
+        return left.name < right.name;
+    });
+}
+
+void DirSnapshot::clear()
+{
+    ino = 0;
+    mtimeNs = 0;
+    entries.clear();
+}
+
+#ifdef STATX_MTIME
+// 内核不支持statx(4.11之前)时回退到fstatat
+static std::atomic<bool> gStatxSupported(true);
+
+static int32_t StatxAt(int32_t dirFd, const char *name, int32_t flags, uint32_t mask, struct statx &stx)
+{
+    if (!gStatxSupported.load(std::memory_order_relaxed))
+    {
+        return -ENOSYS;
+    }
+
+    if (statx(dirFd, name, flags, mask, &stx) == 0)
+    {
+        return NO_ERROR;
+    }
+
+    int32_t error = errno;
+    if (error == ENOSYS)
+    {
+        gStatxSupported.store(false, std::memory_order_relaxed);
+    }
+    return -error;
+}
+#endif
+
+int32_t DirSnapshot::Stat(int32_t fd, uint64_t &ino, int64_t &mtimeNs)
+{
+#ifdef STATX_MTIME
+    // NOTE 只请求inode和mtime, 网络文件系统上可减少属性获取的开销
+    struct statx stx;
+    int32_t status = StatxAt(fd, "", AT_EMPTY_PATH | AT_SYMLINK_NOFOLLOW, STATX_INO | STATX_MTIME, stx);
+    if (status == NO_ERROR)
+    {
+        ino = stx.stx_ino;
+        mtimeNs = static_cast<int64_t>(stx.stx_mtime.tv_sec) * 1000000000 + stx.stx_mtime.tv_nsec;
+        return NO_ERROR;
+    }
+
+    if (status != -ENOSYS)
+    {
+        return status;
+    }
+#endif
+
+    struct stat64 dirStat;
+    if (fstat64(fd, &dirStat) < 0)
+    {
+        return -errno;
+    }
+
+    ino = dirStat.st_ino;
+    mtimeNs = static_cast<int64_t>(dirStat.st_mtim.tv_sec) * 1000000000 + dirStat.st_mtim.tv_nsec;
+    return NO_ERROR;
+}
+
+int32_t DirSnapshot::Stat(int32_t dirFd, const char *name, int64_t &mtimeNs, uint64_t &size)
+{
+#ifdef STATX_MTIME
+    struct statx stx;
+    int32_t status = StatxAt(dirFd, name, AT_SYMLINK_NOFOLLOW, STATX_MTIME | STATX_SIZE, stx);
+    if (status == NO_ERROR)
+    {
+        mtimeNs = static_cast<int64_t>(stx.stx_mtime.tv_sec) * 1000000000 + stx.stx_mtime.tv_nsec;
+        size = stx.stx_size;
+        return NO_ERROR;
+    }
+
+    if (status != -ENOSYS)
+    {
+        return status;
+    }
+#endif
+
+    struct stat64 fileStat;
+    if (fstatat64(dirFd, name, &fileStat, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        return -errno;
+    }
+
+    mtimeNs = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+    size = static_cast<uint64_t>(fileStat.st_size);
+    return NO_ERROR;
+}
+
+int32_t DirSnapshot::Read(int32_t dirFd, DirSnapshot &snapshot)
+{
+    snapshot.entries.clear();
+
+    // NOTE 先取mtime再读目录, 读取期间的修改会使下一次比较时mtime不同, 不会遗漏
+    int32_t status = Stat(dirFd, snapshot.ino, snapshot.mtimeNs);
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    std::vector<uint8_t> direntBuf(GETDENTS_BUF_SIZE);
+    lseek(dirFd, 0, SEEK_SET);
+    while (true)
+    {
+        long readSize = syscall(SYS_getdents64, dirFd, direntBuf.data(), direntBuf.size());
+        if (readSize < 0)
+        {
+            return -errno;
+        }
+
+        if (readSize == 0)
+        {
+            break;
+        }
+
+        for (long offset = 0; offset < readSize; )
+        {
+            const LinuxDirent64 *pEntry = reinterpret_cast<const LinuxDirent64 *>(direntBuf.data() + offset);
+            offset += pEntry->d_reclen;
+
+            const char *pName = pEntry->d_name;
+            if (pName[0] == '.' && (pName[1] == '\0' || (pName[1] == '.' && pName[2] == '\0')))
+            {
+                continue;
+            }
+
+            bool isDirFlag = (pEntry->d_type == DT_DIR);
+            if (pEntry->d_type == DT_UNKNOWN)
+            {
+                struct stat64 itemStat;
+                if (fstatat64(dirFd, pName, &itemStat, AT_SYMLINK_NOFOLLOW) == 0)
+                {
+                    isDirFlag = S_ISDIR(itemStat.st_mode);
+                }
+            }
+
+            snapshot.entries.push_back(DirSnapshotEntry{pName, pEntry->d_ino, isDirFlag});
+        }
+    }
+
+    snapshot.sort();
+    return NO_ERROR;
+}
+
+void DirSnapshot::Diff(const DirSnapshot &oldSnapshot, const DirSnapshot &newSnapshot, const DiffCallback &cb)
+{
+    auto oldIt = oldSnapshot.entries.begin();
+    auto newIt = newSnapshot.entries.begin();
+    while (oldIt != oldSnapshot.entries.end() || newIt != newSnapshot.entries.end())
+    {
+        if (newIt == newSnapshot.entries.end() || (oldIt != oldSnapshot.entries.end() && oldIt->name < newIt->name))
+        {
+            cb(&(*oldIt), nullptr);
+            ++oldIt;
+        }
+        else if (oldIt == oldSnapshot.entries.end() || newIt->name < oldIt->name)
+        {
+            cb(nullptr, &(*newIt));
+            ++newIt;
+        }
+        else
+        {
+            cb(&(*oldIt), &(*newIt));
+            ++oldIt;
+            ++newIt;
+        }
+    }
+}
+
+} // namespace eular
@@ -0,0 +1,95 @@
+/*************************************************************************
+    > File Name: dir_snapshot.h
+    > Author: hsz
+    > Brief: 目录快照, 用于事件队列溢出后的增量重新同步
+    > Created Time: 2026年10月17日 星期六 18时02分15秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_DIR_SNAPSHOT_H__
+#define __INOTIFY_DIR_SNAPSHOT_H__
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+
+namespace eular {
+
+struct DirSnapshotEntry
+{
+    std::string name;       // 文件/目录名
+    uint64_t    ino;        // inode, 由事件插入时为0(未知)
+    bool        isDir;
+};
+
+/**
+ * @brief 目录的inode, mtime和子项列表(按名字排序). 遍历时建立, 之后随事件增量更新,
+ * 溢出时只需重新读取mtime变化的目录并与快照比较
+ */
+struct DirSnapshot
+{
+    uint64_t    ino = 0;
+    int64_t     mtimeNs = 0;    // 0表示未建立
+    std::vector<DirSnapshotEntry> entries;
+
+    bool valid() const { return mtimeNs != 0; }
+
+    /**
+     * @brief 插入或更新子项, 保持有序
+     */
+    void insert(std::string_view name, uint64_t ino, bool isDir);
+
+    /**
+     * @brief 删除子项
+     */
+    void erase(std::string_view name);
+
+    /**
+     * @brief 查找子项
+     *
+     * @return const DirSnapshotEntry* 不存在返回nullptr
+     */
+    const DirSnapshotEntry *find(std::string_view name) const;
+
+    /**
+     * @brief 批量追加后排序
+     */
+    void sort();
+
+    void clear();
+
+    /**
+     * @brief 读取目录的inode, mtime和子项
+     *
+     * @param dirFd 目录句柄
+     * @param snapshot 输出
+     * @return int32_t 成功返回0, 失败返回-errno
+     */
+    static int32_t Read(int32_t dirFd, DirSnapshot &snapshot);
+
+    /**
+     * @brief 获取句柄的inode和mtime
+     *
+     * @return int32_t 成功返回0, 失败返回-errno
+     */
+    static int32_t Stat(int32_t fd, uint64_t &ino, int64_t &mtimeNs);
+
+    /**
+     * @brief 获取目录下文件的mtime和大小(不跟随符号链接), 只请求这两个字段
+     *
+     * @return int32_t 成功返回0, 失败返回-errno
+     */
+    static int32_t Stat(int32_t dirFd, const char *name, int64_t &mtimeNs, uint64_t &size);
+
+    /**
+     * @brief 比较两个快照, 对每个子项调用cb:
+     *  新增: oldEntry为nullptr; 删除: newEntry为nullptr; 都存在: 两者均非空(inode不同表示被替换)
+     */
+    typedef std::function<void(const DirSnapshotEntry *oldEntry, const DirSnapshotEntry *newEntry)> DiffCallback;
+    static void Diff(const DirSnapshot &oldSnapshot, const DirSnapshot &newSnapshot, const DiffCallback &cb);
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_DIR_SNAPSHOT_H__
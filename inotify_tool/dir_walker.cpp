@@ -0,0 +1,422 @@
+/*************************************************************************
+    > File Name: dir_walker.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 13时40分58秒
+ ************************************************************************/
+
+#include "inotify_tool/dir_walker.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <utils/sysdef.h>
+#include <utils/errors.h>
+#include <log/log.h>
+
+#ifdef OS_LINUX
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#define LOG_TAG "Dir-walker"
+
+#define GETDENTS_BUF_SIZE   (32 * 1024)
+#define MAX_OPEN_FDS        256         // 预先openat的子目录句柄上限, 超出后按路径打开
+
+namespace eular {
+
+namespace {
+
+struct LinuxDirent64
+{
+    ino64_t         d_ino;
+    off64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[];
+};
+
+struct WorkItem
+{
+    uint32_t    id;
+    uint32_t    parentId;
+    int32_t     fd;         // 由父目录openat得到的句柄, -1表示按路径打开
+    std::string name;
+    std::string path;
+};
+
+struct WorkQueue
+{
+    std::mutex              mutex;
+    std::deque<WorkItem>    items;
+};
+
+struct WorkerLocal
+{
+    std::vector<DirWalker::Record>  records;
+    uint64_t    entries = 0;
+    uint64_t    statCalls = 0;
+};
+
+class WalkContext
+{
+public:
+    WalkContext(uint32_t threads, const DirWalker::Visitor &visitor, bool collectSnapshot) :
+        m_queues(threads),
+        m_locals(threads),
+        m_visitor(visitor),
+        m_collectSnapshot(collectSnapshot),
+        m_pending(0),
+        m_nextId(0),
+        m_openFds(0),
+        m_error(0)
+    {
+    }
+
+    ~WalkContext()
+    {
+        // 出错终止时队列中可能还有已打开的句柄
+        for (auto &queue : m_queues)
+        {
+            for (auto &item : queue.items)
+            {
+                if (item.fd >= 0)
+                {
+                    close(item.fd);
+                }
+            }
+        }
+    }
+
+    void push(uint32_t worker, WorkItem &&item)
+    {
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(m_queues[worker].mutex);
+        m_queues[worker].items.push_back(std::move(item));
+    }
+
+    uint32_t allocId()
+    {
+        return m_nextId.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void run(uint32_t worker)
+    {
+        std::vector<uint8_t> direntBuf(GETDENTS_BUF_SIZE);
+        uint32_t idleCount = 0;
+
+        while (m_error.load(std::memory_order_relaxed) == 0)
+        {
+            WorkItem item;
+            if (!pop(worker, item))
+            {
+                if (m_pending.load(std::memory_order_acquire) == 0)
+                {
+                    break;
+                }
+
+                if (++idleCount < 64)
+                {
+                    std::this_thread::yield();
+                }
+                else
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+                continue;
+            }
+
+            idleCount = 0;
+            process(worker, item, direntBuf);
+            m_pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    int32_t error() const { return m_error.load(); }
+    uint32_t count() const { return m_nextId.load(); }
+    std::vector<WorkerLocal> &locals() { return m_locals; }
+
+private:
+    bool pop(uint32_t worker, WorkItem &item)
+    {
+        // 优先从自己队列尾部取(深度优先, 局部性好), 否则从其他队列头部窃取
+        {
+            std::lock_guard<std::mutex> lock(m_queues[worker].mutex);
+            if (!m_queues[worker].items.empty())
+            {
+                item = std::move(m_queues[worker].items.back());
+                m_queues[worker].items.pop_back();
+                return true;
+            }
+        }
+
+        for (size_t i = 1; i < m_queues.size(); ++i)
+        {
+            WorkQueue &victim = m_queues[(worker + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.items.empty())
+            {
+                item = std::move(victim.items.front());
+                victim.items.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void setError(int32_t code)
+    {
+        int32_t expected = 0;
+        m_error.compare_exchange_strong(expected, code);
+    }
+
+    void closeFd(int32_t fd)
+    {
+        close(fd);
+        m_openFds.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void process(uint32_t worker, WorkItem &item, std::vector<uint8_t> &direntBuf)
+    {
+        WorkerLocal &local = m_locals[worker];
+        DirWalker::Record record = {item.id, item.parentId, std::move(item.name), std::move(item.path), 0, DirSnapshot()};
+        int32_t status = m_visitor(record);
+        if (status < 0)
+        {
+            setError(status);
+            if (item.fd >= 0)
+            {
+                closeFd(item.fd);
+            }
+            return;
+        }
+
+        local.records.push_back(std::move(record));
+        DirWalker::Record &current = local.records.back();
+        const std::string &dirPath = current.path;
+        if (status == WALK_SKIP)
+        {
+            if (item.fd >= 0)
+            {
+                closeFd(item.fd);
+            }
+            return;
+        }
+
+        int32_t dirFd = item.fd;
+        if (dirFd < 0)
+        {
+            int32_t flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+            if (item.parentId != WALK_INVALID_ID)
+            {
+                flags |= O_NOFOLLOW;
+            }
+
+            dirFd = open(dirPath.c_str(), flags);
+            if (dirFd < 0)
+            {
+                if (errno != EACCES && errno != ENOENT && errno != ENOTDIR && errno != ELOOP)
+                {
+                    setError(-errno);
+                }
+
+                LOGW("open(%s) error. [%d, %s]", dirPath.c_str(), errno, strerror(errno));
+                return;
+            }
+
+            m_openFds.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // NOTE 先取mtime再读目录, 读取期间的修改会使下一次比较时mtime不同, 不会遗漏
+        DirSnapshot *pSnapshot = nullptr;
+        if (m_collectSnapshot && DirSnapshot::Stat(dirFd, current.snapshot.ino, current.snapshot.mtimeNs) == NO_ERROR)
+        {
+            pSnapshot = &current.snapshot;
+        }
+
+        uint32_t parentId = current.id;
+        while (true)
+        {
+            long readSize = syscall(SYS_getdents64, dirFd, direntBuf.data(), direntBuf.size());
+            if (readSize <= 0)
+            {
+                if (readSize < 0)
+                {
+                    LOGW("getdents64(%s) error. [%d, %s]", dirPath.c_str(), errno, strerror(errno));
+                    if (pSnapshot != nullptr)
+                    {
+                        // 不完整的快照在下一次比较时重新读取
+                        pSnapshot->mtimeNs = 0;
+                    }
+                }
+                break;
+            }
+
+            for (long offset = 0; offset < readSize; )
+            {
+                const LinuxDirent64 *pEntry = reinterpret_cast<const LinuxDirent64 *>(direntBuf.data() + offset);
+                offset += pEntry->d_reclen;
+
+                const char *pName = pEntry->d_name;
+                if (pName[0] == '.' && (pName[1] == '\0' || (pName[1] == '.' && pName[2] == '\0')))
+                {
+                    continue;
+                }
+
+                ++local.entries;
+                bool isDirFlag = (pEntry->d_type == DT_DIR);
+                if (pEntry->d_type == DT_UNKNOWN)
+                {
+                    // 部分文件系统不提供d_type
+                    struct stat64 itemStat;
+                    ++local.statCalls;
+                    if (fstatat64(dirFd, pName, &itemStat, AT_SYMLINK_NOFOLLOW) == 0)
+                    {
+                        isDirFlag = S_ISDIR(itemStat.st_mode);
+                    }
+                }
+
+                if (pSnapshot != nullptr)
+                {
+                    pSnapshot->entries.push_back(DirSnapshotEntry{pName, pEntry->d_ino, isDirFlag});
+                }
+
+                if (!isDirFlag)
+                {
+                    continue;
+                }
+
+                int32_t childFd = -1;
+                if (m_openFds.load(std::memory_order_relaxed) < MAX_OPEN_FDS)
+                {
+                    childFd = openat(dirFd, pName, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                    if (childFd >= 0)
+                    {
+                        m_openFds.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+
+                WorkItem child;
+                child.id = allocId();
+                child.parentId = parentId;
+                child.fd = childFd;
+                child.name = pName;
+                child.path.reserve(dirPath.length() + child.name.length() + 1);
+                child.path.append(dirPath).append(child.name).push_back('/');
+                push(worker, std::move(child));
+            }
+        }
+
+        closeFd(dirFd);
+
+        if (pSnapshot != nullptr)
+        {
+            pSnapshot->sort();
+        }
+    }
+
+private:
+    std::vector<WorkQueue>      m_queues;
+    std::vector<WorkerLocal>    m_locals;
+    const DirWalker::Visitor &  m_visitor;
+    bool                        m_collectSnapshot;
+    std::atomic<int64_t>        m_pending;  // 队列中及正在处理的目录数
+    std::atomic<uint32_t>       m_nextId;
+    std::atomic<int32_t>        m_openFds;
+    std::atomic<int32_t>        m_error;
+};
+
+} // namespace
+
+DirWalker::DirWalker(uint32_t threads, bool collectSnapshot) :
+    m_threads(threads > 0 ? threads : 1),
+    m_collectSnapshot(collectSnapshot)
+{
+}
+
+DirWalker::~DirWalker()
+{
+}
+
+int32_t DirWalker::walk(const std::string &rootPath, const std::string &rootName,
+                        const Visitor &visitor, std::vector<Record> &records)
+{
+    auto beginTime = std::chrono::steady_clock::now();
+    m_stats = DirWalkerStats();
+    records.clear();
+
+    WalkContext context(m_threads, visitor, m_collectSnapshot);
+
+    WorkItem root;
+    root.id = context.allocId();
+    root.parentId = WALK_INVALID_ID;
+    root.fd = -1;
+    root.name = rootName;
+    root.path = rootPath;
+    if (root.path.empty() || root.path.back() != '/')
+    {
+        root.path.push_back('/');
+    }
+    context.push(0, std::move(root));
+
+    std::vector<std::thread> threadVec;
+    for (uint32_t i = 1; i < m_threads; ++i)
+    {
+        threadVec.emplace_back(&WalkContext::run, &context, i);
+    }
+    context.run(0);
+    for (auto &it : threadVec)
+    {
+        it.join();
+    }
+
+    // 合并各线程的结果, 成功时每个序号都被访问过, 可直接按序号放置
+    bool failed = (context.error() != 0);
+    if (!failed)
+    {
+        records.resize(context.count());
+    }
+
+    for (auto &local : context.locals())
+    {
+        for (auto &record : local.records)
+        {
+            if (failed)
+            {
+                records.push_back(std::move(record));
+            }
+            else
+            {
+                uint32_t id = record.id;
+                records[id] = std::move(record);
+            }
+        }
+
+        m_stats.entries += local.entries;
+        m_stats.statCalls += local.statCalls;
+    }
+    m_stats.dirs = records.size();
+
+    auto elapsed = std::chrono::steady_clock::now() - beginTime;
+    m_stats.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    m_stats.dirsPerSec = seconds > 0 ? m_stats.dirs / seconds : 0;
+
+    if (failed)
+    {
+        // 失败时records只包含已访问的目录(无序), 便于调用者回滚
+        return context.error();
+    }
+
+    return NO_ERROR;
+}
+
+} // namespace eular
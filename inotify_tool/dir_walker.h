@@ -0,0 +1,93 @@
+/*************************************************************************
+    > File Name: dir_walker.h
+    > Author: hsz
+    > Brief: 多线程目录遍历
+    > Created Time: 2026年10月17日 星期六 13时40分52秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_DIR_WALKER_H__
+#define __INOTIFY_DIR_WALKER_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "inotify_tool/dir_snapshot.h"
+
+#define WALK_INVALID_ID     UINT32_MAX
+
+#define WALK_CONTINUE       0   // 继续遍历子目录
+#define WALK_SKIP           1   // 跳过此目录的子目录
+
+namespace eular {
+
+struct DirWalkerStats
+{
+    uint64_t    dirs = 0;           // 访问的目录数
+    uint64_t    entries = 0;        // 读取的目录项数
+    uint64_t    statCalls = 0;      // d_type未知时的fstatat次数
+    uint64_t    elapsedMs = 0;      // 总耗时
+    double      dirsPerSec = 0;     // 每秒目录数
+};
+
+/**
+ * @brief 多线程work-stealing目录遍历. 使用openat/getdents64读取目录, 依赖d_type判断目录,
+ * 仅当文件系统不提供d_type时才调用fstatat. 遍历结果在各线程本地收集, 结束后统一合并
+ */
+class DirWalker
+{
+public:
+    struct Record
+    {
+        uint32_t    id;         // 目录序号, 父目录的序号总是小于子目录
+        uint32_t    parentId;   // 父目录序号, 根目录为WALK_INVALID_ID
+        std::string name;       // 目录名, 根目录为完整路径
+        std::string path;       // 完整路径, 以'/'结尾
+        int64_t     userData;   // 由visitor填写
+        DirSnapshot snapshot;   // 目录快照, 仅在collectSnapshot时填写
+    };
+
+    /**
+     * @brief 访问目录时的回调, 在读取目录内容之前调用, 可能在多个线程中同时调用
+     * 返回WALK_CONTINUE继续遍历, WALK_SKIP跳过子目录, 负值终止遍历并作为walk的返回值
+     */
+    typedef std::function<int32_t(Record &record)> Visitor;
+
+    /**
+     * @brief 构造
+     *
+     * @param threads 线程数, 小于等于1时在调用线程中遍历
+     * @param collectSnapshot 是否同时记录每个目录的快照(inode, mtime, 子项)
+     */
+    DirWalker(uint32_t threads = 1, bool collectSnapshot = false);
+    ~DirWalker();
+
+    /**
+     * @brief 遍历目录树
+     *
+     * @param rootPath 根目录, 以'/'结尾
+     * @param rootName 根目录的名字(写入Record::name)
+     * @param visitor 回调
+     * @param records 输出, 成功时按id排序(records[i].id == i), 失败时为已访问的目录
+     * @return int32_t 成功返回0, 失败返回visitor返回的负值或-errno
+     */
+    int32_t walk(const std::string &rootPath, const std::string &rootName,
+                 const Visitor &visitor, std::vector<Record> &records);
+
+    /**
+     * @brief 获取上一次遍历的统计信息
+     *
+     * @return const DirWalkerStats&
+     */
+    const DirWalkerStats &stats() const { return m_stats; }
+
+private:
+    uint32_t        m_threads;
+    bool            m_collectSnapshot;
+    DirWalkerStats  m_stats;
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_DIR_WALKER_H__
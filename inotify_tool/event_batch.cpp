@@ -0,0 +1,291 @@
+/*************************************************************************
+    > File Name: event_batch.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 17时05分29秒
+ ************************************************************************/
+
+#include "inotify_tool/event_batch.h"
+
+#include <string.h>
+
+#define FNV_OFFSET_BASIS    0xcbf29ce484222325ULL
+#define FNV_PRIME           0x100000001b3ULL
+
+namespace eular {
+
+InotifyEventItem InotifyEventView::toItem() const
+{
+    InotifyEventItem eventItem;
+    eventItem.event = event;
+    eventItem.cookie = cookie;
+    eventItem.path.assign(path.data(), path.size());
+    eventItem.name.assign(name.data(), name.size());
+    eventItem.fromPath.assign(fromPath.data(), fromPath.size());
+    eventItem.fromName.assign(fromName.data(), fromName.size());
+    eventItem.readNs = readNs;
+    eventItem.emitNs = emitNs;
+    return eventItem;
+}
+
+InotifyEventBatch::InotifyEventBatch(size_t blockSize) :
+    m_blockSize(blockSize > 0 ? blockSize : 4096),
+    m_blockIdx(0),
+    m_blockUsed(0),
+    m_pathKey(nullptr),
+    m_published(0),
+    m_readNs(0)
+{
+}
+
+void InotifyEventBatch::push(uint32_t event, uint32_t cookie, std::string_view path, std::string_view name)
+{
+    pushStored(event, cookie, store(path), name);
+}
+
+void InotifyEventBatch::pushStored(uint32_t event, uint32_t cookie, std::string_view storedPath, std::string_view name)
+{
+    InotifyEventView view;
+    view.event = event;
+    view.cookie = cookie;
+    view.path = storedPath;
+    view.name = store(name);
+    view.readNs = m_readNs;
+    m_viewVec.push_back(view);
+}
+
+void InotifyEventBatch::pushMove(uint32_t event, uint32_t cookie, std::string_view storedPath, std::string_view name,
+                                 std::string_view fromPath, std::string_view fromName)
+{
+    InotifyEventView view;
+    view.event = event;
+    view.cookie = cookie;
+    view.path = storedPath;
+    view.name = store(name);
+    view.fromPath = store(fromPath);
+    view.fromName = store(fromName);
+    view.readNs = m_readNs;
+    m_viewVec.push_back(view);
+}
+
+void InotifyEventBatch::setEmitNs(size_t begin, uint64_t emitNs)
+{
+    for (size_t i = begin; i < m_viewVec.size(); ++i)
+    {
+        m_viewVec[i].emitNs = emitNs;
+    }
+}
+
+std::string_view InotifyEventBatch::store(std::string_view str)
+{
+    if (str.empty())
+    {
+        return std::string_view();
+    }
+
+    char *pData = _alloc(str.size());
+    memcpy(pData, str.data(), str.size());
+    return std::string_view(pData, str.size());
+}
+
+bool InotifyEventBatch::cachedPath(const void *key, std::string_view &path) const
+{
+    if (key == nullptr || key != m_pathKey)
+    {
+        return false;
+    }
+
+    path = m_pathView;
+    return true;
+}
+
+std::string_view InotifyEventBatch::storePath(const void *key, std::string_view path)
+{
+    m_pathKey = key;
+    m_pathView = store(path);
+    return m_pathView;
+}
+
+void InotifyEventBatch::forgetPath()
+{
+    m_pathKey = nullptr;
+    m_pathView = std::string_view();
+}
+
+void InotifyEventBatch::clear()
+{
+    m_blockIdx = 0;
+    m_blockUsed = 0;
+    m_viewVec.clear();
+    m_published = 0;
+    forgetPath();
+}
+
+void InotifyEventBatch::toItemList(std::list<InotifyEventItem> &eventItemList) const
+{
+    for (const auto &view : m_viewVec)
+    {
+        eventItemList.push_back(view.toItem());
+    }
+}
+
+size_t InotifyEventBatch::capacity() const
+{
+    size_t total = 0;
+    for (const auto &block : m_blockVec)
+    {
+        total += block.size;
+    }
+
+    return total;
+}
+
+char *InotifyEventBatch::_alloc(size_t len)
+{
+    while (true)
+    {
+        if (m_blockIdx == m_blockVec.size())
+        {
+            Block block;
+            block.size = len > m_blockSize ? len : m_blockSize;
+            block.data.reset(new char[block.size]);
+            m_blockVec.push_back(std::move(block));
+        }
+
+        Block &block = m_blockVec[m_blockIdx];
+        if (m_blockUsed + len <= block.size)
+        {
+            char *pData = block.data.get() + m_blockUsed;
+            m_blockUsed += len;
+            return pData;
+        }
+
+        // 已分配的视图仍指向旧块, 不能移动, 换下一块
+        ++m_blockIdx;
+        m_blockUsed = 0;
+    }
+}
+
+ModifySet::ModifySet(size_t capacity) :
+    m_size(0),
+    m_deleted(0)
+{
+    size_t realCapacity = 16;
+    while (realCapacity < capacity)
+    {
+        realCapacity <<= 1;
+    }
+
+    m_slotVec.resize(realCapacity, Slot{0, 0, SLOT_EMPTY});
+}
+
+bool ModifySet::insert(int32_t wd, uint64_t nameHash)
+{
+    if (_find(wd, nameHash) != m_slotVec.size())
+    {
+        return false;
+    }
+
+    // 负载(含墓碑)超过1/2时扩容或清理墓碑
+    if ((m_size + m_deleted + 1) * 2 > m_slotVec.size())
+    {
+        _rehash(m_size * 4 > m_slotVec.size() ? m_slotVec.size() * 2 : m_slotVec.size());
+    }
+
+    size_t mask = m_slotVec.size() - 1;
+    for (size_t idx = (nameHash ^ static_cast<uint32_t>(wd)) & mask; ; idx = (idx + 1) & mask)
+    {
+        Slot &slot = m_slotVec[idx];
+        if (slot.state != SLOT_USED)
+        {
+            if (slot.state == SLOT_DELETED)
+            {
+                --m_deleted;
+            }
+
+            slot.hash = nameHash;
+            slot.wd = wd;
+            slot.state = SLOT_USED;
+            ++m_size;
+            return true;
+        }
+    }
+}
+
+bool ModifySet::erase(int32_t wd, uint64_t nameHash)
+{
+    size_t idx = _find(wd, nameHash);
+    if (idx == m_slotVec.size())
+    {
+        return false;
+    }
+
+    m_slotVec[idx].state = SLOT_DELETED;
+    --m_size;
+    ++m_deleted;
+    return true;
+}
+
+bool ModifySet::contains(int32_t wd, uint64_t nameHash) const
+{
+    return _find(wd, nameHash) != m_slotVec.size();
+}
+
+void ModifySet::clear()
+{
+    for (auto &slot : m_slotVec)
+    {
+        slot.state = SLOT_EMPTY;
+    }
+
+    m_size = 0;
+    m_deleted = 0;
+}
+
+uint64_t ModifySet::Hash(std::string_view name)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (unsigned char ch : name)
+    {
+        hash ^= ch;
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+size_t ModifySet::_find(int32_t wd, uint64_t nameHash) const
+{
+    size_t mask = m_slotVec.size() - 1;
+    for (size_t idx = (nameHash ^ static_cast<uint32_t>(wd)) & mask; ; idx = (idx + 1) & mask)
+    {
+        const Slot &slot = m_slotVec[idx];
+        if (slot.state == SLOT_EMPTY)
+        {
+            return m_slotVec.size();
+        }
+
+        if (slot.state == SLOT_USED && slot.hash == nameHash && slot.wd == wd)
+        {
+            return idx;
+        }
+    }
+}
+
+void ModifySet::_rehash(size_t capacity)
+{
+    std::vector<Slot> oldSlotVec(capacity, Slot{0, 0, SLOT_EMPTY});
+    oldSlotVec.swap(m_slotVec);
+
+    m_size = 0;
+    m_deleted = 0;
+    for (const auto &slot : oldSlotVec)
+    {
+        if (slot.state == SLOT_USED)
+        {
+            insert(slot.wd, slot.hash);
+        }
+    }
+}
+
+} // namespace eular
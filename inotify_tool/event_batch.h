@@ -0,0 +1,200 @@
+/*************************************************************************
+    > File Name: event_batch.h
+    > Author: hsz
+    > Brief: 基于内存池的事件批次, 解析热路径上不产生堆分配
+    > Created Time: 2026年10月17日 星期六 17时05分22秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_EVENT_BATCH_H__
+#define __INOTIFY_EVENT_BATCH_H__
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <list>
+#include <vector>
+#include <memory>
+
+#include "inotify_tool/inotify_event.h"
+
+namespace eular {
+
+/**
+ * @brief 事件视图, path/name指向批次内存池, 批次清空后失效
+ */
+struct InotifyEventView
+{
+    uint32_t            event = 0;  // 产生的事件
+    uint32_t            cookie = 0; // 关联两个事件
+    std::string_view    path;       // 所在目录, 以'/'结尾
+    std::string_view    name;       // 发生事件的文件名
+    std::string_view    fromPath;   // EV_IN_MOVE/EV_IN_COPY时原所在目录
+    std::string_view    fromName;   // EV_IN_MOVE/EV_IN_COPY时原文件名
+    uint64_t            readNs = 0; // 读出时的单调时钟纳秒
+    uint64_t            emitNs = 0; // 交付时的单调时钟纳秒
+
+    InotifyEventItem toItem() const;
+};
+
+/**
+ * @brief 一批事件. 字符串存放在按块分配的内存池中, clear只重置偏移, 块和视图数组的容量保留复用,
+ * 稳定运行后push不再分配内存
+ */
+class InotifyEventBatch
+{
+public:
+    InotifyEventBatch(size_t blockSize = 64 * 1024);
+    ~InotifyEventBatch() = default;
+
+    InotifyEventBatch(const InotifyEventBatch &) = delete;
+    InotifyEventBatch &operator=(const InotifyEventBatch &) = delete;
+
+    /**
+     * @brief 追加事件, path和name被拷贝到内存池
+     */
+    void push(uint32_t event, uint32_t cookie, std::string_view path, std::string_view name);
+
+    /**
+     * @brief 追加事件, path已位于内存池中(由storePath返回), 不再拷贝
+     */
+    void pushStored(uint32_t event, uint32_t cookie, std::string_view storedPath, std::string_view name);
+
+    /**
+     * @brief 追加带原位置的事件(EV_IN_MOVE/EV_IN_COPY), storedPath已位于内存池中, 其他字符串被拷贝
+     */
+    void pushMove(uint32_t event, uint32_t cookie, std::string_view storedPath, std::string_view name,
+                  std::string_view fromPath, std::string_view fromName);
+
+    /**
+     * @brief 拷贝字符串到内存池
+     *
+     * @return std::string_view 池中的视图
+     */
+    std::string_view store(std::string_view str);
+
+    /**
+     * @brief 单项路径缓存, 连续多个事件来自同一目录时只拷贝一次路径
+     *
+     * @param key 目录标识(WatchNode指针)
+     * @param path 输出池中的路径
+     * @return true 命中
+     */
+    bool cachedPath(const void *key, std::string_view &path) const;
+    std::string_view storePath(const void *key, std::string_view path);
+
+    /**
+     * @brief 目录树变化(移动/删除)后调用, 使路径缓存失效
+     */
+    void forgetPath();
+
+    void clear();
+
+    /**
+     * @brief 设置之后push的事件的读出时间
+     *
+     * @param readNs 单调时钟纳秒
+     */
+    void stamp(uint64_t readNs) { m_readNs = readNs; }
+
+    /**
+     * @brief 设置从begin开始的事件的交付时间
+     */
+    void setEmitNs(size_t begin, uint64_t emitNs);
+
+    /**
+     * @brief 已分发给订阅者的事件数, clear后归零
+     */
+    size_t published() const { return m_published; }
+    void setPublished(size_t count) { m_published = count; }
+
+    bool empty() const { return m_viewVec.empty(); }
+    size_t size() const { return m_viewVec.size(); }
+    const InotifyEventView &operator[](size_t idx) const { return m_viewVec[idx]; }
+    const InotifyEventView *begin() const { return m_viewVec.data(); }
+    const InotifyEventView *end() const { return m_viewVec.data() + m_viewVec.size(); }
+
+    /**
+     * @brief 转换为InotifyEventItem并追加到list(兼容旧接口, 会分配内存)
+     */
+    void toItemList(std::list<InotifyEventItem> &eventItemList) const;
+
+    /**
+     * @brief 内存池占用字节数
+     */
+    size_t capacity() const;
+
+protected:
+    char *_alloc(size_t len);
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t                  size;
+    };
+
+    size_t                          m_blockSize;
+    size_t                          m_blockIdx;     // 当前使用的块
+    size_t                          m_blockUsed;    // 当前块已使用字节
+    std::vector<Block>              m_blockVec;
+    std::vector<InotifyEventView>   m_viewVec;
+    const void                     *m_pathKey;
+    std::string_view                m_pathView;
+    size_t                          m_published;
+    uint64_t                        m_readNs;
+};
+
+/**
+ * @brief 开放寻址(线性探测)的修改记录集合, key为(wd, 文件名64位哈希). 删除使用墓碑标记,
+ * 只在扩容时分配内存
+ */
+class ModifySet
+{
+public:
+    ModifySet(size_t capacity = 256);
+    ~ModifySet() = default;
+
+    /**
+     * @return true 新插入
+     * @return false 已存在
+     */
+    bool insert(int32_t wd, uint64_t nameHash);
+
+    /**
+     * @return true 存在并已删除
+     * @return false 不存在
+     */
+    bool erase(int32_t wd, uint64_t nameHash);
+
+    bool contains(int32_t wd, uint64_t nameHash) const;
+    void clear();
+    size_t size() const { return m_size; }
+
+    static uint64_t Hash(std::string_view name);
+
+protected:
+    size_t _find(int32_t wd, uint64_t nameHash) const;
+    void _rehash(size_t capacity);
+
+private:
+    enum SlotState : uint8_t {
+        SLOT_EMPTY,
+        SLOT_USED,
+        SLOT_DELETED,
+    };
+
+    struct Slot
+    {
+        uint64_t    hash;
+        int32_t     wd;
+        SlotState   state;
+    };
+
+    std::vector<Slot>   m_slotVec;  // 容量为2的幂
+    size_t              m_size;     // 使用中的槽数
+    size_t              m_deleted;  // 墓碑数
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_EVENT_BATCH_H__
@@ -0,0 +1,450 @@
+/*************************************************************************
+    > File Name: event_coalescer.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 16时31分12秒
+ ************************************************************************/
+
+#include "inotify_tool/event_coalescer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#define BARRIER_EVENT (EV_IN_ERROR | EV_IN_UNMOUNT | EV_IN_IGNORED | EV_IN_Q_OVERFLOW)
+
+namespace eular {
+
+EventCoalescer::EventCoalescer(uint32_t quietWindowMs) :
+    m_quietWindowMs(quietWindowMs),
+    m_seq(0)
+{
+}
+
+void EventCoalescer::setQuietWindow(uint32_t quietWindowMs)
+{
+    m_quietWindowMs = quietWindowMs;
+}
+
+uint64_t EventCoalescer::NowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string EventCoalescer::Key(const std::string &path, const std::string &name)
+{
+    std::string key;
+    key.reserve(path.length() + name.length());
+    key.append(path).append(name);
+    return key;
+}
+
+void EventCoalescer::push(std::list<InotifyEventItem> &eventItemList)
+{
+    push(eventItemList, NowMs());
+}
+
+void EventCoalescer::push(std::list<InotifyEventItem> &eventItemList, uint64_t nowMs)
+{
+    for (auto &item : eventItemList)
+    {
+        ++m_stats.input;
+        uint32_t ev = item.event;
+
+        // 特殊事件之前的积压事件必须先输出
+        if ((ev & BARRIER_EVENT) || item.name.empty())
+        {
+            _flushPrefix("");
+            m_readyList.push_back(std::move(item));
+            continue;
+        }
+
+        if ((ev & EV_IN_MOVE) == EV_IN_MOVE)
+        {
+            _onMove(item, nowMs);
+            continue;
+        }
+
+        bool isDirFlag = (ev & EV_IN_ISDIR);
+        if (isDirFlag && (ev & (EV_IN_MOVED_OUT | EV_IN_MOVED_IN | EV_IN_DELETE)))
+        {
+            _onDirBarrier(item);
+            continue;
+        }
+
+        if (ev & EV_IN_MOVED_OUT)
+        {
+            _onMovedOut(item, nowMs);
+            continue;
+        }
+
+        if (ev & EV_IN_MOVED_IN)
+        {
+            _onMovedIn(item, nowMs);
+            continue;
+        }
+
+        if (ev & EV_IN_CREATE)
+        {
+            std::string key = Key(item.path, item.name);
+            auto it = m_entryMap.find(key);
+            if (it != m_entryMap.end() && it->second.goneEvent != 0 &&
+                Key(it->second.originPath, it->second.originName) != key)
+            {
+                // 旧对象是从其他位置重命名过来后被删除的, 与新建的对象无关
+                _emit(it->second, m_readyList);
+                m_entryMap.erase(it);
+            }
+
+            bool exists = (m_entryMap.find(key) != m_entryMap.end());
+            Entry &entry = _entry(item, nowMs);
+            entry.isDir = isDirFlag;
+            if (!exists)
+            {
+                entry.created = true;
+                entry.createEvent = ev & (EV_IN_CREATE | EV_IN_COPY);
+                entry.copyFromPath = item.fromPath;
+                entry.copyFromName = item.fromName;
+            }
+            else if (entry.goneEvent != 0)
+            {
+                // 删除后重新创建: 原本不存在的仍是新建, 原本存在的视为内容被替换
+                entry.goneEvent = 0;
+                entry.modified = !entry.created;
+            }
+            continue;
+        }
+
+        if (ev & (EV_IN_MODIFY_OVER | EV_IN_CLOSE_WRITE))
+        {
+            Entry &entry = _entry(item, nowMs);
+            entry.modified = true;
+            continue;
+        }
+
+        if (ev & EV_IN_DELETE)
+        {
+            Entry &entry = _entry(item, nowMs);
+            entry.goneEvent = EV_IN_DELETE;
+            continue;
+        }
+    }
+
+    eventItemList.clear();
+}
+
+void EventCoalescer::drain(std::list<InotifyEventItem> &eventItemList)
+{
+    drain(eventItemList, NowMs());
+}
+
+void EventCoalescer::drain(std::list<InotifyEventItem> &eventItemList, uint64_t nowMs)
+{
+    m_stats.output += m_readyList.size();
+    eventItemList.splice(eventItemList.end(), m_readyList);
+
+    std::vector<std::unordered_map<std::string, Entry>::iterator> quietVec;
+    for (auto it = m_entryMap.begin(); it != m_entryMap.end(); ++it)
+    {
+        // 等待配对的移出不输出
+        if (it->second.goneEvent == EV_IN_MOVED_OUT && m_moveOutMap.count(it->second.cookie) &&
+            it->second.lastMs + m_quietWindowMs > nowMs)
+        {
+            continue;
+        }
+
+        if (it->second.lastMs + m_quietWindowMs <= nowMs)
+        {
+            quietVec.push_back(it);
+        }
+    }
+
+    std::sort(quietVec.begin(), quietVec.end(), [] (const auto &left, const auto &right) {
+        return left->second.seq < right->second.seq;
+    });
+
+    for (auto &it : quietVec)
+    {
+        _emit(it->second, eventItemList);
+        m_entryMap.erase(it);
+    }
+}
+
+void EventCoalescer::flush(std::list<InotifyEventItem> &eventItemList)
+{
+    _flushPrefix("");
+    m_stats.output += m_readyList.size();
+    eventItemList.splice(eventItemList.end(), m_readyList);
+}
+
+int64_t EventCoalescer::nextTimeout() const
+{
+    return nextTimeout(NowMs());
+}
+
+int64_t EventCoalescer::nextTimeout(uint64_t nowMs) const
+{
+    if (!m_readyList.empty())
+    {
+        return 0;
+    }
+
+    int64_t timeout = -1;
+    for (const auto &it : m_entryMap)
+    {
+        uint64_t deadline = it.second.lastMs + m_quietWindowMs;
+        int64_t remain = deadline > nowMs ? static_cast<int64_t>(deadline - nowMs) : 0;
+        if (timeout < 0 || remain < timeout)
+        {
+            timeout = remain;
+        }
+    }
+
+    return timeout;
+}
+
+EventCoalescer::Entry &EventCoalescer::_entry(const InotifyEventItem &item, uint64_t nowMs)
+{
+    std::string key = Key(item.path, item.name);
+    auto it = m_entryMap.find(key);
+    if (it == m_entryMap.end())
+    {
+        Entry entry;
+        entry.seq = m_seq++;
+        entry.isDir = (item.event & EV_IN_ISDIR);
+        entry.path = item.path;
+        entry.name = item.name;
+        entry.originPath = item.path;
+        entry.originName = item.name;
+        it = m_entryMap.emplace(std::move(key), std::move(entry)).first;
+    }
+
+    it->second.lastMs = nowMs;
+    return it->second;
+}
+
+void EventCoalescer::_onMovedOut(const InotifyEventItem &item, uint64_t nowMs)
+{
+    Entry &entry = _entry(item, nowMs);
+    entry.goneEvent = EV_IN_MOVED_OUT;
+    entry.cookie = item.cookie;
+    if (item.cookie != 0)
+    {
+        m_moveOutMap[item.cookie] = Key(item.path, item.name);
+    }
+}
+
+void EventCoalescer::_onMovedIn(const InotifyEventItem &item, uint64_t nowMs)
+{
+    std::string destKey = Key(item.path, item.name);
+
+    auto moveIt = item.cookie != 0 ? m_moveOutMap.find(item.cookie) : m_moveOutMap.end();
+    auto srcIt = m_entryMap.end();
+    if (moveIt != m_moveOutMap.end())
+    {
+        srcIt = m_entryMap.find(moveIt->second);
+        m_moveOutMap.erase(moveIt);
+    }
+
+    // 从监视范围外移入, 等同于新建
+    if (srcIt == m_entryMap.end() || srcIt->second.goneEvent != EV_IN_MOVED_OUT)
+    {
+        auto destIt = m_entryMap.find(destKey);
+        if (destIt != m_entryMap.end())
+        {
+            if (!destIt->second.created)
+            {
+                destIt->second.goneEvent = EV_IN_DELETE;
+                _emit(destIt->second, m_readyList);
+            }
+            m_entryMap.erase(destIt);
+        }
+
+        Entry &entry = _entry(item, nowMs);
+        entry.created = true;
+        entry.createEvent = EV_IN_MOVED_IN | (item.event & EV_IN_COPY);
+        entry.copyFromPath = item.fromPath;
+        entry.copyFromName = item.fromName;
+        return;
+    }
+
+    Entry moved = std::move(srcIt->second);
+    m_entryMap.erase(srcIt);
+
+    moved.goneEvent = 0;
+    moved.path = item.path;
+    moved.name = item.name;
+    moved.cookie = item.cookie;
+    moved.lastMs = nowMs;
+
+    // 目标位置已有积压对象, 被覆盖
+    auto destIt = m_entryMap.find(destKey);
+    if (destIt != m_entryMap.end())
+    {
+        Entry &dest = destIt->second;
+        if (!dest.created && dest.goneEvent == 0 && Key(dest.originPath, dest.originName) != destKey)
+        {
+            // 被覆盖的对象是从其他位置重命名过来的, 需要删除其原始位置
+            dest.goneEvent = EV_IN_DELETE;
+            _emit(dest, m_readyList);
+        }
+        m_entryMap.erase(destIt);
+    }
+
+    // 改回原名且未修改, 没有任何净效果
+    if (!moved.created && !moved.modified && Key(moved.originPath, moved.originName) == destKey)
+    {
+        return;
+    }
+
+    m_entryMap.emplace(std::move(destKey), std::move(moved));
+}
+
+void EventCoalescer::_onMove(const InotifyEventItem &item, uint64_t nowMs)
+{
+    // 目录的重命名: 两个位置下积压的事件先输出, 重命名立即输出
+    if (item.event & EV_IN_ISDIR)
+    {
+        std::string srcKey = Key(item.fromPath, item.fromName);
+        _flushPrefix(srcKey + "/");
+        auto it = m_entryMap.find(srcKey);
+        if (it != m_entryMap.end())
+        {
+            _emit(it->second, m_readyList);
+            m_entryMap.erase(it);
+        }
+
+        _onDirBarrier(item);
+        return;
+    }
+
+    // 文件的重命名拆分为以cookie关联的移出和移入
+    InotifyEventItem srcItem;
+    srcItem.event = item.event & ~EV_IN_MOVED_IN;
+    srcItem.cookie = item.cookie;
+    srcItem.path = item.fromPath;
+    srcItem.name = item.fromName;
+    _onMovedOut(srcItem, nowMs);
+
+    InotifyEventItem destItem;
+    destItem.event = item.event & ~EV_IN_MOVED_OUT;
+    destItem.cookie = item.cookie;
+    destItem.path = item.path;
+    destItem.name = item.name;
+    _onMovedIn(destItem, nowMs);
+}
+
+void EventCoalescer::_onDirBarrier(const InotifyEventItem &item)
+{
+    std::string key = Key(item.path, item.name);
+    auto it = m_entryMap.find(key);
+    if ((item.event & EV_IN_DELETE) && it != m_entryMap.end() && it->second.created && it->second.goneEvent == 0)
+    {
+        // 窗口内创建又删除的目录, 其子项同样是窗口内创建的, 通常已相互抵消
+        size_t readyCount = m_readyList.size();
+        _flushPrefix(key + "/");
+        m_entryMap.erase(key);
+
+        // 子项仍有输出(如子项移出但未删除)时, 使用者可能已据此创建了目录, 需输出目录的删除
+        if (m_readyList.size() != readyCount)
+        {
+            m_readyList.push_back(item);
+        }
+        return;
+    }
+
+    _flushPrefix(key + "/");
+    it = m_entryMap.find(key);
+    if (it != m_entryMap.end())
+    {
+        _emit(it->second, m_readyList);
+        m_entryMap.erase(it);
+    }
+
+    m_readyList.push_back(item);
+}
+
+void EventCoalescer::_flushPrefix(const std::string &prefix)
+{
+    std::vector<std::unordered_map<std::string, Entry>::iterator> flushVec;
+    for (auto it = m_entryMap.begin(); it != m_entryMap.end(); ++it)
+    {
+        if (prefix.empty() || it->first.compare(0, prefix.length(), prefix) == 0)
+        {
+            flushVec.push_back(it);
+        }
+    }
+
+    std::sort(flushVec.begin(), flushVec.end(), [] (const auto &left, const auto &right) {
+        return left->second.seq < right->second.seq;
+    });
+
+    for (auto &it : flushVec)
+    {
+        _emit(it->second, m_readyList);
+        m_entryMap.erase(it);
+    }
+}
+
+void EventCoalescer::_emit(Entry &entry, std::list<InotifyEventItem> &eventItemList)
+{
+    uint32_t dirFlag = entry.isDir ? EV_IN_ISDIR : 0;
+    bool renamed = (entry.path != entry.originPath || entry.name != entry.originName);
+    size_t count = eventItemList.size();
+
+    if (entry.goneEvent == EV_IN_MOVED_OUT)
+    {
+        m_moveOutMap.erase(entry.cookie);
+    }
+
+    auto pushEvent = [&] (uint32_t ev, uint32_t cookie, const std::string &path, const std::string &name) {
+        InotifyEventItem eventItem;
+        eventItem.event = ev | dirFlag;
+        eventItem.cookie = cookie;
+        eventItem.path = path;
+        eventItem.name = name;
+        eventItemList.push_back(std::move(eventItem));
+    };
+
+    if (entry.created)
+    {
+        if (entry.goneEvent == 0)
+        {
+            // 创建后被修改, 内容不再与已知文件相同
+            uint32_t createEvent = entry.modified ? (entry.createEvent & ~EV_IN_COPY) : entry.createEvent;
+            pushEvent(createEvent, 0, entry.path, entry.name);
+            if (createEvent & EV_IN_COPY)
+            {
+                eventItemList.back().fromPath = entry.copyFromPath;
+                eventItemList.back().fromName = entry.copyFromName;
+            }
+        }
+    }
+    else if (entry.goneEvent != 0)
+    {
+        // 删除的是窗口开始时位于原始位置的对象
+        pushEvent(entry.goneEvent, entry.cookie, entry.originPath, entry.originName);
+    }
+    else
+    {
+        if (renamed)
+        {
+            pushEvent(EV_IN_MOVE, entry.cookie, entry.path, entry.name);
+            eventItemList.back().fromPath = entry.originPath;
+            eventItemList.back().fromName = entry.originName;
+        }
+
+        if (entry.modified)
+        {
+            pushEvent(EV_IN_MODIFY_OVER, 0, entry.path, entry.name);
+        }
+    }
+
+    // 就绪队列在drain时统计
+    if (&eventItemList != &m_readyList)
+    {
+        m_stats.output += eventItemList.size() - count;
+    }
+}
+
+} // namespace eular
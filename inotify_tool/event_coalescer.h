@@ -0,0 +1,133 @@
+/*************************************************************************
+    > File Name: event_coalescer.h
+    > Author: hsz
+    > Brief: 按路径合并一段静默时间内的事件
+    > Created Time: 2026年10月17日 星期六 16时31分07秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_EVENT_COALESCER_H__
+#define __INOTIFY_EVENT_COALESCER_H__
+
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+#include "inotify_tool/inotify_event.h"
+
+namespace eular {
+
+/**
+ * @brief 位于InotifyTool与同步流程之间, 以路径为key合并事件, 路径静默quietWindow毫秒后才输出净效果:
+ *  1、创建后删除: 不输出
+ *  2、多次修改: 合并为一次EV_IN_MODIFY_OVER
+ *  3、重命名链 a->b->c: 合并为一个 a->c 的EV_IN_MOVE(带fromPath/fromName), 改回原名则不输出.
+ *     输入可以是配对的EV_IN_MOVE, 也可以是以cookie关联的EV_IN_MOVED_OUT/EV_IN_MOVED_IN
+ *  4、创建临时文件写入后重命名为目标(编辑器保存): 输出目标的EV_IN_CREATE
+ *  5、带EV_IN_COPY的创建/移入之后又被修改: 去掉EV_IN_COPY
+ * 目录的移动/删除会先输出该目录下积压的事件再立即输出, 溢出/错误等特殊事件会输出所有积压事件
+ */
+class EventCoalescer
+{
+public:
+    struct Stats
+    {
+        uint64_t    input = 0;      // 输入事件数
+        uint64_t    output = 0;     // 输出事件数
+    };
+
+    EventCoalescer(uint32_t quietWindowMs = 500);
+    ~EventCoalescer() = default;
+
+    /**
+     * @brief 设置静默时间
+     *
+     * @param quietWindowMs 路径最后一次事件后等待的毫秒数
+     */
+    void setQuietWindow(uint32_t quietWindowMs);
+
+    /**
+     * @brief 输入事件
+     *
+     * @param eventItemList 事件, 调用后被清空
+     */
+    void push(std::list<InotifyEventItem> &eventItemList);
+    void push(std::list<InotifyEventItem> &eventItemList, uint64_t nowMs);
+
+    /**
+     * @brief 取出已静默的净事件
+     *
+     * @param eventItemList 输出
+     */
+    void drain(std::list<InotifyEventItem> &eventItemList);
+    void drain(std::list<InotifyEventItem> &eventItemList, uint64_t nowMs);
+
+    /**
+     * @brief 不等待静默, 取出所有积压的净事件
+     *
+     * @param eventItemList 输出
+     */
+    void flush(std::list<InotifyEventItem> &eventItemList);
+
+    /**
+     * @brief 距离下一个路径静默的毫秒数, 可作为waitCompleteEvent的超时时间
+     *
+     * @return int64_t 无积压事件返回-1
+     */
+    int64_t nextTimeout() const;
+    int64_t nextTimeout(uint64_t nowMs) const;
+
+    size_t pending() const { return m_entryMap.size() + m_readyList.size(); }
+    const Stats &stats() const { return m_stats; }
+
+    static uint64_t NowMs();
+
+protected:
+    struct Entry
+    {
+        uint64_t    seq = 0;            // 第一次出现的顺序, 输出按此排序
+        uint64_t    lastMs = 0;         // 最后一次事件的时间
+        uint32_t    cookie = 0;         // 最后一次移动的cookie
+        bool        isDir = false;
+        bool        created = false;    // 静默窗口内新出现(创建或从监视范围外移入)
+        uint32_t    createEvent = 0;    // EV_IN_CREATE 或 EV_IN_MOVED_IN, 可带EV_IN_COPY
+        bool        modified = false;   // 内容被修改
+        uint32_t    goneEvent = 0;      // EV_IN_DELETE 或 EV_IN_MOVED_OUT(移出监视范围), 0表示仍存在
+        std::string path;               // 当前所在目录
+        std::string name;               // 当前名字
+        std::string originPath;         // 窗口开始时所在目录(重命名前)
+        std::string originName;
+        std::string copyFromPath;       // 带EV_IN_COPY时已知文件所在目录
+        std::string copyFromName;
+    };
+
+    Entry &_entry(const InotifyEventItem &item, uint64_t nowMs);
+    void _onMovedOut(const InotifyEventItem &item, uint64_t nowMs);
+    void _onMovedIn(const InotifyEventItem &item, uint64_t nowMs);
+    void _onMove(const InotifyEventItem &item, uint64_t nowMs);
+    void _onDirBarrier(const InotifyEventItem &item);
+
+    /**
+     * @brief 将前缀下(含自身)积压的事件移到就绪队列
+     *
+     * @param prefix 目录完整路径, 以'/'结尾. 为空时移动全部
+     */
+    void _flushPrefix(const std::string &prefix);
+
+    void _emit(Entry &entry, std::list<InotifyEventItem> &eventItemList);
+
+    static std::string Key(const std::string &path, const std::string &name);
+
+private:
+    uint32_t        m_quietWindowMs;
+    uint64_t        m_seq;
+    Stats           m_stats;
+    std::unordered_map<std::string, Entry>      m_entryMap;     // 当前路径 -> 积压状态
+    std::unordered_map<uint32_t, std::string>   m_moveOutMap;   // cookie -> 移出对象的key
+    std::list<InotifyEventItem>                 m_readyList;    // 无需等待静默的事件
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_EVENT_COALESCER_H__
@@ -0,0 +1,315 @@
+/*************************************************************************
+    > File Name: event_dispatcher.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 23时12分47秒
+ ************************************************************************/
+
+#include "inotify_tool/event_dispatcher.h"
+
+#include <chrono>
+
+#include <utils/errors.h>
+
+#define SPECIAL_EVENT (EV_IN_ERROR | EV_IN_UNMOUNT | EV_IN_IGNORED | EV_IN_Q_OVERFLOW)
+
+namespace eular {
+
+// 目录dir下的name是否位于prefix(以'/'结尾)之下, 或者就是prefix本身
+static bool UnderPrefix(const std::string &prefix, std::string_view dir, std::string_view name)
+{
+    if (dir.size() >= prefix.size())
+    {
+        return dir.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    return !name.empty() && dir.size() + name.size() + 1 == prefix.size() &&
+        prefix.compare(0, dir.size(), dir) == 0 &&
+        prefix.compare(dir.size(), name.size(), name) == 0;
+}
+
+Subscription::Subscription(uint32_t id, const SubscribeOptions &options, Callback cb) :
+    m_id(id),
+    m_options(options),
+    m_callback(std::move(cb)),
+    m_overflowed(false),
+    m_cancelled(false)
+{
+    if (!m_options.prefix.empty() && m_options.prefix.back() != '/')
+    {
+        m_options.prefix.push_back('/');
+    }
+
+    if (m_options.capacity == 0)
+    {
+        m_options.capacity = 1;
+    }
+}
+
+bool Subscription::match(const InotifyEventView &view) const
+{
+    if (view.event & SPECIAL_EVENT)
+    {
+        return true;
+    }
+
+    if ((view.event & m_options.eventMask & ~EV_IN_ISDIR) == 0)
+    {
+        return false;
+    }
+
+    if (m_options.prefix.empty())
+    {
+        return true;
+    }
+
+    // 移入/移出前缀的重命名两边都需要知道
+    return UnderPrefix(m_options.prefix, view.path, view.name) ||
+        (!view.fromPath.empty() && UnderPrefix(m_options.prefix, view.fromPath, view.fromName));
+}
+
+int32_t Subscription::wait(std::list<InotifyEventItem> &eventItemList, uint32_t timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto ready = [this] () { return !m_queue.empty() || m_cancelled; };
+    if (timeoutMs > 0)
+    {
+        if (!m_cond.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready))
+        {
+            return TIMED_OUT;
+        }
+    }
+    else
+    {
+        m_cond.wait(lock, ready);
+    }
+
+    if (m_queue.empty())
+    {
+        return NO_INIT;
+    }
+
+    for (auto &eventItem : m_queue)
+    {
+        eventItemList.push_back(std::move(eventItem));
+    }
+    m_queue.clear();
+    m_overflowed = false;
+    return NO_ERROR;
+}
+
+size_t Subscription::poll(std::list<InotifyEventItem> &eventItemList)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t count = m_queue.size();
+    for (auto &eventItem : m_queue)
+    {
+        eventItemList.push_back(std::move(eventItem));
+    }
+    m_queue.clear();
+    m_overflowed = false;
+    return count;
+}
+
+size_t Subscription::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.size();
+}
+
+Subscription::Stats Subscription::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void Subscription::deliver(const InotifyEventBatch &batch, size_t begin)
+{
+    if (m_callback)
+    {
+        std::list<InotifyEventItem> eventItemList;
+        for (size_t i = begin; i < batch.size(); ++i)
+        {
+            if (match(batch[i]))
+            {
+                eventItemList.push_back(batch[i].toItem());
+            }
+        }
+
+        if (!eventItemList.empty())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stats.delivered += eventItemList.size();
+            }
+            m_callback(eventItemList);
+        }
+        return;
+    }
+
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = begin; i < batch.size(); ++i)
+        {
+            if (match(batch[i]))
+            {
+                _enqueue(batch[i]);
+                notify = true;
+            }
+        }
+    }
+
+    if (notify)
+    {
+        m_cond.notify_all();
+    }
+}
+
+void Subscription::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+    }
+    m_cond.notify_all();
+}
+
+void Subscription::_enqueue(const InotifyEventView &view)
+{
+    if (m_overflowed)
+    {
+        ++m_stats.dropped;
+        return;
+    }
+
+    if (m_queue.size() < m_options.capacity)
+    {
+        m_queue.push_back(view.toItem());
+        ++m_stats.delivered;
+        return;
+    }
+
+    ++m_stats.overflows;
+    switch (m_options.policy)
+    {
+    case OverflowPolicy::DROP_NEWEST:
+        ++m_stats.dropped;
+        break;
+    case OverflowPolicy::DROP_OLDEST:
+        m_queue.pop_front();
+        m_queue.push_back(view.toItem());
+        ++m_stats.dropped;
+        ++m_stats.delivered;
+        break;
+    case OverflowPolicy::RESYNC:
+    {
+        // 队列中的事件已不完整, 只保留一个溢出事件提示订阅者重新扫描前缀
+        m_stats.dropped += m_queue.size() + 1;
+        m_queue.clear();
+
+        InotifyEventItem eventItem;
+        eventItem.event = EV_IN_Q_OVERFLOW;
+        eventItem.path = m_options.prefix;
+        m_queue.push_back(std::move(eventItem));
+        m_overflowed = true;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+EventDispatcher::EventDispatcher() :
+    m_nextId(1),
+    m_subscriptionVec(std::make_shared<SubscriptionVec>())
+{
+}
+
+Subscription::SP EventDispatcher::subscribe(const SubscribeOptions &options, Subscription::Callback cb)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Subscription::SP subscription = std::make_shared<Subscription>(m_nextId++, options, std::move(cb));
+
+    auto subscriptionVec = std::make_shared<SubscriptionVec>(*m_subscriptionVec);
+    subscriptionVec->push_back(subscription);
+    m_subscriptionVec = std::move(subscriptionVec);
+    return subscription;
+}
+
+bool EventDispatcher::unsubscribe(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto subscriptionVec = std::make_shared<SubscriptionVec>();
+    subscriptionVec->reserve(m_subscriptionVec->size());
+
+    Subscription::SP removed;
+    for (const auto &it : *m_subscriptionVec)
+    {
+        if (it->id() == id)
+        {
+            removed = it;
+            continue;
+        }
+        subscriptionVec->push_back(it);
+    }
+
+    if (removed == nullptr)
+    {
+        return false;
+    }
+
+    m_subscriptionVec = std::move(subscriptionVec);
+    removed->cancel();
+    return true;
+}
+
+void EventDispatcher::dispatch(const InotifyEventBatch &batch, size_t begin)
+{
+    std::shared_ptr<const SubscriptionVec> subscriptionVec;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        subscriptionVec = m_subscriptionVec;
+    }
+
+    for (const auto &it : *subscriptionVec)
+    {
+        it->deliver(batch, begin);
+    }
+}
+
+uint32_t EventDispatcher::eventMask() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t mask = 0;
+    for (const auto &it : *m_subscriptionVec)
+    {
+        mask |= it->options().eventMask;
+    }
+
+    return mask;
+}
+
+void EventDispatcher::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &it : *m_subscriptionVec)
+    {
+        it->cancel();
+    }
+    m_subscriptionVec = std::make_shared<SubscriptionVec>();
+}
+
+bool EventDispatcher::empty() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_subscriptionVec->empty();
+}
+
+size_t EventDispatcher::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_subscriptionVec->size();
+}
+
+} // namespace eular
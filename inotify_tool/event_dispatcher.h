@@ -0,0 +1,170 @@
+/*************************************************************************
+    > File Name: event_dispatcher.h
+    > Author: hsz
+    > Brief: 事件订阅, 一次解析按前缀和事件过滤后分发给多个订阅者
+    > Created Time: 2026年10月17日 星期六 23时12分40秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_EVENT_DISPATCHER_H__
+#define __INOTIFY_EVENT_DISPATCHER_H__
+
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+#include "inotify_tool/inotify_event.h"
+#include "inotify_tool/event_batch.h"
+
+namespace eular {
+
+/**
+ * @brief 订阅队列满时的处理方式
+ *
+ * NOTE 没有阻塞等待的策略: 所有订阅者共用解析线程, 等待一个慢订阅者会推迟其他订阅者并使内核队列溢出.
+ * 需要保留最早的事件时使用DROP_NEWEST
+ */
+enum class OverflowPolicy : uint32_t {
+    DROP_NEWEST,    // 丢弃新事件
+    DROP_OLDEST,    // 丢弃队列中最早的事件
+    RESYNC,         // 清空队列并放入一个EV_IN_Q_OVERFLOW(path为订阅前缀), 订阅者需自行重新扫描
+};
+
+struct SubscribeOptions
+{
+    std::string     prefix;                         // 只接收此目录(绝对路径)及其子孙的事件, 空表示全部
+    uint32_t        eventMask = EV_IN_ALL;          // 接收的事件, 溢出/卸载等特殊事件总是投递
+    size_t          capacity = 4096;                // 队列容量(事件数), 回调订阅不使用
+    OverflowPolicy  policy = OverflowPolicy::RESYNC;
+};
+
+/**
+ * @brief 一个订阅者. 设置回调时在解析线程中同步调用, 否则事件进入有界队列, 由订阅者线程wait/poll取走
+ */
+class Subscription
+{
+public:
+    typedef std::shared_ptr<Subscription> SP;
+    typedef std::function<void(std::list<InotifyEventItem> &)> Callback;
+
+    struct Stats
+    {
+        uint64_t    delivered = 0;  // 投递的事件数
+        uint64_t    dropped = 0;    // 队列满丢弃的事件数
+        uint64_t    overflows = 0;  // 队列满的次数
+    };
+
+    Subscription(uint32_t id, const SubscribeOptions &options, Callback cb);
+    ~Subscription() = default;
+
+    uint32_t id() const { return m_id; }
+    const SubscribeOptions &options() const { return m_options; }
+
+    /**
+     * @brief 事件是否属于此订阅
+     */
+    bool match(const InotifyEventView &view) const;
+
+    /**
+     * @brief 等待并取走队列中的所有事件
+     *
+     * @param eventItemList 输出
+     * @param timeoutMs 超时时间, 0表示一直等待
+     * @return int32_t 成功返回0, 超时返回TIMED_OUT, 已取消订阅返回NO_INIT
+     */
+    int32_t wait(std::list<InotifyEventItem> &eventItemList, uint32_t timeoutMs);
+
+    /**
+     * @brief 非阻塞取走队列中的所有事件
+     *
+     * @param eventItemList 输出
+     * @return size_t 取走的事件数
+     */
+    size_t poll(std::list<InotifyEventItem> &eventItemList);
+
+    size_t pending() const;
+    Stats stats() const;
+
+protected:
+    friend class EventDispatcher;
+
+    /**
+     * @brief 投递批次中从begin开始的匹配事件
+     */
+    void deliver(const InotifyEventBatch &batch, size_t begin);
+
+    /**
+     * @brief 取消订阅, 唤醒等待中的wait
+     */
+    void cancel();
+
+    void _enqueue(const InotifyEventView &view);
+
+private:
+    uint32_t                        m_id;
+    SubscribeOptions                m_options;
+    Callback                        m_callback;
+    mutable std::mutex              m_mutex;
+    std::condition_variable         m_cond;
+    std::deque<InotifyEventItem>    m_queue;
+    Stats                           m_stats;
+    bool                            m_overflowed;   // RESYNC策略下已放入溢出事件, 取走前不再入队
+    bool                            m_cancelled;
+};
+
+/**
+ * @brief 订阅者列表. 订阅/取消可在任意线程调用, 列表以写时复制方式替换, 分发时不持锁
+ */
+class EventDispatcher
+{
+public:
+    EventDispatcher();
+    ~EventDispatcher() = default;
+
+    /**
+     * @brief 添加订阅
+     *
+     * @param options 过滤条件和队列设置
+     * @param cb 回调, 为空时使用队列
+     * @return Subscription::SP
+     */
+    Subscription::SP subscribe(const SubscribeOptions &options, Subscription::Callback cb);
+
+    /**
+     * @brief 取消订阅
+     *
+     * @return true 成功
+     * @return false 不存在
+     */
+    bool unsubscribe(uint32_t id);
+
+    /**
+     * @brief 分发批次中从begin开始的事件
+     */
+    void dispatch(const InotifyEventBatch &batch, size_t begin);
+
+    /**
+     * @brief 所有订阅者事件的并集
+     */
+    uint32_t eventMask() const;
+
+    void clear();
+    bool empty() const;
+    size_t size() const;
+
+private:
+    typedef std::vector<Subscription::SP> SubscriptionVec;
+
+    mutable std::mutex                      m_mutex;
+    uint32_t                                m_nextId;
+    std::shared_ptr<const SubscriptionVec>  m_subscriptionVec;
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_EVENT_DISPATCHER_H__
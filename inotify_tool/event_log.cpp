@@ -0,0 +1,255 @@
+/*************************************************************************
+    > File Name: event_log.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月18日 星期日 00时21分42秒
+ ************************************************************************/
+
+#include "inotify_tool/event_log.h"
+
+#include <string.h>
+#include <errno.h>
+
+#include <utils/sysdef.h>
+#include <utils/errors.h>
+#include <log/log.h>
+
+#define LOG_TAG "Event-log"
+
+#define EVENT_LOG_MAGIC     "INOTRLOG"
+#define EVENT_LOG_VERSION   1
+#define WATCH_FLAG_RECURSION    0x01
+#define WATCH_FLAG_DIR          0x02
+
+namespace eular {
+
+struct EventLogHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    reserved;
+};
+
+struct EventLogRecordHeader
+{
+    uint32_t    type;
+    uint32_t    size;   // 负载长度
+    uint64_t    ns;
+};
+
+struct EventLogWatchHeader
+{
+    int32_t     wd;
+    int32_t     parentWd;
+    uint32_t    ev;
+    uint32_t    flags;
+};
+
+EventLogWriter::EventLogWriter() :
+    m_fp(nullptr),
+    m_bytes(0)
+{
+}
+
+EventLogWriter::~EventLogWriter()
+{
+    close();
+}
+
+int32_t EventLogWriter::open(const std::string &file)
+{
+    close();
+    m_fp = fopen(file.c_str(), "wbe");
+    if (m_fp == nullptr)
+    {
+        int32_t error = errno;
+        LOGE("fopen %s error. [%d, %s]", file.c_str(), error, strerror(error));
+        return -error;
+    }
+
+    EventLogHeader header;
+    memcpy(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic));
+    header.version = EVENT_LOG_VERSION;
+    header.reserved = 0;
+    if (fwrite(&header, sizeof(header), 1, m_fp) != 1)
+    {
+        int32_t error = errno;
+        LOGE("write %s error. [%d, %s]", file.c_str(), error, strerror(error));
+        close();
+        return -error;
+    }
+
+    m_bytes = sizeof(header);
+    return NO_ERROR;
+}
+
+void EventLogWriter::close()
+{
+    if (m_fp != nullptr)
+    {
+        fclose(m_fp);
+        m_fp = nullptr;
+    }
+}
+
+void EventLogWriter::writeWatch(uint64_t ns, const EventLogWatch &watch)
+{
+    EventLogWatchHeader head;
+    head.wd = watch.wd;
+    head.parentWd = watch.parentWd;
+    head.ev = watch.ev;
+    head.flags = (watch.recursion ? WATCH_FLAG_RECURSION : 0) | (watch.isDir ? WATCH_FLAG_DIR : 0);
+    _writeRecord(EventLogType::WATCH, ns, &head, sizeof(head), watch.name.data(), watch.name.size());
+}
+
+void EventLogWriter::writeData(uint64_t ns, const void *data, size_t size)
+{
+    _writeRecord(EventLogType::DATA, ns, nullptr, 0, data, size);
+}
+
+void EventLogWriter::_writeRecord(EventLogType type, uint64_t ns, const void *head, size_t headSize,
+                                  const void *body, size_t bodySize)
+{
+    if (m_fp == nullptr)
+    {
+        return;
+    }
+
+    EventLogRecordHeader record;
+    record.type = static_cast<uint32_t>(type);
+    record.size = static_cast<uint32_t>(headSize + bodySize);
+    record.ns = ns;
+
+    bool ok = fwrite(&record, sizeof(record), 1, m_fp) == 1;
+    if (ok && headSize > 0)
+    {
+        ok = fwrite(head, headSize, 1, m_fp) == 1;
+    }
+    if (ok && bodySize > 0)
+    {
+        ok = fwrite(body, bodySize, 1, m_fp) == 1;
+    }
+
+    if (!ok)
+    {
+        // 磁盘满等错误时停止录制, 不影响监视
+        int32_t error = errno;
+        LOGE("write event log error, stop recording. [%d, %s]", error, strerror(error));
+        close();
+        return;
+    }
+
+    m_bytes += sizeof(record) + record.size;
+}
+
+int32_t EventLogReader::open(const std::string &file)
+{
+    m_buffer.clear();
+    m_offset = 0;
+
+    FILE *fp = fopen(file.c_str(), "rbe");
+    if (fp == nullptr)
+    {
+        int32_t error = errno;
+        if (error == ENOENT)
+        {
+            return NAME_NOT_FOUND;
+        }
+
+        LOGE("fopen %s error. [%d, %s]", file.c_str(), error, strerror(error));
+        return -error;
+    }
+
+    uint8_t block[64 * 1024];
+    size_t readSize = 0;
+    while ((readSize = fread(block, 1, sizeof(block), fp)) > 0)
+    {
+        m_buffer.insert(m_buffer.end(), block, block + readSize);
+    }
+
+    bool readError = ferror(fp) != 0;
+    fclose(fp);
+    if (readError)
+    {
+        LOGE("read %s error", file.c_str());
+        m_buffer.clear();
+        return UNKNOWN_ERROR;
+    }
+
+    EventLogHeader header;
+    if (m_buffer.size() < sizeof(header))
+    {
+        LOGW("invalid event log %s", file.c_str());
+        m_buffer.clear();
+        return UNKNOWN_ERROR;
+    }
+
+    memcpy(&header, m_buffer.data(), sizeof(header));
+    if (memcmp(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic)) != 0 || header.version != EVENT_LOG_VERSION)
+    {
+        LOGW("invalid event log header %s", file.c_str());
+        m_buffer.clear();
+        return UNKNOWN_ERROR;
+    }
+
+    m_offset = sizeof(header);
+    return NO_ERROR;
+}
+
+bool EventLogReader::next(EventLogRecord &record)
+{
+    EventLogRecordHeader head;
+    if (m_offset + sizeof(head) > m_buffer.size())
+    {
+        return false;
+    }
+
+    memcpy(&head, m_buffer.data() + m_offset, sizeof(head));
+    const uint8_t *pPayload = m_buffer.data() + m_offset + sizeof(head);
+    if (m_offset + sizeof(head) + head.size > m_buffer.size())
+    {
+        LOGW("event log truncated at %zu", m_offset);
+        return false;
+    }
+
+    record.ns = head.ns;
+    record.type = static_cast<EventLogType>(head.type);
+    record.data = std::string_view();
+    switch (record.type)
+    {
+    case EventLogType::WATCH:
+    {
+        EventLogWatchHeader watch;
+        if (head.size < sizeof(watch))
+        {
+            LOGW("invalid watch record at %zu", m_offset);
+            return false;
+        }
+
+        memcpy(&watch, pPayload, sizeof(watch));
+        record.watch.wd = watch.wd;
+        record.watch.parentWd = watch.parentWd;
+        record.watch.ev = watch.ev;
+        record.watch.recursion = (watch.flags & WATCH_FLAG_RECURSION) != 0;
+        record.watch.isDir = (watch.flags & WATCH_FLAG_DIR) != 0;
+        record.watch.name.assign(reinterpret_cast<const char *>(pPayload) + sizeof(watch), head.size - sizeof(watch));
+        break;
+    }
+    case EventLogType::DATA:
+        record.data = std::string_view(reinterpret_cast<const char *>(pPayload), head.size);
+        break;
+    default:
+        LOGW("unknown record type %u at %zu", head.type, m_offset);
+        return false;
+    }
+
+    m_offset += sizeof(head) + head.size;
+    return true;
+}
+
+void EventLogReader::rewind()
+{
+    m_offset = m_buffer.empty() ? 0 : sizeof(EventLogHeader);
+}
+
+} // namespace eular
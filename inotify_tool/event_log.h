@@ -0,0 +1,123 @@
+/*************************************************************************
+    > File Name: event_log.h
+    > Author: hsz
+    > Brief: 原始inotify事件流的录制文件, 用于离线重放解析器
+    > Created Time: 2026年10月18日 星期日 00时21分35秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_EVENT_LOG_H__
+#define __INOTIFY_EVENT_LOG_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace eular {
+
+enum class EventLogType : uint32_t {
+    WATCH   = 1,    // 新增的watch(录制开始时的watch表及之后新增的watch)
+    DATA    = 2,    // 一次read返回的原始inotify_event字节
+};
+
+/**
+ * @brief 录制的watch
+ */
+struct EventLogWatch
+{
+    int32_t     wd = -1;
+    int32_t     parentWd = -1;  // 根目录为-1
+    uint32_t    ev = 0;
+    bool        recursion = false;
+    bool        isDir = true;
+    std::string name;           // 根目录为完整路径, 其他为目录名
+};
+
+/**
+ * @brief 一条记录. data指向读取器内部的缓冲区, 下一次next前有效
+ */
+struct EventLogRecord
+{
+    EventLogType        type = EventLogType::DATA;
+    uint64_t            ns = 0;     // 录制时的CLOCK_MONOTONIC纳秒
+    EventLogWatch       watch;      // type为WATCH时有效
+    std::string_view    data;       // type为DATA时有效
+};
+
+/**
+ * @brief 录制文件. 格式(本机字节序):
+ *  文件头: magic[8] version(u32) reserved(u32)
+ *  记录头: type(u32) size(u32) ns(u64), 之后为size字节的负载
+ *  WATCH负载: wd(i32) parentWd(i32) ev(u32) flags(u32) name
+ *  DATA负载: read返回的原始字节
+ * 父目录的WATCH总在子目录之前. 写入经stdio缓冲, 录制只用于调试和基准测试
+ */
+class EventLogWriter
+{
+public:
+    EventLogWriter();
+    ~EventLogWriter();
+
+    EventLogWriter(const EventLogWriter &) = delete;
+    EventLogWriter &operator=(const EventLogWriter &) = delete;
+
+    /**
+     * @brief 创建文件并写入文件头, 已存在的文件被覆盖
+     *
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t open(const std::string &file);
+    void close();
+    bool isOpen() const { return m_fp != nullptr; }
+
+    void writeWatch(uint64_t ns, const EventLogWatch &watch);
+    void writeData(uint64_t ns, const void *data, size_t size);
+
+    uint64_t bytes() const { return m_bytes; }
+
+protected:
+    void _writeRecord(EventLogType type, uint64_t ns, const void *head, size_t headSize,
+                      const void *body, size_t bodySize);
+
+private:
+    FILE       *m_fp;
+    uint64_t    m_bytes;
+};
+
+class EventLogReader
+{
+public:
+    EventLogReader() = default;
+    ~EventLogReader() = default;
+
+    /**
+     * @brief 读取整个文件并校验文件头
+     *
+     * @return int32_t 成功返回0, 文件不存在返回NAME_NOT_FOUND, 格式错误返回UNKNOWN_ERROR
+     */
+    int32_t open(const std::string &file);
+
+    /**
+     * @brief 读取下一条记录
+     *
+     * @return true 成功
+     * @return false 已读完或记录被截断
+     */
+    bool next(EventLogRecord &record);
+
+    /**
+     * @brief 回到第一条记录
+     */
+    void rewind();
+
+    size_t size() const { return m_buffer.size(); }
+
+private:
+    std::vector<uint8_t>    m_buffer;
+    size_t                  m_offset = 0;
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_EVENT_LOG_H__
@@ -0,0 +1,617 @@
+/*************************************************************************
+    > File Name: fanotify_tool.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 15时20分52秒
+ ************************************************************************/
+
+#include "inotify_tool/fanotify_tool.h"
+
+#include <string.h>
+#include <limits.h>
+
+#include <utils/sysdef.h>
+#include <utils/errors.h>
+#include <log/log.h>
+
+#ifdef OS_LINUX
+#include <sys/fanotify.h>
+#include <sys/statfs.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "inotify_tool/inotify_event.h"
+#include "inotify_tool/inotify_utils.h"
+
+#define LOG_TAG "Fanotify-tool"
+
+#define INVALID_ID      (-1)
+#define FAN_BUF_SIZE    (64 * 1024)
+#define MAX_HANDLE_SIZE 128
+
+// 旧的内核头文件中没有FAN_RENAME(5.17+)
+#ifndef FAN_RENAME
+#define FAN_RENAME                          0x10000000
+#define FAN_EVENT_INFO_TYPE_OLD_DFID_NAME   10
+#define FAN_EVENT_INFO_TYPE_NEW_DFID_NAME   12
+#endif
+
+namespace eular {
+
+static uint64_t FsidToKey(const void *fsid)
+{
+    uint64_t key = 0;
+    memcpy(&key, fsid, sizeof(key));
+    return key;
+}
+
+/**
+ * @brief 查找指定类型的目录handle + 文件名信息
+ */
+static const struct fanotify_event_info_fid *FindFidInfo(const struct fanotify_event_metadata *pMeta, uint8_t infoType)
+{
+    for (uint32_t offset = pMeta->metadata_len; offset + sizeof(struct fanotify_event_info_header) <= pMeta->event_len; )
+    {
+        const struct fanotify_event_info_header *pHeader =
+            reinterpret_cast<const struct fanotify_event_info_header *>(reinterpret_cast<const uint8_t *>(pMeta) + offset);
+        if (pHeader->len == 0)
+        {
+            break;
+        }
+
+        if (pHeader->info_type == infoType)
+        {
+            return reinterpret_cast<const struct fanotify_event_info_fid *>(pHeader);
+        }
+
+        offset += pHeader->len;
+    }
+
+    return nullptr;
+}
+
+static const char *FidName(const struct fanotify_event_info_fid *pFid)
+{
+    const struct file_handle *pHandle = reinterpret_cast<const struct file_handle *>(pFid->handle);
+    return reinterpret_cast<const char *>(pHandle->f_handle + pHandle->handle_bytes);
+}
+
+FanotifyTool::FanotifyTool() noexcept :
+    m_fanotifyFd(INVALID_ID),
+    m_errorCode(0),
+    m_renameSupported(true)
+{
+}
+
+FanotifyTool::~FanotifyTool() noexcept
+{
+    destroy();
+}
+
+bool FanotifyTool::create() noexcept
+{
+    m_errorCode = 0;
+    if (INVALID_ID == m_fanotifyFd)
+    {
+        m_fanotifyFd = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK | FAN_REPORT_DFID_NAME,
+                                     O_RDONLY | O_LARGEFILE);
+    }
+
+    if (INVALID_ID == m_fanotifyFd)
+    {
+        // EINVAL: 内核不支持FAN_REPORT_DFID_NAME; EPERM: 缺少CAP_SYS_ADMIN
+        m_errorCode = errno;
+        LOGE("fanotify_init error. [%d, %s]", errno, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+void FanotifyTool::destroy()
+{
+    if (m_fanotifyFd != INVALID_ID)
+    {
+        close(m_fanotifyFd);
+        m_fanotifyFd = INVALID_ID;
+    }
+
+    for (const auto &it : m_mountFdMap)
+    {
+        close(it.second);
+    }
+
+    m_mountFdMap.clear();
+    m_rootMap.clear();
+    m_handleCache.clear();
+    m_fileModifySet.clear();
+    m_errorCode = 0;
+    m_renameSupported = true;
+}
+
+int32_t FanotifyTool::fd() const
+{
+    return m_fanotifyFd;
+}
+
+int32_t FanotifyTool::watchRecursive(const std::vector<std::string> &paths, uint32_t ev)
+{
+    m_errorCode = 0;
+    if (INVALID_ID == m_fanotifyFd)
+    {
+        return INVALID_OPERATION;
+    }
+
+    uint64_t mask = inotifyEvent2FanotifyEv(ev);
+    if (mask == 0)
+    {
+        return NO_ERROR;
+    }
+
+    for (const auto &it : paths)
+    {
+        struct stat64 pathStat;
+        if (it.empty() || it[0] != '/' || lstat64(it.c_str(), &pathStat) < 0 || !S_ISDIR(pathStat.st_mode))
+        {
+            LOGE("Invalid path(\"%s\")", it.c_str());
+            return INVALID_PARAM;
+        }
+
+        std::string fixedPath = it;
+        utils::CorrectionPath(fixedPath);
+        if (m_rootMap.find(fixedPath) != m_rootMap.end())
+        {
+            LOGE("Path(\"%s\") already exists", it.c_str());
+            return ALREADY_EXISTS;
+        }
+    }
+
+    for (const auto &it : paths)
+    {
+        std::string fixedPath = it;
+        utils::CorrectionPath(fixedPath);
+
+        struct statfs fsStat;
+        if (statfs(fixedPath.c_str(), &fsStat) < 0)
+        {
+            m_errorCode = errno;
+            return UNKNOWN_ERROR;
+        }
+
+        uint64_t fsidKey = FsidToKey(&fsStat.f_fsid);
+        if (m_mountFdMap.find(fsidKey) == m_mountFdMap.end())
+        {
+            if (_markFilesystem(fixedPath, mask) < 0)
+            {
+                m_errorCode = errno;
+                LOGE("fanotify_mark(%s) error. [%d, %s]", fixedPath.c_str(), errno, strerror(errno));
+                return UNKNOWN_ERROR;
+            }
+
+            int32_t mountFd = open(fixedPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (mountFd < 0)
+            {
+                m_errorCode = errno;
+                return UNKNOWN_ERROR;
+            }
+
+            m_mountFdMap[fsidKey] = mountFd;
+        }
+        else
+        {
+            // 同一文件系统已有mark, 合并事件
+            _markFilesystem(fixedPath, mask);
+        }
+
+        m_rootMap[fixedPath] = ev;
+    }
+
+    return NO_ERROR;
+}
+
+int32_t FanotifyTool::_markFilesystem(const std::string &path, uint64_t mask)
+{
+    const uint64_t moveMask = FAN_MOVED_FROM | FAN_MOVED_TO;
+    if (m_renameSupported && (mask & moveMask))
+    {
+        // FAN_RENAME在一个事件中同时携带原位置和新位置, 不再需要FAN_MOVED_FROM/FAN_MOVED_TO
+        if (fanotify_mark(m_fanotifyFd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, (mask & ~moveMask) | FAN_RENAME | FAN_ONDIR,
+                          AT_FDCWD, path.c_str()) == 0)
+        {
+            return 0;
+        }
+
+        if (errno != EINVAL)
+        {
+            return -1;
+        }
+
+        // 5.17之前的内核不支持FAN_RENAME, 移动事件无法配对
+        LOGW("FAN_RENAME not supported, moves are reported as unpaired EV_IN_MOVED_OUT/EV_IN_MOVED_IN");
+        m_renameSupported = false;
+    }
+
+    return fanotify_mark(m_fanotifyFd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, mask | FAN_ONDIR, AT_FDCWD, path.c_str());
+}
+
+int32_t FanotifyTool::waitCompleteEvent(uint32_t timeout)
+{
+    m_errorCode = 0;
+    if (INVALID_ID == m_fanotifyFd)
+    {
+        return NO_INIT;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = m_fanotifyFd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int32_t errorCode = 0;
+    do {
+        errorCode = ::poll(&pfd, 1, timeout > 0 ? static_cast<int32_t>(timeout) : -1);
+    } while (errorCode < 0 && errno == EINTR);
+
+    if (errorCode < 0)
+    {
+        m_errorCode = errno;
+        return UNKNOWN_ERROR;
+    }
+
+    if (errorCode == 0)
+    {
+        return TIMED_OUT;
+    }
+
+    return _readEvent();
+}
+
+void FanotifyTool::setEventCallback(EventCallback cb)
+{
+    m_eventCallback = std::move(cb);
+}
+
+int32_t FanotifyTool::processEvent()
+{
+    m_errorCode = 0;
+    if (INVALID_ID == m_fanotifyFd)
+    {
+        return NO_INIT;
+    }
+
+    int32_t status = _readEvent();
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    if (m_eventCallback && !m_eventItemQueue.empty())
+    {
+        std::list<InotifyEventItem> eventItemList = std::move(m_eventItemQueue);
+        m_eventItemQueue.clear();
+        m_eventCallback(eventItemList);
+    }
+
+    return NO_ERROR;
+}
+
+void FanotifyTool::getEventItem(std::list<InotifyEventItem> &eventItemVec)
+{
+    eventItemVec = std::move(m_eventItemQueue);
+    m_eventItemQueue.clear();
+}
+
+int32_t FanotifyTool::getLastError()
+{
+    return m_errorCode;
+}
+
+uint64_t FanotifyTool::inotifyEvent2FanotifyEv(uint32_t ev) const noexcept
+{
+    uint64_t fanotifyEv = 0;
+
+#define FANOTIFY_MAP(XXX)                                               \
+    XXX(InotifyEvent::EV_IN_MODIFY_OVER, FAN_MODIFY | FAN_CLOSE_WRITE)  \
+    XXX(InotifyEvent::EV_IN_CLOSE_WRITE, FAN_MODIFY | FAN_CLOSE_WRITE)  \
+    XXX(InotifyEvent::EV_IN_MOVED_OUT, FAN_MOVED_FROM)                  \
+    XXX(InotifyEvent::EV_IN_MOVED_IN, FAN_MOVED_TO)                     \
+    XXX(InotifyEvent::EV_IN_CREATE, FAN_CREATE)                         \
+    XXX(InotifyEvent::EV_IN_DELETE, FAN_DELETE)                         \
+
+#define XXX(InoEv, fanEv)       \
+    if ((InoEv) & ev)           \
+    {                           \
+        fanotifyEv |= fanEv;    \
+    }                           \
+
+    FANOTIFY_MAP(XXX);
+
+#undef XXX
+#undef FANOTIFY_MAP
+
+    return fanotifyEv;
+}
+
+int32_t FanotifyTool::_readEvent()
+{
+    alignas(struct fanotify_event_metadata) uint8_t eventBuffer[FAN_BUF_SIZE];
+    do {
+        ssize_t readSize = ::read(m_fanotifyFd, eventBuffer, sizeof(eventBuffer));
+        if (readSize < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno != EAGAIN) {
+                m_errorCode = errno;
+                LOGE("read(%d) error. [%d, %s]", m_fanotifyFd, errno, strerror(errno));
+                return UNKNOWN_ERROR;
+            }
+
+            break;
+        }
+
+        if (readSize == 0) {
+            break;
+        }
+
+        _parseEvent(eventBuffer, readSize);
+    } while (true);
+
+    return NO_ERROR;
+}
+
+void FanotifyTool::_parseEvent(const uint8_t *pBuffer, size_t size)
+{
+    const struct fanotify_event_metadata *pMeta = reinterpret_cast<const struct fanotify_event_metadata *>(pBuffer);
+    int32_t length = static_cast<int32_t>(size);
+
+    for (; FAN_EVENT_OK(pMeta, length); pMeta = FAN_EVENT_NEXT(pMeta, length))
+    {
+        if (pMeta->vers != FANOTIFY_METADATA_VERSION)
+        {
+            LOGE("fanotify metadata version mismatch: %u", pMeta->vers);
+            break;
+        }
+
+        // 使用FID上报时不会携带文件句柄
+        if (pMeta->fd >= 0)
+        {
+            close(pMeta->fd);
+        }
+
+        if (pMeta->mask & FAN_Q_OVERFLOW)
+        {
+            InotifyEventItem eventItem;
+            eventItem.event = FAN_Q_OVERFLOW;
+            m_eventItemQueue.push_back(eventItem);
+            continue;
+        }
+
+        // 重命名事件不与其他事件合并, 携带原位置和新位置两个信息
+        if (pMeta->mask & FAN_RENAME)
+        {
+            _parseRename(pMeta);
+            continue;
+        }
+
+        // 查找父目录handle + 文件名
+        const struct fanotify_event_info_fid *pFid = FindFidInfo(pMeta, FAN_EVENT_INFO_TYPE_DFID_NAME);
+        if (pFid == nullptr)
+        {
+            continue;
+        }
+
+        const char *pName = FidName(pFid);
+        if (pName[0] == '\0' || (pName[0] == '.' && pName[1] == '\0'))
+        {
+            // 目录自身的事件
+            continue;
+        }
+
+        std::string dirPath;
+        if (!_resolveHandle(&pFid->fsid, pFid->handle, dirPath))
+        {
+            continue;
+        }
+
+        uint32_t watchEv = _watchedEvent(dirPath);
+        if (watchEv == 0)
+        {
+            continue;
+        }
+
+        uint32_t dirFlag = (pMeta->mask & FAN_ONDIR) ? EV_IN_ISDIR : 0;
+        auto pushEvent = [&] (uint32_t ev) {
+            // 修改后关闭输出EV_IN_MODIFY_OVER, 只监视EV_IN_CLOSE_WRITE时也需要输出
+            uint32_t watchedMask = (ev == EV_IN_MODIFY_OVER) ? (EV_IN_MODIFY_OVER | EV_IN_CLOSE_WRITE) : ev;
+            if ((watchEv & watchedMask) == 0)
+            {
+                return;
+            }
+
+            InotifyEventItem eventItem;
+            eventItem.event = ev | dirFlag;
+            eventItem.path = dirPath;
+            eventItem.name = pName;
+            m_eventItemQueue.push_back(std::move(eventItem));
+        };
+
+        // NOTE fanotify可能将同一对象的多个事件合并为一个, 按发生顺序逐个处理
+        if (pMeta->mask & FAN_CREATE)
+        {
+            pushEvent(EV_IN_CREATE);
+        }
+
+        if (pMeta->mask & FAN_MODIFY)
+        {
+            // 多次修改只记录一次
+            m_fileModifySet.insert(dirPath + pName);
+        }
+
+        if (pMeta->mask & FAN_CLOSE_WRITE)
+        {
+            auto modifyIt = m_fileModifySet.find(dirPath + pName);
+            if (modifyIt != m_fileModifySet.end())
+            {
+                pushEvent(EV_IN_MODIFY_OVER);
+                m_fileModifySet.erase(modifyIt);
+            }
+        }
+
+        if (pMeta->mask & FAN_MOVED_FROM)
+        {
+            pushEvent(EV_IN_MOVED_OUT);
+        }
+
+        if (pMeta->mask & FAN_MOVED_TO)
+        {
+            pushEvent(EV_IN_MOVED_IN);
+        }
+
+        if (pMeta->mask & FAN_DELETE)
+        {
+            pushEvent(EV_IN_DELETE);
+        }
+
+        // 目录被移动或删除后, 缓存的子目录路径失效
+        if (dirFlag && (pMeta->mask & (FAN_MOVED_FROM | FAN_MOVED_TO | FAN_DELETE)))
+        {
+            m_handleCache.clear();
+        }
+    }
+}
+
+void FanotifyTool::_parseRename(const struct fanotify_event_metadata *pMeta)
+{
+    const struct fanotify_event_info_fid *pOldFid = FindFidInfo(pMeta, FAN_EVENT_INFO_TYPE_OLD_DFID_NAME);
+    const struct fanotify_event_info_fid *pNewFid = FindFidInfo(pMeta, FAN_EVENT_INFO_TYPE_NEW_DFID_NAME);
+    if (pOldFid == nullptr || pNewFid == nullptr)
+    {
+        return;
+    }
+
+    // 原目录的handle在事件生成时仍然有效, 解析出的是当前路径; 目录已被删除时按不在监视范围处理
+    std::string fromPath;
+    std::string toPath;
+    uint32_t fromEv = _resolveHandle(&pOldFid->fsid, pOldFid->handle, fromPath) ? _watchedEvent(fromPath) : 0;
+    uint32_t toEv = _resolveHandle(&pNewFid->fsid, pNewFid->handle, toPath) ? _watchedEvent(toPath) : 0;
+
+    InotifyEventItem eventItem;
+    uint32_t dirFlag = (pMeta->mask & FAN_ONDIR) ? EV_IN_ISDIR : 0;
+    if (fromEv != 0 && toEv != 0)
+    {
+        // 与inotify后端相同, 监视范围内的重命名输出一个EV_IN_MOVE
+        if (((fromEv & EV_IN_MOVED_OUT) | (toEv & EV_IN_MOVED_IN)) == 0)
+        {
+            return;
+        }
+
+        eventItem.event = EV_IN_MOVE | dirFlag;
+        eventItem.path = toPath;
+        eventItem.name = FidName(pNewFid);
+        eventItem.fromPath = fromPath;
+        eventItem.fromName = FidName(pOldFid);
+    }
+    else if (fromEv & EV_IN_MOVED_OUT)
+    {
+        eventItem.event = EV_IN_MOVED_OUT | dirFlag;
+        eventItem.path = fromPath;
+        eventItem.name = FidName(pOldFid);
+    }
+    else if (toEv & EV_IN_MOVED_IN)
+    {
+        eventItem.event = EV_IN_MOVED_IN | dirFlag;
+        eventItem.path = toPath;
+        eventItem.name = FidName(pNewFid);
+    }
+    else
+    {
+        return;
+    }
+
+    m_eventItemQueue.push_back(std::move(eventItem));
+
+    // 目录被移动后, 缓存的子目录路径失效
+    if (dirFlag)
+    {
+        m_handleCache.clear();
+    }
+}
+
+bool FanotifyTool::_resolveHandle(const void *fsid, const void *pHandle, std::string &dirPath)
+{
+    const struct file_handle *pFileHandle = static_cast<const struct file_handle *>(pHandle);
+    if (pFileHandle->handle_bytes > MAX_HANDLE_SIZE)
+    {
+        return false;
+    }
+
+    size_t handleSize = sizeof(struct file_handle) + pFileHandle->handle_bytes;
+    std::string cacheKey(static_cast<const char *>(fsid), sizeof(uint64_t));
+    cacheKey.append(static_cast<const char *>(pHandle), handleSize);
+    auto cacheIt = m_handleCache.find(cacheKey);
+    if (cacheIt != m_handleCache.end())
+    {
+        dirPath = cacheIt->second;
+        return true;
+    }
+
+    auto mountIt = m_mountFdMap.find(FsidToKey(fsid));
+    if (mountIt == m_mountFdMap.end())
+    {
+        return false;
+    }
+
+    // open_by_handle_at的参数不是const
+    alignas(struct file_handle) uint8_t handleBuffer[sizeof(struct file_handle) + MAX_HANDLE_SIZE];
+    memcpy(handleBuffer, pHandle, handleSize);
+    int32_t dirFd = open_by_handle_at(mountIt->second, reinterpret_cast<struct file_handle *>(handleBuffer),
+                                      O_PATH | O_CLOEXEC);
+    if (dirFd < 0)
+    {
+        // ESTALE: 目录已被删除
+        if (errno != ESTALE)
+        {
+            LOGW("open_by_handle_at error. [%d, %s]", errno, strerror(errno));
+        }
+        return false;
+    }
+
+    char procPath[64];
+    char linkPath[PATH_MAX];
+    snprintf(procPath, sizeof(procPath), "/proc/self/fd/%d", dirFd);
+    ssize_t linkSize = readlink(procPath, linkPath, sizeof(linkPath) - 1);
+    close(dirFd);
+    if (linkSize <= 0)
+    {
+        return false;
+    }
+
+    dirPath.assign(linkPath, linkSize);
+    if (dirPath.back() != '/')
+    {
+        dirPath.push_back('/');
+    }
+
+    m_handleCache.emplace(std::move(cacheKey), dirPath);
+    return true;
+}
+
+uint32_t FanotifyTool::_watchedEvent(const std::string &dirPath) const
+{
+    for (const auto &it : m_rootMap)
+    {
+        if (dirPath.compare(0, it.first.length(), it.first) == 0)
+        {
+            return it.second;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace eular
@@ -0,0 +1,121 @@
+/*************************************************************************
+    > File Name: fanotify_tool.h
+    > Author: hsz
+    > Brief: 基于fanotify文件系统mark的监控后端
+    > Created Time: 2026年10月17日 星期六 15时20分46秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_FANOTIFY_TOOL_H__
+#define __INOTIFY_FANOTIFY_TOOL_H__
+
+#include <string>
+#include <list>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "inotify_tool/watcher_backend.h"
+
+struct fanotify_event_metadata;
+
+namespace eular {
+
+/**
+ * @brief fanotify后端. 每个文件系统只需一个mark, 不受max_user_watches限制, 也不会为每个目录占用内核内存.
+ * 事件携带父目录的file handle和文件名(FAN_REPORT_DFID_NAME), 通过open_by_handle_at解析为路径,
+ * 只输出位于监视根目录下的事件. 需要CAP_SYS_ADMIN和CAP_DAC_READ_SEARCH, 内核5.9+
+ *
+ * 移动: 内核5.17+使用FAN_RENAME, 监视范围内的重命名与inotify后端相同输出一个EV_IN_MOVE(含fromPath/fromName).
+ * 更早的内核只有FAN_MOVED_FROM/FAN_MOVED_TO且不携带cookie, 重命名输出为不配对的EV_IN_MOVED_OUT和EV_IN_MOVED_IN,
+ * 上层无法区分重命名和移入/移出; 频繁移动的目录树在这些内核上应使用inotify后端
+ */
+class FanotifyTool : public WatcherBackend
+{
+public:
+    typedef std::shared_ptr<FanotifyTool> SP;
+    typedef std::unique_ptr<FanotifyTool> Ptr;
+
+    FanotifyTool() noexcept;
+    ~FanotifyTool() noexcept;
+
+    WatcherBackendType type() const override { return WatcherBackendType::FANOTIFY; }
+
+    bool create() noexcept override;
+    void destroy() override;
+    int32_t fd() const override;
+
+    /**
+     * @brief 监视目录所在的文件系统, 只输出paths下的事件
+     *
+     * @param paths 目录路径(绝对路径)数组
+     * @param ev 事件
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t watchRecursive(const std::vector<std::string> &paths, uint32_t ev) override;
+    using WatcherBackend::watchRecursive;
+
+    int32_t waitCompleteEvent(uint32_t timeout) override;
+    void setEventCallback(EventCallback cb) override;
+    int32_t processEvent() override;
+    void getEventItem(std::list<InotifyEventItem> &eventItemVec) override;
+    int32_t getLastError() override;
+
+protected:
+    /**
+     * @brief InotifyEvent事件转成fanotify mark的事件
+     *
+     * @param ev
+     * @return uint64_t
+     */
+    uint64_t inotifyEvent2FanotifyEv(uint32_t ev) const noexcept;
+
+    /**
+     * @brief 为路径所在的文件系统添加mark. 包含移动事件时优先使用FAN_RENAME, 内核不支持时退回FAN_MOVED_FROM/FAN_MOVED_TO
+     *
+     * @return int32_t fanotify_mark的返回值
+     */
+    int32_t _markFilesystem(const std::string &path, uint64_t mask);
+
+    int32_t _readEvent();
+    void _parseEvent(const uint8_t *pBuffer, size_t size);
+
+    /**
+     * @brief 解析FAN_RENAME事件, 两端都在监视范围内时输出EV_IN_MOVE, 否则输出EV_IN_MOVED_OUT或EV_IN_MOVED_IN
+     */
+    void _parseRename(const struct fanotify_event_metadata *pMeta);
+
+    /**
+     * @brief 将目录的file handle解析为路径(以'/'结尾)
+     *
+     * @param fsid 文件系统ID
+     * @param pHandle struct file_handle
+     * @param dirPath 输出路径
+     * @return true 成功
+     * @return false 失败(目录已删除或不在监视的文件系统中)
+     */
+    bool _resolveHandle(const void *fsid, const void *pHandle, std::string &dirPath);
+
+    /**
+     * @brief 路径是否在监视根目录下
+     *
+     * @param dirPath 目录路径
+     * @return uint32_t 所在根目录的事件掩码, 不在时返回0
+     */
+    uint32_t _watchedEvent(const std::string &dirPath) const;
+
+private:
+    int32_t         m_fanotifyFd;
+    int32_t         m_errorCode;
+    EventCallback   m_eventCallback;
+    bool            m_renameSupported;  // 内核支持FAN_RENAME(5.17+), 移动事件可配对
+    std::list<InotifyEventItem>                 m_eventItemQueue;   // 事件队列
+    std::unordered_set<std::string>             m_fileModifySet;    // 文件被修改集合
+    std::map<std::string, uint32_t>             m_rootMap;          // 监视根目录 -> 事件
+    std::unordered_map<uint64_t, int32_t>       m_mountFdMap;       // fsid -> 文件系统内目录句柄(用于open_by_handle_at)
+    std::unordered_map<std::string, std::string> m_handleCache;     // fsid + file handle -> 目录路径
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_FANOTIFY_TOOL_H__
@@ -0,0 +1,80 @@
+/*************************************************************************
+    > File Name: histogram.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 23时48分26秒
+ ************************************************************************/
+
+#include "inotify_tool/histogram.h"
+
+namespace eular {
+
+uint64_t HistogramSnapshot::percentile(double p) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(p * count + 0.5);
+    rank = rank == 0 ? 1 : (rank > count ? count : rank);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LOG2_BUCKETS; ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+        {
+            uint64_t upper = (i == 0) ? 0 : (i == 64 ? UINT64_MAX : (1ULL << i) - 1);
+            return upper < max ? upper : max;
+        }
+    }
+
+    return max;
+}
+
+Log2Histogram::Log2Histogram()
+{
+    reset();
+}
+
+void Log2Histogram::record(uint64_t value)
+{
+    size_t idx = (value == 0) ? 0 : 64 - __builtin_clzll(value);
+    m_buckets[idx].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+HistogramSnapshot Log2Histogram::snapshot() const
+{
+    HistogramSnapshot snapshot;
+    for (size_t i = 0; i < LOG2_BUCKETS; ++i)
+    {
+        snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+
+    snapshot.count = m_count.load(std::memory_order_relaxed);
+    snapshot.sum = m_sum.load(std::memory_order_relaxed);
+    snapshot.max = m_max.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void Log2Histogram::reset()
+{
+    for (auto &it : m_buckets)
+    {
+        it.store(0, std::memory_order_relaxed);
+    }
+
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+} // namespace eular
@@ -0,0 +1,61 @@
+/*************************************************************************
+    > File Name: histogram.h
+    > Author: hsz
+    > Brief: 无锁log2直方图, 记录线程与查询线程可以不同
+    > Created Time: 2026年10月17日 星期六 23时48分20秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_HISTOGRAM_H__
+#define __INOTIFY_HISTOGRAM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+namespace eular {
+
+#define LOG2_BUCKETS    65
+
+struct HistogramSnapshot
+{
+    uint64_t    count = 0;
+    uint64_t    sum = 0;
+    uint64_t    max = 0;
+    uint64_t    buckets[LOG2_BUCKETS] = {}; // buckets[0]为0, buckets[i]为[2^(i-1), 2^i)
+
+    double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0.0; }
+
+    /**
+     * @brief 近似分位数, 返回所在桶的上界(不超过max)
+     *
+     * @param p [0, 1]
+     */
+    uint64_t percentile(double p) const;
+};
+
+/**
+ * @brief 按2的幂分桶的直方图. record只做relaxed原子加, 不分配内存; snapshot各字段之间不保证一致
+ */
+class Log2Histogram
+{
+public:
+    Log2Histogram();
+    ~Log2Histogram() = default;
+
+    Log2Histogram(const Log2Histogram &) = delete;
+    Log2Histogram &operator=(const Log2Histogram &) = delete;
+
+    void record(uint64_t value);
+    HistogramSnapshot snapshot() const;
+    void reset();
+
+private:
+    std::atomic<uint64_t>   m_buckets[LOG2_BUCKETS];
+    std::atomic<uint64_t>   m_count;
+    std::atomic<uint64_t>   m_sum;
+    std::atomic<uint64_t>   m_max;
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_HISTOGRAM_H__
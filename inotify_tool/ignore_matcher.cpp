@@ -0,0 +1,496 @@
+/*************************************************************************
+    > File Name: ignore_matcher.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 20时41分58秒
+ ************************************************************************/
+
+#include "inotify_tool/ignore_matcher.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <utils/errors.h>
+#include <log/log.h>
+
+#define LOG_TAG "Ignore-matcher"
+
+namespace eular {
+
+/**
+ * @brief 匹配字符类[...], pos指向'['
+ *
+ * @param valid 输出是否完整的字符类, 不完整时'['按普通字符处理
+ * @return true c属于字符类
+ */
+static bool MatchClass(std::string_view pattern, size_t &pos, char c, bool &valid)
+{
+    size_t i = pos + 1;
+    bool negate = false;
+    if (i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^'))
+    {
+        negate = true;
+        ++i;
+    }
+
+    bool matched = false;
+    bool first = true;
+    while (i < pattern.size() && (pattern[i] != ']' || first))
+    {
+        first = false;
+        char low = pattern[i];
+        if (low == '\\' && i + 1 < pattern.size())
+        {
+            low = pattern[++i];
+        }
+        ++i;
+
+        char high = low;
+        if (i + 1 < pattern.size() && pattern[i] == '-' && pattern[i + 1] != ']')
+        {
+            high = pattern[i + 1];
+            i += 2;
+            if (high == '\\' && i < pattern.size())
+            {
+                high = pattern[i++];
+            }
+        }
+
+        if (low <= c && c <= high)
+        {
+            matched = true;
+        }
+    }
+
+    valid = i < pattern.size();
+    if (valid)
+    {
+        pos = i + 1;
+    }
+
+    return matched != negate;
+}
+
+IgnoreMatcher::IgnoreMatcher(const std::string &root)
+{
+    setRoot(root);
+}
+
+void IgnoreMatcher::setRoot(const std::string &root)
+{
+    m_root = root;
+    if (!m_root.empty() && m_root.back() != '/')
+    {
+        m_root.push_back('/');
+    }
+}
+
+int32_t IgnoreMatcher::add(const std::string &rule)
+{
+    std::vector<std::string> rules = { rule };
+    return add(rules);
+}
+
+int32_t IgnoreMatcher::add(const std::vector<std::string> &rules)
+{
+    std::vector<Rule> ruleVec;
+    for (const auto &it : rules)
+    {
+        Rule rule;
+        int32_t status = _compile(it, rule);
+        if (status < 0)
+        {
+            LOGE("invalid ignore rule: \"%s\"", it.c_str());
+            return status;
+        }
+
+        if (status > 0)
+        {
+            ruleVec.push_back(std::move(rule));
+        }
+    }
+
+    for (auto &it : ruleVec)
+    {
+        m_ruleVec.push_back(std::move(it));
+    }
+    _index();
+
+    return NO_ERROR;
+}
+
+int32_t IgnoreMatcher::load(const std::string &file)
+{
+    std::vector<std::string> rules;
+    int32_t status = ReadFile(file, rules);
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    return add(rules);
+}
+
+void IgnoreMatcher::clear()
+{
+    m_ruleVec.clear();
+    _index();
+}
+
+bool IgnoreMatcher::ignored(std::string_view path, bool isDir) const
+{
+    while (!path.empty() && path.back() == '/')
+    {
+        path.remove_suffix(1);
+    }
+
+    // 根目录本身不会被忽略
+    if (path.length() < m_root.length())
+    {
+        return false;
+    }
+
+    size_t pos = path.rfind('/');
+    if (pos == std::string_view::npos)
+    {
+        return ignored(std::string_view(), path, isDir);
+    }
+
+    return ignored(path.substr(0, pos + 1), path.substr(pos + 1), isDir);
+}
+
+bool IgnoreMatcher::ignored(std::string_view dirPath, std::string_view name, bool isDir) const
+{
+    if (m_ruleVec.empty() || name.empty())
+    {
+        return false;
+    }
+
+    int64_t best = -1;
+    _lookup(m_nameIndex, name, isDir, best);
+    if (!m_suffixIndex.empty())
+    {
+        size_t pos = name.rfind('.');
+        if (pos != std::string_view::npos)
+        {
+            _lookup(m_suffixIndex, name.substr(pos), isDir, best);
+        }
+    }
+
+    // 只有存在路径规则时才拼接相对路径
+    thread_local std::string relPathScratch;
+    std::string_view relPath;
+    if (m_pathRules > 0 && !m_root.empty() && dirPath.compare(0, m_root.length(), m_root) == 0)
+    {
+        relPathScratch.assign(dirPath.substr(m_root.length()));
+        relPathScratch.append(name);
+        relPath = relPathScratch;
+        _lookup(m_pathIndex, relPath, isDir, best);
+    }
+
+    // 序号大的规则优先, 不大于已命中规则的无需检查
+    for (auto it = m_globVec.rbegin(); it != m_globVec.rend() && static_cast<int64_t>(*it) > best; ++it)
+    {
+        const Rule &rule = m_ruleVec[*it];
+        if (rule.dirOnly && !isDir)
+        {
+            continue;
+        }
+
+        bool matched = (rule.type == NAME_GLOB) ? Match(rule.pattern, name) :
+            (!relPath.empty() && Match(rule.pattern, relPath));
+        if (matched)
+        {
+            best = *it;
+            break;
+        }
+    }
+
+    return best >= 0 && !m_ruleVec[best].negate;
+}
+
+bool IgnoreMatcher::Match(std::string_view pattern, std::string_view path)
+{
+    size_t p = 0;
+    size_t s = 0;
+    while (p < pattern.size())
+    {
+        char c = pattern[p];
+        if (c == '*')
+        {
+            if (p + 1 < pattern.size() && pattern[p + 1] == '*')
+            {
+                size_t next = p + 2;
+                if (next < pattern.size() && pattern[next] == '/')
+                {
+                    // "**/"匹配零或多层目录
+                    std::string_view rest = pattern.substr(next + 1);
+                    for (size_t k = s; ; ++k)
+                    {
+                        if (Match(rest, path.substr(k)))
+                        {
+                            return true;
+                        }
+
+                        k = path.find('/', k);
+                        if (k == std::string_view::npos)
+                        {
+                            return false;
+                        }
+                    }
+                }
+
+                std::string_view rest = pattern.substr(next);
+                for (size_t k = s; k <= path.size(); ++k)
+                {
+                    if (Match(rest, path.substr(k)))
+                    {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            // '*'不跨越'/'
+            std::string_view rest = pattern.substr(p + 1);
+            for (size_t k = s; ; ++k)
+            {
+                if (Match(rest, path.substr(k)))
+                {
+                    return true;
+                }
+
+                if (k >= path.size() || path[k] == '/')
+                {
+                    return false;
+                }
+            }
+        }
+
+        if (s >= path.size())
+        {
+            return false;
+        }
+
+        if (c == '?')
+        {
+            if (path[s] == '/')
+            {
+                return false;
+            }
+
+            ++p;
+            ++s;
+            continue;
+        }
+
+        if (c == '[')
+        {
+            size_t pos = p;
+            bool valid = false;
+            bool matched = MatchClass(pattern, pos, path[s], valid);
+            if (valid)
+            {
+                if (!matched || path[s] == '/')
+                {
+                    return false;
+                }
+
+                p = pos;
+                ++s;
+                continue;
+            }
+        }
+
+        if (c == '\\' && p + 1 < pattern.size())
+        {
+            c = pattern[++p];
+        }
+
+        if (c != path[s])
+        {
+            return false;
+        }
+
+        ++p;
+        ++s;
+    }
+
+    return s == path.size();
+}
+
+int32_t IgnoreMatcher::ReadFile(const std::string &file, std::vector<std::string> &rules)
+{
+    FILE *fp = fopen(file.c_str(), "r");
+    if (fp == nullptr)
+    {
+        int32_t error = errno;
+        LOGE("open %s error. [%d, %s]", file.c_str(), error, strerror(error));
+        return -error;
+    }
+
+    char *line = nullptr;
+    size_t capacity = 0;
+    ssize_t length = 0;
+    while ((length = getline(&line, &capacity, fp)) >= 0)
+    {
+        rules.emplace_back(line, length);
+    }
+
+    free(line);
+    fclose(fp);
+    return NO_ERROR;
+}
+
+const std::vector<std::string> &IgnoreMatcher::DefaultRules()
+{
+    static const std::vector<std::string> rules = {
+        "node_modules/",
+        "__pycache__/",
+        "**/.git/objects/",
+        ".svn/",
+        ".hg/",
+        "*.swp",
+        "*.swo",
+        "*.swx",
+        "*~",
+        ".#*",
+        "\\#*#",
+        ".DS_Store",
+    };
+
+    return rules;
+}
+
+int32_t IgnoreMatcher::_compile(const std::string &line, Rule &rule)
+{
+    std::string_view text(line);
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+    {
+        text.remove_suffix(1);
+    }
+
+    // 结尾未转义的空格被忽略
+    while (!text.empty() && text.back() == ' ' && !(text.size() >= 2 && text[text.size() - 2] == '\\'))
+    {
+        text.remove_suffix(1);
+    }
+
+    if (text.empty() || text[0] == '#')
+    {
+        return 0;
+    }
+
+    rule.negate = false;
+    if (text[0] == '!')
+    {
+        rule.negate = true;
+        text.remove_prefix(1);
+    }
+    else if (text[0] == '\\' && text.size() > 1 && (text[1] == '!' || text[1] == '#'))
+    {
+        text.remove_prefix(1);
+    }
+
+    rule.dirOnly = false;
+    while (!text.empty() && text.back() == '/')
+    {
+        rule.dirOnly = true;
+        text.remove_suffix(1);
+    }
+
+    // "**/name"等价于"name"
+    while (text.size() > 3 && text.compare(0, 3, "**/") == 0 && text.find('/', 3) == std::string_view::npos)
+    {
+        text.remove_prefix(3);
+    }
+
+    bool anchored = (text.find('/') != std::string_view::npos);
+    if (!text.empty() && text[0] == '/')
+    {
+        text.remove_prefix(1);
+    }
+
+    if (text.empty())
+    {
+        return INVALID_PARAM;
+    }
+
+    bool glob = (text.find_first_of("*?[\\") != std::string_view::npos);
+    rule.pattern.assign(text);
+    if (anchored)
+    {
+        rule.type = glob ? PATH_GLOB : PATH_LITERAL;
+    }
+    else if (!glob)
+    {
+        rule.type = NAME_LITERAL;
+    }
+    else if (text.size() > 2 && text[0] == '*' && text[1] == '.' &&
+             text.find_first_of("*?[\\.", 2) == std::string_view::npos)
+    {
+        rule.type = NAME_SUFFIX;
+    }
+    else
+    {
+        rule.type = NAME_GLOB;
+    }
+
+    return 1;
+}
+
+void IgnoreMatcher::_index()
+{
+    m_nameIndex.clear();
+    m_suffixIndex.clear();
+    m_pathIndex.clear();
+    m_globVec.clear();
+    m_pathRules = 0;
+
+    for (uint32_t i = 0; i < m_ruleVec.size(); ++i)
+    {
+        std::string_view pattern(m_ruleVec[i].pattern);
+        switch (m_ruleVec[i].type)
+        {
+        case NAME_LITERAL:
+            m_nameIndex[pattern].push_back(i);
+            break;
+        case NAME_SUFFIX:
+            m_suffixIndex[pattern.substr(1)].push_back(i);
+            break;
+        case PATH_LITERAL:
+            m_pathIndex[pattern].push_back(i);
+            ++m_pathRules;
+            break;
+        case PATH_GLOB:
+            m_globVec.push_back(i);
+            ++m_pathRules;
+            break;
+        case NAME_GLOB:
+            m_globVec.push_back(i);
+            break;
+        }
+    }
+}
+
+void IgnoreMatcher::_lookup(const RuleIndex &index, std::string_view key, bool isDir, int64_t &best) const
+{
+    auto it = index.find(key);
+    if (it == index.end())
+    {
+        return;
+    }
+
+    for (uint32_t i : it->second)
+    {
+        if (static_cast<int64_t>(i) > best && (!m_ruleVec[i].dirOnly || isDir))
+        {
+            best = i;
+        }
+    }
+}
+
+} // namespace eular
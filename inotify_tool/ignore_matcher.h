@@ -0,0 +1,171 @@
+/*************************************************************************
+    > File Name: ignore_matcher.h
+    > Author: hsz
+    > Brief: gitignore语法的忽略规则
+    > Created Time: 2026年10月17日 星期六 20时41分52秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_IGNORE_MATCHER_H__
+#define __INOTIFY_IGNORE_MATCHER_H__
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+namespace eular {
+
+/**
+ * @brief 忽略规则匹配器, 语法与.gitignore相同:
+ *  '#'开头为注释; '!'取反; 结尾'/'只匹配目录; 开头或中间含'/'时相对根目录匹配完整路径, 否则匹配任意层级的名字;
+ *  '*'和'?'不匹配'/', '**'匹配任意层目录. 多条规则同时匹配时以最后一条为准.
+ *
+ * 规则按类型编译: 不含通配符的名字和路径放入哈希表, "*.ext"按扩展名放入哈希表, 其余通配规则按序号倒序逐条匹配,
+ * 序号不大于已命中规则的不再检查. 常见的规则(node_modules/, *.swp)只需一两次哈希查找.
+ *
+ * NOTE 只判断路径本身, 不检查父目录是否被忽略, 调用者需保证父目录未被忽略(被忽略的目录不会被遍历和监视)
+ */
+class IgnoreMatcher
+{
+public:
+    IgnoreMatcher() = default;
+    explicit IgnoreMatcher(const std::string &root);
+    ~IgnoreMatcher() = default;
+
+    // 索引中的string_view指向规则字符串, 不可拷贝
+    IgnoreMatcher(const IgnoreMatcher &) = delete;
+    IgnoreMatcher &operator=(const IgnoreMatcher &) = delete;
+
+    /**
+     * @brief 设置根目录, 路径规则相对根目录匹配
+     *
+     * @param root 绝对路径
+     */
+    void setRoot(const std::string &root);
+    const std::string &root() const { return m_root; }
+
+    /**
+     * @brief 添加一条规则, 空行和注释被跳过
+     *
+     * @param rule 规则
+     * @return int32_t 成功返回0, 规则无效返回INVALID_PARAM
+     */
+    int32_t add(const std::string &rule);
+
+    /**
+     * @brief 添加多条规则, 有无效规则时不添加任何规则
+     *
+     * @param rules 规则
+     * @return int32_t 成功返回0, 规则无效返回INVALID_PARAM
+     */
+    int32_t add(const std::vector<std::string> &rules);
+
+    /**
+     * @brief 从文件(如.gitignore)添加规则
+     *
+     * @param file 文件路径
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t load(const std::string &file);
+
+    void clear();
+    bool empty() const { return m_ruleVec.empty(); }
+    size_t size() const { return m_ruleVec.size(); }
+
+    /**
+     * @brief 是否有需要完整路径的规则, 没有时ignored的dirPath可以为空
+     */
+    bool anchored() const { return m_pathRules > 0; }
+
+    /**
+     * @brief 路径是否被忽略
+     *
+     * @param path 根目录下的绝对路径, 目录可以'/'结尾
+     * @param isDir 是否目录
+     * @return true 被忽略
+     */
+    bool ignored(std::string_view path, bool isDir) const;
+
+    /**
+     * @brief 目录下的项是否被忽略, 不需要拼接完整路径
+     *
+     * @param dirPath 所在目录的绝对路径, 以'/'结尾. anchored()为false时可以为空
+     * @param name 文件/目录名
+     * @param isDir 是否目录
+     * @return true 被忽略
+     */
+    bool ignored(std::string_view dirPath, std::string_view name, bool isDir) const;
+
+    /**
+     * @brief 通配符匹配, '*'和'?'不匹配'/', '**'匹配任意字符, 支持[a-z]/[!a-z]和'\'转义
+     *
+     * @param pattern 模式
+     * @param path 路径
+     * @return true 匹配
+     */
+    static bool Match(std::string_view pattern, std::string_view path);
+
+    /**
+     * @brief 读取规则文件的每一行
+     *
+     * @param file 文件路径
+     * @param rules 输出
+     * @return int32_t 成功返回0, 失败返回负的errno
+     */
+    static int32_t ReadFile(const std::string &file, std::vector<std::string> &rules);
+
+    /**
+     * @brief 常用的忽略规则: 依赖目录, 版本库对象, 编辑器临时文件
+     */
+    static const std::vector<std::string> &DefaultRules();
+
+private:
+    enum RuleType : uint8_t {
+        NAME_LITERAL,   // 名字, 无通配符
+        NAME_SUFFIX,    // *.ext
+        NAME_GLOB,      // 名字, 含通配符
+        PATH_LITERAL,   // 相对路径, 无通配符
+        PATH_GLOB,      // 相对路径, 含通配符
+    };
+
+    struct Rule
+    {
+        std::string pattern;    // 去掉'!', 开头和结尾'/'后的模式
+        RuleType    type;
+        bool        negate;     // '!'
+        bool        dirOnly;    // 结尾'/'
+    };
+
+    typedef std::unordered_map<std::string_view, std::vector<uint32_t>> RuleIndex;
+
+    /**
+     * @brief 解析一行规则
+     *
+     * @return int32_t 有规则返回1, 空行或注释返回0, 无效返回INVALID_PARAM
+     */
+    static int32_t _compile(const std::string &line, Rule &rule);
+
+    /**
+     * @brief 规则全部添加后重建索引
+     */
+    void _index();
+
+    /**
+     * @brief 在索引中查找序号大于best的规则
+     */
+    void _lookup(const RuleIndex &index, std::string_view key, bool isDir, int64_t &best) const;
+
+private:
+    std::string         m_root;         // 以'/'结尾
+    std::vector<Rule>   m_ruleVec;
+    RuleIndex           m_nameIndex;    // NAME_LITERAL
+    RuleIndex           m_suffixIndex;  // NAME_SUFFIX, key为".ext"
+    RuleIndex           m_pathIndex;    // PATH_LITERAL
+    std::vector<uint32_t> m_globVec;    // NAME_GLOB和PATH_GLOB的序号, 升序
+    uint32_t            m_pathRules = 0;
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_IGNORE_MATCHER_H__
@@ -0,0 +1,131 @@
+/*************************************************************************
+    > File Name: inode_index.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 22时31分12秒
+ ************************************************************************/
+
+#include "inotify_tool/inode_index.h"
+
+namespace eular {
+
+InodeIndex::InodeIndex(uint32_t tombstoneTtlMs) :
+    m_tombstoneTtlMs(tombstoneTtlMs),
+    m_lastExpireMs(0)
+{
+}
+
+void InodeIndex::setTombstoneTtl(uint32_t tombstoneTtlMs)
+{
+    m_tombstoneTtlMs = tombstoneTtlMs;
+}
+
+void InodeIndex::update(uint64_t dev, uint64_t ino, int32_t wd, std::string_view name, uint64_t size, int64_t mtimeNs)
+{
+    InodeRecord &record = m_recordMap[InodeKey{dev, ino}];
+    record.wd = wd;
+    record.name.assign(name);
+    record.gonePath.clear();
+    record.size = size;
+    record.mtimeNs = mtimeNs;
+    record.goneMs = 0;
+}
+
+const InodeRecord *InodeIndex::find(uint64_t dev, uint64_t ino) const
+{
+    auto it = m_recordMap.find(InodeKey{dev, ino});
+    if (it == m_recordMap.end())
+    {
+        return nullptr;
+    }
+
+    if (!it->second.gone() && m_deadWdSet.count(it->second.wd) > 0)
+    {
+        return nullptr;
+    }
+
+    return &it->second;
+}
+
+void InodeIndex::erase(uint64_t dev, uint64_t ino, int32_t wd, std::string_view name)
+{
+    auto it = m_recordMap.find(InodeKey{dev, ino});
+    if (it != m_recordMap.end() && !it->second.gone() && it->second.wd == wd && it->second.name == name)
+    {
+        m_recordMap.erase(it);
+    }
+}
+
+void InodeIndex::markGone(uint64_t dev, uint64_t ino, int32_t wd, std::string_view name, const std::string &path, uint64_t nowMs)
+{
+    auto it = m_recordMap.find(InodeKey{dev, ino});
+    if (it == m_recordMap.end() || it->second.gone() || it->second.wd != wd || it->second.name != name)
+    {
+        return;
+    }
+
+    it->second.wd = -1;
+    it->second.gonePath = path;
+    it->second.goneMs = nowMs > 0 ? nowMs : 1;
+}
+
+void InodeIndex::setDirDev(int32_t wd, uint64_t dev)
+{
+    m_dirDevMap[wd] = dev;
+    m_deadWdSet.erase(wd);
+}
+
+bool InodeIndex::dirDev(int32_t wd, uint64_t &dev) const
+{
+    auto it = m_dirDevMap.find(wd);
+    if (it == m_dirDevMap.end())
+    {
+        return false;
+    }
+
+    dev = it->second;
+    return true;
+}
+
+void InodeIndex::forgetDir(int32_t wd)
+{
+    if (m_dirDevMap.erase(wd) > 0)
+    {
+        m_deadWdSet.insert(wd);
+    }
+}
+
+void InodeIndex::expire(uint64_t nowMs)
+{
+    if (nowMs < m_lastExpireMs + m_tombstoneTtlMs / 2)
+    {
+        return;
+    }
+    m_lastExpireMs = nowMs;
+
+    for (auto it = m_recordMap.begin(); it != m_recordMap.end(); )
+    {
+        const InodeRecord &record = it->second;
+        bool expired = record.gone() ? (record.goneMs + m_tombstoneTtlMs <= nowMs) : (m_deadWdSet.count(record.wd) > 0);
+        if (expired)
+        {
+            it = m_recordMap.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    m_deadWdSet.clear();
+}
+
+void InodeIndex::clear()
+{
+    m_recordMap.clear();
+    m_dirDevMap.clear();
+    m_deadWdSet.clear();
+    m_lastExpireMs = 0;
+}
+
+} // namespace eular
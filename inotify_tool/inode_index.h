@@ -0,0 +1,128 @@
+/*************************************************************************
+    > File Name: inode_index.h
+    > Author: hsz
+    > Brief: (dev, inode) -> 文件位置的索引, 用于识别移入/硬链接的已知文件
+    > Created Time: 2026年10月17日 星期六 22时31分06秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_INODE_INDEX_H__
+#define __INOTIFY_INODE_INDEX_H__
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace eular {
+
+struct InodeRecord
+{
+    int32_t     wd = -1;        // 所在目录的wd, 已移出时无效
+    std::string name;           // 文件名
+    std::string gonePath;       // 移出监视范围时的完整路径
+    uint64_t    size = 0;
+    int64_t     mtimeNs = 0;
+    uint64_t    goneMs = 0;     // 移出监视范围的单调时钟毫秒, 0表示仍在监视范围内
+
+    bool gone() const { return goneMs != 0; }
+};
+
+/**
+ * @brief 监视范围内普通文件的(dev, inode)索引, 随事件增量更新. 只保存所在目录的wd和文件名,
+ * 目录重命名无需更新. 移出监视范围的文件保留一段时间(墓碑), 之后移回时可识别为移动.
+ * 解除监视的目录只做标记, 其下的记录在下一次expire时统一清理
+ */
+class InodeIndex
+{
+public:
+    InodeIndex(uint32_t tombstoneTtlMs = 10 * 60 * 1000);
+    ~InodeIndex() = default;
+
+    /**
+     * @brief 设置移出的文件保留的时间
+     *
+     * @param tombstoneTtlMs 毫秒
+     */
+    void setTombstoneTtl(uint32_t tombstoneTtlMs);
+
+    /**
+     * @brief 插入或更新文件的位置和属性
+     */
+    void update(uint64_t dev, uint64_t ino, int32_t wd, std::string_view name, uint64_t size, int64_t mtimeNs);
+
+    /**
+     * @brief 查找记录, 所在目录已解除监视的记录视为不存在
+     *
+     * @return const InodeRecord* 不存在返回nullptr
+     */
+    const InodeRecord *find(uint64_t dev, uint64_t ino) const;
+
+    /**
+     * @brief 删除记录, 只有位置与(wd, name)一致时才删除(同一inode的其他硬链接不受影响)
+     */
+    void erase(uint64_t dev, uint64_t ino, int32_t wd, std::string_view name);
+
+    /**
+     * @brief 文件被移出监视范围, 转为墓碑
+     *
+     * @param path 移出前的完整路径
+     * @param nowMs 单调时钟毫秒
+     */
+    void markGone(uint64_t dev, uint64_t ino, int32_t wd, std::string_view name, const std::string &path, uint64_t nowMs);
+
+    /**
+     * @brief 记录目录所在的设备
+     */
+    void setDirDev(int32_t wd, uint64_t dev);
+
+    /**
+     * @brief 获取目录所在的设备
+     *
+     * @return true 目录已索引
+     */
+    bool dirDev(int32_t wd, uint64_t &dev) const;
+
+    /**
+     * @brief 目录已解除监视
+     */
+    void forgetDir(int32_t wd);
+
+    /**
+     * @brief 清理过期的墓碑和已解除监视目录下的记录, 每半个TTL最多执行一次
+     *
+     * @param nowMs 单调时钟毫秒
+     */
+    void expire(uint64_t nowMs);
+
+    size_t size() const { return m_recordMap.size(); }
+    void clear();
+
+protected:
+    struct InodeKey
+    {
+        uint64_t    dev;
+        uint64_t    ino;
+
+        bool operator==(const InodeKey &other) const { return dev == other.dev && ino == other.ino; }
+    };
+
+    struct InodeKeyHash
+    {
+        size_t operator()(const InodeKey &key) const
+        {
+            return static_cast<size_t>(key.ino * 0x9e3779b97f4a7c15ULL ^ key.dev);
+        }
+    };
+
+private:
+    uint32_t        m_tombstoneTtlMs;
+    uint64_t        m_lastExpireMs;
+    std::unordered_map<InodeKey, InodeRecord, InodeKeyHash> m_recordMap;
+    std::unordered_map<int32_t, uint64_t>   m_dirDevMap;    // wd -> dev
+    std::unordered_set<int32_t>             m_deadWdSet;    // 已解除监视, 等待清理的目录
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_INODE_INDEX_H__
@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include <string>
 
+// 监视范围内配对的重命名, path/name为新位置, fromPath/fromName为原位置
 #define EV_IN_MOVE (InotifyEvent::EV_IN_MOVED_OUT | InotifyEvent::EV_IN_MOVED_IN)
 #define EV_IN_ALL (                     \
     InotifyEvent::EV_IN_MODIFY_OVER |   \
@@ -29,10 +30,12 @@ enum InotifyEvent {
     EV_IN_MOVED_IN          = 0x80,         // 文件/目录从其他目录移动到监视目录
     EV_IN_CREATE            = 0x100,        // 在监视目录中创建文件或目录, 例如open(O_CREAT), mkdir, link, symlink, bind on a UNIX domain socket
     EV_IN_DELETE            = 0x200,        // 文件或目录从监视目录中删除
+    EV_IN_COPY              = 0x10000,      // 与EV_IN_CREATE/EV_IN_MOVED_IN同时出现, 文件是fromPath/fromName的硬链接(需开启身份跟踪)
 
     // 特殊标志, 无需主动带上
     EV_IN_ERROR             = 0x1000,       // 处理事件过程中出现问题
     EV_IN_UNMOUNT           = 0x2000,       // 监视的目录被卸载
+    EV_IN_Q_OVERFLOW        = 0x4000,       // 内核事件队列溢出, 期间的事件已丢失
     EV_IN_IGNORED           = 0x8000,       // 监视的文件/目录已被删除
     EV_IN_ISDIR             = 0x40000000,   // 操作的是个目录
 };
@@ -43,6 +46,10 @@ struct InotifyEventItem
     uint32_t        cookie = 0; // 关联两个事件
     std::string     path;       // 监视的路径, 如果监视的文件则是文件的绝对路径
     std::string     name;       // 发生事件的文件名(路径时此值为空)
+    std::string     fromPath;   // EV_IN_MOVE时原所在目录, EV_IN_COPY时已知文件所在目录
+    std::string     fromName;   // EV_IN_MOVE时原文件名, EV_IN_COPY时已知文件名
+    uint64_t        readNs = 0; // 从内核读出(或由轮询/重新同步产生)时的CLOCK_MONOTONIC纳秒
+    uint64_t        emitNs = 0; // 交付给使用者时的CLOCK_MONOTONIC纳秒
 };
 
 
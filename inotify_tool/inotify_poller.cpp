@@ -0,0 +1,209 @@
+/*************************************************************************
+    > File Name: inotify_poller.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 10时12分40秒
+ ************************************************************************/
+
+#include <utils/sysdef.h>
+#include <utils/errors.h>
+#include <log/log.h>
+
+#ifdef OS_LINUX
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#include "inotify_tool/inotify_poller.h"
+#include "inotify_tool/watcher_backend.h"
+
+#define LOG_TAG "Inotify-poller"
+
+#define INVALID_ID      (-1)
+#define MAX_EPOLL_EVENTS 64
+
+namespace eular {
+
+InotifyPoller::InotifyPoller() noexcept :
+    m_epollFd(INVALID_ID),
+    m_errorCode(0)
+{
+}
+
+InotifyPoller::~InotifyPoller() noexcept
+{
+    destroy();
+}
+
+bool InotifyPoller::create() noexcept
+{
+    m_errorCode = 0;
+    if (INVALID_ID == m_epollFd)
+    {
+        m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    }
+
+    if (INVALID_ID == m_epollFd)
+    {
+        m_errorCode = errno;
+        return false;
+    }
+
+    return true;
+}
+
+void InotifyPoller::destroy()
+{
+    if (m_epollFd != INVALID_ID)
+    {
+        close(m_epollFd);
+        m_epollFd = INVALID_ID;
+    }
+
+    m_inotifySet.clear();
+}
+
+int32_t InotifyPoller::fd() const
+{
+    return m_epollFd;
+}
+
+int32_t InotifyPoller::addInotify(WatcherBackend *pInotify)
+{
+    m_errorCode = 0;
+    if (INVALID_ID == m_epollFd)
+    {
+        return NO_INIT;
+    }
+
+    if (pInotify == nullptr || pInotify->fd() == INVALID_ID)
+    {
+        return INVALID_PARAM;
+    }
+
+    if (m_inotifySet.find(pInotify) != m_inotifySet.end())
+    {
+        return ALREADY_EXISTS;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = pInotify;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, pInotify->fd(), &ev) < 0)
+    {
+        m_errorCode = errno;
+        LOGE("epoll_ctl(ADD, %d) error. [%d, %s]", pInotify->fd(), errno, strerror(errno));
+        return UNKNOWN_ERROR;
+    }
+
+    m_inotifySet.insert(pInotify);
+    return NO_ERROR;
+}
+
+int32_t InotifyPoller::removeInotify(WatcherBackend *pInotify)
+{
+    m_errorCode = 0;
+    auto it = m_inotifySet.find(pInotify);
+    if (it == m_inotifySet.end())
+    {
+        return INVALID_PARAM;
+    }
+
+    m_inotifySet.erase(it);
+    if (m_epollFd != INVALID_ID && pInotify->fd() != INVALID_ID)
+    {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, pInotify->fd(), nullptr);
+    }
+
+    return NO_ERROR;
+}
+
+int32_t InotifyPoller::poll(uint32_t timeout)
+{
+    return _wait(timeout > 0 ? static_cast<int32_t>(timeout) : -1);
+}
+
+int32_t InotifyPoller::dispatch()
+{
+    int32_t status = _wait(0);
+    return status == TIMED_OUT ? NO_ERROR : status;
+}
+
+int64_t InotifyPoller::nextTimeout() const
+{
+    int64_t timeout = -1;
+    for (WatcherBackend *pInotify : m_inotifySet)
+    {
+        int64_t timerMs = pInotify->nextTimeout();
+        if (timerMs >= 0 && (timeout < 0 || timerMs < timeout))
+        {
+            timeout = timerMs;
+        }
+    }
+
+    return timeout;
+}
+
+int32_t InotifyPoller::getLastError() const
+{
+    return m_errorCode;
+}
+
+int32_t InotifyPoller::_wait(int32_t timeoutMs)
+{
+    m_errorCode = 0;
+    if (INVALID_ID == m_epollFd)
+    {
+        return NO_INIT;
+    }
+
+    // 后端的定时任务到期时也需要醒来
+    int32_t waitMs = timeoutMs;
+    int64_t timerMs = nextTimeout();
+    if (timerMs >= 0 && (waitMs < 0 || timerMs < waitMs))
+    {
+        waitMs = static_cast<int32_t>(timerMs);
+    }
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int32_t nfds = 0;
+    do {
+        nfds = epoll_wait(m_epollFd, events, MAX_EPOLL_EVENTS, waitMs);
+    } while (nfds < 0 && errno == EINTR);
+
+    if (nfds < 0)
+    {
+        m_errorCode = errno;
+        return UNKNOWN_ERROR;
+    }
+
+    std::set<WatcherBackend *> processedSet;
+    for (int32_t i = 0; i < nfds; ++i)
+    {
+        WatcherBackend *pInotify = static_cast<WatcherBackend *>(events[i].data.ptr);
+        int32_t status = pInotify->processEvent();
+        if (status != NO_ERROR)
+        {
+            LOGW("inotify(%d) process event error: %d", pInotify->fd(), status);
+        }
+        processedSet.insert(pInotify);
+    }
+
+    for (WatcherBackend *pInotify : m_inotifySet)
+    {
+        if (pInotify->nextTimeout() == 0 && processedSet.find(pInotify) == processedSet.end())
+        {
+            pInotify->processEvent();
+            processedSet.insert(pInotify);
+        }
+    }
+
+    if (processedSet.empty())
+    {
+        return TIMED_OUT;
+    }
+
+    return NO_ERROR;
+}
+
+} // namespace eular
@@ -0,0 +1,136 @@
+/*************************************************************************
+    > File Name: inotify_poller.h
+    > Author: hsz
+    > Brief: 基于epoll的多inotify实例事件分发
+    > Created Time: 2026年10月17日 星期六 10时12分35秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_POLLER_H__
+#define __INOTIFY_POLLER_H__
+
+#include <stdint.h>
+#include <set>
+#include <memory>
+
+namespace eular {
+
+class WatcherBackend;
+
+/**
+ * @brief 将多个监控后端(InotifyTool/FanotifyTool)的句柄注册到同一个epoll集合中, 可读时调用对应实例的processEvent
+ *
+ * poller自身的句柄(fd())在任一实例可读时可读, 因此可直接注册到hv::EventLoop. 轮询扫描, 移动配对超时和
+ * 自动保存快照没有可读事件, 每次分发后需按nextTimeout()重新设置定时器:
+ *
+ *  struct PollerContext {
+ *      hv::EventLoop           *loop;
+ *      eular::InotifyPoller    *poller;
+ *      hv::TimerID             timerId = INVALID_TIMER_ID;
+ *
+ *      void dispatch() {
+ *          poller->dispatch();
+ *          loop->killTimer(timerId);
+ *          int64_t timeoutMs = poller->nextTimeout();
+ *          timerId = timeoutMs < 0 ? INVALID_TIMER_ID : loop->setTimeout(std::max<int64_t>(timeoutMs, 1),
+ *              [this] (hv::TimerID) { timerId = INVALID_TIMER_ID; dispatch(); });
+ *      }
+ *  };
+ *
+ *  PollerContext context{loop.get(), &poller};
+ *  hio_t *io = hio_get(loop->loop(), poller.fd());
+ *  hio_setcontext(io, &context);
+ *  hio_add(io, [] (hio_t *io) {
+ *      static_cast<PollerContext *>(hio_context(io))->dispatch();
+ *  }, HV_READ);
+ *  context.dispatch(); // 设置第一个定时器
+ *
+ * 这样本地文件监控无需独立线程, 空闲时不占用CPU, 与HTTP服务运行在同一个事件循环中
+ */
+class InotifyPoller
+{
+public:
+    typedef std::shared_ptr<InotifyPoller> SP;
+    typedef std::unique_ptr<InotifyPoller> Ptr;
+
+    InotifyPoller() noexcept;
+    ~InotifyPoller() noexcept;
+
+    /**
+     * @brief 创建epoll句柄
+     *
+     * @return true 成功
+     * @return false 失败
+     */
+    bool create() noexcept;
+
+    /**
+     * @brief 销毁epoll句柄, 不会销毁已注册的实例
+     *
+     */
+    void destroy();
+
+    /**
+     * @brief 获取epoll句柄
+     *
+     * @return int32_t
+     */
+    int32_t fd() const;
+
+    /**
+     * @brief 注册一个监控实例, 实例需已调用create
+     *
+     * @param pInotify inotify实例, 生命周期由调用者保证
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t addInotify(WatcherBackend *pInotify);
+
+    /**
+     * @brief 移除一个inotify实例
+     *
+     * @param pInotify inotify实例
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t removeInotify(WatcherBackend *pInotify);
+
+    /**
+     * @brief 等待事件并分发到可读的inotify实例, 后端定时任务(nextTimeout)到期时同样调用其processEvent
+     *
+     * @param timeout 超时时间(毫秒), 0表示一直等待
+     * @return int32_t 成功返回0, 超时返回TIMED_OUT, 失败返回其他负值
+     */
+    int32_t poll(uint32_t timeout);
+
+    /**
+     * @brief 非阻塞分发当前可读的inotify实例, 用于事件循环的读回调
+     *
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t dispatch();
+
+    /**
+     * @brief 所有实例中最近的定时任务(轮询扫描, 移动配对超时, 自动保存快照)的毫秒数,
+     * 注册到事件循环时到期后应调用dispatch
+     *
+     * @return int64_t 没有定时任务时返回-1
+     */
+    int64_t nextTimeout() const;
+
+    /**
+     * @brief 获取错误码
+     *
+     * @return int32_t
+     */
+    int32_t getLastError() const;
+
+protected:
+    int32_t _wait(int32_t timeoutMs);
+
+private:
+    int32_t                 m_epollFd;      // epoll句柄
+    int32_t                 m_errorCode;    // 错误码
+    std::set<WatcherBackend *> m_inotifySet; // 已注册的实例
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_POLLER_H__
@@ -6,10 +6,16 @@
  ************************************************************************/
 
 #include <sstream>
+#include <cstring>
+#include <cinttypes>
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <unordered_set>
 
 #include <utils/sysdef.h>
 #include <utils/errors.h>
-#include <utils/buffer.h>
 #include <log/log.h>
 
 #ifdef OS_LINUX
@@ -17,17 +23,20 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <dirent.h>
+#include <poll.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <time.h>
 #include <unistd.h>
 
 #define INOTIFY_EVENT_SIZE  (sizeof(struct inotify_event))
-#define MAX_BUF_SIZE (1024 * INOTIFY_EVENT_SIZE)
-
-#define INOTIFY_PROCDIR "/proc/sys/fs/inotify/"
-#define WATCHES_SIZE_PATH INOTIFY_PROCDIR "max_user_watches"
-#define QUEUE_SIZE_PATH INOTIFY_PROCDIR "max_queued_watches"
-#define INSTANCES_PATH INOTIFY_PROCDIR "max_user_instances"
+// 一次read可容纳的最短事件数, 较大的缓冲区使突发时的read次数更少
+#define MAX_BUF_SIZE (4096 * INOTIFY_EVENT_SIZE)
+// 单个事件的最大长度, 缓冲区剩余空间不足此值时认为read可能未读完
+#define MAX_EVENT_SIZE (INOTIFY_EVENT_SIZE + NAME_MAX + 1)
+// 估算队列中事件数时的平均长度(名字按16字节对齐)
+#define AVG_EVENT_SIZE (INOTIFY_EVENT_SIZE + 16)
 
 #endif
 
@@ -40,6 +49,20 @@
 
 #define INVALID_ID (-1)
 
+#define MAX_WALK_THREADS 8
+
+#define WATCH_DEMOTED   (-2)    // 超出watch预算, 降级为轮询
+
+#define PROMOTE_SCORE   3.0     // 轮询子树的活跃度达到此值时尝试升级为watch
+#define DEMOTE_SCORE    0.5     // 活跃度低于此值的watch子树可降级为轮询
+
+#define DEFAULT_MOVE_TIMEOUT_MS 50  // IN_MOVED_FROM等待配对的默认时间
+
+#define DEFAULT_REMOTE_LATENCY_MS   5000    // 网络文件系统的默认检测延迟上限
+
+// 文件系统时间戳取自粗粒度时钟, 可能比实际修改时间早一个tick
+#define RESYNC_MTIME_SLACK_NS (50 * 1000 * 1000)
+
 namespace eular {
 
 void DumpInotifyEvent(const struct inotify_event *ev);
@@ -48,13 +71,34 @@ InotifyTool::InotifyTool() noexcept :
     m_recursion(false),
     m_inotifyFd(INVALID_ID),
     m_errorCode(0),
-    m_inotifyBuffer(MAX_BUF_SIZE)
+    m_walkThreads(std::min<uint32_t>(std::max<uint32_t>(std::thread::hardware_concurrency(), 1), MAX_WALK_THREADS)),
+    m_readBuffer(new uint8_t[MAX_BUF_SIZE]),
+    m_readUsed(0),
+    m_batchWindowMs(0),
+    m_batchMaxEvents(0),
+    m_statsBeginMs(0),
+    m_subscribedEv(0),
+    m_batchTaken(false),
+    m_resyncMode(ResyncMode::CHANGED_DIRS),
+    m_overflowPending(false),
+    m_consistentNs(0),
+    m_moveTimeoutMs(DEFAULT_MOVE_TIMEOUT_MS),
+    m_identityTracking(false),
+    m_remotePolling(true),
+    m_remoteLatencyMs(DEFAULT_REMOTE_LATENCY_MS),
+    m_persistedNs(0),
+    m_snapshotIntervalMs(0),
+    m_snapshotMs(0),
+    m_snapshotNs(0),
+    m_replaying(false),
+    m_replayNowMs(0)
 {
 }
 
 InotifyTool::~InotifyTool() noexcept
 {
     destroyInotify();
+    m_dispatcher.clear();
 }
 
 bool InotifyTool::createInotify() noexcept
@@ -71,19 +115,42 @@ bool InotifyTool::createInotify() noexcept
         return false;
     }
 
+    if (m_statsBeginMs == 0)
+    {
+        m_statsBeginMs = utils::MonotonicMs();
+    }
+
     return true;
 }
 
 void InotifyTool::destroyInotify()
 {
+    if (!m_snapshotFile.empty() && !m_watchTree.empty() && m_consistentNs != m_snapshotNs)
+    {
+        saveSnapshot(m_snapshotFile);
+    }
+
     if (m_inotifyFd != INVALID_ID)
     {
         close(m_inotifyFd);
         m_inotifyFd = INVALID_ID;
     }
 
+    m_eventLog.close();
+
     setErrorCode(0);
-    m_pathWithWd.clear();
+    m_watchTree.clear();
+    m_eventBatch.clear();
+    m_modifySet.clear();
+    m_watchBudget.clear();
+    m_pollingScanner.clear();
+    m_overflowPending = false;
+    m_consistentNs = 0;
+    m_pendingMoveMap.clear();
+    m_inodeIndex.clear();
+    m_persistedDirs.clear();
+    m_persistedNs = 0;
+    m_snapshotNs = 0;
 }
 
 int32_t InotifyTool::watchFile(const std::string &fileName, uint32_t ev)
@@ -117,39 +184,42 @@ int32_t InotifyTool::watchFiles(const std::vector<std::string> &fileNames, uint3
         }
 
         // inotify已监视此路径
-        if (m_pathWithWd.contains(it))
+        if (m_watchTree.find(it) != nullptr)
         {
             LOGE("Path(\"%s\") already exists", it.c_str());
             return ALREADY_EXISTS;
         }
     }
 
-    std::vector<InotifyInfo> wdVec;
-    wdVec.reserve(fileNames.size());
+    std::vector<WatchNode *> nodeVec;
+    nodeVec.reserve(fileNames.size());
 
-    for (int32_t i = 0; i < fileNames.size(); ++i)
+    for (size_t i = 0; i < fileNames.size(); ++i)
     {
-        int32_t wd = inotify_add_watch(m_inotifyFd, fileNames[i].c_str(), IN_ALL_EVENTS);
+        std::string filePath = fileNames[i];
+        bool isDirFlag = isDir(filePath);
+        int32_t wd = inotify_add_watch(m_inotifyFd, filePath.c_str(), _kernelMask(ev, isDirFlag, false));
         if (INVALID_ID == wd)
         {
             setErrorCode(errno);
-            for (auto it : wdVec)
+            for (auto it : nodeVec)
             {
-                inotify_rm_watch(m_inotifyFd, it.wd);
-                m_pathWithWd.erase(it);
+                inotify_rm_watch(m_inotifyFd, it->info.wd);
+                m_watchTree.erase(it);
             }
             return UNKNOWN_ERROR;
         }
 
         InotifyInfo info = {wd, ev, false};
-        wdVec.push_back(info);
-        std::string filePath = fileNames[i];
-        size_t length = filePath.length();
-        if (isDir(filePath) && filePath[length - 1] != '/')
+        if (isDirFlag && filePath.back() != '/')
         {
             filePath.append("/");
         }
-        m_pathWithWd.insert(info, fileNames[i]);
+        nodeVec.push_back(m_watchTree.insert(nullptr, filePath, info, isDirFlag));
+        if (m_eventLog.isOpen())
+        {
+            m_eventLog.writeWatch(utils::MonotonicNs(), {wd, INVALID_ID, ev, false, isDirFlag, filePath});
+        }
     }
 
     return NO_ERROR;
@@ -185,563 +255,2371 @@ int32_t InotifyTool::watchRecursive(const std::vector<std::string> &paths, uint3
             return INVALID_PARAM;
         }
 
-        if (m_pathWithWd.contains(it))
+        if (m_watchTree.find(it) != nullptr || m_pollingScanner.contains(it))
         {
             LOGE("Path(\"%s\") already exists", it.c_str());
             return ALREADY_EXISTS;
         }
     }
 
-    std::vector<InotifyInfo> wdVec;
-    wdVec.reserve(paths.size());
+    // 首次监视的时间作为初始一致点
+    if (m_consistentNs == 0)
+    {
+        m_consistentNs = utils::RealtimeNs();
+    }
 
-    for (int32_t i = 0; i < paths.size(); ++i)
+    std::vector<WatchNode *> restoredVec;
+    std::vector<std::string> overflowVec;
+    for (size_t i = 0; i < paths.size(); ++i)
     {
-        std::list<std::pair<std::string, InotifyInfo>> infoList;
-        if (!_watchRecursive(infoList, paths[i], ev))
+        std::string fixedPath = paths[i];
+        utils::CorrectionPath(fixedPath);
+
+        // 网络文件系统上inotify只能看到本机的修改
+        int32_t status = NO_ERROR;
+        if (_pollRemoteRoot(fixedPath, ev, status))
         {
-            return UNKNOWN_ERROR;
+            if (status != NO_ERROR)
+            {
+                return status;
+            }
+            continue;
         }
 
-        for (const auto &it : infoList)
+        // 快照中有此根目录时按快照添加watch, 不遍历
+        size_t rootIdx = 0;
+        for (; rootIdx < m_persistedDirs.size(); ++rootIdx)
         {
-            m_pathWithWd.insert(it.second, it.first);
-            LOGE("wd: %d, path: %s", it.second.wd, it.first.c_str());
+            if (m_persistedDirs[rootIdx].parent == SNAPSHOT_NO_PARENT && m_persistedDirs[rootIdx].name == fixedPath)
+            {
+                break;
+            }
         }
-    }
 
-    return NO_ERROR;
-}
+        std::list<WatchEntry> entryList;
+        std::vector<RestoreDir> missingVec;
+        if (rootIdx < m_persistedDirs.size() && _restoreTree(entryList, missingVec, rootIdx, ev))
+        {
+            size_t restored = entryList.size();
+            _mergeWatches(entryList);
+            for (const auto &it : missingVec)
+            {
+                // 离线期间删除的目录由父目录的比较输出事件
+                if (isDir(it.path) && _watchRecursive(entryList, it.parentWd, it.name, it.path, ev))
+                {
+                    _mergeWatches(entryList);
+                }
+                entryList.clear();
+            }
 
-void InotifyTool::removeWatch(const std::string &path)
-{
-}
+            restoredVec.push_back(m_watchTree.find(fixedPath));
+            LOGI("restore %s from snapshot: %zu directories, %zu subtrees walked, %zu watches",
+                fixedPath.c_str(), restored, missingVec.size(), m_watchTree.size());
+            continue;
+        }
 
-int32_t InotifyTool::waitCompleteEvent(uint32_t timeout)
-{
-    setErrorCode(0);
-    if (INVALID_ID == m_inotifyFd)
-    {
-        return NO_INIT;
-    }
+        if (!_watchRecursive(entryList, INVALID_ID, fixedPath, fixedPath, ev, m_walkThreads))
+        {
+            return UNKNOWN_ERROR;
+        }
 
-    fd_set readFd;
-    struct timeval readTimeout;
-    struct timeval *pReadTimeout = nullptr;
-    if (timeout > 0)
-    {
-        readTimeout.tv_sec = timeout / 1000;
-        readTimeout.tv_usec = timeout & 1000 * 1000;
+        _mergeWatches(entryList);
+        LOGI("watch %s: %" PRIu64 " directories, %" PRIu64 " ms, %.0f dirs/s, %zu watches, %zu polled directories",
+            fixedPath.c_str(), m_walkStats.dirs, m_walkStats.elapsedMs, m_walkStats.dirsPerSec,
+            m_watchTree.size(), m_pollingScanner.dirCount());
 
-        pReadTimeout = &readTimeout;
+        // 快照中有此根目录但无法按快照恢复, 遍历得到的目录树仍需与快照比较
+        if (rootIdx < m_persistedDirs.size())
+        {
+            bool complete = false;
+            WatchNode *pRoot = _adoptSnapshot(rootIdx, complete);
+            if (pRoot != nullptr)
+            {
+                restoredVec.push_back(pRoot);
+            }
+            if (pRoot == nullptr || !complete)
+            {
+                overflowVec.push_back(fixedPath);
+            }
+        }
     }
 
-    FD_ZERO(&readFd);
-    FD_SET(m_inotifyFd, &readFd);
-    int32_t errorCode = select(m_inotifyFd + 1, &readFd, nullptr, nullptr, pReadTimeout);
-    if (errorCode < 0)
+    // 与快照比较, 输出离线期间的变化. 快照之后的修改都视为离线修改
+    if (!restoredVec.empty() || !overflowVec.empty())
     {
-        setErrorCode(errno);
-        return UNKNOWN_ERROR;
-    }
+        if (m_batchTaken)
+        {
+            m_eventBatch.clear();
+            m_batchTaken = false;
+        }
 
-    if (errorCode == 0)
-    {
-        return TIMED_OUT;
+        // 根目录或部分子目录无法与快照比较, 由使用者完整核对
+        m_eventBatch.stamp(utils::MonotonicNs());
+        for (const auto &it : overflowVec)
+        {
+            LOGW("%s can not compare with snapshot, report overflow", it.c_str());
+            m_eventBatch.push(EV_IN_Q_OVERFLOW, 0, it, std::string_view());
+        }
     }
 
-    // 等待足够的字节数
-    uint32_t bytesToRead = 0;
-    do {
-        errorCode = ioctl(m_inotifyFd, FIONREAD, &bytesToRead);
-    } while (!errorCode && bytesToRead < sizeof(struct inotify_event));
-    if (errorCode < 0) {
-        LOGE("ioctl(FIONREAD) error. [%d, %s]", errno, strerror(errno));
-        setErrorCode(errno);
-        return UNKNOWN_ERROR;
+    if (!restoredVec.empty())
+    {
+        m_consistentNs = std::min(m_consistentNs, m_persistedNs);
+        ResyncMode mode = (m_resyncMode == ResyncMode::NONE) ? ResyncMode::CHANGED_DIRS : m_resyncMode;
+        m_restoreStats = _compareSnapshot(mode, restoredVec);
+        m_restoreStats.count = restoredVec.size();
+        LOGI("compare with snapshot: %" PRIu64 "/%" PRIu64 " directories scanned, %" PRIu64 " events, %" PRIu64 " ms",
+            m_restoreStats.dirsScanned, m_restoreStats.dirsChecked, m_restoreStats.events, m_restoreStats.elapsedMs);
     }
 
-    char eventBuffer[MAX_BUF_SIZE];
-    do {
-        ssize_t readSize = ::read(m_inotifyFd, eventBuffer, MAX_BUF_SIZE);
-        if (readSize < 0) {
-            if (errno != EAGAIN) {
-                setErrorCode(errno);
-                LOGE("read(%d) error. [%d, %s]", m_inotifyFd, errno, strerror(errno));
-                return UNKNOWN_ERROR;
-            }
-
-            break;
-        }
-
-        LOGD("read size: %zd", readSize);
-
-        // 读到结尾
-        if (readSize == 0) {
-            break;
-        }
+    _updateGauges();
+    return NO_ERROR;
+}
 
-        m_inotifyBuffer.append(eventBuffer, readSize);
-        _parseEvent(m_inotifyBuffer);
-    } while (true);
+void InotifyTool::setWalkThreads(uint32_t threads)
+{
+    m_walkThreads = threads > 0 ? threads : 1;
+}
 
-    return NO_ERROR;
+DirWalkerStats InotifyTool::getWalkStats() const
+{
+    return m_walkStats;
 }
 
-void InotifyTool::getEventItem(std::list<InotifyEventItem> &eventItemVec)
+void InotifyTool::setResyncMode(ResyncMode mode)
 {
-    eventItemVec = std::move(m_eventItemQueue);
-    m_eventItemQueue.clear();
+    m_resyncMode = mode;
 }
 
-int32_t InotifyTool::getLastError()
+ResyncStats InotifyTool::getResyncStats() const
 {
-    return m_errorCode;
+    return m_resyncStats;
 }
 
-std::string InotifyTool::errorMsg(int32_t code)
+void InotifyTool::setWatchLimit(uint32_t watches)
 {
-    return strerror(code);
+    m_watchBudget.setLimit(watches);
 }
 
-uint32_t InotifyTool::inotifyEvent2RealInotifyEv(uint32_t ev) const noexcept
+InotifyLimits InotifyTool::getInotifyLimits() const
 {
-    uint32_t inotifyEv = 0;
+    return m_watchBudget.limits();
+}
 
-#define INOTIFY_MAP(XXX)                                        \
-    XXX(InotifyEvent::EV_IN_MODIFY_OVER, IN_MODIFY)             \
-    XXX(InotifyEvent::EV_IN_CLOSE_WRITE, IN_CLOSE_WRITE)        \
-    XXX(InotifyEvent::EV_IN_MOVED_OUT, IN_MOVED_FROM)           \
-    XXX(InotifyEvent::EV_IN_MOVED_IN, IN_MOVED_TO)              \
-    XXX(InotifyEvent::EV_IN_CREATE, IN_CREATE)                  \
-    XXX(InotifyEvent::EV_IN_DELETE, IN_DELETE)                  \
+void InotifyTool::setPollInterval(uint32_t minIntervalMs, uint32_t maxIntervalMs)
+{
+    m_pollingScanner.setInterval(minIntervalMs, maxIntervalMs);
+}
 
-#define XXX(InoEv, realInoEv)   \
-    if ((InoEv) & ev)           \
-    {                           \
-        inotifyEv |= realInoEv; \
-    }                           \
+void InotifyTool::setRemotePolling(bool enable, uint32_t maxLatencyMs)
+{
+    m_remotePolling = enable;
+    m_remoteLatencyMs = maxLatencyMs > 0 ? maxLatencyMs : DEFAULT_REMOTE_LATENCY_MS;
+}
 
-    INOTIFY_MAP(XXX);
+void InotifyTool::setPollThreads(uint32_t threads)
+{
+    m_pollingScanner.setScanThreads(threads);
+}
 
-#undef XXX
-#undef INOTIFY_MAP
+PollingScanner::Stats InotifyTool::getPollingStats() const
+{
+    return m_pollingScanner.stats();
+}
 
-    return inotifyEv;
+size_t InotifyTool::getWatchCount() const
+{
+    return m_watchTree.size();
 }
 
-uint32_t InotifyTool::realInotifyEv2InotifyEvent(uint32_t ev) const noexcept
+size_t InotifyTool::getPolledDirCount() const
 {
-    uint32_t inotifyEv = InotifyEvent::EV_IN_NONE;
+    return m_pollingScanner.dirCount();
+}
 
-#define INOTIFY_MAP(XXX)                                        \
-    XXX(InotifyEvent::EV_IN_MODIFY_OVER, IN_MODIFY)             \
-    XXX(InotifyEvent::EV_IN_CLOSE_WRITE, IN_CLOSE_WRITE)        \
-    XXX(InotifyEvent::EV_IN_MOVED_OUT, IN_MOVED_FROM)           \
-    XXX(InotifyEvent::EV_IN_MOVED_IN, IN_MOVED_TO)              \
-    XXX(InotifyEvent::EV_IN_CREATE, IN_CREATE)                  \
-    XXX(InotifyEvent::EV_IN_DELETE, IN_DELETE)                  \
-    XXX(InotifyEvent::EV_IN_UNMOUNT, IN_UNMOUNT)                \
-    XXX(InotifyEvent::EV_IN_IGNORED, IN_IGNORED)                \
-    XXX(InotifyEvent::EV_IN_ISDIR, IN_ISDIR)                    \
+int32_t InotifyTool::setIgnoreRules(const std::string &path, const std::vector<std::string> &rules)
+{
+    if (path.empty() || path[0] != '/')
+    {
+        return INVALID_PARAM;
+    }
 
-#define XXX(InoEv, realInoEv)   \
-    if ((realInoEv) & ev)       \
-    {                           \
-        inotifyEv |= InoEv;     \
-    }                           \
+    std::string fixedPath = path;
+    utils::CorrectionPath(fixedPath);
 
-    INOTIFY_MAP(XXX);
+    IgnoreMatcher matcher(fixedPath);
+    int32_t status = matcher.add(rules);
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
 
-#undef XXX
-#undef INOTIFY_MAP
+    // 节点保存匹配器的指针, 已存在时原地替换规则
+    std::unique_ptr<IgnoreMatcher> &spMatcher = m_ignoreMap[fixedPath];
+    if (spMatcher == nullptr)
+    {
+        spMatcher.reset(new IgnoreMatcher(fixedPath));
+    }
 
-    return 0;
+    spMatcher->clear();
+    spMatcher->add(rules);
+    LOGI("%s: %zu ignore rules", fixedPath.c_str(), spMatcher->size());
+    return NO_ERROR;
 }
 
-bool InotifyTool::isDir(const std::string &path) const
+int32_t InotifyTool::loadIgnoreFile(const std::string &path, const std::string &file)
 {
-    struct stat64 pathStat;
-
-    if (-1 == lstat64(path.c_str(), &pathStat))
+    std::vector<std::string> rules;
+    int32_t status = IgnoreMatcher::ReadFile(file, rules);
+    if (status != NO_ERROR)
     {
-        if (errno != ENOENT)
-        {
-            LOGW("Stat failed on %s: %s\n", path.c_str(), strerror(errno));
-        }
-
-        return false;
+        return status;
     }
 
-    return (S_ISDIR(pathStat.st_mode) && !S_ISLNK(pathStat.st_mode));
+    return setIgnoreRules(path, rules);
 }
 
-void InotifyTool::setErrorCode(int32_t code)
+void InotifyTool::setMovePairTimeout(uint32_t timeoutMs)
 {
-    m_errorCode = code;
+    m_moveTimeoutMs = timeoutMs;
 }
 
-bool InotifyTool::_watchRecursive(std::list<std::pair<std::string, InotifyInfo>> &infoList, const std::string &path, uint32_t ev)
+void InotifyTool::setIdentityTracking(bool enable, uint32_t tombstoneTtlMs)
 {
-    std::string fixedPath = path;
-    utils::CorrectionPath(fixedPath);
-
-    int32_t wd = inotify_add_watch(m_inotifyFd, fixedPath.c_str(), IN_ALL_EVENTS);
-    if (INVALID_ID == wd)
+    m_identityTracking = enable;
+    m_inodeIndex.setTombstoneTtl(tombstoneTtlMs);
+    if (!enable)
     {
-        return false;
+        m_inodeIndex.clear();
     }
+}
 
-    InotifyInfo info = {wd, ev, true};
-    infoList.push_back({fixedPath, info});
+int32_t InotifyTool::saveSnapshot(const std::string &file)
+{
+    // 每个根目录按广度优先连续存放, 父目录在子目录之前
+    std::vector<PersistedDir> dirVec;
+    std::vector<const WatchNode *> nodeVec;
+    m_watchTree.foreach([&] (const WatchNode *pNode) {
+        if (pNode->parent == nullptr && pNode->isDir && pNode->info.recursion)
+        {
+            nodeVec.push_back(pNode);
+        }
+    });
 
-    DIR *pDir = opendir(fixedPath.c_str());
-    if (nullptr == pDir)
+    dirVec.reserve(m_watchTree.size());
+    for (const WatchNode *pRoot : nodeVec)
     {
-        if ( errno == ENOTDIR )
+        size_t begin = dirVec.size();
+        std::vector<std::pair<const WatchNode *, uint32_t>> queue = { {pRoot, SNAPSHOT_NO_PARENT} };
+        for (size_t i = 0; i < queue.size(); ++i)
         {
-            LOGE("Path: %s is not a directory", fixedPath.c_str());
+            const WatchNode *pNode = queue[i].first;
+            dirVec.push_back({queue[i].second, pNode->info.ev, pNode->info.recursion, pNode->name, pNode->snapshot});
+            for (const auto &it : pNode->children)
+            {
+                if (it.second->isDir)
+                {
+                    queue.push_back(std::make_pair(it.second, static_cast<uint32_t>(begin + i)));
+                }
+            }
         }
-
-        setErrorCode(errno);
-        return false;
     }
 
-    struct dirent *pDirEntry;
-    struct stat64 itemStat;
-    while ((pDirEntry = readdir(pDir)) != nullptr) {
-        if (std::string(".") == pDirEntry->d_name || std::string("..") == pDirEntry->d_name) {
-            continue;
-        }
-
-        std::string itemPath = fixedPath + pDirEntry->d_name;
-        if (-1 == lstat64(itemPath.c_str(), &itemStat))
-        {
-            if (errno == EACCES) { // 获取信息没有权限
-                LOGW("Path: %s no permission", itemPath.c_str());
-                continue;
-            } else if (errno == ENOENT) { // 悬空符号链接
-                LOGW("Path: %s maybe dangling symbolic link", itemPath.c_str());
-                continue;
-            } else if (errno == ELOOP) { // 一个文件经过多重符号链接
-                LOGW("Path: %s. Too many symbolic links encountered while traversing the path.", itemPath.c_str());
-                continue;
-            }
+    int32_t status = SnapshotFile::Save(file, m_consistentNs, dirVec);
+    if (status == NO_ERROR)
+    {
+        m_snapshotNs = m_consistentNs;
+        m_snapshotMs = utils::MonotonicMs();
+        LOGD("save snapshot %s: %zu directories", file.c_str(), dirVec.size());
+    }
 
-            setErrorCode(errno);
-            closedir(pDir);
-            return false;
-        }
+    return status;
+}
 
-        if (S_ISDIR(itemStat.st_mode) && !S_ISLNK(itemStat.st_mode))
-        {
-            if (!_watchRecursive(infoList, itemPath, ev))
-            {
-                return false;
-            }
-        }
+int32_t InotifyTool::loadSnapshot(const std::string &file)
+{
+    int64_t consistentNs = 0;
+    std::vector<PersistedDir> dirVec;
+    int32_t status = SnapshotFile::Load(file, consistentNs, dirVec);
+    if (status != NO_ERROR)
+    {
+        return status;
     }
 
-    closedir(pDir);
-    return true;
+    m_persistedDirs = std::move(dirVec);
+    m_persistedNs = consistentNs;
+    LOGI("load snapshot %s: %zu directories", file.c_str(), m_persistedDirs.size());
+    return NO_ERROR;
 }
 
-void InotifyTool::_parseEvent(ByteBuffer &inotifyEventBuf)
+void InotifyTool::setSnapshotFile(const std::string &file, uint32_t intervalMs)
 {
-    // IN_MOVED_FROM事件中的文件/目录名
-    const char *pMoveOut = nullptr;
-    // IN_MOVED_FROM事件是对目录还是文件的操作
-    bool moveOutItemIsDirFlag = false;
-    // IN_MOVED_FROM事件的cookie
-    uint32_t eventCookie = 0;
+    m_snapshotFile = file;
+    m_snapshotIntervalMs = intervalMs;
+    m_snapshotMs = utils::MonotonicMs();
+}
 
-    int32_t movedSelfWd = 0;
+ResyncStats InotifyTool::getRestoreStats() const
+{
+    return m_restoreStats;
+}
 
-    const struct inotify_event *pInoEvent = nullptr;
+void InotifyTool::removeWatch(const std::string &path)
+{
+}
 
-    size_t i = 0;
-    // NOTE 未防止因read读取到不完整inotify_event产生越界行为, 需要在for条件中判断是否完整结构体
-    for (; i < inotifyEventBuf.size() && (i + INOTIFY_EVENT_SIZE) < inotifyEventBuf.size(); i += (INOTIFY_EVENT_SIZE + pInoEvent->len))
+int32_t InotifyTool::waitCompleteEvent(uint32_t timeout)
+{
+    setErrorCode(0);
+    if (INVALID_ID == m_inotifyFd)
     {
-        pInoEvent = (const struct inotify_event *)(inotifyEventBuf.const_data() + i);
+        return NO_INIT;
+    }
 
-        DumpInotifyEvent(pInoEvent);
+    // NOTE 内核保证read只返回完整的inotify_event, 可读即可直接读取, 无需轮询FIONREAD
+    struct pollfd pfd;
+    pfd.fd = m_inotifyFd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
 
-        InotifyEventItem eventItem;
-        InotifyInfo evTemp = {pInoEvent->wd, 0, false};
+    // 从快照恢复时产生的离线事件
+    if (!m_eventBatch.empty() && !m_batchTaken)
+    {
+        _publish();
+        return NO_ERROR;
+    }
 
-        if (pInoEvent->mask & IN_Q_OVERFLOW)
+    // 有轮询子树时需要按扫描间隔醒来
+    uint64_t deadlineMs = utils::MonotonicMs() + timeout;
+    while (true)
+    {
+        uint64_t nowMs = utils::MonotonicMs();
+        int64_t waitMs = timeout > 0 ? static_cast<int64_t>(deadlineMs > nowMs ? deadlineMs - nowMs : 0) : -1;
+        int64_t scanMs = m_pollingScanner.nextTimeout(nowMs);
+        if (scanMs >= 0 && (waitMs < 0 || scanMs < waitMs))
         {
-            eventItem.cookie = pInoEvent->cookie;
-            eventItem.event = pInoEvent->mask;
-            m_eventItemQueue.push_back(eventItem);
-
-            continue;
+            waitMs = scanMs;
         }
 
-        if (pInoEvent->mask & IN_DELETE_SELF)
+        int64_t moveMs = _nextMoveTimeout(nowMs);
+        if (moveMs >= 0 && (waitMs < 0 || moveMs < waitMs))
         {
-            // 监视目录被删除需要解除监视并从映射表中移除
-            LOGW("erase wd: %d for IN_DELETE_SELF", pInoEvent->wd);
-            inotify_rm_watch(m_inotifyFd, pInoEvent->wd);
-            continue;
+            waitMs = moveMs;
         }
 
-        // 监视已显式删除(inotify_rm_Watch)或自动删除(文件已删除或文件系统已卸载)
-        if (pInoEvent->mask & IN_IGNORED)
+        int64_t snapshotMs = _nextSnapshotTimeout(nowMs);
+        if (snapshotMs >= 0 && (waitMs < 0 || snapshotMs < waitMs))
         {
-            LOGI("wd: %d Trigger IN_IGNORED event", pInoEvent->wd);
-            m_pathWithWd.erase(evTemp);
-            continue;
+            waitMs = snapshotMs;
         }
 
-        auto it = m_pathWithWd.find(evTemp);
-        if (it == m_pathWithWd.end())
+        int32_t errorCode = 0;
+        do {
+            errorCode = ::poll(&pfd, 1, static_cast<int32_t>(waitMs));
+            ++m_kernelStats.waitCalls;
+        } while (errorCode < 0 && errno == EINTR);
+
+        if (errorCode < 0)
         {
-            LOGE("-----------------------------------------------------------------");
-            for (auto it = m_pathWithWd.begin(); it != m_pathWithWd.end(); ++it)
-            {
-                LOGD("wd: %d, path: %s", it.key().wd, it.value().c_str());
-            }
-            LOGE("-----------------------------------------------------------------");
+            setErrorCode(errno);
+            return UNKNOWN_ERROR;
         }
-        // TODO 当从双向映射容器找不到wd时, 表示wd未插入到容器或未移除监视的情况下删除
-        LOG_ASSERT(it != m_pathWithWd.end(), "wd(%d) not found", pInoEvent->wd);
-
-        // 当前目录是否递归
-        bool recursionFlag = it.key().recursion;
-
-        // 当前操作的事件是否目录
-        bool isDirFlag = false;
 
-        // 监视目录取消挂载或被删除
-        if (pInoEvent->mask & IN_UNMOUNT)
+        if (errorCode > 0)
         {
-            eventItem.cookie = pInoEvent->cookie;
-            eventItem.event = pInoEvent->mask;
-            std::string deletedItem;
-            if (pInoEvent->len > 0)
+            ++m_kernelStats.wakeups;
+            int32_t status = _readEvent(false);
+            if (status == NO_ERROR && m_batchWindowMs > 0)
             {
-                deletedItem = pInoEvent->name;
+                status = _batchWindow();
             }
-            eventItem.path = it.value();
-            eventItem.name = deletedItem;
-            m_eventItemQueue.push_back(eventItem);
-
-            // 卸载磁盘或自身被删除需要解除监视
-            LOGW("erase wd: %d for IN_UNMOUNT", pInoEvent->wd);
-            inotify_rm_watch(m_inotifyFd, pInoEvent->wd);
-            m_pathWithWd.erase(it);
-
-            continue;
+            _pollScan(utils::MonotonicMs());
+            _autoSnapshot(utils::MonotonicMs());
+            _publish();
+            return status;
         }
 
-        if (pInoEvent->len == 0)
+        _expireMoves(utils::MonotonicMs());
+        _pollScan(utils::MonotonicMs());
+        _autoSnapshot(utils::MonotonicMs());
+        if (!m_eventBatch.empty() && !m_batchTaken)
         {
-            // 无意义的事件
-            continue;
+            _publish();
+            return NO_ERROR;
         }
 
+        if (timeout > 0 && utils::MonotonicMs() >= deadlineMs)
+        {
+            return TIMED_OUT;
+        }
+    }
+}
+
+int64_t InotifyTool::nextTimeout() const
+{
+    if (!m_eventBatch.empty() && !m_batchTaken)
+    {
+        return 0;
+    }
+
+    uint64_t nowMs = utils::MonotonicMs();
+    int64_t timeout = m_pollingScanner.nextTimeout(nowMs);
+    int64_t moveMs = _nextMoveTimeout(nowMs);
+    if (moveMs >= 0 && (timeout < 0 || moveMs < timeout))
+    {
+        timeout = moveMs;
+    }
+
+    int64_t snapshotMs = _nextSnapshotTimeout(nowMs);
+    if (snapshotMs >= 0 && (timeout < 0 || snapshotMs < timeout))
+    {
+        timeout = snapshotMs;
+    }
+
+    return timeout;
+}
+
+int32_t InotifyTool::fd() const
+{
+    return m_inotifyFd;
+}
+
+void InotifyTool::setEventCallback(EventCallback cb)
+{
+    m_eventCallback = std::move(cb);
+}
+
+int32_t InotifyTool::processEvent()
+{
+    setErrorCode(0);
+    if (INVALID_ID == m_inotifyFd)
+    {
+        return NO_INIT;
+    }
+
+    int32_t status = _readEvent();
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    _pollScan(utils::MonotonicMs());
+    _autoSnapshot(utils::MonotonicMs());
+    _publish();
+    if (m_eventBatch.empty())
+    {
+        return NO_ERROR;
+    }
+
+    if (m_batchCallback)
+    {
+        m_batchCallback(m_eventBatch);
+        m_eventBatch.clear();
+    }
+    else if (m_eventCallback)
+    {
+        std::list<InotifyEventItem> eventItemList;
+        m_eventBatch.toItemList(eventItemList);
+        m_eventBatch.clear();
+        m_eventCallback(eventItemList);
+    }
+    else if (!m_dispatcher.empty())
+    {
+        m_eventBatch.clear();
+    }
+
+    return NO_ERROR;
+}
+
+void InotifyTool::setBatchCallback(BatchCallback cb)
+{
+    m_batchCallback = std::move(cb);
+}
+
+Subscription::SP InotifyTool::subscribe(const SubscribeOptions &options, Subscription::Callback cb)
+{
+    Subscription::SP subscription = m_dispatcher.subscribe(options, std::move(cb));
+    uint32_t subscribedEv = m_dispatcher.eventMask();
+    if (subscribedEv != m_subscribedEv)
+    {
+        m_subscribedEv = subscribedEv;
+        _updateKernelMasks(true);
+    }
+
+    return subscription;
+}
+
+bool InotifyTool::unsubscribe(const Subscription::SP &subscription)
+{
+    if (subscription == nullptr || !m_dispatcher.unsubscribe(subscription->id()))
+    {
+        return false;
+    }
+
+    uint32_t subscribedEv = m_dispatcher.eventMask();
+    if (subscribedEv != m_subscribedEv)
+    {
+        m_subscribedEv = subscribedEv;
+        _updateKernelMasks(false);
+    }
+
+    return true;
+}
+
+void InotifyTool::setBatchWindow(uint32_t windowMs, uint32_t maxEvents)
+{
+    m_batchWindowMs = windowMs;
+    m_batchMaxEvents = maxEvents;
+}
+
+InotifyStats InotifyTool::getStats() const
+{
+    InotifyStats stats;
+    stats.watches = m_gauges.watches.load(std::memory_order_relaxed);
+    stats.polledDirs = m_gauges.polledDirs.load(std::memory_order_relaxed);
+    stats.pendingModify = m_gauges.pendingModify.load(std::memory_order_relaxed);
+    stats.pendingMoves = m_gauges.pendingMoves.load(std::memory_order_relaxed);
+    stats.queuedEvents = m_gauges.queuedEvents.load(std::memory_order_relaxed);
+    stats.overflows = m_gauges.overflows.load(std::memory_order_relaxed);
+    stats.parseNs = m_parseHistogram.snapshot();
+    stats.residenceNs = m_residenceHistogram.snapshot();
+    stats.batchSize = m_batchSizeHistogram.snapshot();
+    return stats;
+}
+
+KernelEventStats InotifyTool::getKernelEventStats() const
+{
+    KernelEventStats stats = m_kernelStats;
+    stats.elapsedMs = m_statsBeginMs > 0 ? utils::MonotonicMs() - m_statsBeginMs : 0;
+    if (stats.events > 0)
+    {
+        stats.syscallsPerEvent = static_cast<double>(stats.readCalls + stats.waitCalls) / stats.events;
+    }
+
+    if (stats.elapsedMs > 0)
+    {
+        stats.wakeupsPerSec = stats.wakeups * 1000.0 / stats.elapsedMs;
+    }
+
+    return stats;
+}
+
+int32_t InotifyTool::startRecording(const std::string &file)
+{
+    if (m_replaying)
+    {
+        return INVALID_OPERATION;
+    }
+
+    int32_t status = m_eventLog.open(file);
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    // 当前的watch表, 父目录在子目录之前
+    std::vector<const WatchNode *> nodeStack;
+    m_watchTree.foreach([&nodeStack] (const WatchNode *pNode) {
+        if (pNode->parent == nullptr)
+        {
+            nodeStack.push_back(pNode);
+        }
+    });
+
+    uint64_t nowNs = utils::MonotonicNs();
+    size_t watches = 0;
+    while (!nodeStack.empty())
+    {
+        const WatchNode *pNode = nodeStack.back();
+        nodeStack.pop_back();
+
+        int32_t parentWd = pNode->parent != nullptr ? pNode->parent->info.wd : INVALID_ID;
+        m_eventLog.writeWatch(nowNs, {pNode->info.wd, parentWd, pNode->info.ev, pNode->info.recursion,
+                                      pNode->isDir, pNode->name});
+        ++watches;
+        for (const auto &it : pNode->children)
+        {
+            nodeStack.push_back(it.second);
+        }
+    }
+
+    LOGI("start recording to %s, %zu watches", file.c_str(), watches);
+    return NO_ERROR;
+}
+
+void InotifyTool::stopRecording()
+{
+    if (m_eventLog.isOpen())
+    {
+        LOGI("stop recording, %" PRIu64 " bytes", m_eventLog.bytes());
+        m_eventLog.close();
+    }
+}
+
+int32_t InotifyTool::replay(const std::string &file, bool realtime, const BatchCallback &cb)
+{
+    if (!m_watchTree.empty() || m_pollingScanner.dirCount() > 0 || m_eventLog.isOpen())
+    {
+        LOGE("replay requires an empty watch tree");
+        return INVALID_OPERATION;
+    }
+
+    EventLogReader reader;
+    int32_t status = reader.open(file);
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    ReplayStats stats;
+    auto deliver = [&] () {
+        _publish();
+        stats.events += m_eventBatch.size();
+        if (cb && !m_eventBatch.empty())
+        {
+            cb(m_eventBatch);
+        }
+        m_eventBatch.clear();
+    };
+
+    m_eventBatch.clear();
+    m_batchTaken = false;
+    m_replaying = true;
+
+    uint64_t kernelEvents = m_kernelStats.events;
+    uint64_t beginNs = utils::MonotonicNs();
+    uint64_t firstNs = 0;
+    EventLogRecord record;
+    while (reader.next(record))
+    {
+        m_replayNowMs = record.ns / 1000000;
+        if (record.type == EventLogType::WATCH)
+        {
+            _replayWatch(record.watch);
+            continue;
+        }
+
+        if (realtime)
+        {
+            // 按与第一条DATA记录的时间差等待
+            if (stats.records == 0)
+            {
+                firstNs = record.ns;
+            }
+
+            uint64_t offsetNs = record.ns - firstNs;
+            uint64_t elapsedNs = utils::MonotonicNs() - beginNs;
+            if (offsetNs > elapsedNs)
+            {
+                usleep((offsetNs - elapsedNs) / 1000);
+            }
+        }
+
+        // 与_readEvent相同, 录制时的每次read解析一次
+        uint64_t parseBeginNs = utils::MonotonicNs();
+        m_eventBatch.stamp(parseBeginNs);
+        _parseEvent(reinterpret_cast<const uint8_t *>(record.data.data()), record.data.size());
+        m_parseHistogram.record(utils::MonotonicNs() - parseBeginNs);
+        _expireMoves(m_replayNowMs);
+
+        // 重放时没有文件系统可以重新同步, 只输出溢出事件
+        m_overflowPending = false;
+
+        ++stats.records;
+        stats.bytes += record.data.size();
+        deliver();
+    }
+
+    // 录制结束时仍未配对的IN_MOVED_FROM
+    _expireMoves(UINT64_MAX);
+    deliver();
+
+    stats.kernelEvents = m_kernelStats.events - kernelEvents;
+    stats.elapsedNs = utils::MonotonicNs() - beginNs;
+    if (stats.elapsedNs > 0)
+    {
+        stats.kernelEventsPerSec = stats.kernelEvents * 1e9 / stats.elapsedNs;
+        stats.eventsPerSec = stats.events * 1e9 / stats.elapsedNs;
+    }
+    m_replayStats = stats;
+
+    m_replaying = false;
+    m_replayNowMs = 0;
+    m_watchTree.clear();
+    m_modifySet.clear();
+    m_watchBudget.clear();
+    m_pendingMoveMap.clear();
+    m_inodeIndex.clear();
+    _updateGauges();
+
+    LOGI("replay %s: %" PRIu64 " reads, %" PRIu64 " kernel events, %" PRIu64 " events, %.0f events/s",
+        file.c_str(), stats.records, stats.kernelEvents, stats.events, stats.kernelEventsPerSec);
+    return NO_ERROR;
+}
+
+ReplayStats InotifyTool::getReplayStats() const
+{
+    return m_replayStats;
+}
+
+void InotifyTool::getEventItem(std::list<InotifyEventItem> &eventItemVec)
+{
+    eventItemVec.clear();
+    m_eventBatch.toItemList(eventItemVec);
+    m_eventBatch.clear();
+    m_batchTaken = false;
+    m_gauges.queuedEvents.store(0, std::memory_order_relaxed);
+}
+
+const InotifyEventBatch &InotifyTool::getEventBatch()
+{
+    m_batchTaken = true;
+    m_gauges.queuedEvents.store(0, std::memory_order_relaxed);
+    return m_eventBatch;
+}
+
+int32_t InotifyTool::getLastError()
+{
+    return m_errorCode;
+}
+
+std::string InotifyTool::errorMsg(int32_t code)
+{
+    return strerror(code);
+}
+
+uint32_t InotifyTool::inotifyEvent2RealInotifyEv(uint32_t ev) const noexcept
+{
+    uint32_t inotifyEv = 0;
+
+#define INOTIFY_MAP(XXX)                                        \
+    XXX(InotifyEvent::EV_IN_MODIFY_OVER, IN_MODIFY | IN_CLOSE_WRITE) \
+    XXX(InotifyEvent::EV_IN_CLOSE_WRITE, IN_MODIFY | IN_CLOSE_WRITE) \
+    XXX(InotifyEvent::EV_IN_MOVED_OUT, IN_MOVED_FROM)           \
+    XXX(InotifyEvent::EV_IN_MOVED_IN, IN_MOVED_TO)              \
+    XXX(InotifyEvent::EV_IN_CREATE, IN_CREATE)                  \
+    XXX(InotifyEvent::EV_IN_DELETE, IN_DELETE)                  \
+
+#define XXX(InoEv, realInoEv)   \
+    if ((InoEv) & ev)           \
+    {                           \
+        inotifyEv |= realInoEv; \
+    }                           \
+
+    INOTIFY_MAP(XXX);
+
+#undef XXX
+#undef INOTIFY_MAP
+
+    return inotifyEv;
+}
+
+uint32_t InotifyTool::realInotifyEv2InotifyEvent(uint32_t ev) const noexcept
+{
+    uint32_t inotifyEv = InotifyEvent::EV_IN_NONE;
+
+#define INOTIFY_MAP(XXX)                                        \
+    XXX(InotifyEvent::EV_IN_MODIFY_OVER, IN_MODIFY)             \
+    XXX(InotifyEvent::EV_IN_CLOSE_WRITE, IN_CLOSE_WRITE)        \
+    XXX(InotifyEvent::EV_IN_MOVED_OUT, IN_MOVED_FROM)           \
+    XXX(InotifyEvent::EV_IN_MOVED_IN, IN_MOVED_TO)              \
+    XXX(InotifyEvent::EV_IN_CREATE, IN_CREATE)                  \
+    XXX(InotifyEvent::EV_IN_DELETE, IN_DELETE)                  \
+    XXX(InotifyEvent::EV_IN_UNMOUNT, IN_UNMOUNT)                \
+    XXX(InotifyEvent::EV_IN_Q_OVERFLOW, IN_Q_OVERFLOW)          \
+    XXX(InotifyEvent::EV_IN_IGNORED, IN_IGNORED)                \
+    XXX(InotifyEvent::EV_IN_ISDIR, IN_ISDIR)                    \
+
+#define XXX(InoEv, realInoEv)   \
+    if ((realInoEv) & ev)       \
+    {                           \
+        inotifyEv |= InoEv;     \
+    }                           \
+
+    INOTIFY_MAP(XXX);
+
+#undef XXX
+#undef INOTIFY_MAP
+
+    return inotifyEv;
+}
+
+uint32_t InotifyTool::_kernelMask(uint32_t ev, bool isDir, bool recursion) const noexcept
+{
+    uint32_t mask = inotifyEvent2RealInotifyEv(ev | m_subscribedEv);
+
+    // 移动需要两端配对才能区分重命名和移入/移出
+    if (mask & IN_MOVE)
+    {
+        mask |= IN_MOVE;
+    }
+
+    if (!isDir)
+    {
+        return mask;
+    }
+
+    // 已删除但仍被打开的文件不再产生事件; 只监视目录, 避免监视期间目录被替换为文件或符号链接
+    mask |= IN_DELETE_SELF | IN_EXCL_UNLINK | IN_ONLYDIR | IN_DONT_FOLLOW;
+    if (recursion)
+    {
+        // 维护目录树和快照
+        mask |= IN_CREATE | IN_DELETE | IN_MOVE;
+    }
+
+    if (m_identityTracking)
+    {
+        // 刷新inode索引中的大小和mtime
+        mask |= IN_CREATE | IN_DELETE | IN_MOVE | IN_MODIFY | IN_CLOSE_WRITE;
+    }
+
+    return mask;
+}
+
+void InotifyTool::_updateKernelMasks(bool grow)
+{
+    if (INVALID_ID == m_inotifyFd)
+    {
+        return;
+    }
+
+    std::vector<int32_t> staleVec;
+    m_watchTree.foreach([&] (const WatchNode *pNode) {
+        uint32_t mask = _kernelMask(pNode->info.ev, pNode->isDir, pNode->info.recursion);
+        std::string path = m_watchTree.path(pNode);
+        int32_t wd = inotify_add_watch(m_inotifyFd, path.c_str(), grow ? (mask | IN_MASK_ADD) : mask);
+        if (wd != INVALID_ID && wd != pNode->info.wd)
+        {
+            // 路径已指向其他inode, 等待该节点的IN_IGNORED/删除事件
+            staleVec.push_back(wd);
+        }
+        ++m_kernelStats.maskUpdates;
+    });
+
+    for (int32_t wd : staleVec)
+    {
+        if (m_watchTree.find(wd) == nullptr)
+        {
+            inotify_rm_watch(m_inotifyFd, wd);
+        }
+    }
+}
+
+bool InotifyTool::isDir(const std::string &path) const
+{
+    struct stat64 pathStat;
+
+    if (-1 == lstat64(path.c_str(), &pathStat))
+    {
+        if (errno != ENOENT)
+        {
+            LOGW("Stat failed on %s: %s\n", path.c_str(), strerror(errno));
+        }
+
+        return false;
+    }
+
+    return (S_ISDIR(pathStat.st_mode) && !S_ISLNK(pathStat.st_mode));
+}
+
+void InotifyTool::setErrorCode(int32_t code)
+{
+    m_errorCode = code;
+}
+
+bool InotifyTool::_watchRecursive(std::list<WatchEntry> &entryList, int32_t parentWd,
+                                  const std::string &name, const std::string &path, uint32_t ev,
+                                  uint32_t threads)
+{
+    // 重放时新增的watch由之后的WATCH记录添加
+    if (m_replaying)
+    {
+        return true;
+    }
+
+    std::string fixedPath = path;
+    utils::CorrectionPath(fixedPath);
+
+    const IgnoreMatcher *ignore = _findIgnore(fixedPath);
+
+    // 超出预算或内核watch耗尽(ENOSPC)的目录及其子树降级为轮询
+    std::atomic<uint32_t> addedCount(0);
+    uint32_t usedCount = static_cast<uint32_t>(m_watchTree.size());
+    uint32_t limit = m_watchBudget.limit();
+
+    uint32_t kernelMask = _kernelMask(ev, true, true);
+
+    // NOTE 先添加监视再读取目录内容, 避免遗漏读取期间新建的子目录
+    DirWalker::Visitor visitor = [&] (DirWalker::Record &record) -> int32_t {
+        // 被忽略的子树不占用watch
+        if (ignore != nullptr && ignore->ignored(record.path, true))
+        {
+            return WALK_SKIP;
+        }
+
+        if (usedCount + addedCount.load(std::memory_order_relaxed) >= limit)
+        {
+            record.userData = WATCH_DEMOTED;
+            return WALK_SKIP;
+        }
+
+        int32_t wd = inotify_add_watch(m_inotifyFd, record.path.c_str(), kernelMask);
+        if (INVALID_ID == wd)
+        {
+            if (errno == ENOSPC)
+            {
+                LOGW("inotify watches exhausted, poll %s", record.path.c_str());
+                record.userData = WATCH_DEMOTED;
+                return WALK_SKIP;
+            }
+
+            if (record.parentId != WALK_INVALID_ID && (errno == EACCES || errno == ENOENT)) {
+                LOGW("Path: %s can not be watched. [%d, %s]", record.path.c_str(), errno, strerror(errno));
+                return WALK_SKIP;
+            }
+
+            return -errno;
+        }
+
+        record.userData = wd;
+        addedCount.fetch_add(1, std::memory_order_relaxed);
+        return WALK_CONTINUE;
+    };
+
+    std::vector<DirWalker::Record> records;
+    DirWalker walker(threads, m_resyncMode != ResyncMode::NONE || m_identityTracking);
+    int32_t status = walker.walk(fixedPath, name, visitor, records);
+    if (parentWd == INVALID_ID)
+    {
+        m_walkStats = walker.stats();
+    }
+
+    if (status != NO_ERROR)
+    {
+        // 失败时records无序, 只解除已添加的监视
+        for (const auto &record : records)
+        {
+            if (record.userData > 0)
+            {
+                inotify_rm_watch(m_inotifyFd, static_cast<int32_t>(record.userData));
+            }
+        }
+
+        setErrorCode(-status);
+        LOGE("watch %s error. [%d, %s]", fixedPath.c_str(), -status, strerror(-status));
+        return false;
+    }
+
+    // 成功时records按序号排列, 父目录在子目录之前
+    for (auto &record : records)
+    {
+        if (record.userData == WATCH_DEMOTED)
+        {
+            bool isRoot = (record.parentId == WALK_INVALID_ID && parentWd == INVALID_ID);
+            m_pollingScanner.add(record.path, ev, isRoot, utils::MonotonicMs(), ignore);
+            continue;
+        }
+
+        // 无法监视的目录(无权限或已删除)
+        if (record.userData <= 0)
+        {
+            continue;
+        }
+
+        int32_t recordParentWd = parentWd;
+        if (record.parentId != WALK_INVALID_ID)
+        {
+            recordParentWd = static_cast<int32_t>(records[record.parentId].userData);
+        }
+
+        if (m_identityTracking)
+        {
+            _indexDir(static_cast<int32_t>(record.userData), record.path, record.snapshot);
+        }
+
+        entryList.push_back({recordParentWd, record.name, {static_cast<int32_t>(record.userData), ev, true},
+                             std::move(record.snapshot), ignore});
+    }
+
+    return true;
+}
+
+size_t InotifyTool::_persistedPaths(size_t rootIdx, std::vector<std::string> &pathVec) const
+{
+    size_t endIdx = rootIdx + 1;
+    while (endIdx < m_persistedDirs.size() && m_persistedDirs[endIdx].parent != SNAPSHOT_NO_PARENT)
+    {
+        ++endIdx;
+    }
+
+    pathVec.assign(endIdx - rootIdx, std::string());
+    for (size_t i = rootIdx; i < endIdx; ++i)
+    {
+        const PersistedDir &dir = m_persistedDirs[i];
+        if (i == rootIdx)
+        {
+            pathVec[0] = dir.name;
+        }
+        else if (dir.parent >= rootIdx && dir.parent < i)
+        {
+            pathVec[i - rootIdx] = pathVec[dir.parent - rootIdx] + dir.name + "/";
+        }
+    }
+    return endIdx;
+}
+
+bool InotifyTool::_restoreTree(std::list<WatchEntry> &entryList, std::vector<RestoreDir> &missingVec,
+                               size_t rootIdx, uint32_t ev)
+{
+    std::vector<std::string> pathVec;
+    size_t endIdx = _persistedPaths(rootIdx, pathVec);
+
+    // 超出预算时由遍历决定降级哪些子树
+    if (m_watchTree.size() + (endIdx - rootIdx) >= m_watchBudget.limit())
+    {
+        return false;
+    }
+    std::unordered_set<std::string_view> recordSet(pathVec.begin(), pathVec.end());
+
+    const IgnoreMatcher *ignore = _findIgnore(pathVec[0]);
+    std::vector<int32_t> wdVec(endIdx - rootIdx, INVALID_ID);
+    std::vector<size_t> idxVec;
+    for (size_t i = rootIdx; i < endIdx; ++i)
+    {
+        const PersistedDir &dir = m_persistedDirs[i];
+        size_t offset = i - rootIdx;
+        const std::string &path = pathVec[offset];
+        bool isRoot = (i == rootIdx);
+
+        // 父目录未恢复时子树由父目录的比较重新监视
+        int32_t parentWd = isRoot ? INVALID_ID : wdVec[dir.parent - rootIdx];
+        if (path.empty() || (!isRoot && parentWd == INVALID_ID))
+        {
+            continue;
+        }
+
+        if (!isRoot && ignore != nullptr && ignore->ignored(path, true))
+        {
+            continue;
+        }
+
+        int32_t wd = inotify_add_watch(m_inotifyFd, path.c_str(), _kernelMask(ev, true, true));
+        bool replaced = false;
+        if (INVALID_ID != wd && dir.snapshot.valid())
+        {
+            // 同名目录已被替换, 快照不再适用
+            struct stat64 dirStat;
+            replaced = lstat64(path.c_str(), &dirStat) != 0 || dirStat.st_ino != dir.snapshot.ino;
+            if (replaced)
+            {
+                inotify_rm_watch(m_inotifyFd, wd);
+            }
+        }
+
+        if (INVALID_ID == wd || replaced)
+        {
+            int32_t error = replaced ? ESTALE : errno;
+            if (!isRoot && (replaced || error == ENOENT || error == EACCES || error == ENOTDIR))
+            {
+                continue;
+            }
+
+            LOGW("restore %s error, walk again. [%d, %s]", path.c_str(), error, strerror(error));
+            for (int32_t it : wdVec)
+            {
+                if (it != INVALID_ID)
+                {
+                    inotify_rm_watch(m_inotifyFd, it);
+                }
+            }
+            entryList.clear();
+            missingVec.clear();
+            return false;
+        }
+
+        wdVec[offset] = wd;
+        if (m_identityTracking)
+        {
+            _indexDir(wd, path, dir.snapshot);
+        }
+
+        // 快照中有记录但没有对应目录记录的子目录(保存时处于轮询或无法监视), 需要重新遍历
+        if (dir.recursion)
+        {
+            for (const auto &entry : dir.snapshot.entries)
+            {
+                if (!entry.isDir || (ignore != nullptr && ignore->ignored(path, entry.name, true)))
+                {
+                    continue;
+                }
+
+                std::string childPath = path + entry.name + "/";
+                if (recordSet.find(childPath) == recordSet.end())
+                {
+                    missingVec.push_back({wd, entry.name, std::move(childPath)});
+                }
+            }
+        }
+
+        entryList.push_back({parentWd, dir.name, {wd, ev, dir.recursion}, DirSnapshot(), isRoot ? ignore : nullptr});
+        idxVec.push_back(i);
+    }
+
+    // 整个根目录恢复成功后才取走快照, 失败时重新遍历的目录树仍需与快照比较
+    auto idxIt = idxVec.begin();
+    for (auto &entry : entryList)
+    {
+        entry.snapshot = std::move(m_persistedDirs[*idxIt++].snapshot);
+    }
+    return true;
+}
+
+WatchNode *InotifyTool::_adoptSnapshot(size_t rootIdx, bool &complete)
+{
+    std::vector<std::string> pathVec;
+    size_t endIdx = _persistedPaths(rootIdx, pathVec);
+
+    WatchNode *pRoot = nullptr;
+    complete = true;
+    for (size_t i = rootIdx; i < endIdx; ++i)
+    {
+        PersistedDir &dir = m_persistedDirs[i];
+        const std::string &path = pathVec[i - rootIdx];
+        if (path.empty() || !dir.snapshot.valid())
+        {
+            continue;
+        }
+
+        // 降级为轮询的目录从当前状态开始扫描, 离线期间的变化无法输出
+        WatchNode *pNode = m_watchTree.find(path);
+        if (pNode == nullptr)
+        {
+            complete &= !m_pollingScanner.contains(path);
+            continue;
+        }
+
+        // 同名目录已被替换时保留遍历建立的快照, 由父目录的比较输出事件
+        struct stat64 dirStat;
+        if (lstat64(path.c_str(), &dirStat) != 0 || dirStat.st_ino != dir.snapshot.ino)
+        {
+            continue;
+        }
+
+        pNode->snapshot = std::move(dir.snapshot);
+        if (i == rootIdx)
+        {
+            pRoot = pNode;
+        }
+    }
+
+    return pRoot;
+}
+
+void InotifyTool::_mergeWatches(std::list<WatchEntry> &entryList)
+{
+    if (m_eventLog.isOpen() && !entryList.empty())
+    {
+        uint64_t nowNs = utils::MonotonicNs();
+        for (const auto &it : entryList)
+        {
+            m_eventLog.writeWatch(nowNs, {it.info.wd, it.parentWd, it.info.ev, it.info.recursion, true, it.name});
+        }
+    }
+
+    m_watchTree.merge(entryList);
+}
+
+void InotifyTool::_replayWatch(const EventLogWatch &watch)
+{
+    InotifyInfo info = {watch.wd, watch.ev, watch.recursion};
+    if (!watch.recursion)
+    {
+        m_watchTree.insert(nullptr, watch.name, info, watch.isDir);
+        return;
+    }
+
+    std::list<WatchEntry> entryList;
+    entryList.push_back({watch.parentWd, watch.name, info, DirSnapshot(), nullptr});
+    if (watch.parentWd == INVALID_ID)
+    {
+        entryList.back().ignore = _findIgnore(watch.name);
+    }
+    m_watchTree.merge(entryList);
+    m_eventBatch.forgetPath();
+}
+
+void InotifyTool::_indexDir(int32_t wd, const std::string &path, const DirSnapshot &snapshot)
+{
+    int32_t dirFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0)
+    {
+        return;
+    }
+
+    struct stat64 fileStat;
+    if (fstat64(dirFd, &fileStat) == 0)
+    {
+        m_inodeIndex.setDirDev(wd, fileStat.st_dev);
+    }
+
+    for (const auto &entry : snapshot.entries)
+    {
+        if (entry.isDir || fstatat64(dirFd, entry.name.c_str(), &fileStat, AT_SYMLINK_NOFOLLOW) != 0 ||
+            !S_ISREG(fileStat.st_mode))
+        {
+            continue;
+        }
+
+        int64_t mtimeNs = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+        m_inodeIndex.update(fileStat.st_dev, fileStat.st_ino, wd, entry.name, fileStat.st_size, mtimeNs);
+    }
+
+    close(dirFd);
+}
+
+uint32_t InotifyTool::_identifyFile(WatchNode *pNode, std::string_view name, bool movedIn,
+                                    std::string &fromPath, std::string &fromName)
+{
+    uint64_t dev = 0;
+    if (!m_identityTracking || !m_inodeIndex.dirDev(pNode->info.wd, dev))
+    {
+        return 0;
+    }
+
+    m_pathScratch.clear();
+    m_watchTree.appendPath(pNode, m_pathScratch);
+    m_pathScratch.append(name);
+
+    struct stat64 fileStat;
+    if (lstat64(m_pathScratch.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+    {
+        return 0;
+    }
+
+    uint64_t ino = fileStat.st_ino;
+    uint64_t size = fileStat.st_size;
+    int64_t mtimeNs = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+    pNode->snapshot.insert(name, ino, false);
+
+    uint32_t hint = 0;
+    if (movedIn)
+    {
+        // 经监视范围外中转移回, IN_MOVED_FROM仍在等待配对
+        for (auto it = m_pendingMoveMap.begin(); it != m_pendingMoveMap.end(); ++it)
+        {
+            uint64_t moveDev = 0;
+            if (!it->second.isDir && it->second.ino == ino &&
+                m_inodeIndex.dirDev(it->second.wd, moveDev) && moveDev == dev)
+            {
+                fromPath = it->second.path;
+                fromName = it->second.name;
+                m_pendingMoveMap.erase(it);
+                hint = EV_IN_MOVE;
+                break;
+            }
+        }
+    }
+
+    const InodeRecord *pRecord = (hint == 0) ? m_inodeIndex.find(dev, ino) : nullptr;
+    if (pRecord != nullptr && pRecord->size == size && pRecord->mtimeNs == mtimeNs)
+    {
+        if (pRecord->gone())
+        {
+            if (movedIn)
+            {
+                size_t pos = pRecord->gonePath.rfind('/');
+                fromPath = pRecord->gonePath.substr(0, pos + 1);
+                fromName = pRecord->gonePath.substr(pos + 1);
+                hint = EV_IN_MOVE;
+            }
+        }
+        else if (pRecord->wd != pNode->info.wd || pRecord->name != name)
+        {
+            WatchNode *pKnown = m_watchTree.find(pRecord->wd);
+            if (pKnown != nullptr)
+            {
+                fromPath = m_watchTree.path(pKnown);
+                fromName = pRecord->name;
+                hint = EV_IN_COPY;
+            }
+        }
+    }
+
+    // 硬链接保留已知位置的记录
+    if (hint != EV_IN_COPY)
+    {
+        m_inodeIndex.update(dev, ino, pNode->info.wd, name, size, mtimeNs);
+    }
+
+    return hint;
+}
+
+const IgnoreMatcher *InotifyTool::_findIgnore(const std::string &path) const
+{
+    // 根目录不会嵌套, 取路径所在的根目录
+    const IgnoreMatcher *ignore = nullptr;
+    size_t length = 0;
+    for (const auto &it : m_ignoreMap)
+    {
+        const std::string &root = it.first;
+        bool contains = path.compare(0, root.length(), root) == 0 || path + "/" == root;
+        if (contains && root.length() > length)
+        {
+            ignore = it.second.get();
+            length = root.length();
+        }
+    }
+
+    return ignore;
+}
+
+bool InotifyTool::_ignored(const WatchNode *node, std::string_view name, bool isDir)
+{
+    const IgnoreMatcher *ignore = node->ignore;
+    if (ignore == nullptr || ignore->empty())
+    {
+        return false;
+    }
+
+    // 路径视图会缓存到批次中, 同一目录的后续事件可直接使用
+    std::string_view dirPath;
+    if (ignore->anchored())
+    {
+        dirPath = _batchPath(node);
+    }
+
+    return ignore->ignored(dirPath, name, isDir);
+}
+
+std::string_view InotifyTool::_batchPath(const WatchNode *node)
+{
+    std::string_view path;
+    if (m_eventBatch.cachedPath(node, path))
+    {
+        return path;
+    }
+
+    m_pathScratch.clear();
+    m_watchTree.appendPath(node, m_pathScratch);
+    return m_eventBatch.storePath(node, m_pathScratch);
+}
+
+bool InotifyTool::_pollRemoteRoot(const std::string &path, uint32_t ev, int32_t &status)
+{
+    std::string fsType;
+    if (!m_remotePolling || m_replaying || !utils::IsRemoteFs(path, fsType))
+    {
+        return false;
+    }
+
+    uint64_t beginMs = utils::MonotonicMs();
+    status = m_pollingScanner.add(path, ev, true, beginMs, _findIgnore(path), m_remoteLatencyMs);
+    if (status != NO_ERROR)
+    {
+        setErrorCode(-status);
+        LOGE("poll %s (%s) error. [%d, %s]", path.c_str(), fsType.c_str(), -status, strerror(-status));
+        return true;
+    }
+
+    LOGI("%s is on %s, poll %zu directories (%" PRIu64 " ms), latency bound %u ms", path.c_str(), fsType.c_str(),
+        m_pollingScanner.dirCount(), utils::MonotonicMs() - beginMs, m_remoteLatencyMs);
+    return true;
+}
+
+void InotifyTool::_unwatchTree(WatchNode *node)
+{
+    if (node == nullptr)
+    {
+        return;
+    }
+
+    std::vector<int32_t> wdVec;
+    int32_t wd = node->info.wd;
+    m_watchTree.erase(node, &wdVec);
+    m_eventBatch.forgetPath();
+    wdVec.push_back(wd);
+    for (int32_t it : wdVec)
+    {
+        inotify_rm_watch(m_inotifyFd, it);
+        m_watchBudget.forget(it);
+        m_inodeIndex.forgetDir(it);
+    }
+}
+
+int32_t InotifyTool::_readEvent(bool drain)
+{
+    // 上一次通过getEventBatch取走的批次在本次读取时才失效
+    if (m_batchTaken)
+    {
+        m_eventBatch.clear();
+        m_batchTaken = false;
+    }
+
+    // 本次读取之前发生的修改都已通过事件上报(或在队列中), 无溢出时可作为新的一致点
+    int64_t readBeginNs = utils::RealtimeNs();
+
+    do {
+        uint8_t *pBuffer = m_readBuffer.get();
+        size_t space = MAX_BUF_SIZE - m_readUsed;
+        ssize_t readSize = ::read(m_inotifyFd, pBuffer + m_readUsed, space);
+        ++m_kernelStats.readCalls;
+        if (readSize < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno != EAGAIN) {
+                setErrorCode(errno);
+                LOGE("read(%d) error. [%d, %s]", m_inotifyFd, errno, strerror(errno));
+                return UNKNOWN_ERROR;
+            }
+
+            break;
+        }
+
+        LOGD("read size: %zd", readSize);
+
+        // 读到结尾
+        if (readSize == 0) {
+            break;
+        }
+
+        m_kernelStats.bytes += readSize;
+        size_t dataSize = m_readUsed + readSize;
+        uint64_t parseBeginNs = utils::MonotonicNs();
+        if (m_eventLog.isOpen())
+        {
+            m_eventLog.writeData(parseBeginNs, pBuffer + m_readUsed, readSize);
+        }
+        m_eventBatch.stamp(parseBeginNs);
+        size_t parsed = _parseEvent(pBuffer, dataSize);
+        m_parseHistogram.record(utils::MonotonicNs() - parseBeginNs);
+
+        // NOTE 内核只返回完整的事件, 正常情况下没有剩余, 不需要移动数据
+        m_readUsed = dataSize - parsed;
+        if (m_readUsed > 0 && parsed > 0)
+        {
+            memmove(pBuffer, pBuffer + parsed, m_readUsed);
+        }
+
+        // 未填满缓冲区说明队列已读空, 新到的事件会再次唤醒poll
+        if (!drain && static_cast<size_t>(readSize) + MAX_EVENT_SIZE <= space)
+        {
+            break;
+        }
+    } while (true);
+
+    _expireMoves(utils::MonotonicMs());
+    if (m_identityTracking)
+    {
+        m_inodeIndex.expire(utils::MonotonicMs());
+    }
+
+    if (m_overflowPending)
+    {
+        _resync();
+    }
+    else if (readBeginNs > m_consistentNs)
+    {
+        m_consistentNs = readBeginNs;
+    }
+
+    return NO_ERROR;
+}
+
+void InotifyTool::_pollScan(uint64_t nowMs)
+{
+    int64_t scanMs = m_pollingScanner.nextTimeout(nowMs);
+    if (scanMs != 0)
+    {
+        return;
+    }
+
+    if (m_batchTaken)
+    {
+        m_eventBatch.clear();
+        m_batchTaken = false;
+    }
+
+    m_eventBatch.stamp(utils::MonotonicNs());
+    m_pollingScanner.scan(nowMs, m_eventBatch);
+    _rebalance(nowMs);
+}
+
+void InotifyTool::_rebalance(uint64_t nowMs)
+{
+    std::vector<PollingScanner::SubtreeInfo> subtreeVec;
+    m_pollingScanner.subtrees(nowMs, subtreeVec);
+    for (const auto &subtree : subtreeVec)
+    {
+        // 按活跃度降序排列
+        if (subtree.activity < PROMOTE_SCORE)
+        {
+            break;
+        }
+
+        if (subtree.pinned)
+        {
+            continue;
+        }
+
+        size_t used = m_watchTree.size();
+        size_t limit = m_watchBudget.limit();
+        size_t available = limit > used ? limit - used : 0;
+        if (subtree.dirs > available)
+        {
+            available += _demoteColdest(subtree.dirs - available, subtree.path, nowMs);
+        }
+
+        if (subtree.dirs > available)
+        {
+            continue;
+        }
+
+        int32_t parentWd = INVALID_ID;
+        std::string name = subtree.path;
+        if (!subtree.isRoot)
+        {
+            std::string parentPath = subtree.path.substr(0, subtree.path.rfind('/', subtree.path.length() - 2) + 1);
+            WatchNode *pParent = m_watchTree.find(parentPath);
+            if (pParent == nullptr)
+            {
+                continue;
+            }
+
+            parentWd = pParent->info.wd;
+            name = subtree.path.substr(parentPath.length(), subtree.path.length() - parentPath.length() - 1);
+        }
+
+        LOGI("promote %s (%zu directories, activity %.2f) to inotify watches", subtree.path.c_str(), subtree.dirs, subtree.activity);
+        m_pollingScanner.remove(subtree.path);
+
+        std::list<WatchEntry> entryList;
+        if (!_watchRecursive(entryList, parentWd, name, subtree.path, subtree.ev))
+        {
+            m_pollingScanner.add(subtree.path, subtree.ev, subtree.isRoot, nowMs, _findIgnore(subtree.path));
+            continue;
+        }
+
+        // 刚升级的目录给予初始活跃度, 避免立即被降级
+        for (const auto &entry : entryList)
+        {
+            m_watchBudget.touch(entry.info.wd, nowMs, PROMOTE_SCORE);
+        }
+        _mergeWatches(entryList);
+        m_eventBatch.forgetPath();
+    }
+}
+
+size_t InotifyTool::_demoteColdest(size_t needed, const std::string &exclude, uint64_t nowMs)
+{
+    struct Candidate
+    {
+        WatchNode * node;
+        size_t      count;
+    };
+
+    // 后序计算每个子树的最大活跃度和目录数, 只保留整棵子树都不活跃的最大子树
+    std::vector<Candidate> candidateVec;
+    std::function<size_t(WatchNode *, double &)> visit = [&] (WatchNode *pNode, double &maxScore) -> size_t {
+        size_t count = 1;
+        maxScore = m_watchBudget.score(pNode->info.wd, nowMs);
+        size_t firstChild = candidateVec.size();
+        for (const auto &it : pNode->children)
+        {
+            double childScore = 0;
+            count += visit(it.second, childScore);
+            maxScore = std::max(maxScore, childScore);
+        }
+
+        if (pNode->parent != nullptr && pNode->isDir && maxScore < DEMOTE_SCORE)
+        {
+            // 整棵子树可降级, 替换掉其中已收集的子节点
+            candidateVec.resize(firstChild);
+            candidateVec.push_back({pNode, count});
+        }
+
+        return count;
+    };
+
+    std::vector<WatchNode *> rootVec;
+    m_watchTree.foreach([&rootVec] (WatchNode *pNode) {
+        if (pNode->parent == nullptr)
+        {
+            rootVec.push_back(pNode);
+        }
+    });
+
+    for (WatchNode *pRoot : rootVec)
+    {
+        double maxScore = 0;
+        visit(pRoot, maxScore);
+    }
+
+    std::sort(candidateVec.begin(), candidateVec.end(), [] (const Candidate &left, const Candidate &right) {
+        return left.count > right.count;
+    });
+
+    // 不足以腾出所需的watch时不降级
+    std::vector<std::pair<WatchNode *, std::string>> demoteVec;
+    size_t freed = 0;
+    for (const auto &candidate : candidateVec)
+    {
+        if (freed >= needed)
+        {
+            break;
+        }
+
+        std::string path = m_watchTree.path(candidate.node);
+        if (exclude.compare(0, path.length(), path) == 0)
+        {
+            continue;
+        }
+
+        demoteVec.push_back(std::make_pair(candidate.node, std::move(path)));
+        freed += candidate.count;
+    }
+
+    if (freed < needed)
+    {
+        return 0;
+    }
+
+    for (const auto &it : demoteVec)
+    {
+        const std::string &path = it.second;
+        WatchNode *pNode = it.first;
+        uint32_t ev = pNode->info.ev;
+        const IgnoreMatcher *ignore = pNode->ignore;
+        LOGI("demote %s to polling", path.c_str());
+        _unwatchTree(pNode);
+        m_pollingScanner.add(path, ev, false, nowMs, ignore);
+    }
+
+    return freed;
+}
+
+void InotifyTool::_resync()
+{
+    m_overflowPending = false;
+    if (m_resyncMode == ResyncMode::NONE)
+    {
+        return;
+    }
+
+    ResyncStats stats = _compareSnapshot(m_resyncMode, std::vector<WatchNode *>());
+    stats.count = m_resyncStats.count + 1;
+    m_resyncStats = stats;
+    LOGI("resync after overflow: %" PRIu64 "/%" PRIu64 " directories scanned, %" PRIu64 " events, %" PRIu64 " ms",
+        stats.dirsScanned, stats.dirsChecked, stats.events, stats.elapsedMs);
+}
+
+ResyncStats InotifyTool::_compareSnapshot(ResyncMode mode, const std::vector<WatchNode *> &rootVec)
+{
+    auto beginTime = std::chrono::steady_clock::now();
+    int64_t resyncBeginNs = utils::RealtimeNs();
+    m_eventBatch.stamp(utils::MonotonicNs());
+    int64_t modifiedAfterNs = m_consistentNs - RESYNC_MTIME_SLACK_NS;
+
+    ResyncStats stats;
+
+    struct AddedDir
+    {
+        int32_t     parentWd;
+        std::string name;
+        std::string path;
+        uint32_t    ev;
+    };
+    std::vector<AddedDir> addedDirVec;
+    std::vector<int32_t> removedWdVec;
+    std::string dirPath;
+
+    auto compareDir = [&] (WatchNode *pNode) {
+        if (!pNode->isDir)
+        {
+            return;
+        }
+
+        ++stats.dirsChecked;
+        dirPath.clear();
+        m_watchTree.appendPath(pNode, dirPath);
+
+        // 打开失败说明目录已删除或被移走, 由父目录的比较输出事件
+        int32_t dirFd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0)
+        {
+            return;
+        }
+
+        uint64_t ino = 0;
+        int64_t mtimeNs = 0;
+        bool changed = !pNode->snapshot.valid() ||
+            DirSnapshot::Stat(dirFd, ino, mtimeNs) != NO_ERROR ||
+            ino != pNode->snapshot.ino || mtimeNs != pNode->snapshot.mtimeNs;
+        if (!changed && mode != ResyncMode::ALL_DIRS)
+        {
+            close(dirFd);
+            return;
+        }
+
+        DirSnapshot current;
+        if (DirSnapshot::Read(dirFd, current) != NO_ERROR)
+        {
+            close(dirFd);
+            return;
+        }
+        ++stats.dirsScanned;
+
+        // 没有基准快照时只建立快照
+        if (!pNode->snapshot.valid())
+        {
+            pNode->snapshot = std::move(current);
+            close(dirFd);
+            return;
+        }
+
+        std::string_view path = _batchPath(pNode);
+        auto onAdded = [&] (const DirSnapshotEntry *pEntry) {
+            m_eventBatch.pushStored(EV_IN_CREATE | (pEntry->isDir ? EV_IN_ISDIR : 0), 0, path, pEntry->name);
+            ++stats.events;
+            if (pEntry->isDir && pNode->info.recursion)
+            {
+                addedDirVec.push_back({pNode->info.wd, pEntry->name, dirPath + pEntry->name, pNode->info.ev});
+            }
+        };
+
+        auto onRemoved = [&] (const DirSnapshotEntry *pEntry) {
+            m_eventBatch.pushStored(EV_IN_DELETE | (pEntry->isDir ? EV_IN_ISDIR : 0), 0, path, pEntry->name);
+            ++stats.events;
+            WatchNode *pChild = pEntry->isDir ? m_watchTree.child(pNode, pEntry->name) : nullptr;
+            if (pChild != nullptr)
+            {
+                removedWdVec.push_back(pChild->info.wd);
+            }
+        };
+
+        DirSnapshot::Diff(pNode->snapshot, current, [&] (const DirSnapshotEntry *pOld, const DirSnapshotEntry *pNew) {
+            const DirSnapshotEntry *pEntry = (pNew != nullptr) ? pNew : pOld;
+            if (pNode->ignore != nullptr && pNode->ignore->ignored(path, pEntry->name, pEntry->isDir))
+            {
+                return;
+            }
+
+            if (pOld == nullptr)
+            {
+                onAdded(pNew);
+                return;
+            }
+
+            if (pNew == nullptr)
+            {
+                onRemoved(pOld);
+                return;
+            }
+
+            // 同名但inode不同, 已被替换. 由事件插入的子项inode未知
+            if ((pOld->ino != 0 && pOld->ino != pNew->ino) || pOld->isDir != pNew->isDir)
+            {
+                onRemoved(pOld);
+                onAdded(pNew);
+                return;
+            }
+
+            if (pNew->isDir)
+            {
+                return;
+            }
+
+            struct stat64 fileStat;
+            ++stats.fileStats;
+            if (fstatat64(dirFd, pNew->name.c_str(), &fileStat, AT_SYMLINK_NOFOLLOW) == 0)
+            {
+                int64_t fileMtimeNs = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+                if (fileMtimeNs >= modifiedAfterNs)
+                {
+                    m_eventBatch.pushStored(EV_IN_MODIFY_OVER, 0, path, pNew->name);
+                    ++stats.events;
+                }
+            }
+        });
+
+        pNode->snapshot = std::move(current);
+        close(dirFd);
+    };
+
+    if (rootVec.empty())
+    {
+        m_watchTree.foreach(compareDir);
+    }
+    else
+    {
+        std::vector<WatchNode *> stack(rootVec);
+        while (!stack.empty())
+        {
+            WatchNode *pNode = stack.back();
+            stack.pop_back();
+            compareDir(pNode);
+            for (const auto &it : pNode->children)
+            {
+                stack.push_back(it.second);
+            }
+        }
+    }
+
+    // 遍历结束后再修改目录树
+    for (int32_t wd : removedWdVec)
+    {
+        _unwatchTree(m_watchTree.find(wd));
+    }
+
+    for (const auto &it : addedDirVec)
+    {
+        // 按快照恢复失败而重新遍历时, 离线期间新建的目录已被监视或轮询
+        WatchNode *pParent = m_watchTree.find(it.parentWd);
+        if (pParent == nullptr || m_watchTree.child(pParent, it.name) != nullptr || m_pollingScanner.contains(it.path))
+        {
+            continue;
+        }
+
+        std::list<WatchEntry> entryList;
+        if (_watchRecursive(entryList, it.parentWd, it.name, it.path, it.ev))
+        {
+            _mergeWatches(entryList);
+        }
+    }
+    m_eventBatch.forgetPath();
+
+    m_consistentNs = resyncBeginNs;
+    stats.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - beginTime).count();
+    return stats;
+}
+
+void InotifyTool::_expireMoves(uint64_t nowMs)
+{
+    if (m_pendingMoveMap.empty())
+    {
+        return;
+    }
+
+    if (m_batchTaken)
+    {
+        m_eventBatch.clear();
+        m_batchTaken = false;
+    }
+
+    m_eventBatch.stamp(utils::MonotonicNs());
+    for (auto it = m_pendingMoveMap.begin(); it != m_pendingMoveMap.end(); )
+    {
+        if (it->second.deadlineMs > nowMs)
+        {
+            ++it;
+            continue;
+        }
+
+        _emitMovedOut(it->first, it->second);
+        it = m_pendingMoveMap.erase(it);
+    }
+}
+
+void InotifyTool::_flushMove(int32_t wd, std::string_view name)
+{
+    for (auto it = m_pendingMoveMap.begin(); it != m_pendingMoveMap.end(); ++it)
+    {
+        if (it->second.wd == wd && it->second.name == name)
+        {
+            _emitMovedOut(it->first, it->second);
+            m_pendingMoveMap.erase(it);
+            return;
+        }
+    }
+}
+
+InotifyTool::PendingMove *InotifyTool::_pendingDirMove(const WatchNode *pNode)
+{
+    for (auto &it : m_pendingMoveMap)
+    {
+        if (!it.second.isDir)
+        {
+            continue;
+        }
+
+        const WatchNode *pMoved = m_watchTree.child(m_watchTree.find(it.second.wd), it.second.name);
+        for (const WatchNode *pParent = pNode; pMoved != nullptr && pParent != nullptr; pParent = pParent->parent)
+        {
+            if (pParent == pMoved)
+            {
+                return &it.second;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+void InotifyTool::_emitMovedOut(uint32_t cookie, const PendingMove &move)
+{
+    // 目录被移出监视范围, 停止监视此目录. 暂存的子树事件发生在监视范围外, 丢弃
+    if (move.isDir)
+    {
+        if (!move.held.empty())
+        {
+            size_t dropped = 0;
+            for (size_t i = 0; i + INOTIFY_EVENT_SIZE <= move.held.size(); ++dropped)
+            {
+                i += INOTIFY_EVENT_SIZE + reinterpret_cast<const struct inotify_event *>(move.held.data() + i)->len;
+            }
+            m_kernelStats.movedOutDropped += dropped;
+            LOGD("%s%s moved out, drop %zu events", move.path.c_str(), move.name.c_str(), dropped);
+        }
+
+        WatchNode *pNode = m_watchTree.child(m_watchTree.find(move.wd), move.name);
+        if (pNode != nullptr)
+        {
+            _unwatchTree(pNode);
+        }
+        else if (m_pollingScanner.subtreeCount() > 0)
+        {
+            m_pollingScanner.remove(move.path + move.name + "/");
+        }
+    }
+
+    uint64_t dev = 0;
+    if (!move.isDir && move.ino != 0 && m_inodeIndex.dirDev(move.wd, dev))
+    {
+        m_inodeIndex.markGone(dev, move.ino, move.wd, move.name, move.path + move.name, utils::MonotonicMs());
+    }
+
+    m_eventBatch.push(EV_IN_MOVED_OUT | (move.isDir ? EV_IN_ISDIR : 0), cookie, move.path, move.name);
+}
+
+int64_t InotifyTool::_nextMoveTimeout(uint64_t nowMs) const
+{
+    int64_t timeout = -1;
+    for (const auto &it : m_pendingMoveMap)
+    {
+        int64_t remain = it.second.deadlineMs > nowMs ? static_cast<int64_t>(it.second.deadlineMs - nowMs) : 0;
+        if (timeout < 0 || remain < timeout)
+        {
+            timeout = remain;
+        }
+    }
+
+    return timeout;
+}
+
+int64_t InotifyTool::_nextSnapshotTimeout(uint64_t nowMs) const
+{
+    if (m_snapshotFile.empty() || m_watchTree.empty() || m_consistentNs == m_snapshotNs)
+    {
+        return -1;
+    }
+
+    uint64_t deadlineMs = m_snapshotMs + m_snapshotIntervalMs;
+    return deadlineMs > nowMs ? static_cast<int64_t>(deadlineMs - nowMs) : 0;
+}
+
+void InotifyTool::_autoSnapshot(uint64_t nowMs)
+{
+    if (_nextSnapshotTimeout(nowMs) != 0)
+    {
+        return;
+    }
+
+    // 失败时也等待下一个间隔再重试
+    m_snapshotMs = nowMs;
+    saveSnapshot(m_snapshotFile);
+}
+
+void InotifyTool::_publish()
+{
+    size_t begin = m_eventBatch.published();
+    if (begin < m_eventBatch.size())
+    {
+        uint64_t emitNs = utils::MonotonicNs();
+        m_eventBatch.setEmitNs(begin, emitNs);
+        for (size_t i = begin; i < m_eventBatch.size(); ++i)
+        {
+            uint64_t readNs = m_eventBatch[i].readNs;
+            m_residenceHistogram.record(emitNs > readNs ? emitNs - readNs : 0);
+        }
+        m_batchSizeHistogram.record(m_eventBatch.size() - begin);
+
+        m_eventBatch.setPublished(m_eventBatch.size());
+        m_dispatcher.dispatch(m_eventBatch, begin);
+    }
+
+    _updateGauges();
+}
+
+void InotifyTool::_updateGauges()
+{
+    m_gauges.watches.store(m_watchTree.size(), std::memory_order_relaxed);
+    m_gauges.polledDirs.store(m_pollingScanner.dirCount(), std::memory_order_relaxed);
+    m_gauges.pendingModify.store(m_modifySet.size(), std::memory_order_relaxed);
+    m_gauges.pendingMoves.store(m_pendingMoveMap.size(), std::memory_order_relaxed);
+    m_gauges.queuedEvents.store(m_batchTaken ? 0 : m_eventBatch.size(), std::memory_order_relaxed);
+}
+
+int32_t InotifyTool::_batchWindow()
+{
+    // 窗口内睡眠而不是逐个事件唤醒, 事件在内核队列中累积, 最后连续read读取整个突发
+    uint64_t deadlineMs = utils::MonotonicMs() + m_batchWindowMs;
+    uint64_t sliceMs = std::max<uint64_t>(m_batchWindowMs / 4, 1);
+    while (true)
+    {
+        if (m_batchMaxEvents > 0)
+        {
+            int32_t avail = 0;
+            ++m_kernelStats.waitCalls;
+            if (ioctl(m_inotifyFd, FIONREAD, &avail) == 0 &&
+                m_eventBatch.size() + avail / AVG_EVENT_SIZE >= m_batchMaxEvents)
+            {
+                break;
+            }
+        }
+
+        uint64_t nowMs = utils::MonotonicMs();
+        if (nowMs >= deadlineMs)
+        {
+            break;
+        }
+
+        ++m_kernelStats.waitCalls;
+        usleep(std::min<uint64_t>(sliceMs, deadlineMs - nowMs) * 1000);
+    }
+
+    return _readEvent(true);
+}
+
+size_t InotifyTool::_parseEvent(const uint8_t *data, size_t size, bool held)
+{
+    const struct inotify_event *pInoEvent = nullptr;
+    uint64_t nowMs = m_replaying ? m_replayNowMs : utils::MonotonicMs();
+
+    size_t i = 0;
+    // NOTE 未防止因read读取到不完整inotify_event产生越界行为, 需要在for条件中判断是否完整结构体
+    for (; i < size && (i + INOTIFY_EVENT_SIZE) <= size; i += (INOTIFY_EVENT_SIZE + pInoEvent->len))
+    {
+        pInoEvent = (const struct inotify_event *)(data + i);
+        if (i + INOTIFY_EVENT_SIZE + pInoEvent->len > size)
+        {
+            break;
+        }
+
+#ifndef NDEBUG
+        // 每个事件都拼接掩码字符串, 只在调试构建中输出
+        DumpInotifyEvent(pInoEvent);
+#endif
+        // 暂存的事件读取时已统计, 且不会是忽略的事件
+        if (!held)
+        {
+            ++m_kernelStats.events;
+        }
+        if ((pInoEvent->mask & ~(IN_ISDIR | IN_ACCESS | IN_OPEN | IN_CLOSE_NOWRITE | IN_ATTRIB | IN_MOVE_SELF)) == 0)
+        {
+            ++m_kernelStats.ignored;
+            continue;
+        }
+
+        if (pInoEvent->mask & IN_Q_OVERFLOW)
+        {
+            // 读完当前所有事件后再重新同步, 减少与后续事件重复
+            LOGW("inotify event queue overflow");
+            m_overflowPending = true;
+            m_gauges.overflows.fetch_add(1, std::memory_order_relaxed);
+            m_eventBatch.push(pInoEvent->mask, pInoEvent->cookie, std::string_view(), std::string_view());
+            continue;
+        }
+
+        if (pInoEvent->mask & IN_DELETE_SELF)
+        {
+            // 监视目录被删除需要解除监视并从映射表中移除
+            LOGW("erase wd: %d for IN_DELETE_SELF", pInoEvent->wd);
+            inotify_rm_watch(m_inotifyFd, pInoEvent->wd);
+            continue;
+        }
+
+        // 监视已显式删除(inotify_rm_Watch)或自动删除(文件已删除或文件系统已卸载)
+        if (pInoEvent->mask & IN_IGNORED)
+        {
+            LOGI("wd: %d Trigger IN_IGNORED event", pInoEvent->wd);
+            _unwatchTree(m_watchTree.find(pInoEvent->wd));
+            continue;
+        }
+
+        // NOTE 解除监视后, 内核队列中可能仍有此wd的事件
+        WatchNode *pNode = m_watchTree.find(pInoEvent->wd);
+        if (pNode == nullptr)
+        {
+            LOGW("wd(%d) not found, mask: %#x", pInoEvent->wd, pInoEvent->mask);
+            continue;
+        }
+
+        // 目录的IN_MOVED_FROM等待配对时目录可能已移出监视范围, 其子树中的事件暂存到配对(按新路径解析)或超时(丢弃)
+        PendingMove *pDirMove = m_pendingMoveMap.empty() ? nullptr : _pendingDirMove(pNode);
+        if (pDirMove != nullptr)
+        {
+            // IN_MOVED_TO总是紧跟IN_MOVED_FROM, 暂存过多说明已移出, 下次检查超时时输出
+            if (pDirMove->held.size() >= MAX_BUF_SIZE)
+            {
+                pDirMove->deadlineMs = 0;
+                ++m_kernelStats.movedOutDropped;
+                continue;
+            }
+
+            const uint8_t *pRaw = reinterpret_cast<const uint8_t *>(pInoEvent);
+            pDirMove->held.insert(pDirMove->held.end(), pRaw, pRaw + INOTIFY_EVENT_SIZE + pInoEvent->len);
+            continue;
+        }
+
+        if (pInoEvent->mask & IN_ALL_EVENTS & ~(IN_ACCESS | IN_OPEN | IN_CLOSE_NOWRITE))
+        {
+            m_watchBudget.touch(pInoEvent->wd, nowMs);
+        }
+
+        // 内核的name以'\0'填充到len长度
+        std::string_view name;
+        if (pInoEvent->len > 0)
+        {
+            name = std::string_view(pInoEvent->name, strnlen(pInoEvent->name, pInoEvent->len));
+        }
+
+        // 监视目录取消挂载或被删除
+        if (pInoEvent->mask & IN_UNMOUNT)
+        {
+            m_eventBatch.pushStored(pInoEvent->mask, pInoEvent->cookie, _batchPath(pNode), name);
+
+            // 卸载磁盘或自身被删除需要解除监视
+            LOGW("erase wd: %d for IN_UNMOUNT", pInoEvent->wd);
+            _unwatchTree(pNode);
+
+            continue;
+        }
+
+        if (name.empty())
+        {
+            // 无意义的事件
+            continue;
+        }
+
+        // 被忽略的项在拼接路径和更新快照之前丢弃. 改名为被忽略的名字时, 超时未配对的IN_MOVED_FROM会解除目录监视
+        if (pNode->ignore != nullptr && _ignored(pNode, name, pInoEvent->mask & IN_ISDIR))
+        {
+            continue;
+        }
+
+        // 当前操作的事件是否目录
+        bool isDirFlag = false;
+        uint32_t event = 0;
+
         // 表示当前是个目录
         if (pInoEvent->mask & IN_ISDIR)
         {
             isDirFlag = true;
-            eventItem.event |= EV_IN_ISDIR;
+            event |= EV_IN_ISDIR;
         }
 
         if (pInoEvent->mask & IN_DELETE)
         {
-            eventItem.cookie = pInoEvent->cookie;
-            eventItem.event |= EV_IN_DELETE;
-            eventItem.path = it.value();
-            eventItem.name = pInoEvent->name;
-            m_eventItemQueue.push_back(eventItem);
+            if (isDirFlag && m_pollingScanner.subtreeCount() > 0)
+            {
+                m_pollingScanner.remove(m_watchTree.path(pNode).append(name).append("/"));
+            }
 
+            uint64_t dev = 0;
+            const DirSnapshotEntry *pEntry = pNode->snapshot.find(name);
+            if (!isDirFlag && pEntry != nullptr && m_inodeIndex.dirDev(pInoEvent->wd, dev))
+            {
+                m_inodeIndex.erase(dev, pEntry->ino, pInoEvent->wd, name);
+            }
+
+            pNode->snapshot.erase(name);
+            m_eventBatch.pushStored(event | EV_IN_DELETE, pInoEvent->cookie, _batchPath(pNode), name);
             continue;
         }
 
         // 文件/目录被创建
         if (pInoEvent->mask & IN_CREATE)
         {
+            _flushMove(pInoEvent->wd, name);
+            pNode->snapshot.insert(name, 0, isDirFlag);
+
             // 如果新建文件是目录, 并且当前父目录递归监视, 则将此目录加入到监视中
-            if (isDirFlag && it.key().recursion)
+            if (isDirFlag && pNode->info.recursion)
             {
-                uint32_t mask = EV_IN_ERROR;
-                std::list<std::pair<std::string, InotifyInfo>> infoList;
-                if (_watchRecursive(infoList, it.value() + pInoEvent->name, it.key().ev))
+                std::list<WatchEntry> entryList;
+                std::string dirPath = m_watchTree.path(pNode);
+                dirPath.append(name);
+                if (!_watchRecursive(entryList, pNode->info.wd, pInoEvent->name, dirPath, pNode->info.ev))
                 {
-                    for (const auto &it : infoList)
-                    {
-                        m_pathWithWd.insert(it.second, it.first);
-                    }
-
-                    mask = 0;
+                    event |= EV_IN_ERROR;
                 }
 
-                eventItem.event |= mask;
+                _mergeWatches(entryList);
+                m_eventBatch.forgetPath();
             }
 
-            eventItem.cookie = pInoEvent->cookie;
-            eventItem.event |= EV_IN_CREATE;
-            eventItem.path = it.value();
-            eventItem.name = pInoEvent->name;
-            m_eventItemQueue.push_back(eventItem);
+            // 新建的硬链接指向已知文件
+            std::string fromPath, fromName;
+            if (!isDirFlag && _identifyFile(pNode, name, false, fromPath, fromName) == EV_IN_COPY)
+            {
+                m_eventBatch.pushMove(event | EV_IN_CREATE | EV_IN_COPY, pInoEvent->cookie, _batchPath(pNode), name,
+                                      fromPath, fromName);
+                continue;
+            }
 
+            m_eventBatch.pushStored(event | EV_IN_CREATE, pInoEvent->cookie, _batchPath(pNode), name);
             continue;
         }
 
-        // 文件被修改
+        // 文件被修改, 多次修改只记录一次
         if (pInoEvent->mask & IN_MODIFY)
         {
-            std::string filePath = it.value() + pInoEvent->name;
-            auto modifyIt = m_fileModifySet.find(filePath);
-            if (modifyIt == m_fileModifySet.end())
-            {
-                // 多次修改只记录一次
-                m_fileModifySet.insert(filePath);
-            }
-
+            m_modifySet.insert(pInoEvent->wd, ModifySet::Hash(name));
             continue;
         }
 
         // 修改完毕, 将修改事件压入队列
         if ((pInoEvent->mask & IN_CLOSE_WRITE))
         {
-            std::string filePath = it.value() + pInoEvent->name;
-            auto modifyIt = m_fileModifySet.find(filePath);
-            // 如果等于end表示文件以写方式打开, 但是并未修改文件后关闭
-            if (modifyIt != m_fileModifySet.end())
+            // 不存在表示文件以写方式打开, 但是并未修改文件后关闭
+            if (m_modifySet.erase(pInoEvent->wd, ModifySet::Hash(name)))
             {
-                eventItem.cookie = pInoEvent->cookie;
-                eventItem.event |= EV_IN_MODIFY_OVER;
-                eventItem.path = it.value();
-                eventItem.name = pInoEvent->name;
-                m_eventItemQueue.push_back(eventItem);
-
-                m_fileModifySet.erase(modifyIt);
+                // 刷新索引中的大小和修改时间
+                std::string fromPath, fromName;
+                _identifyFile(pNode, name, false, fromPath, fromName);
+                m_eventBatch.pushStored(event | EV_IN_MODIFY_OVER, pInoEvent->cookie, _batchPath(pNode), name);
             }
 
             continue;
         }
 
-        // 文件或目录被移动到其他位置
+        // 文件或目录被移动到其他位置. 配对的IN_MOVED_TO可能在下一次读取中, 记录到等待表
         if (pInoEvent->mask & IN_MOVED_FROM)
         {
-            moveOutItemIsDirFlag = isDirFlag;
-            pMoveOut = pInoEvent->name;
-            eventCookie = pInoEvent->cookie;
+            const DirSnapshotEntry *pEntry = pNode->snapshot.find(name);
+            uint64_t ino = (pEntry != nullptr) ? pEntry->ino : 0;
+            pNode->snapshot.erase(name);
 
-            eventItem.cookie = pInoEvent->cookie;
-            eventItem.event |= EV_IN_MOVED_OUT;
-            eventItem.path = it.value();
-            eventItem.name = pInoEvent->name;
-            m_eventItemQueue.push_back(eventItem);
+            auto moveIt = m_pendingMoveMap.find(pInoEvent->cookie);
+            if (moveIt != m_pendingMoveMap.end())
+            {
+                _emitMovedOut(moveIt->first, moveIt->second);
+                m_pendingMoveMap.erase(moveIt);
+            }
 
             // NOTE 考虑到对目录重命名会产生IN_MOVED_FROM事件, 故不在此处进行inotify的删除wd操作
+            m_pendingMoveMap[pInoEvent->cookie] = {pInoEvent->wd, isDirFlag, ino, m_watchTree.path(pNode),
+                                                   std::string(name), nowMs + m_moveTimeoutMs, {}};
             continue;
         }
 
         // 文件或目录从其他位置移动到被监视目录
         if (pInoEvent->mask & IN_MOVED_TO)
         {
-            std::string parentPath = it.value();
-            const char *pMoveIn = pInoEvent->name;
+            pNode->snapshot.insert(name, 0, isDirFlag);
 
-            // 对目录的重名操作, 需要更新旧的值
-            if (eventCookie == pInoEvent->cookie && pMoveOut != nullptr && moveOutItemIsDirFlag)
+            PendingMove moveOut;
+            auto moveIt = m_pendingMoveMap.find(pInoEvent->cookie);
+            bool paired = (moveIt != m_pendingMoveMap.end());
+            if (paired)
             {
-                auto tempBiMap = m_pathWithWd;
+                moveOut = std::move(moveIt->second);
+                m_pendingMoveMap.erase(moveIt);
+            }
+            else
+            {
+                _flushMove(pInoEvent->wd, name);
+            }
+
+            // 被移动的目录处于轮询中, 需要按新路径重新监视
+            bool rewatch = isDirFlag;
 
-                for (auto bimapIt = tempBiMap.begin(); bimapIt != tempBiMap.end(); ++bimapIt)
+            // 对目录的重名操作, 只需将节点挂到新的父节点下, 子树路径随之改变
+            if (paired && moveOut.isDir)
+            {
+                WatchNode *pMoveOutParent = m_watchTree.find(moveOut.wd);
+                WatchNode *pMoveOutNode = m_watchTree.child(pMoveOutParent, moveOut.name);
+                if (pMoveOutNode != nullptr)
                 {
-                    std::string moveOutPath = parentPath + pMoveOut;
-                    if (std::string::npos != bimapIt.value().find(moveOutPath))
-                    {
-                        std::string oldPath = bimapIt.value();
-                        utils::StringReplace(oldPath, moveOutPath, parentPath + pMoveIn);
-                        bimapIt.update(oldPath);
-                        continue;
-                    }
+                    m_watchTree.move(pMoveOutNode, pNode, std::string(name));
+                    m_eventBatch.forgetPath();
                 }
 
-                m_pathWithWd = std::move(tempBiMap);
-
-                pMoveOut = nullptr;
-                moveOutItemIsDirFlag = false;
+                rewatch = (pMoveOutNode == nullptr &&
+                    m_pollingScanner.remove(moveOut.path + moveOut.name + "/"));
             }
-            else if (isDirFlag)
+
+            if (rewatch)
             {
-                InotifyInfo info = it.key();
+                InotifyInfo info = pNode->info;
+                std::string dirPath = m_watchTree.path(pNode);
+                dirPath.append(name);
                 // 目录从其他位置移动到此处
                 if (info.recursion)
                 {
-                    std::list<std::pair<std::string, InotifyInfo>> infoList;
-                    if (_watchRecursive(infoList, parentPath + pMoveIn, info.ev))
-                    {
-                        for (const auto &it : infoList)
-                        {
-                            m_pathWithWd.insert(it.second, it.first);
-                        }
-                    }
-                    else
+                    std::list<WatchEntry> entryList;
+                    if (!_watchRecursive(entryList, info.wd, std::string(name), dirPath, info.ev))
                     {
-                        eventItem.event |= EV_IN_ERROR;
+                        event |= EV_IN_ERROR;
                     }
+
+                    _mergeWatches(entryList);
                 }
                 else
                 {
-                    watchFile(parentPath + pMoveIn, info.ev);
+                    watchFile(dirPath, info.ev);
                 }
+                m_eventBatch.forgetPath();
             }
 
-            eventItem.cookie = pInoEvent->cookie;
-            eventItem.event |= EV_IN_MOVED_IN;
-            eventItem.path = parentPath;
-            eventItem.name = pMoveIn;
-            m_eventItemQueue.push_back(eventItem);
-
-            continue;
-        }
-
-        // NOTE IN_MOVED_FROM和IN_MOVED_TO是连续事件, 中间不会被其他事件隔开
-        // 有IN_MOVED_FROM而没有IN_MOVED_TO事件
-        if (pMoveOut != nullptr && moveOutItemIsDirFlag)
-        {
-            auto tempBiMap = m_pathWithWd;
-
-            // 目录被移走, 则停止监视目录
-            std::string path = it.value() + pMoveOut;
-            for (auto bimapIt = tempBiMap.begin(); bimapIt != tempBiMap.end(); )
+            if (paired)
             {
-                if (bimapIt.value().find(path))
+                // 监视范围内的移动, 索引记录随文件迁移
+                uint64_t dev = 0;
+                const InodeRecord *pRecord = nullptr;
+                if (!moveOut.isDir && moveOut.ino != 0 && m_inodeIndex.dirDev(moveOut.wd, dev) &&
+                    (pRecord = m_inodeIndex.find(dev, moveOut.ino)) != nullptr && !pRecord->gone() &&
+                    pRecord->wd == moveOut.wd && pRecord->name == moveOut.name)
                 {
-                    inotify_rm_watch(m_inotifyFd, bimapIt.key().wd);
-                    bimapIt = tempBiMap.erase(bimapIt);
-                    continue;
+                    pNode->snapshot.insert(name, moveOut.ino, false);
+                    m_inodeIndex.update(dev, moveOut.ino, pInoEvent->wd, name, pRecord->size, pRecord->mtimeNs);
                 }
 
-                ++bimapIt;
-            }
+                m_eventBatch.pushMove(event | EV_IN_MOVE, pInoEvent->cookie, _batchPath(pNode), name,
+                                      moveOut.path, moveOut.name);
 
-            m_pathWithWd = std::move(tempBiMap);
-            // NOTE 此时迭代器it已失效, 无法继续使用
+                // 子树已挂到新位置, 暂存的事件按新路径输出在移动之后
+                if (!moveOut.held.empty())
+                {
+                    _parseEvent(moveOut.held.data(), moveOut.held.size(), true);
+                }
+                continue;
+            }
 
-            pMoveOut = nullptr;
-            moveOutItemIsDirFlag = false;
+            // 从监视范围外移入的文件可能是之前移出的文件或已知文件的硬链接
+            std::string fromPath, fromName;
+            uint32_t hint = isDirFlag ? 0 : _identifyFile(pNode, name, true, fromPath, fromName);
+            if (hint == EV_IN_MOVE)
+            {
+                m_eventBatch.pushMove(event | EV_IN_MOVE, pInoEvent->cookie, _batchPath(pNode), name,
+                                      fromPath, fromName);
+            }
+            else if (hint == EV_IN_COPY)
+            {
+                m_eventBatch.pushMove(event | EV_IN_MOVED_IN | EV_IN_COPY, pInoEvent->cookie, _batchPath(pNode), name,
+                                      fromPath, fromName);
+            }
+            else
+            {
+                m_eventBatch.pushStored(event | EV_IN_MOVED_IN, pInoEvent->cookie, _batchPath(pNode), name);
+            }
+            continue;
         }
     }
 
-    // 保留剩余数据
-    if (i < inotifyEventBuf.size())
-    {
-        const uint8_t *pBegin = inotifyEventBuf.const_data() + i;
-        size_t copySize = inotifyEventBuf.size() - i;
-        inotifyEventBuf.set(pBegin, copySize);
-    }
-    else
-    {
-        inotifyEventBuf.clear();
-    }
+    return i;
 }
 
 // void InotifyTool::_disassembleU32(uint32_t flag, uint32_t vec[U32_BITS])
@@ -807,8 +2685,10 @@ std::string Event2String(uint32_t ev)
     XXX(InotifyEvent::EV_IN_DELETE, IN_DELETE)                  \
     XXX(InotifyEvent::EV_IN_ERROR, IN_ONESHOT)                  \
     XXX(InotifyEvent::EV_IN_UNMOUNT, IN_UNMOUNT)                \
+    XXX(InotifyEvent::EV_IN_Q_OVERFLOW, IN_Q_OVERFLOW)          \
     XXX(InotifyEvent::EV_IN_IGNORED, IN_IGNORED)                \
     XXX(InotifyEvent::EV_IN_ISDIR, IN_ISDIR)                    \
+    XXX(InotifyEvent::EV_IN_COPY, 0)                            \
 
     const char *orStr = " | ";
 
@@ -14,11 +14,22 @@
 #include <set>
 #include <map>
 #include <memory>
-
-#include <utils/bimap.h>
-#include <utils/buffer.h>
+#include <atomic>
+#include <functional>
 
 #include "inotify_tool/inotify_tool_p.h"
+#include "inotify_tool/watch_tree.h"
+#include "inotify_tool/dir_walker.h"
+#include "inotify_tool/watcher_backend.h"
+#include "inotify_tool/event_batch.h"
+#include "inotify_tool/watch_budget.h"
+#include "inotify_tool/polling_scanner.h"
+#include "inotify_tool/ignore_matcher.h"
+#include "inotify_tool/snapshot_file.h"
+#include "inotify_tool/inode_index.h"
+#include "inotify_tool/event_dispatcher.h"
+#include "inotify_tool/histogram.h"
+#include "inotify_tool/event_log.h"
 
 #define U32_BITS (sizeof(uint32_t) * __CHAR_BIT__)
 
@@ -26,15 +37,81 @@ struct InotifyEventItem;
 
 namespace eular {
 
-class InotifyTool
+/**
+ * @brief 事件队列溢出后的重新同步方式
+ */
+enum class ResyncMode : uint32_t {
+    NONE,           // 不重新同步, 只输出EV_IN_Q_OVERFLOW
+    CHANGED_DIRS,   // 只读取mtime变化的目录, 并检查其中文件的mtime
+    ALL_DIRS,       // 读取所有目录并检查所有文件的mtime, 可发现mtime未变化的目录中的文件修改
+};
+
+struct ResyncStats
+{
+    uint64_t    count = 0;          // 重新同步次数
+    uint64_t    dirsChecked = 0;    // 检查mtime的目录数
+    uint64_t    dirsScanned = 0;    // 重新读取的目录数
+    uint64_t    fileStats = 0;      // 检查mtime的文件数
+    uint64_t    events = 0;         // 输出的合成事件数
+    uint64_t    elapsedMs = 0;      // 耗时
+};
+
+struct KernelEventStats
+{
+    uint64_t    events = 0;         // 从内核读取的事件数
+    uint64_t    ignored = 0;        // 读取后直接丢弃的事件数(IN_ACCESS/IN_OPEN/IN_CLOSE_NOWRITE/IN_ATTRIB等)
+    uint64_t    movedOutDropped = 0; // 目录移出监视范围后, 其子树中被丢弃的事件数
+    uint64_t    maskUpdates = 0;    // 订阅变化导致的watch掩码更新次数
+    uint64_t    wakeups = 0;        // 因inotify句柄可读而处理事件的次数
+    uint64_t    readCalls = 0;      // read系统调用次数
+    uint64_t    waitCalls = 0;      // waitCompleteEvent中等待的系统调用次数(poll, 批处理窗口中的ioctl/usleep)
+    uint64_t    bytes = 0;          // 读取的字节数
+    uint64_t    elapsedMs = 0;      // 自createInotify以来的毫秒数
+    double      syscallsPerEvent = 0;   // (readCalls + waitCalls) / events
+    double      wakeupsPerSec = 0;
+};
+
+/**
+ * @brief 运行统计, 可在任意线程查询. 计数在每次waitCompleteEvent/processEvent交付事件时更新
+ */
+struct InotifyStats
+{
+    size_t      watches = 0;        // 当前watch数
+    size_t      polledDirs = 0;     // 轮询的目录数
+    size_t      pendingModify = 0;  // 已修改但未关闭的文件数
+    size_t      pendingMoves = 0;   // 等待配对的IN_MOVED_FROM数
+    size_t      queuedEvents = 0;   // 已交付但未被取走的事件数
+    uint64_t    overflows = 0;      // 内核队列溢出次数
+    HistogramSnapshot parseNs;      // 每次read的解析耗时(纳秒)
+    HistogramSnapshot residenceNs;  // 事件从读出到交付的时间(纳秒), 不含在内核队列中的时间
+    HistogramSnapshot batchSize;    // 每次交付的事件数
+};
+
+struct ReplayStats
+{
+    uint64_t    records = 0;        // 重放的DATA记录数(即录制时的read次数)
+    uint64_t    bytes = 0;          // 重放的原始事件字节数
+    uint64_t    kernelEvents = 0;   // 解析的内核事件数
+    uint64_t    events = 0;         // 输出的事件数
+    uint64_t    elapsedNs = 0;      // 耗时, 实时重放时包含等待时间
+    double      kernelEventsPerSec = 0;
+    double      eventsPerSec = 0;
+};
+
+class InotifyTool : public WatcherBackend
 {
 public:
     typedef std::shared_ptr<InotifyTool> SP;
     typedef std::unique_ptr<InotifyTool> Ptr;
+    typedef std::function<void(const InotifyEventBatch &)> BatchCallback;
 
     InotifyTool() noexcept;
     ~InotifyTool() noexcept;
 
+    WatcherBackendType type() const override { return WatcherBackendType::INOTIFY; }
+    bool create() noexcept override { return createInotify(); }
+    void destroy() override { destroyInotify(); }
+
     /**
      * @brief 创建一个inotify句柄
      * 
@@ -83,7 +160,160 @@ public:
      * @param ev 事件
      * @return int32_t 成功返回0, 失败返回负值
      */
-    int32_t watchRecursive(const std::vector<std::string> &paths, uint32_t ev);
+    int32_t watchRecursive(const std::vector<std::string> &paths, uint32_t ev) override;
+
+    /**
+     * @brief 设置递归监视时遍历目录的线程数, 默认为CPU核数(最多8)
+     * 
+     * @param threads 线程数
+     */
+    void setWalkThreads(uint32_t threads);
+
+    /**
+     * @brief 获取上一次watchRecursive的遍历统计(目录数, 耗时, 每秒目录数)
+     * 
+     * @return DirWalkerStats 
+     */
+    DirWalkerStats getWalkStats() const;
+
+    /**
+     * @brief 设置溢出后的重新同步方式, 默认ResyncMode::CHANGED_DIRS. 需在监视前设置, 否则不会建立目录快照
+     * 溢出时先输出EV_IN_Q_OVERFLOW, 随后输出与快照比较得到的EV_IN_CREATE/EV_IN_DELETE/EV_IN_MODIFY_OVER
+     * 
+     * @param mode 方式
+     */
+    void setResyncMode(ResyncMode mode);
+
+    /**
+     * @brief 获取上一次重新同步的统计
+     * 
+     * @return ResyncStats 
+     */
+    ResyncStats getResyncStats() const;
+
+    /**
+     * @brief 设置inotify watch上限, 默认为max_user_watches的90%. 超出上限的子树降级为mtime轮询,
+     * 运行中活跃的轮询子树会升级为watch, 必要时将最不活跃的watch子树降级
+     * 
+     * @param watches 上限, 0表示按内核限制计算
+     */
+    void setWatchLimit(uint32_t watches);
+
+    /**
+     * @brief 获取内核限制(/proc/sys/fs/inotify/)
+     * 
+     * @return InotifyLimits 
+     */
+    InotifyLimits getInotifyLimits() const;
+
+    /**
+     * @brief 设置轮询间隔范围, 最大间隔即轮询子树的最大检测延迟
+     * 
+     * @param minIntervalMs 发现变化后的间隔
+     * @param maxIntervalMs 无变化时逐步加倍到的最大间隔
+     */
+    void setPollInterval(uint32_t minIntervalMs, uint32_t maxIntervalMs);
+
+    /**
+     * @brief 设置网络文件系统的轮询. 开启时(默认)watchRecursive按statfs判断根目录的文件系统,
+     * inotify无法感知远端修改的文件系统(NFS, SMB/CIFS, FUSE, Ceph, 9P等)上的根目录整体改为轮询,
+     * 输出与inotify相同的EV_IN_CREATE/EV_IN_DELETE/EV_IN_MODIFY_OVER. 这些子树不占用watch, 也不会升级为watch.
+     * 检测延迟还受客户端属性缓存(如NFS的actimeo)影响
+     * 
+     * @param enable 是否开启, 需在watchRecursive之前设置
+     * @param maxLatencyMs 检测延迟上限(扫描间隔加扫描耗时), 默认5000毫秒
+     */
+    void setRemotePolling(bool enable, uint32_t maxLatencyMs = 5000);
+
+    /**
+     * @brief 设置轮询扫描和遍历的线程数, 默认1
+     * 
+     * @param threads 线程数
+     */
+    void setPollThreads(uint32_t threads);
+
+    /**
+     * @brief 获取轮询统计
+     * 
+     * @return PollingScanner::Stats 
+     */
+    PollingScanner::Stats getPollingStats() const;
+
+    size_t getWatchCount() const;
+    size_t getPolledDirCount() const;
+
+    /**
+     * @brief 设置根目录的忽略规则(gitignore语法), 被忽略的目录不监视, 被忽略的项不产生事件.
+     * 应在watchRecursive之前设置, 之后设置不会解除已有的监视
+     * 
+     * @param path 根目录, 与watchRecursive的路径相同
+     * @param rules 规则, 每项一行, 替换已有规则
+     * @return int32_t 成功返回0, 规则无效返回INVALID_PARAM
+     */
+    int32_t setIgnoreRules(const std::string &path, const std::vector<std::string> &rules);
+
+    /**
+     * @brief 从文件(如.gitignore)读取根目录的忽略规则
+     * 
+     * @param path 根目录, 与watchRecursive的路径相同
+     * @param file 规则文件
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t loadIgnoreFile(const std::string &path, const std::string &file);
+
+    /**
+     * @brief 设置IN_MOVED_FROM等待配对IN_MOVED_TO的时间, 默认50毫秒. 配对成功输出一个EV_IN_MOVE事件(带原路径),
+     * 超时仍未配对视为移出监视范围, 输出EV_IN_MOVED_OUT
+     * 
+     * @param timeoutMs 超时时间(毫秒)
+     */
+    void setMovePairTimeout(uint32_t timeoutMs);
+
+    /**
+     * @brief 开启文件身份跟踪, 需在监视前设置. 维护监视范围内普通文件的(dev, inode)索引, 移入或新建的文件
+     * 与已知文件的inode, 大小和mtime一致时:
+     *  1、已知文件已移出监视范围(或等待配对中): 输出EV_IN_MOVE, fromPath/fromName为移出前的位置
+     *  2、已知文件仍在原位置(硬链接): 事件附加EV_IN_COPY, fromPath/fromName为已知文件
+     * 遍历时需要stat每个文件, 轮询中的子树不参与
+     * 
+     * @param enable 是否开启
+     * @param tombstoneTtlMs 移出监视范围的文件保留多久
+     */
+    void setIdentityTracking(bool enable, uint32_t tombstoneTtlMs = 10 * 60 * 1000);
+
+    /**
+     * @brief 将递归监视的目录树(wd以外的部分: 目录名, 事件, 快照)保存到文件, 用于重启后快速恢复.
+     * 轮询中的子树不保存, 恢复时重新遍历
+     * 
+     * @param file 文件路径
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t saveSnapshot(const std::string &file);
+
+    /**
+     * @brief 读取快照文件, 之后watchRecursive监视快照中的根目录时按快照直接添加watch而不遍历,
+     * 并比较mtime变化的目录, 以EV_IN_CREATE/EV_IN_DELETE/EV_IN_MODIFY_OVER输出离线期间的变化
+     * 
+     * @param file 文件路径
+     * @return int32_t 成功返回0, 文件不存在返回NAME_NOT_FOUND, 文件损坏返回UNKNOWN_ERROR
+     */
+    int32_t loadSnapshot(const std::string &file);
+
+    /**
+     * @brief 设置自动保存的快照文件, 有新事件时在waitCompleteEvent/processEvent中按间隔保存,
+     * destroyInotify时也会保存
+     * 
+     * @param file 文件路径, 空表示不自动保存
+     * @param intervalMs 保存间隔
+     */
+    void setSnapshotFile(const std::string &file, uint32_t intervalMs);
+
+    /**
+     * @brief 获取从快照恢复时的比较统计
+     * 
+     * @return ResyncStats 
+     */
+    ResyncStats getRestoreStats() const;
 
     /**
      * @brief 未实现
@@ -98,21 +328,139 @@ public:
      * @param timeout 超时时间
      * @return int32_t 成功返回0, 超时返回TIMED_OUT, 失败返回其他负值
      */
-    int32_t waitCompleteEvent(uint32_t timeout);
+    int32_t waitCompleteEvent(uint32_t timeout) override;
+
+    /**
+     * @brief 获取inotify句柄, 用于注册到hv::EventLoop或epoll中(可读时调用processEvent)
+     * 
+     * @return int32_t 未创建时返回-1
+     */
+    int32_t fd() const override;
+
+    /**
+     * @brief 距离下一个定时任务(轮询扫描, IN_MOVED_FROM配对超时, 自动保存快照)的毫秒数,
+     * 事件驱动模式下应在此时间后调用processEvent
+     * 
+     * @return int64_t 有未取走的事件(如从快照恢复时产生)返回0, 没有定时任务时返回-1
+     */
+    int64_t nextTimeout() const override;
+
+    /**
+     * @brief 设置事件回调, 设置后processEvent解析出的事件批量投递给回调, 不再进入事件队列
+     * 
+     * @param cb 回调
+     */
+    void setEventCallback(EventCallback cb) override;
+
+    /**
+     * @brief 非阻塞读取并解析当前所有可读事件, 用于异步模式(fd可读时调用)
+     * 
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t processEvent() override;
+
+    /**
+     * @brief 设置批次回调, 优先于EventCallback. 批次只在回调期间有效, 不产生额外内存分配
+     * 
+     * @param cb 回调
+     */
+    void setBatchCallback(BatchCallback cb);
+
+    /**
+     * @brief 订阅事件. 每批事件只解析一次, 在waitCompleteEvent/processEvent返回前按前缀和事件过滤分发给所有订阅者,
+     * 多个使用者(同步, 索引, 界面)可共享同一组inotify watch. 分发不影响getEventBatch和回调,
+     * 但有订阅者且未设置回调时, processEvent分发后直接清空批次. 订阅的事件超出已有watch的掩码时以IN_MASK_ADD扩展,
+     * 因此需与watchRecursive在同一线程调用
+     * 
+     * @param options 前缀, 事件, 队列容量和溢出处理
+     * @param cb 回调, 在调用processEvent/waitCompleteEvent的线程中执行. 为空时事件进入订阅者的有界队列
+     * @return Subscription::SP 
+     */
+    Subscription::SP subscribe(const SubscribeOptions &options, Subscription::Callback cb = nullptr);
+
+    /**
+     * @brief 取消订阅, 唤醒阻塞在Subscription::wait中的线程
+     * 
+     * @param subscription 
+     * @return true 成功
+     * @return false 不存在
+     */
+    bool unsubscribe(const Subscription::SP &subscription);
+
+    /**
+     * @brief 设置waitCompleteEvent的批处理窗口. 被事件唤醒后让事件在内核队列中累积, 直到超过windowMs或
+     * 累积约maxEvents个事件(按字节数估算)才一次读取, 突发时一次唤醒处理整个突发. 窗口越大系统调用越少,
+     * 但首个事件的延迟越高, 且窗口内的事件数不能超过max_queued_events
+     * 
+     * @param windowMs 窗口毫秒数, 0表示不等待(默认)
+     * @param maxEvents 批次事件数上限, 0表示只受时间限制
+     */
+    void setBatchWindow(uint32_t windowMs, uint32_t maxEvents);
+
+    /**
+     * @brief 获取运行统计(watch数, 积压数, 溢出次数, 解析耗时/驻留时间/批次大小直方图), 可在其他线程调用
+     * 
+     * @return InotifyStats 
+     */
+    InotifyStats getStats() const;
+
+    /**
+     * @brief 获取内核事件统计, ignored占比反映掩码是否足够精确, syscallsPerEvent/wakeupsPerSec用于调整批处理窗口
+     * 
+     * @return KernelEventStats 
+     */
+    KernelEventStats getKernelEventStats() const;
+
+    /**
+     * @brief 开始录制: 写入当前的watch表, 之后每次read返回的原始字节和新增的watch都追加到文件中.
+     * 快照, 忽略规则和轮询子树不录制
+     * 
+     * @param file 录制文件, 已存在时覆盖
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t startRecording(const std::string &file);
+    void stopRecording();
+    bool isRecording() const { return m_eventLog.isOpen(); }
+
+    /**
+     * @brief 重放录制文件, 不访问文件系统也不需要inotify句柄, 用于确定性地测试和比较解析器.
+     * 每条DATA记录按录制时的顺序解析, 配对超时使用录制时的时间; 每批事件交付订阅者后传给cb.
+     * 需在未监视任何路径时调用, 重放结束后清空监视树. 忽略规则需在重放前按录制时的根目录设置
+     * 
+     * @param file 录制文件
+     * @param realtime 是否按录制时的时间间隔重放, 否则尽快重放
+     * @param cb 批次回调, 可为空
+     * @return int32_t 成功返回0, 文件不存在返回NAME_NOT_FOUND, 文件损坏返回UNKNOWN_ERROR, 已有监视返回INVALID_OPERATION
+     */
+    int32_t replay(const std::string &file, bool realtime, const BatchCallback &cb);
+
+    /**
+     * @brief 获取上一次重放的统计
+     * 
+     * @return ReplayStats 
+     */
+    ReplayStats getReplayStats() const;
 
     /**
-     * @brief 获取产生的事件
+     * @brief 获取产生的事件(转换为InotifyEventItem, 会分配内存)
      * 
      * @param eventItemVec 
      */
-    void getEventItem(std::list<InotifyEventItem> &eventItemVec);
+    void getEventItem(std::list<InotifyEventItem> &eventItemVec) override;
+
+    /**
+     * @brief 获取产生的事件批次, 无拷贝. 返回的批次在下一次waitCompleteEvent/processEvent前有效
+     * 
+     * @return const InotifyEventBatch& 
+     */
+    const InotifyEventBatch &getEventBatch();
 
     /**
      * @brief 获取错误码
      * 
      * @return int32_t 
      */
-    int32_t getLastError();
+    int32_t getLastError() override;
 
     /**
      * @brief 错误码转成字符串
@@ -139,6 +487,23 @@ protected:
      */
     uint32_t realInotifyEv2InotifyEvent(uint32_t ev) const noexcept;
 
+    /**
+     * @brief 计算watch的内核掩码: 请求的事件和订阅者的事件, 加上维护目录树/快照/索引所需的最少事件
+     * 
+     * @param ev 监视时请求的事件
+     * @param isDir 是否目录
+     * @param recursion 是否递归监视
+     * @return uint32_t inotify_add_watch的mask
+     */
+    uint32_t _kernelMask(uint32_t ev, bool isDir, bool recursion) const noexcept;
+
+    /**
+     * @brief 订阅者的事件并集变化后更新所有watch的掩码, 增加时使用IN_MASK_ADD, 减少时替换
+     * 
+     * @param grow 是否只增加
+     */
+    void _updateKernelMasks(bool grow);
+
     /**
      * @brief 是否目录
      * 
@@ -158,25 +523,329 @@ protected:
     /**
      * @brief 递归监视目录
      * 
-     * @param infoList 信息
+     * @param entryList 收集到的监视项, 父目录在子目录之前
+     * @param parentWd 父目录wd, 监视根目录时为-1
+     * @param name 目录名, 监视根目录时为完整路径
      * @param path 监控路径
      * @param ev 事件
+     * @param threads 遍历线程数
      * @return true 成功
      * @return false 失败
      */
-    bool _watchRecursive(std::list<std::pair<std::string, InotifyInfo>> &infoList,
-                         const std::string &path, uint32_t ev);
+    bool _watchRecursive(std::list<WatchEntry> &entryList, int32_t parentWd,
+                         const std::string &name, const std::string &path, uint32_t ev,
+                         uint32_t threads = 1);
 
-    void _parseEvent(ByteBuffer &inotifyEventBuf);
+    /**
+     * @brief 合并监视项到监视树, 录制中时同时写入WATCH记录
+     * 
+     * @param entryList 监视项, 父目录在子目录之前
+     */
+    void _mergeWatches(std::list<WatchEntry> &entryList);
+
+    /**
+     * @brief 重放时按WATCH记录添加节点
+     * 
+     * @param watch 录制的watch
+     */
+    void _replayWatch(const EventLogWatch &watch);
+
+    /**
+     * @brief 将目录中的普通文件加入inode索引
+     * 
+     * @param wd 目录wd
+     * @param path 目录路径, 以'/'结尾
+     * @param snapshot 目录快照
+     */
+    void _indexDir(int32_t wd, const std::string &path, const DirSnapshot &snapshot);
+
+    /**
+     * @brief 新建或移入的文件与inode索引比较并更新索引
+     * 
+     * @param node 所在目录
+     * @param name 文件名
+     * @param movedIn 是否移入
+     * @param fromPath 输出原所在目录
+     * @param fromName 输出原文件名
+     * @return uint32_t EV_IN_MOVE, EV_IN_COPY或0
+     */
+    uint32_t _identifyFile(WatchNode *node, std::string_view name, bool movedIn,
+                           std::string &fromPath, std::string &fromName);
+
+    /**
+     * @brief 查找路径所属根目录的忽略规则
+     * 
+     * @param path 绝对路径
+     * @return const IgnoreMatcher* 没有规则返回nullptr
+     */
+    const IgnoreMatcher *_findIgnore(const std::string &path) const;
+
+    /**
+     * @brief 目录下的项是否被忽略, 只有路径规则才拼接目录路径
+     * 
+     * @param node 所在目录
+     * @param name 文件/目录名
+     * @param isDir 是否目录
+     * @return true 被忽略
+     */
+    bool _ignored(const WatchNode *node, std::string_view name, bool isDir);
+
+    /**
+     * @brief 根目录位于网络文件系统时改为固定轮询
+     * 
+     * @param path 根目录, 以'/'结尾
+     * @param ev 事件
+     * @param status 输出轮询的结果
+     * @return true 已改为轮询
+     * @return false 本地文件系统或未开启
+     */
+    bool _pollRemoteRoot(const std::string &path, uint32_t ev, int32_t &status);
+
+    /**
+     * @brief 解除节点及其子树的监视
+     * 
+     * @param node 节点
+     */
+    void _unwatchTree(WatchNode *node);
+
+    /**
+     * @brief 获取节点路径在当前批次内存池中的视图, 同一目录的连续事件只拷贝一次
+     * 
+     * @param node 节点
+     * @return std::string_view 
+     */
+    std::string_view _batchPath(const WatchNode *node);
+
+    /**
+     * @brief 事件队列溢出后与目录快照比较, 输出丢失事件的净效果
+     * 
+     */
+    void _resync();
+
+    /**
+     * @brief 重新读取目录并与快照比较, 输出m_consistentNs之后变化的事件
+     * 
+     * @param mode 方式, 不能为NONE
+     * @param rootVec 只比较这些子树, 为空时比较所有目录
+     * @return ResyncStats 统计(不含count)
+     */
+    ResyncStats _compareSnapshot(ResyncMode mode, const std::vector<WatchNode *> &rootVec);
+
+    struct RestoreDir
+    {
+        int32_t     parentWd;
+        std::string name;
+        std::string path;
+    };
+
+    /**
+     * @brief 按快照中的根目录记录添加watch, 不遍历目录
+     * 
+     * @param entryList 收集到的监视项
+     * @param missingVec 输出快照中没有记录(如曾被轮询)的子目录, 需要重新遍历
+     * @param rootIdx 根目录在m_persistedDirs中的序号
+     * @param ev 事件
+     * @return true 成功
+     * @return false 根目录无法按快照恢复, 需要重新遍历
+     */
+    bool _restoreTree(std::list<WatchEntry> &entryList, std::vector<RestoreDir> &missingVec,
+                      size_t rootIdx, uint32_t ev);
+
+    /**
+     * @brief 计算快照中一个根目录下各目录的路径
+     * 
+     * @param rootIdx 根目录在m_persistedDirs中的序号
+     * @param pathVec 输出路径, 与m_persistedDirs[rootIdx, 返回值)一一对应, 父目录无效时为空
+     * @return size_t 下一个根目录的序号
+     */
+    size_t _persistedPaths(size_t rootIdx, std::vector<std::string> &pathVec) const;
+
+    /**
+     * @brief 根目录无法按快照恢复而重新遍历后, 将快照放入inode未变的目录节点, 以便与快照比较
+     * 
+     * @param rootIdx 根目录在m_persistedDirs中的序号
+     * @param complete 输出是否所有目录都能与快照比较, 降级为轮询的目录无法比较
+     * @return WatchNode* 根目录节点, 根目录未被inotify监视或已被替换时返回nullptr
+     */
+    WatchNode *_adoptSnapshot(size_t rootIdx, bool &complete);
+
+    /**
+     * @brief 等待配对的IN_MOVED_FROM
+     */
+    struct PendingMove
+    {
+        int32_t     wd = -1;    // 所在目录的wd
+        bool        isDir = false;
+        uint64_t    ino = 0;    // 快照中的inode, 0表示未知
+        std::string path;       // 所在目录, 以'/'结尾
+        std::string name;
+        uint64_t    deadlineMs = 0; // 超时的单调时钟毫秒
+        std::vector<uint8_t> held;  // 目录配对前其子树中的原始事件, 配对后按新路径重新解析, 超时丢弃
+    };
+
+    /**
+     * @brief 输出超时未配对的IN_MOVED_FROM
+     * 
+     * @param nowMs 单调时钟毫秒
+     */
+    void _expireMoves(uint64_t nowMs);
+
+    /**
+     * @brief 输出同一目录下同名的未配对IN_MOVED_FROM, 保证其先于该名字的后续事件
+     * 
+     * @param wd 目录wd
+     * @param name 文件/目录名
+     */
+    void _flushMove(int32_t wd, std::string_view name);
+
+    /**
+     * @brief 查找子树包含pNode的未配对目录IN_MOVED_FROM. 此时目录可能已移出监视范围, 其子树中的事件需暂存
+     * 
+     * @param pNode 事件所在目录
+     * @return PendingMove* 没有返回nullptr
+     */
+    PendingMove *_pendingDirMove(const WatchNode *pNode);
+
+    /**
+     * @brief 输出一个未配对的IN_MOVED_FROM, 目录移出监视范围时解除其监视并丢弃暂存的子树事件
+     * 
+     * @param cookie 事件的cookie
+     * @param move 等待配对的事件
+     */
+    void _emitMovedOut(uint32_t cookie, const PendingMove &move);
+
+    /**
+     * @brief 距离最早的IN_MOVED_FROM超时的毫秒数
+     * 
+     * @param nowMs 单调时钟毫秒
+     * @return int64_t 没有等待配对的事件返回-1
+     */
+    int64_t _nextMoveTimeout(uint64_t nowMs) const;
+
+    /**
+     * @brief 距离下一次自动保存快照的毫秒数
+     * 
+     * @param nowMs 单调时钟毫秒
+     * @return int64_t 未设置自动保存或没有新事件时返回-1
+     */
+    int64_t _nextSnapshotTimeout(uint64_t nowMs) const;
+
+    /**
+     * @brief 距上次保存超过间隔且有新事件时保存快照
+     * 
+     * @param nowMs 单调时钟毫秒
+     */
+    void _autoSnapshot(uint64_t nowMs);
+
+    /**
+     * @brief 交付批次中的新事件: 记录交付时间和直方图, 分发给订阅者, 更新统计
+     */
+    void _publish();
+    void _updateGauges();
+
+    /**
+     * @brief 轮询到期的子树, 并根据活跃度调整watch分配
+     * 
+     * @param nowMs 单调时钟毫秒
+     */
+    void _pollScan(uint64_t nowMs);
+    void _rebalance(uint64_t nowMs);
+
+    /**
+     * @brief 将不活跃的watch子树降级为轮询
+     * 
+     * @param needed 需要释放的watch数
+     * @param exclude 不能降级的路径(待升级子树)
+     * @param nowMs 单调时钟毫秒
+     * @return size_t 释放的watch数
+     */
+    size_t _demoteColdest(size_t needed, const std::string &exclude, uint64_t nowMs);
+
+    /**
+     * @brief 非阻塞读取inotify句柄并解析事件
+     * 
+     * @param drain 是否读到EAGAIN. 否则读取未填满缓冲区即认为已读空, 省去一次read,
+     *              只能用于水平触发的poll(剩余事件会再次唤醒)
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t _readEvent(bool drain = true);
+
+    /**
+     * @brief 批处理窗口内继续等待并读取事件
+     * 
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t _batchWindow();
+
+    /**
+     * @brief 解析缓冲区中的事件
+     * 
+     * @param data 缓冲区
+     * @param size 数据长度
+     * @param held 是否为目录移动配对后重放的暂存事件, 读取时已统计
+     * @return size_t 已解析的字节数, 末尾不完整的事件不解析
+     */
+    size_t _parseEvent(const uint8_t *data, size_t size, bool held = false);
 
 private:
     bool            m_recursion;     // 是否递归监控子目录
     int32_t         m_inotifyFd;     // Inotify文件描述符
     int32_t         m_errorCode;     // 错误码
-    ByteBuffer      m_inotifyBuffer; // inotify缓冲区
-    std::list<InotifyEventItem>     m_eventItemQueue; // 事件队列
-    std::set<std::string>           m_fileModifySet;  // 文件被修改集合
-    BiMap<InotifyInfo, std::string> m_pathWithWd;     // 目录/文件和wd句柄的双向映射
+    uint32_t        m_walkThreads;   // 递归监视的遍历线程数
+    DirWalkerStats  m_walkStats;     // 上一次递归监视的遍历统计
+    std::unique_ptr<uint8_t[]> m_readBuffer; // read直接写入的缓冲区
+    size_t          m_readUsed;      // 缓冲区开头未解析的字节数(不完整的事件)
+    uint32_t        m_batchWindowMs;
+    uint32_t        m_batchMaxEvents;
+    uint64_t        m_statsBeginMs;  // 统计开始的单调时钟毫秒
+    EventCallback   m_eventCallback; // 异步模式下的事件回调
+    BatchCallback   m_batchCallback; // 异步模式下的批次回调
+    EventDispatcher m_dispatcher;    // 订阅者
+    uint32_t        m_subscribedEv;  // 订阅者事件的并集, 参与计算内核掩码
+    KernelEventStats m_kernelStats;
+
+    struct Gauges
+    {
+        std::atomic<size_t>     watches{0};
+        std::atomic<size_t>     polledDirs{0};
+        std::atomic<size_t>     pendingModify{0};
+        std::atomic<size_t>     pendingMoves{0};
+        std::atomic<size_t>     queuedEvents{0};
+        std::atomic<uint64_t>   overflows{0};
+    };
+    Gauges          m_gauges;
+    Log2Histogram   m_parseHistogram;
+    Log2Histogram   m_residenceHistogram;
+    Log2Histogram   m_batchSizeHistogram;
+    bool            m_batchTaken;    // 批次已通过getEventBatch取走
+    std::string     m_pathScratch;   // 拼接路径的临时缓冲, 复用容量
+    InotifyEventBatch               m_eventBatch;     // 事件批次
+    ModifySet                       m_modifySet;      // 文件被修改集合(wd, 文件名哈希)
+    ResyncMode      m_resyncMode;    // 溢出后的重新同步方式
+    ResyncStats     m_resyncStats;   // 上一次重新同步的统计
+    bool            m_overflowPending; // 读取到溢出事件, 读完后重新同步
+    int64_t         m_consistentNs;  // 此时间(CLOCK_REALTIME)之前的修改都已上报
+    uint32_t        m_moveTimeoutMs; // IN_MOVED_FROM等待配对的时间
+    std::map<uint32_t, PendingMove> m_pendingMoveMap; // cookie -> 等待配对的IN_MOVED_FROM, 跨越多次读取
+    bool            m_identityTracking; // 是否维护inode索引
+    InodeIndex      m_inodeIndex;    // (dev, inode) -> 文件位置
+    WatchBudget     m_watchBudget;   // watch预算与目录活跃度
+    PollingScanner  m_pollingScanner; // 超出预算的子树和网络文件系统上的根目录
+    bool            m_remotePolling; // 网络文件系统上的根目录改为轮询
+    uint32_t        m_remoteLatencyMs; // 网络文件系统的检测延迟上限
+    std::map<std::string, std::unique_ptr<IgnoreMatcher>> m_ignoreMap; // 根目录 -> 忽略规则, 节点保存其指针
+    std::vector<PersistedDir>       m_persistedDirs;  // 读取的快照, 按根目录连续存放
+    int64_t         m_persistedNs;   // 快照的一致点
+    ResyncStats     m_restoreStats;  // 从快照恢复时的比较统计
+    std::string     m_snapshotFile;  // 自动保存的快照文件
+    uint32_t        m_snapshotIntervalMs; // 自动保存间隔
+    uint64_t        m_snapshotMs;    // 上次保存的单调时钟毫秒
+    int64_t         m_snapshotNs;    // 上次保存的一致点
+    EventLogWriter  m_eventLog;      // 录制文件
+    bool            m_replaying;     // 重放中, 不访问文件系统
+    uint64_t        m_replayNowMs;   // 重放时的虚拟时钟(录制时的单调时钟毫秒)
+    ReplayStats     m_replayStats;   // 上一次重放的统计
+    WatchTree                       m_watchTree;      // wd与路径的前缀树索引
 };
 
 } // namespace eular
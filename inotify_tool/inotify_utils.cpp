@@ -12,6 +12,12 @@
 
 #include <utils/sysdef.h>
 
+#include <time.h>
+
+#ifdef OS_LINUX
+#include <sys/vfs.h>
+#endif
+
 namespace eular {
 namespace utils {
 
@@ -42,6 +48,68 @@ void StringReplace(std::string &opStr, const std::string &from, const std::strin
     }
 }
 
+int64_t RealtimeNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t MonotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+uint64_t MonotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+bool IsRemoteFs(const std::string &path, std::string &fsType)
+{
+    // linux/magic.h中的f_type, 部分旧内核头文件没有定义
+    static const struct {
+        uint32_t    magic;
+        const char *name;
+    } remoteFsTable[] = {
+        {0x00006969, "nfs"},
+        {0x0000517B, "smb"},
+        {0xFF534D42, "cifs"},
+        {0xFE534D42, "smb2"},
+        {0x65735546, "fuse"},
+        {0x00C36400, "ceph"},
+        {0x01021997, "9p"},
+        {0x5346414F, "afs"},
+        {0x73757245, "coda"},
+        {0x0000564C, "ncp"},
+        {0x0BD00BD0, "lustre"},
+        {0x01161970, "gfs2"},
+        {0x7461636F, "ocfs2"},
+    };
+
+    struct statfs fsStat;
+    if (statfs(path.c_str(), &fsStat) != 0)
+    {
+        return false;
+    }
+
+    uint32_t magic = static_cast<uint32_t>(fsStat.f_type);
+    for (const auto &it : remoteFsTable)
+    {
+        if (it.magic == magic)
+        {
+            fsType = it.name;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 } // namespace utils
 } // namespace eular
 
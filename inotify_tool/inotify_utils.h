@@ -8,6 +8,7 @@
 #ifndef __INOTIFY_TOOL_UTILS_H__
 #define __INOTIFY_TOOL_UTILS_H__
 
+#include <stdint.h>
 #include <string>
 
 namespace eular {
@@ -24,6 +25,36 @@ void CorrectionPath(std::string &item);
  */
 void StringReplace(std::string &opStr, const std::string &from, const std::string &to);
 
+/**
+ * @brief CLOCK_REALTIME纳秒, 与文件mtime可比较
+ * 
+ * @return int64_t 
+ */
+int64_t RealtimeNs();
+
+/**
+ * @brief CLOCK_MONOTONIC毫秒, 用于定时
+ * 
+ * @return uint64_t 
+ */
+uint64_t MonotonicMs();
+
+/**
+ * @brief CLOCK_MONOTONIC纳秒, 用于耗时统计
+ * 
+ * @return uint64_t 
+ */
+uint64_t MonotonicNs();
+
+/**
+ * @brief 路径是否位于inotify无法感知远端修改的文件系统上(NFS, SMB/CIFS, FUSE, Ceph, 9P等), 按statfs的f_type判断
+ * 
+ * @param path 路径
+ * @param fsType 输出文件系统名, 非此类文件系统时不修改
+ * @return true 是
+ */
+bool IsRemoteFs(const std::string &path, std::string &fsType);
+
 } // namespace utils
 } // namespace eular
 
@@ -0,0 +1,497 @@
+/*************************************************************************
+    > File Name: polling_scanner.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 19时24分11秒
+ ************************************************************************/
+
+#include "inotify_tool/polling_scanner.h"
+#include "inotify_tool/dir_walker.h"
+#include "inotify_tool/watch_budget.h"
+#include "inotify_tool/inotify_utils.h"
+#include "inotify_tool/ignore_matcher.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <thread>
+
+#include <utils/sysdef.h>
+#include <utils/errors.h>
+#include <log/log.h>
+
+#ifdef OS_LINUX
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define LOG_TAG "Polling-scanner"
+
+#define DEFAULT_HALF_LIFE_MS    (10 * 60 * 1000)
+#define RECORD_IGNORED          1   // 被忽略的目录, 不加入子树
+#define PARALLEL_MIN_DIRS       32  // 子树目录数超过此值才多线程检查
+
+namespace eular {
+
+static bool HasPrefix(const std::string &str, const std::string &prefix)
+{
+    return str.compare(0, prefix.length(), prefix) == 0;
+}
+
+PollingScanner::PollingScanner(uint32_t minIntervalMs, uint32_t maxIntervalMs) :
+    m_minIntervalMs(1000),
+    m_maxIntervalMs(30000),
+    m_halfLifeMs(DEFAULT_HALF_LIFE_MS),
+    m_scanThreads(1)
+{
+    setInterval(minIntervalMs, maxIntervalMs);
+}
+
+void PollingScanner::setInterval(uint32_t minIntervalMs, uint32_t maxIntervalMs)
+{
+    m_minIntervalMs = minIntervalMs > 0 ? minIntervalMs : 1;
+    m_maxIntervalMs = std::max(maxIntervalMs, m_minIntervalMs);
+    for (auto &it : m_subtreeMap)
+    {
+        it.second.intervalMs = std::min(std::max(it.second.intervalMs, m_minIntervalMs), m_maxIntervalMs);
+    }
+}
+
+int32_t PollingScanner::add(const std::string &path, uint32_t ev, bool isRoot, uint64_t nowMs,
+                            const IgnoreMatcher *ignore, uint32_t latencyMs)
+{
+    if (path.empty() || path.back() != '/')
+    {
+        return INVALID_PARAM;
+    }
+
+    if (contains(path))
+    {
+        return ALREADY_EXISTS;
+    }
+
+    Subtree subtree;
+    subtree.ev = ev;
+    subtree.isRoot = isRoot;
+    subtree.intervalMs = m_minIntervalMs;
+    subtree.nextScanMs = nowMs + m_minIntervalMs;
+    subtree.activity = 0;
+    subtree.activityMs = nowMs;
+    subtree.ignore = ignore;
+    subtree.latencyMs = latencyMs;
+    subtree.scanMs = 0;
+
+    int32_t status = _load(path, ignore, subtree.dirMap);
+    if (status != NO_ERROR)
+    {
+        LOGE("load %s error. [%d, %s]", path.c_str(), -status, strerror(-status));
+        return status;
+    }
+
+    // 合并嵌套的子树
+    for (auto it = m_subtreeMap.lower_bound(path); it != m_subtreeMap.end() && HasPrefix(it->first, path); )
+    {
+        subtree.isRoot = subtree.isRoot || it->second.isRoot;
+        if (it->second.latencyMs > 0 && (subtree.latencyMs == 0 || it->second.latencyMs < subtree.latencyMs))
+        {
+            subtree.latencyMs = it->second.latencyMs;
+        }
+        it = m_subtreeMap.erase(it);
+    }
+
+    LOGI("poll %s: %zu directories%s", path.c_str(), subtree.dirMap.size(), subtree.latencyMs > 0 ? " (pinned)" : "");
+    m_subtreeMap[path] = std::move(subtree);
+    return NO_ERROR;
+}
+
+bool PollingScanner::remove(const std::string &path)
+{
+    bool removed = false;
+    for (auto it = m_subtreeMap.lower_bound(path); it != m_subtreeMap.end() && HasPrefix(it->first, path); )
+    {
+        it = m_subtreeMap.erase(it);
+        removed = true;
+    }
+
+    return removed;
+}
+
+bool PollingScanner::contains(const std::string &path) const
+{
+    // 包含path的子树根目录不大于path
+    auto it = m_subtreeMap.upper_bound(path);
+    if (it == m_subtreeMap.begin())
+    {
+        return false;
+    }
+
+    --it;
+    return HasPrefix(path, it->first) || it->first == path + "/";
+}
+
+size_t PollingScanner::dirCount() const
+{
+    size_t count = 0;
+    for (const auto &it : m_subtreeMap)
+    {
+        count += it.second.dirMap.size();
+    }
+
+    return count;
+}
+
+int64_t PollingScanner::nextTimeout(uint64_t nowMs) const
+{
+    int64_t timeout = -1;
+    for (const auto &it : m_subtreeMap)
+    {
+        int64_t remain = it.second.nextScanMs > nowMs ? static_cast<int64_t>(it.second.nextScanMs - nowMs) : 0;
+        if (timeout < 0 || remain < timeout)
+        {
+            timeout = remain;
+        }
+    }
+
+    return timeout;
+}
+
+uint32_t PollingScanner::scan(uint64_t nowMs, InotifyEventBatch &batch)
+{
+    uint32_t events = 0;
+    for (auto it = m_subtreeMap.begin(); it != m_subtreeMap.end(); )
+    {
+        Subtree &subtree = it->second;
+        if (subtree.nextScanMs > nowMs)
+        {
+            ++it;
+            continue;
+        }
+
+        uint64_t scanBeginMs = utils::MonotonicMs();
+        int32_t count = _scanSubtree(it->first, subtree, batch);
+        subtree.scanMs = utils::MonotonicMs() - scanBeginMs;
+        m_stats.lastScanMs = subtree.scanMs;
+        m_stats.maxScanMs = std::max(m_stats.maxScanMs, subtree.scanMs);
+        if (count < 0)
+        {
+            // 根目录被删除或移走, 由父目录的watch输出事件
+            LOGI("polling subtree %s removed", it->first.c_str());
+            it = m_subtreeMap.erase(it);
+            continue;
+        }
+
+        subtree.activity = WatchBudget::Decay(subtree.activity, nowMs > subtree.activityMs ? nowMs - subtree.activityMs : 0, m_halfLifeMs);
+        subtree.activityMs = nowMs;
+        if (count > 0)
+        {
+            subtree.activity += 1;
+            subtree.intervalMs = m_minIntervalMs;
+        }
+        else
+        {
+            subtree.intervalMs = std::min(subtree.intervalMs * 2, m_maxIntervalMs);
+        }
+
+        // 变化最晚在下一次扫描结束时发现, 间隔需为扫描耗时留出余量
+        if (subtree.latencyMs > 0)
+        {
+            uint64_t maxIntervalMs = subtree.latencyMs > subtree.scanMs ? subtree.latencyMs - subtree.scanMs : 0;
+            subtree.intervalMs = static_cast<uint32_t>(std::min<uint64_t>(subtree.intervalMs, maxIntervalMs));
+            subtree.intervalMs = std::max(subtree.intervalMs, std::min(m_minIntervalMs, subtree.latencyMs));
+            if (subtree.scanMs >= subtree.latencyMs)
+            {
+                LOGW("scan %s took %" PRIu64 " ms, exceeds latency bound %u ms", it->first.c_str(),
+                    subtree.scanMs, subtree.latencyMs);
+            }
+        }
+
+        subtree.nextScanMs = nowMs + subtree.intervalMs;
+        events += count;
+        ++it;
+    }
+
+    return events;
+}
+
+void PollingScanner::subtrees(uint64_t nowMs, std::vector<SubtreeInfo> &subtreeVec) const
+{
+    subtreeVec.clear();
+    for (const auto &it : m_subtreeMap)
+    {
+        const Subtree &subtree = it.second;
+        uint64_t elapsedMs = nowMs > subtree.activityMs ? nowMs - subtree.activityMs : 0;
+        subtreeVec.push_back({it.first, subtree.ev, subtree.isRoot, subtree.dirMap.size(),
+                              WatchBudget::Decay(subtree.activity, elapsedMs, m_halfLifeMs), subtree.latencyMs > 0});
+    }
+
+    std::sort(subtreeVec.begin(), subtreeVec.end(), [] (const SubtreeInfo &left, const SubtreeInfo &right) {
+        return left.activity > right.activity;
+    });
+}
+
+int32_t PollingScanner::_load(const std::string &path, const IgnoreMatcher *ignore, std::map<std::string, PolledDir> &dirMap)
+{
+    DirWalker::Visitor visitor = [ignore] (DirWalker::Record &record) -> int32_t {
+        if (ignore != nullptr && ignore->ignored(record.path, true))
+        {
+            record.userData = RECORD_IGNORED;
+            return WALK_SKIP;
+        }
+
+        return WALK_CONTINUE;
+    };
+
+    std::vector<DirWalker::Record> records;
+    DirWalker walker(m_scanThreads, true);
+    int32_t status = walker.walk(path, path, visitor, records);
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    std::vector<std::map<std::string, PolledDir>::iterator> dirVec;
+    dirVec.reserve(records.size());
+    for (auto &record : records)
+    {
+        if (record.userData == RECORD_IGNORED)
+        {
+            continue;
+        }
+
+        PolledDir dir;
+        dir.snapshot = std::move(record.snapshot);
+        dirVec.push_back(dirMap.insert_or_assign(record.path, std::move(dir)).first);
+    }
+
+    // 记录文件的初始状态, 之后的扫描与其比较. 遍历后目录已变化的保留遍历时的快照, 由下一次扫描输出差异
+    std::vector<DirCheck> checkVec(dirVec.size());
+    _parallelFor(dirVec.size(), [&] (size_t i) {
+        _checkDir(dirVec[i]->first, dirVec[i]->second, ignore, checkVec[i]);
+    });
+
+    for (size_t i = 0; i < dirVec.size(); ++i)
+    {
+        if (checkVec[i].status == NO_ERROR && !checkVec[i].scanned)
+        {
+            dirVec[i]->second.files = std::move(checkVec[i].files);
+        }
+    }
+
+    return NO_ERROR;
+}
+
+void PollingScanner::_parallelFor(size_t count, const std::function<void(size_t)> &fn) const
+{
+    uint32_t threads = static_cast<uint32_t>(std::min<size_t>(m_scanThreads, count / PARALLEL_MIN_DIRS + 1));
+    std::atomic<size_t> nextIndex(0);
+    auto worker = [&] () {
+        size_t i = 0;
+        while ((i = nextIndex.fetch_add(1, std::memory_order_relaxed)) < count)
+        {
+            fn(i);
+        }
+    };
+
+    if (threads > 1)
+    {
+        std::vector<std::thread> threadVec;
+        for (uint32_t i = 1; i < threads; ++i)
+        {
+            threadVec.emplace_back(worker);
+        }
+        worker();
+        for (auto &it : threadVec)
+        {
+            it.join();
+        }
+    }
+    else
+    {
+        worker();
+    }
+}
+
+void PollingScanner::_checkDir(const std::string &dirPath, const PolledDir &dir, const IgnoreMatcher *ignore, DirCheck &check) const
+{
+    const DirSnapshot &snapshot = dir.snapshot;
+    int32_t dirFd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0)
+    {
+        check.status = -errno;
+        return;
+    }
+
+    uint64_t ino = 0;
+    int64_t mtimeNs = 0;
+    bool changed = !snapshot.valid() ||
+        DirSnapshot::Stat(dirFd, ino, mtimeNs) != NO_ERROR ||
+        ino != snapshot.ino || mtimeNs != snapshot.mtimeNs;
+
+    // 各子项上一次的状态, 新建或被替换的项没有
+    std::vector<const FileState *> previousVec;
+    if (changed && DirSnapshot::Read(dirFd, check.current) == NO_ERROR)
+    {
+        check.scanned = true;
+        previousVec.resize(check.current.entries.size(), nullptr);
+        if (snapshot.valid())
+        {
+            const DirSnapshotEntry *pOldBegin = snapshot.entries.data();
+            const DirSnapshotEntry *pNewBegin = check.current.entries.data();
+            DirSnapshot::Diff(snapshot, check.current, [&] (const DirSnapshotEntry *pOld, const DirSnapshotEntry *pNew) {
+                if (pOld != nullptr && pNew != nullptr && pOld->ino == pNew->ino && pOld->isDir == pNew->isDir)
+                {
+                    size_t oldIndex = pOld - pOldBegin;
+                    previousVec[pNew - pNewBegin] = oldIndex < dir.files.size() ? &dir.files[oldIndex] : nullptr;
+                }
+            });
+        }
+    }
+    else
+    {
+        previousVec.resize(snapshot.entries.size(), nullptr);
+        for (size_t i = 0; i < previousVec.size() && i < dir.files.size(); ++i)
+        {
+            previousVec[i] = &dir.files[i];
+        }
+    }
+
+    // NOTE 原地修改文件不会改变目录的mtime, 需要检查每个文件. 新建的文件已输出EV_IN_CREATE, 只记录状态
+    const DirSnapshot &latest = check.scanned ? check.current : snapshot;
+    check.files.resize(latest.entries.size());
+    for (size_t i = 0; i < latest.entries.size(); ++i)
+    {
+        const DirSnapshotEntry &entry = latest.entries[i];
+        if (entry.isDir || (ignore != nullptr && ignore->ignored(dirPath, entry.name, false)))
+        {
+            continue;
+        }
+
+        const FileState *pPrevious = previousVec[i];
+        FileState &state = check.files[i];
+        ++check.fileStats;
+        if (DirSnapshot::Stat(dirFd, entry.name.c_str(), state.mtimeNs, state.size) != NO_ERROR)
+        {
+            // 读取目录后被删除, 由下一次扫描的目录比较输出删除事件
+            if (pPrevious != nullptr)
+            {
+                state = *pPrevious;
+            }
+            continue;
+        }
+
+        if (pPrevious != nullptr && pPrevious->mtimeNs != 0 &&
+            (pPrevious->mtimeNs != state.mtimeNs || pPrevious->size != state.size))
+        {
+            check.modified.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    close(dirFd);
+}
+
+int32_t PollingScanner::_scanSubtree(const std::string &root, Subtree &subtree, InotifyEventBatch &batch)
+{
+    ++m_stats.scans;
+    int32_t events = 0;
+
+    std::vector<std::map<std::string, PolledDir>::iterator> dirVec;
+    dirVec.reserve(subtree.dirMap.size());
+    for (auto it = subtree.dirMap.begin(); it != subtree.dirMap.end(); ++it)
+    {
+        dirVec.push_back(it);
+    }
+
+    // 各目录的检查互不依赖, 只读快照; 事件在之后按目录顺序输出
+    std::vector<DirCheck> checkVec(dirVec.size());
+    _parallelFor(dirVec.size(), [&] (size_t i) {
+        _checkDir(dirVec[i]->first, dirVec[i]->second, subtree.ignore, checkVec[i]);
+    });
+
+    // 根目录总是第一个
+    if (!checkVec.empty() && checkVec[0].status != NO_ERROR && dirVec[0]->first == root)
+    {
+        return checkVec[0].status;
+    }
+
+    std::vector<std::string> addedDirVec;
+    std::vector<std::string> removedDirVec;
+    m_stats.dirsChecked += dirVec.size();
+    for (size_t i = 0; i < dirVec.size(); ++i)
+    {
+        // 父目录的比较会输出删除事件
+        DirCheck &check = checkVec[i];
+        if (check.status != NO_ERROR)
+        {
+            continue;
+        }
+
+        const std::string &dirPath = dirVec[i]->first;
+        DirSnapshot &snapshot = dirVec[i]->second.snapshot;
+        m_stats.fileStats += check.fileStats;
+        if (check.scanned)
+        {
+            ++m_stats.dirsScanned;
+            if (snapshot.valid())
+            {
+                std::string_view path = batch.storePath(&snapshot, dirPath);
+                DirSnapshot::Diff(snapshot, check.current, [&] (const DirSnapshotEntry *pOld, const DirSnapshotEntry *pNew) {
+                    const DirSnapshotEntry *pEntry = (pNew != nullptr) ? pNew : pOld;
+                    if (subtree.ignore != nullptr && subtree.ignore->ignored(dirPath, pEntry->name, pEntry->isDir))
+                    {
+                        return;
+                    }
+
+                    bool replaced = (pOld != nullptr && pNew != nullptr && (pOld->ino != pNew->ino || pOld->isDir != pNew->isDir));
+                    if (pNew == nullptr || replaced)
+                    {
+                        batch.pushStored(EV_IN_DELETE | (pOld->isDir ? EV_IN_ISDIR : 0), 0, path, pOld->name);
+                        ++events;
+                        if (pOld->isDir)
+                        {
+                            removedDirVec.push_back(dirPath + pOld->name + "/");
+                        }
+                    }
+
+                    if (pOld == nullptr || replaced)
+                    {
+                        batch.pushStored(EV_IN_CREATE | (pNew->isDir ? EV_IN_ISDIR : 0), 0, path, pNew->name);
+                        ++events;
+                        if (pNew->isDir)
+                        {
+                            addedDirVec.push_back(dirPath + pNew->name + "/");
+                        }
+                    }
+                });
+            }
+
+            snapshot = std::move(check.current);
+        }
+        dirVec[i]->second.files = std::move(check.files);
+
+        for (uint32_t index : check.modified)
+        {
+            batch.push(EV_IN_MODIFY_OVER, 0, dirPath, snapshot.entries[index].name);
+            ++events;
+        }
+    }
+    batch.forgetPath();
+
+    for (const auto &it : removedDirVec)
+    {
+        for (auto dirIt = subtree.dirMap.lower_bound(it); dirIt != subtree.dirMap.end() && HasPrefix(dirIt->first, it); )
+        {
+            dirIt = subtree.dirMap.erase(dirIt);
+        }
+    }
+
+    for (const auto &it : addedDirVec)
+    {
+        _load(it, subtree.ignore, subtree.dirMap);
+    }
+
+    m_stats.events += events;
+    return events;
+}
+
+} // namespace eular
@@ -0,0 +1,207 @@
+/*************************************************************************
+    > File Name: polling_scanner.h
+    > Author: hsz
+    > Brief: 无法分配inotify watch的子树通过mtime轮询检测变化
+    > Created Time: 2026年10月17日 星期六 19时24分03秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_POLLING_SCANNER_H__
+#define __INOTIFY_POLLING_SCANNER_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+
+#include "inotify_tool/dir_snapshot.h"
+#include "inotify_tool/event_batch.h"
+
+namespace eular {
+
+class IgnoreMatcher;
+
+/**
+ * @brief 轮询扫描器. 每个子树保存所有目录的快照及其中文件的mtime和大小, 扫描时只重新读取mtime变化的目录,
+ * 并将每个文件的mtime和大小与快照比较(不依赖本地时钟, 服务器时钟偏差或mtime被设为过去的时间也能检测到). 扫描间隔自适应: 发现变化时回到最小间隔, 否则加倍直到最大间隔,
+ * 检测延迟不超过最大间隔. 目录较多时各目录的检查分给多个线程, 事件仍按目录顺序输出
+ *
+ * 指定了检测延迟的子树(如网络文件系统上的根目录)固定轮询, 不会升级为watch,
+ * 其间隔上限为检测延迟减去上一次扫描的耗时
+ */
+class PollingScanner
+{
+public:
+    struct Stats
+    {
+        uint64_t    scans = 0;          // 子树扫描次数
+        uint64_t    dirsChecked = 0;    // 检查mtime的目录数
+        uint64_t    dirsScanned = 0;    // 重新读取的目录数
+        uint64_t    fileStats = 0;      // 检查mtime和大小的文件数
+        uint64_t    events = 0;         // 输出的事件数
+        uint64_t    lastScanMs = 0;     // 最近一次子树扫描的耗时
+        uint64_t    maxScanMs = 0;      // 子树扫描的最大耗时
+    };
+
+    struct SubtreeInfo
+    {
+        std::string path;       // 子树根目录, 以'/'结尾
+        uint32_t    ev;         // 事件
+        bool        isRoot;     // 是否watchRecursive的根目录
+        size_t      dirs;       // 目录数
+        double      activity;   // 活跃度
+        bool        pinned;     // 固定轮询, 不升级为watch
+    };
+
+    PollingScanner(uint32_t minIntervalMs = 1000, uint32_t maxIntervalMs = 30000);
+    ~PollingScanner() = default;
+
+    /**
+     * @brief 设置扫描间隔范围
+     *
+     * @param minIntervalMs 发现变化后的间隔
+     * @param maxIntervalMs 无变化时的最大间隔, 即最大检测延迟
+     */
+    void setInterval(uint32_t minIntervalMs, uint32_t maxIntervalMs);
+
+    /**
+     * @brief 设置活跃度半衰期
+     */
+    void setHalfLife(uint32_t halfLifeMs) { m_halfLifeMs = halfLifeMs; }
+
+    /**
+     * @brief 设置扫描和遍历的线程数, 默认1. 网络文件系统上每次stat都有往返延迟, 多线程可缩短扫描时间
+     */
+    void setScanThreads(uint32_t threads) { m_scanThreads = threads > 0 ? threads : 1; }
+
+    /**
+     * @brief 添加子树并建立快照, 已有的嵌套子树被合并
+     *
+     * @param path 目录, 以'/'结尾
+     * @param ev 事件
+     * @param isRoot 是否watchRecursive的根目录
+     * @param nowMs 单调时钟毫秒
+     * @param ignore 忽略规则, 被忽略的目录不遍历, 被忽略的项不产生事件
+     * @param latencyMs 检测延迟上限, 非0时子树固定轮询
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t add(const std::string &path, uint32_t ev, bool isRoot, uint64_t nowMs,
+                const IgnoreMatcher *ignore = nullptr, uint32_t latencyMs = 0);
+
+    /**
+     * @brief 删除以path为根的子树及其下的子树
+     *
+     * @return true 有子树被删除
+     */
+    bool remove(const std::string &path);
+
+    /**
+     * @brief path是否位于某个子树中
+     */
+    bool contains(const std::string &path) const;
+
+    size_t subtreeCount() const { return m_subtreeMap.size(); }
+    size_t dirCount() const;
+
+    /**
+     * @brief 距离下一次扫描的毫秒数
+     *
+     * @return int64_t 没有子树时返回-1
+     */
+    int64_t nextTimeout(uint64_t nowMs) const;
+
+    /**
+     * @brief 扫描到期的子树, 事件追加到batch
+     *
+     * @return uint32_t 输出的事件数
+     */
+    uint32_t scan(uint64_t nowMs, InotifyEventBatch &batch);
+
+    /**
+     * @brief 获取所有子树, 按活跃度从高到低排列
+     */
+    void subtrees(uint64_t nowMs, std::vector<SubtreeInfo> &subtreeVec) const;
+
+    const Stats &stats() const { return m_stats; }
+    void clear() { m_subtreeMap.clear(); }
+
+protected:
+    /**
+     * @brief 文件的mtime和大小, mtimeNs为0表示未知(目录, 被忽略或获取失败)
+     */
+    struct FileState
+    {
+        int64_t     mtimeNs = 0;
+        uint64_t    size = 0;
+    };
+
+    /**
+     * @brief 轮询的目录: 快照及与快照子项一一对应的文件状态
+     */
+    struct PolledDir
+    {
+        DirSnapshot snapshot;
+        std::vector<FileState> files;
+    };
+
+    struct Subtree
+    {
+        uint32_t    ev;
+        bool        isRoot;
+        uint32_t    intervalMs;
+        uint64_t    nextScanMs;
+        double      activity;
+        uint64_t    activityMs;
+        uint32_t    latencyMs;      // 检测延迟上限, 0表示使用最大间隔
+        uint64_t    scanMs;         // 上一次扫描的耗时
+        const IgnoreMatcher *ignore;
+        std::map<std::string, PolledDir> dirMap; // 目录完整路径 -> 目录, 父目录在前
+    };
+
+    /**
+     * @brief 遍历目录, 将快照及文件状态加入dirMap
+     */
+    int32_t _load(const std::string &path, const IgnoreMatcher *ignore, std::map<std::string, PolledDir> &dirMap);
+
+    /**
+     * @brief 在扫描线程中对[0, count)逐个调用fn
+     */
+    void _parallelFor(size_t count, const std::function<void(size_t)> &fn) const;
+
+    /**
+     * @brief 一个目录的检查结果, 由工作线程填写
+     */
+    struct DirCheck
+    {
+        int32_t     status = 0;         // 打开目录失败时为-errno
+        bool        scanned = false;    // mtime变化, 已重新读取
+        DirSnapshot current;            // 重新读取的快照
+        std::vector<uint32_t> modified; // mtime或大小变化的文件在(新)快照中的序号
+        std::vector<FileState> files;   // (新)快照中各文件的状态
+        uint64_t    fileStats = 0;
+    };
+
+    /**
+     * @brief 检查一个目录, 只读取快照, 可在多个线程中同时调用
+     */
+    void _checkDir(const std::string &dirPath, const PolledDir &dir, const IgnoreMatcher *ignore, DirCheck &check) const;
+
+    /**
+     * @brief 扫描一个子树
+     *
+     * @return int32_t 事件数, 子树根目录不存在时返回负值
+     */
+    int32_t _scanSubtree(const std::string &root, Subtree &subtree, InotifyEventBatch &batch);
+
+private:
+    uint32_t    m_minIntervalMs;
+    uint32_t    m_maxIntervalMs;
+    uint32_t    m_halfLifeMs;
+    uint32_t    m_scanThreads;
+    Stats       m_stats;
+    std::map<std::string, Subtree>  m_subtreeMap;   // 子树根目录 -> 子树
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_POLLING_SCANNER_H__
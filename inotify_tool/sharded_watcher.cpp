@@ -0,0 +1,447 @@
+/*************************************************************************
+    > File Name: sharded_watcher.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 21时18分14秒
+ ************************************************************************/
+
+#include "inotify_tool/sharded_watcher.h"
+#include "inotify_tool/ignore_matcher.h"
+#include "inotify_tool/inotify_utils.h"
+
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+#include <utils/sysdef.h>
+#include <utils/errors.h>
+#include <log/log.h>
+
+#ifdef OS_LINUX
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#define LOG_TAG "Sharded-watcher"
+
+#define INVALID_ID (-1)
+
+#define MAX_SHARDS          8
+#define DEQUEUE_BULK_SIZE   256
+
+namespace eular {
+
+ShardedWatcher::ShardedWatcher(uint32_t shards) noexcept :
+    m_shards(shards),
+    m_notifyFd(INVALID_ID),
+    m_stopFd(INVALID_ID),
+    m_errorCode(0),
+    m_running(false)
+{
+    if (m_shards == 0)
+    {
+        m_shards = std::min<uint32_t>(std::max<uint32_t>(std::thread::hardware_concurrency(), 1), MAX_SHARDS);
+    }
+}
+
+ShardedWatcher::~ShardedWatcher() noexcept
+{
+    destroy();
+}
+
+bool ShardedWatcher::create() noexcept
+{
+    m_errorCode = 0;
+    if (m_notifyFd != INVALID_ID)
+    {
+        return true;
+    }
+
+    m_notifyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_notifyFd < 0 || m_stopFd < 0)
+    {
+        m_errorCode = errno;
+        LOGE("eventfd error. [%d, %s]", errno, strerror(errno));
+        destroy();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < m_shards; ++i)
+    {
+        std::unique_ptr<Shard> spShard(new Shard());
+        spShard->index = i;
+        if (!spShard->tool.createInotify())
+        {
+            m_errorCode = spShard->tool.getLastError();
+            LOGE("create inotify for shard %u error. [%d, %s]", i, m_errorCode, strerror(m_errorCode));
+            destroy();
+            return false;
+        }
+
+        spShard->token.reset(new moodycamel::ProducerToken(m_eventQueue));
+        Shard *pShard = spShard.get();
+        spShard->tool.setBatchCallback([this, pShard] (const InotifyEventBatch &batch) {
+            _enqueue(pShard, batch);
+        });
+        m_shardVec.push_back(std::move(spShard));
+    }
+
+    LOGI("%u inotify shards created", m_shards);
+    return true;
+}
+
+void ShardedWatcher::destroy()
+{
+    stop();
+    m_shardVec.clear();
+    m_ignoreRuleMap.clear();
+
+    if (m_notifyFd != INVALID_ID)
+    {
+        close(m_notifyFd);
+        m_notifyFd = INVALID_ID;
+    }
+
+    if (m_stopFd != INVALID_ID)
+    {
+        close(m_stopFd);
+        m_stopFd = INVALID_ID;
+    }
+}
+
+int32_t ShardedWatcher::fd() const
+{
+    return m_notifyFd;
+}
+
+int32_t ShardedWatcher::setIgnoreRules(const std::string &path, const std::vector<std::string> &rules)
+{
+    if (m_running.load(std::memory_order_acquire))
+    {
+        return INVALID_OPERATION;
+    }
+
+    IgnoreMatcher matcher(path);
+    int32_t status = matcher.add(rules);
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    std::string fixedPath = path;
+    utils::CorrectionPath(fixedPath);
+    m_ignoreRuleMap[fixedPath] = rules;
+    return NO_ERROR;
+}
+
+int32_t ShardedWatcher::watchRecursive(const std::vector<std::string> &paths, uint32_t ev)
+{
+    m_errorCode = 0;
+    if (m_shardVec.empty())
+    {
+        return NO_INIT;
+    }
+
+    if (m_running.load(std::memory_order_acquire))
+    {
+        return INVALID_OPERATION;
+    }
+
+    for (const auto &path : paths)
+    {
+        // 按watch数分配, 使各分片的读取和解析量大致相同
+        Shard *pShard = m_shardVec.front().get();
+        for (const auto &it : m_shardVec)
+        {
+            if (it->tool.getWatchCount() + it->tool.getPolledDirCount() <
+                pShard->tool.getWatchCount() + pShard->tool.getPolledDirCount())
+            {
+                pShard = it.get();
+            }
+        }
+
+        std::string fixedPath = path;
+        utils::CorrectionPath(fixedPath);
+        auto ruleIt = m_ignoreRuleMap.find(fixedPath);
+        if (ruleIt != m_ignoreRuleMap.end())
+        {
+            pShard->tool.setIgnoreRules(fixedPath, ruleIt->second);
+        }
+
+        int32_t status = pShard->tool.watchRecursive(path, ev);
+        if (status != NO_ERROR)
+        {
+            m_errorCode = pShard->tool.getLastError();
+            return status;
+        }
+
+        ++pShard->roots;
+        pShard->watches.store(pShard->tool.getWatchCount(), std::memory_order_relaxed);
+        pShard->polledDirs.store(pShard->tool.getPolledDirCount(), std::memory_order_relaxed);
+        LOGI("shard %u: watch %s, %zu watches", pShard->index, path.c_str(), pShard->tool.getWatchCount());
+    }
+
+    return NO_ERROR;
+}
+
+int32_t ShardedWatcher::start()
+{
+    if (m_shardVec.empty())
+    {
+        return NO_INIT;
+    }
+
+    bool expected = false;
+    if (!m_running.compare_exchange_strong(expected, true))
+    {
+        return NO_ERROR;
+    }
+
+    for (const auto &it : m_shardVec)
+    {
+        it->thread = std::thread(&ShardedWatcher::_shardLoop, this, it.get());
+    }
+
+    return NO_ERROR;
+}
+
+void ShardedWatcher::stop()
+{
+    bool expected = true;
+    if (!m_running.compare_exchange_strong(expected, false))
+    {
+        return;
+    }
+
+    // 不读取m_stopFd, 所有分片线程都能看到可读
+    uint64_t value = 1;
+    if (write(m_stopFd, &value, sizeof(value)) < 0)
+    {
+        LOGE("write stop eventfd error. [%d, %s]", errno, strerror(errno));
+    }
+
+    for (const auto &it : m_shardVec)
+    {
+        if (it->thread.joinable())
+        {
+            it->thread.join();
+        }
+    }
+
+    if (read(m_stopFd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+    {
+        LOGE("read stop eventfd error. [%d, %s]", errno, strerror(errno));
+    }
+}
+
+int32_t ShardedWatcher::waitCompleteEvent(uint32_t timeout)
+{
+    m_errorCode = 0;
+    if (m_notifyFd == INVALID_ID)
+    {
+        return NO_INIT;
+    }
+
+    int32_t status = start();
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    if (m_eventQueue.size_approx() > 0)
+    {
+        return NO_ERROR;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = m_notifyFd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int32_t errorCode = 0;
+    do {
+        errorCode = ::poll(&pfd, 1, timeout > 0 ? static_cast<int32_t>(timeout) : -1);
+    } while (errorCode < 0 && errno == EINTR);
+
+    if (errorCode < 0)
+    {
+        m_errorCode = errno;
+        return UNKNOWN_ERROR;
+    }
+
+    return errorCode > 0 ? NO_ERROR : TIMED_OUT;
+}
+
+void ShardedWatcher::setEventCallback(EventCallback cb)
+{
+    m_eventCallback = std::move(cb);
+}
+
+int32_t ShardedWatcher::processEvent()
+{
+    m_errorCode = 0;
+    if (m_notifyFd == INVALID_ID)
+    {
+        return NO_INIT;
+    }
+
+    int32_t status = start();
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    std::list<InotifyEventItem> eventItemList;
+    getEventItem(eventItemList);
+    if (!eventItemList.empty() && m_eventCallback)
+    {
+        m_eventCallback(eventItemList);
+    }
+
+    return NO_ERROR;
+}
+
+void ShardedWatcher::getEventItem(std::list<InotifyEventItem> &eventItemVec)
+{
+    eventItemVec.clear();
+    if (m_notifyFd == INVALID_ID)
+    {
+        return;
+    }
+
+    // NOTE 先清除通知再出队, 出队后入队的事件会再次触发通知, 不会丢失唤醒
+    _drainNotify();
+
+    InotifyEventItem items[DEQUEUE_BULK_SIZE];
+    size_t count = 0;
+    while ((count = m_eventQueue.try_dequeue_bulk(items, DEQUEUE_BULK_SIZE)) > 0)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            eventItemVec.push_back(std::move(items[i]));
+        }
+    }
+}
+
+int32_t ShardedWatcher::getLastError()
+{
+    return m_errorCode;
+}
+
+void ShardedWatcher::getShardStats(std::vector<ShardStats> &statsVec) const
+{
+    statsVec.clear();
+    for (const auto &it : m_shardVec)
+    {
+        ShardStats stats;
+        stats.shard = it->index;
+        stats.roots = it->roots;
+        stats.watches = it->watches.load(std::memory_order_relaxed);
+        stats.polledDirs = it->polledDirs.load(std::memory_order_relaxed);
+        stats.wakeups = it->wakeups.load(std::memory_order_relaxed);
+        stats.batches = it->batches.load(std::memory_order_relaxed);
+        stats.events = it->events.load(std::memory_order_relaxed);
+        stats.maxBatch = it->maxBatch.load(std::memory_order_relaxed);
+        stats.busyUs = it->busyUs.load(std::memory_order_relaxed);
+        stats.lastError = it->lastError.load(std::memory_order_relaxed);
+        statsVec.push_back(stats);
+    }
+}
+
+void ShardedWatcher::_shardLoop(Shard *pShard)
+{
+    struct pollfd pfds[2];
+    pfds[0].fd = pShard->tool.fd();
+    pfds[0].events = POLLIN;
+    pfds[1].fd = m_stopFd;
+    pfds[1].events = POLLIN;
+
+    while (m_running.load(std::memory_order_acquire))
+    {
+        pfds[0].revents = 0;
+        pfds[1].revents = 0;
+
+        // 有轮询子树时按扫描间隔醒来
+        int64_t timeout = pShard->tool.nextTimeout();
+        int32_t errorCode = ::poll(pfds, 2, timeout < 0 ? -1 : static_cast<int32_t>(timeout));
+        if (errorCode < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            pShard->lastError.store(-errno, std::memory_order_relaxed);
+            LOGE("shard %u poll error. [%d, %s]", pShard->index, errno, strerror(errno));
+            break;
+        }
+
+        if (pfds[1].revents & POLLIN)
+        {
+            break;
+        }
+
+        auto beginTime = std::chrono::steady_clock::now();
+        int32_t status = pShard->tool.processEvent();
+        pShard->wakeups.fetch_add(1, std::memory_order_relaxed);
+        pShard->busyUs.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - beginTime).count(), std::memory_order_relaxed);
+        if (status != NO_ERROR)
+        {
+            pShard->lastError.store(status, std::memory_order_relaxed);
+            LOGE("shard %u process event error: %d", pShard->index, status);
+        }
+
+        pShard->watches.store(pShard->tool.getWatchCount(), std::memory_order_relaxed);
+        pShard->polledDirs.store(pShard->tool.getPolledDirCount(), std::memory_order_relaxed);
+    }
+
+    LOGI("shard %u exit", pShard->index);
+}
+
+void ShardedWatcher::_enqueue(Shard *pShard, const InotifyEventBatch &batch)
+{
+    std::vector<InotifyEventItem> &itemVec = pShard->itemScratch;
+    itemVec.clear();
+    for (const auto &it : batch)
+    {
+        itemVec.push_back(it.toItem());
+    }
+
+    if (itemVec.empty())
+    {
+        return;
+    }
+
+    if (!m_eventQueue.enqueue_bulk(*pShard->token, std::make_move_iterator(itemVec.begin()), itemVec.size()))
+    {
+        LOGE("shard %u enqueue %zu events error", pShard->index, itemVec.size());
+        return;
+    }
+
+    pShard->batches.fetch_add(1, std::memory_order_relaxed);
+    pShard->events.fetch_add(itemVec.size(), std::memory_order_relaxed);
+    if (itemVec.size() > pShard->maxBatch.load(std::memory_order_relaxed))
+    {
+        pShard->maxBatch.store(itemVec.size(), std::memory_order_relaxed);
+    }
+
+    uint64_t value = 1;
+    if (write(m_notifyFd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+    {
+        LOGE("write notify eventfd error. [%d, %s]", errno, strerror(errno));
+    }
+}
+
+void ShardedWatcher::_drainNotify()
+{
+    uint64_t value = 0;
+    if (read(m_notifyFd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+    {
+        LOGE("read notify eventfd error. [%d, %s]", errno, strerror(errno));
+    }
+}
+
+} // namespace eular
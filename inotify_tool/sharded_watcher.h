@@ -0,0 +1,214 @@
+/*************************************************************************
+    > File Name: sharded_watcher.h
+    > Author: hsz
+    > Brief: 多inotify实例分片监视, 各分片独立线程解析后汇入无锁队列
+    > Created Time: 2026年10月17日 星期六 21时18分06秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_SHARDED_WATCHER_H__
+#define __INOTIFY_SHARDED_WATCHER_H__
+
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <thread>
+
+#include "httpd/concurrentqueue.h"
+
+#include "inotify_tool/inotify_event.h"
+#include "inotify_tool/inotify_tool.h"
+#include "inotify_tool/watcher_backend.h"
+
+namespace eular {
+
+struct ShardStats
+{
+    uint32_t    shard = 0;          // 分片序号
+    size_t      roots = 0;          // 分配的根目录数
+    size_t      watches = 0;        // watch数
+    size_t      polledDirs = 0;     // 轮询的目录数
+    uint64_t    wakeups = 0;        // 线程被唤醒处理的次数
+    uint64_t    batches = 0;        // 入队的批次数
+    uint64_t    events = 0;         // 入队的事件数
+    uint64_t    maxBatch = 0;       // 单批最大事件数
+    uint64_t    busyUs = 0;         // 解析和入队耗时(微秒)
+    int32_t     lastError = 0;      // 最近一次processEvent的错误
+};
+
+/**
+ * @brief 分片监视器. 创建N个InotifyTool实例, 每个根目录按当前watch数最少的原则分配给一个分片,
+ * 每个分片在独立线程中poll自身的inotify句柄并解析, 事件通过分片各自的ProducerToken写入
+ * moodycamel::ConcurrentQueue(多生产者无锁队列), 再写eventfd唤醒消费者.
+ *
+ * fd()返回该eventfd, 可像单个InotifyTool一样注册到InotifyPoller或hv::EventLoop中.
+ * 同一根目录的事件保持顺序, 不同根目录之间的事件无全局顺序.
+ *
+ * NOTE watchRecursive和setIgnoreRules需在start之前调用, 启动后分片实例只由分片线程访问
+ */
+class ShardedWatcher : public WatcherBackend
+{
+public:
+    typedef std::shared_ptr<ShardedWatcher> SP;
+    typedef std::unique_ptr<ShardedWatcher> Ptr;
+
+    /**
+     * @brief 构造
+     *
+     * @param shards 分片数, 0表示CPU核数(最多8个)
+     */
+    explicit ShardedWatcher(uint32_t shards = 0) noexcept;
+    ~ShardedWatcher() noexcept;
+
+    WatcherBackendType type() const override { return WatcherBackendType::INOTIFY; }
+
+    /**
+     * @brief 创建所有分片的inotify实例和eventfd
+     *
+     * @return true 成功
+     * @return false 失败
+     */
+    bool create() noexcept override;
+
+    /**
+     * @brief 停止分片线程并销毁所有实例
+     *
+     */
+    void destroy() override;
+
+    /**
+     * @brief 获取事件通知句柄(eventfd), 队列有事件时可读
+     *
+     * @return int32_t 未创建时返回-1
+     */
+    int32_t fd() const override;
+
+    /**
+     * @brief 设置根目录的忽略规则, 在该根目录被分配到分片时应用
+     *
+     * @param path 根目录
+     * @param rules 规则
+     * @return int32_t 成功返回0, 已启动返回INVALID_OPERATION
+     */
+    int32_t setIgnoreRules(const std::string &path, const std::vector<std::string> &rules);
+
+    /**
+     * @brief 递归监视目录, 每个根目录分配给当前watch数最少的分片
+     *
+     * @param paths 目录路径(绝对路径)数组
+     * @param ev 事件
+     * @return int32_t 成功返回0, 已启动返回INVALID_OPERATION, 失败返回其他负值
+     */
+    int32_t watchRecursive(const std::vector<std::string> &paths, uint32_t ev) override;
+    using WatcherBackend::watchRecursive;
+
+    /**
+     * @brief 启动分片线程, waitCompleteEvent和processEvent会自动启动
+     *
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t start();
+
+    /**
+     * @brief 停止分片线程, 队列中未取走的事件保留
+     *
+     */
+    void stop();
+
+    /**
+     * @brief 等待队列中有事件
+     *
+     * @param timeout 超时时间(毫秒), 0表示一直等待
+     * @return int32_t 成功返回0, 超时返回TIMED_OUT, 失败返回其他负值
+     */
+    int32_t waitCompleteEvent(uint32_t timeout) override;
+
+    /**
+     * @brief 设置事件回调, 在processEvent的调用线程中执行
+     *
+     * @param cb 回调
+     */
+    void setEventCallback(EventCallback cb) override;
+
+    /**
+     * @brief 清除eventfd计数并将队列中的事件交给回调
+     *
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t processEvent() override;
+
+    /**
+     * @brief 取出队列中的所有事件
+     *
+     * @param eventItemVec
+     */
+    void getEventItem(std::list<InotifyEventItem> &eventItemVec) override;
+    int32_t getLastError() override;
+
+    /**
+     * @brief 获取各分片的计数, 用于观察负载是否均衡
+     *
+     * @param statsVec 输出, 按分片序号排列
+     */
+    void getShardStats(std::vector<ShardStats> &statsVec) const;
+
+    uint32_t shardCount() const { return static_cast<uint32_t>(m_shardVec.size()); }
+    size_t queueSize() const { return m_eventQueue.size_approx(); }
+
+protected:
+    struct Shard
+    {
+        uint32_t                index = 0;
+        InotifyTool             tool;
+        std::thread             thread;
+        size_t                  roots = 0;
+        std::vector<InotifyEventItem> itemScratch;  // 批次转换的临时缓冲, 复用容量
+        std::unique_ptr<moodycamel::ProducerToken> token;
+        std::atomic<size_t>     watches{0};
+        std::atomic<size_t>     polledDirs{0};
+        std::atomic<uint64_t>   wakeups{0};
+        std::atomic<uint64_t>   batches{0};
+        std::atomic<uint64_t>   events{0};
+        std::atomic<uint64_t>   maxBatch{0};
+        std::atomic<uint64_t>   busyUs{0};
+        std::atomic<int32_t>    lastError{0};
+    };
+
+    /**
+     * @brief 分片线程
+     *
+     * @param pShard 分片
+     */
+    void _shardLoop(Shard *pShard);
+
+    /**
+     * @brief 将分片的一个批次写入队列
+     *
+     * @param pShard 分片
+     * @param batch 批次
+     */
+    void _enqueue(Shard *pShard, const InotifyEventBatch &batch);
+
+    /**
+     * @brief 清除eventfd计数
+     */
+    void _drainNotify();
+
+private:
+    uint32_t                            m_shards;           // 分片数
+    int32_t                             m_notifyFd;         // 有事件时可读
+    int32_t                             m_stopFd;           // 停止时可读, 唤醒所有分片线程
+    int32_t                             m_errorCode;
+    std::atomic<bool>                   m_running;
+    EventCallback                       m_eventCallback;
+    moodycamel::ConcurrentQueue<InotifyEventItem>   m_eventQueue;    // 所有分片的事件, 需在分片(持有ProducerToken)之前构造
+    std::vector<std::unique_ptr<Shard>> m_shardVec;
+    std::map<std::string, std::vector<std::string>> m_ignoreRuleMap; // 根目录 -> 忽略规则
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_SHARDED_WATCHER_H__
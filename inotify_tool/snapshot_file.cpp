@@ -0,0 +1,302 @@
+/*************************************************************************
+    > File Name: snapshot_file.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 21时52分47秒
+ ************************************************************************/
+
+#include "inotify_tool/snapshot_file.h"
+
+#include <string.h>
+#include <errno.h>
+
+#include <utils/sysdef.h>
+#include <utils/errors.h>
+#include <log/log.h>
+
+#ifdef OS_LINUX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define LOG_TAG "Snapshot-file"
+
+#define SNAPSHOT_MAGIC      "INOTSNAP"
+#define SNAPSHOT_VERSION    2   // 2: checksum包含consistentNs
+#define SNAPSHOT_FLAG_RECURSION 0x01
+#define ENTRY_DIR_BIT       0x80000000u
+
+namespace eular {
+
+struct SnapshotHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    dirCount;
+    int64_t     consistentNs;
+    uint64_t    payloadSize;
+    uint64_t    checksum;
+};
+
+static uint64_t Checksum(const uint8_t *data, size_t size, uint64_t hash = 14695981039346656037ULL)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief 文件头中的checksum: 覆盖consistentNs和负载. magic和version直接比较, payloadSize与文件长度比较, dirCount由解析负载校验
+ */
+static uint64_t FileChecksum(int64_t consistentNs, const uint8_t *payload, size_t size)
+{
+    uint64_t hash = Checksum(reinterpret_cast<const uint8_t *>(&consistentNs), sizeof(consistentNs));
+    return Checksum(payload, size, hash);
+}
+
+/**
+ * @brief 带边界检查的顺序读取
+ */
+class SnapshotReader
+{
+public:
+    SnapshotReader(const uint8_t *data, size_t size) : m_pos(data), m_end(data + size) {}
+
+    template <typename T>
+    bool read(T &value)
+    {
+        if (static_cast<size_t>(m_end - m_pos) < sizeof(T))
+        {
+            return false;
+        }
+
+        memcpy(&value, m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return true;
+    }
+
+    bool read(std::string &value, size_t length)
+    {
+        if (static_cast<size_t>(m_end - m_pos) < length)
+        {
+            return false;
+        }
+
+        value.assign(reinterpret_cast<const char *>(m_pos), length);
+        m_pos += length;
+        return true;
+    }
+
+    bool end() const { return m_pos == m_end; }
+
+private:
+    const uint8_t *m_pos;
+    const uint8_t *m_end;
+};
+
+template <typename T>
+static uint8_t *Write(uint8_t *pos, const T &value)
+{
+    memcpy(pos, &value, sizeof(T));
+    return pos + sizeof(T);
+}
+
+static uint8_t *Write(uint8_t *pos, const std::string &value)
+{
+    memcpy(pos, value.data(), value.length());
+    return pos + value.length();
+}
+
+int32_t SnapshotFile::Save(const std::string &file, int64_t consistentNs, const std::vector<PersistedDir> &dirVec)
+{
+    size_t payloadSize = 0;
+    for (const auto &dir : dirVec)
+    {
+        payloadSize += sizeof(uint32_t) * 4 + sizeof(uint64_t) + sizeof(int64_t) + sizeof(uint32_t) + dir.name.length();
+        for (const auto &entry : dir.snapshot.entries)
+        {
+            payloadSize += sizeof(uint64_t) + sizeof(uint32_t) + entry.name.length();
+        }
+    }
+
+    std::string tmpFile = file + ".tmp";
+    int32_t fd = open(tmpFile.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        int32_t error = errno;
+        LOGE("open %s error. [%d, %s]", tmpFile.c_str(), error, strerror(error));
+        return -error;
+    }
+
+    size_t fileSize = sizeof(SnapshotHeader) + payloadSize;
+    if (ftruncate(fd, static_cast<off_t>(fileSize)) != 0)
+    {
+        int32_t error = errno;
+        LOGE("ftruncate %s error. [%d, %s]", tmpFile.c_str(), error, strerror(error));
+        close(fd);
+        unlink(tmpFile.c_str());
+        return -error;
+    }
+
+    void *pMap = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (pMap == MAP_FAILED)
+    {
+        int32_t error = errno;
+        LOGE("mmap %s error. [%d, %s]", tmpFile.c_str(), error, strerror(error));
+        close(fd);
+        unlink(tmpFile.c_str());
+        return -error;
+    }
+
+    uint8_t *pBegin = static_cast<uint8_t *>(pMap);
+    uint8_t *pPayload = pBegin + sizeof(SnapshotHeader);
+    uint8_t *pos = pPayload;
+    for (const auto &dir : dirVec)
+    {
+        pos = Write(pos, dir.parent);
+        pos = Write(pos, dir.ev);
+        pos = Write(pos, static_cast<uint32_t>(dir.recursion ? SNAPSHOT_FLAG_RECURSION : 0));
+        pos = Write(pos, static_cast<uint32_t>(dir.snapshot.entries.size()));
+        pos = Write(pos, dir.snapshot.ino);
+        pos = Write(pos, dir.snapshot.mtimeNs);
+        pos = Write(pos, static_cast<uint32_t>(dir.name.length()));
+        pos = Write(pos, dir.name);
+        for (const auto &entry : dir.snapshot.entries)
+        {
+            pos = Write(pos, entry.ino);
+            pos = Write(pos, static_cast<uint32_t>(entry.name.length() | (entry.isDir ? ENTRY_DIR_BIT : 0)));
+            pos = Write(pos, entry.name);
+        }
+    }
+
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.dirCount = static_cast<uint32_t>(dirVec.size());
+    header.consistentNs = consistentNs;
+    header.payloadSize = payloadSize;
+    header.checksum = FileChecksum(consistentNs, pPayload, payloadSize);
+    memcpy(pBegin, &header, sizeof(header));
+
+    int32_t status = NO_ERROR;
+    if (msync(pMap, fileSize, MS_SYNC) != 0)
+    {
+        status = -errno;
+        LOGE("msync %s error. [%d, %s]", tmpFile.c_str(), errno, strerror(errno));
+    }
+
+    munmap(pMap, fileSize);
+    close(fd);
+
+    if (status == NO_ERROR && rename(tmpFile.c_str(), file.c_str()) != 0)
+    {
+        status = -errno;
+        LOGE("rename %s error. [%d, %s]", file.c_str(), errno, strerror(errno));
+    }
+
+    if (status != NO_ERROR)
+    {
+        unlink(tmpFile.c_str());
+    }
+
+    return status;
+}
+
+int32_t SnapshotFile::Load(const std::string &file, int64_t &consistentNs, std::vector<PersistedDir> &dirVec)
+{
+    dirVec.clear();
+    int32_t fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        int32_t error = errno;
+        if (error == ENOENT)
+        {
+            return NAME_NOT_FOUND;
+        }
+
+        LOGE("open %s error. [%d, %s]", file.c_str(), error, strerror(error));
+        return -error;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(SnapshotHeader))
+    {
+        LOGW("invalid snapshot file %s", file.c_str());
+        close(fd);
+        return UNKNOWN_ERROR;
+    }
+
+    size_t fileSize = static_cast<size_t>(fileStat.st_size);
+    void *pMap = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pMap == MAP_FAILED)
+    {
+        int32_t error = errno;
+        LOGE("mmap %s error. [%d, %s]", file.c_str(), error, strerror(error));
+        return -error;
+    }
+
+    const uint8_t *pBegin = static_cast<const uint8_t *>(pMap);
+    const uint8_t *pPayload = pBegin + sizeof(SnapshotHeader);
+    SnapshotHeader header;
+    memcpy(&header, pBegin, sizeof(header));
+
+    bool valid = memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == SNAPSHOT_VERSION &&
+        header.payloadSize == fileSize - sizeof(SnapshotHeader) &&
+        header.checksum == FileChecksum(header.consistentNs, pPayload, header.payloadSize);
+
+    SnapshotReader reader(pPayload, valid ? header.payloadSize : 0);
+    if (valid)
+    {
+        dirVec.resize(header.dirCount);
+    }
+
+    for (uint32_t i = 0; valid && i < header.dirCount; ++i)
+    {
+        PersistedDir &dir = dirVec[i];
+        uint32_t flags = 0;
+        uint32_t entryCount = 0;
+        uint32_t nameLen = 0;
+        valid = reader.read(dir.parent) && reader.read(dir.ev) && reader.read(flags) &&
+            reader.read(entryCount) && reader.read(dir.snapshot.ino) && reader.read(dir.snapshot.mtimeNs) &&
+            reader.read(nameLen) && reader.read(dir.name, nameLen);
+
+        // 父目录必须在前
+        valid = valid && (dir.parent == SNAPSHOT_NO_PARENT || dir.parent < i);
+        dir.recursion = (flags & SNAPSHOT_FLAG_RECURSION) != 0;
+        if (valid)
+        {
+            dir.snapshot.entries.resize(entryCount);
+        }
+
+        for (uint32_t j = 0; valid && j < entryCount; ++j)
+        {
+            DirSnapshotEntry &entry = dir.snapshot.entries[j];
+            uint32_t length = 0;
+            valid = reader.read(entry.ino) && reader.read(length) && reader.read(entry.name, length & ~ENTRY_DIR_BIT);
+            entry.isDir = (length & ENTRY_DIR_BIT) != 0;
+        }
+    }
+
+    valid = valid && reader.end();
+    munmap(pMap, fileSize);
+
+    if (!valid)
+    {
+        LOGW("snapshot file %s is corrupted", file.c_str());
+        dirVec.clear();
+        return UNKNOWN_ERROR;
+    }
+
+    consistentNs = header.consistentNs;
+    return NO_ERROR;
+}
+
+} // namespace eular
@@ -0,0 +1,68 @@
+/*************************************************************************
+    > File Name: snapshot_file.h
+    > Author: hsz
+    > Brief: 监视树快照的持久化文件
+    > Created Time: 2026年10月17日 星期六 21时52分40秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_SNAPSHOT_FILE_H__
+#define __INOTIFY_SNAPSHOT_FILE_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "inotify_tool/dir_snapshot.h"
+
+#define SNAPSHOT_NO_PARENT  UINT32_MAX
+
+namespace eular {
+
+/**
+ * @brief 持久化的目录
+ */
+struct PersistedDir
+{
+    uint32_t    parent;     // 父目录序号, 根目录为SNAPSHOT_NO_PARENT. 父目录总在子目录之前
+    uint32_t    ev;         // 监视的事件
+    bool        recursion;  // 是否递归
+    std::string name;       // 根目录为完整路径(以'/'结尾), 其他为目录名
+    DirSnapshot snapshot;   // inode, mtime和子项
+};
+
+/**
+ * @brief 快照文件. 格式(本机字节序):
+ *  文件头: magic[8] version(u32) dirCount(u32) consistentNs(i64) payloadSize(u64) checksum(u64, consistentNs和负载的FNV-1a)
+ *  目录: parent(u32) ev(u32) flags(u32) entryCount(u32) ino(u64) mtimeNs(i64) nameLen(u32) name
+ *  子项: ino(u64) nameLen(u32, 最高位表示目录) name
+ *
+ * 写入时先写临时文件(ftruncate后mmap填充), msync后rename替换, 崩溃时保留旧文件;
+ * 读取时mmap整个文件并校验长度和checksum, 任何不一致都视为无快照
+ */
+class SnapshotFile
+{
+public:
+    /**
+     * @brief 保存
+     *
+     * @param file 文件路径
+     * @param consistentNs 此时间(CLOCK_REALTIME)之前的修改都已反映在快照中
+     * @param dirVec 目录, 父目录在子目录之前
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    static int32_t Save(const std::string &file, int64_t consistentNs, const std::vector<PersistedDir> &dirVec);
+
+    /**
+     * @brief 读取
+     *
+     * @param file 文件路径
+     * @param consistentNs 输出保存时的一致点
+     * @param dirVec 输出目录
+     * @return int32_t 成功返回0, 文件不存在返回NAME_NOT_FOUND, 格式错误返回UNKNOWN_ERROR, 其他失败返回负值
+     */
+    static int32_t Load(const std::string &file, int64_t &consistentNs, std::vector<PersistedDir> &dirVec);
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_SNAPSHOT_FILE_H__
@@ -0,0 +1,134 @@
+/*************************************************************************
+    > File Name: watch_budget.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 19时10分40秒
+ ************************************************************************/
+
+#include "inotify_tool/watch_budget.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#include <log/log.h>
+
+#define LOG_TAG "Watch-budget"
+
+#define INOTIFY_PROCDIR "/proc/sys/fs/inotify/"
+#define WATCHES_SIZE_PATH INOTIFY_PROCDIR "max_user_watches"
+#define QUEUE_SIZE_PATH INOTIFY_PROCDIR "max_queued_events"
+#define INSTANCES_PATH INOTIFY_PROCDIR "max_user_instances"
+
+#define WATCH_BUDGET_RATIO          0.9
+#define DEFAULT_MAX_USER_WATCHES    8192            // 读取失败时使用的旧内核默认值
+#define DEFAULT_HALF_LIFE_MS        (10 * 60 * 1000)
+
+namespace eular {
+
+static uint32_t ReadProcValue(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == nullptr)
+    {
+        return 0;
+    }
+
+    unsigned long value = 0;
+    if (fscanf(fp, "%lu", &value) != 1)
+    {
+        value = 0;
+    }
+    fclose(fp);
+
+    return value > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(value);
+}
+
+InotifyLimits InotifyLimits::Read()
+{
+    InotifyLimits limits;
+    limits.maxUserWatches = ReadProcValue(WATCHES_SIZE_PATH);
+    limits.maxQueuedEvents = ReadProcValue(QUEUE_SIZE_PATH);
+    limits.maxUserInstances = ReadProcValue(INSTANCES_PATH);
+    return limits;
+}
+
+WatchBudget::WatchBudget() :
+    m_limit(0),
+    m_userLimit(0),
+    m_halfLifeMs(DEFAULT_HALF_LIFE_MS)
+{
+    reload();
+}
+
+void WatchBudget::reload()
+{
+    m_limits = InotifyLimits::Read();
+    if (m_userLimit > 0)
+    {
+        m_limit = m_userLimit;
+        return;
+    }
+
+    uint32_t maxWatches = m_limits.maxUserWatches > 0 ? m_limits.maxUserWatches : DEFAULT_MAX_USER_WATCHES;
+    m_limit = static_cast<uint32_t>(maxWatches * WATCH_BUDGET_RATIO);
+    LOGI("max_user_watches: %u, max_queued_events: %u, max_user_instances: %u, watch budget: %u",
+        m_limits.maxUserWatches, m_limits.maxQueuedEvents, m_limits.maxUserInstances, m_limit);
+}
+
+void WatchBudget::setLimit(uint32_t watches)
+{
+    m_userLimit = watches;
+    reload();
+}
+
+void WatchBudget::setHalfLife(uint32_t halfLifeMs)
+{
+    m_halfLifeMs = halfLifeMs > 0 ? halfLifeMs : 1;
+}
+
+void WatchBudget::touch(int32_t wd, uint64_t nowMs, double weight)
+{
+    auto it = m_activityMap.find(wd);
+    if (it == m_activityMap.end())
+    {
+        m_activityMap.emplace(wd, Activity{weight, nowMs});
+        return;
+    }
+
+    Activity &activity = it->second;
+    activity.score = Decay(activity.score, nowMs > activity.lastMs ? nowMs - activity.lastMs : 0, m_halfLifeMs) + weight;
+    activity.lastMs = nowMs;
+}
+
+double WatchBudget::score(int32_t wd, uint64_t nowMs) const
+{
+    auto it = m_activityMap.find(wd);
+    if (it == m_activityMap.end())
+    {
+        return 0;
+    }
+
+    return Decay(it->second.score, nowMs > it->second.lastMs ? nowMs - it->second.lastMs : 0, m_halfLifeMs);
+}
+
+void WatchBudget::forget(int32_t wd)
+{
+    m_activityMap.erase(wd);
+}
+
+void WatchBudget::clear()
+{
+    m_activityMap.clear();
+}
+
+double WatchBudget::Decay(double score, uint64_t elapsedMs, uint32_t halfLifeMs)
+{
+    if (elapsedMs == 0 || score == 0)
+    {
+        return score;
+    }
+
+    return score * exp2(-static_cast<double>(elapsedMs) / halfLifeMs);
+}
+
+} // namespace eular
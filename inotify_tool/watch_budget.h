@@ -0,0 +1,108 @@
+/*************************************************************************
+    > File Name: watch_budget.h
+    > Author: hsz
+    > Brief: inotify watch数量预算与目录活跃度
+    > Created Time: 2026年10月17日 星期六 19时10分34秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_WATCH_BUDGET_H__
+#define __INOTIFY_WATCH_BUDGET_H__
+
+#include <stdint.h>
+#include <unordered_map>
+
+namespace eular {
+
+/**
+ * @brief /proc/sys/fs/inotify/下的内核限制
+ */
+struct InotifyLimits
+{
+    uint32_t    maxUserWatches = 0;     // 每个用户的watch上限
+    uint32_t    maxQueuedEvents = 0;    // 每个实例的事件队列长度
+    uint32_t    maxUserInstances = 0;   // 每个用户的实例上限
+
+    /**
+     * @brief 读取内核限制, 读取失败的项为0
+     *
+     * @return InotifyLimits
+     */
+    static InotifyLimits Read();
+};
+
+/**
+ * @brief watch预算. 默认使用max_user_watches的90%(同一用户的其他进程也会占用watch),
+ * 并按指数衰减记录每个wd的活跃度, 用于决定哪些目录保留真实watch, 哪些降级为轮询
+ */
+class WatchBudget
+{
+public:
+    WatchBudget();
+    ~WatchBudget() = default;
+
+    /**
+     * @brief 重新读取内核限制并计算预算
+     */
+    void reload();
+
+    /**
+     * @brief 手动设置watch上限, 0表示按内核限制计算
+     *
+     * @param watches 上限
+     */
+    void setLimit(uint32_t watches);
+    uint32_t limit() const { return m_limit; }
+    const InotifyLimits &limits() const { return m_limits; }
+
+    /**
+     * @brief 设置活跃度半衰期
+     *
+     * @param halfLifeMs 毫秒
+     */
+    void setHalfLife(uint32_t halfLifeMs);
+    uint32_t halfLife() const { return m_halfLifeMs; }
+
+    /**
+     * @brief 记录一次活动
+     *
+     * @param wd 监视描述符
+     * @param nowMs 单调时钟毫秒
+     * @param weight 权重
+     */
+    void touch(int32_t wd, uint64_t nowMs, double weight = 1.0);
+
+    /**
+     * @brief 获取衰减到nowMs的活跃度
+     */
+    double score(int32_t wd, uint64_t nowMs) const;
+
+    void forget(int32_t wd);
+    void clear();
+
+    /**
+     * @brief 按半衰期衰减
+     *
+     * @param score 上一次的值
+     * @param elapsedMs 经过的毫秒数
+     * @param halfLifeMs 半衰期
+     * @return double
+     */
+    static double Decay(double score, uint64_t elapsedMs, uint32_t halfLifeMs);
+
+private:
+    struct Activity
+    {
+        double      score;
+        uint64_t    lastMs;
+    };
+
+    InotifyLimits   m_limits;
+    uint32_t        m_limit;        // 0表示按内核限制计算
+    uint32_t        m_userLimit;    // setLimit设置的值
+    uint32_t        m_halfLifeMs;
+    std::unordered_map<int32_t, Activity>   m_activityMap;
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_WATCH_BUDGET_H__
@@ -0,0 +1,298 @@
+/*************************************************************************
+    > File Name: watch_tree.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 11时03分24秒
+ ************************************************************************/
+
+#include "inotify_tool/watch_tree.h"
+
+namespace eular {
+
+WatchNode *WatchTree::insert(WatchNode *parent, const std::string &name, const InotifyInfo &info, bool isDir)
+{
+    auto it = m_wdMap.find(info.wd);
+    if (it != m_wdMap.end())
+    {
+        // 同一个inode重复监视时内核返回相同的wd
+        it->second->info = info;
+        return it->second.get();
+    }
+
+    std::unique_ptr<WatchNode> spNode(new WatchNode());
+    WatchNode *pNode = spNode.get();
+    pNode->info = info;
+    pNode->isDir = isDir;
+    pNode->parent = parent;
+    pNode->name = name;
+    pNode->ignore = (parent != nullptr) ? parent->ignore : nullptr;
+
+    if (parent == nullptr)
+    {
+        m_rootMap[pNode->name] = pNode;
+    }
+    else
+    {
+        parent->children[pNode->name] = pNode;
+    }
+
+    m_wdMap.emplace(info.wd, std::move(spNode));
+    return pNode;
+}
+
+void WatchTree::merge(std::list<WatchEntry> &entryList)
+{
+    for (auto &it : entryList)
+    {
+        WatchNode *parent = nullptr;
+        if (it.parentWd >= 0)
+        {
+            parent = find(it.parentWd);
+            if (parent == nullptr)
+            {
+                // 父目录在合并前已被移除
+                continue;
+            }
+        }
+
+        WatchNode *pNode = insert(parent, it.name, it.info);
+        pNode->snapshot = std::move(it.snapshot);
+        if (parent == nullptr)
+        {
+            pNode->ignore = it.ignore;
+        }
+    }
+}
+
+WatchNode *WatchTree::find(int32_t wd) const
+{
+    auto it = m_wdMap.find(wd);
+    if (it == m_wdMap.end())
+    {
+        return nullptr;
+    }
+
+    return it->second.get();
+}
+
+WatchNode *WatchTree::find(const std::string &path) const
+{
+    for (const auto &it : m_rootMap)
+    {
+        const std::string &rootPath = it.first;
+        WatchNode *pNode = it.second;
+        if (!pNode->isDir || rootPath.back() != '/')
+        {
+            if (path == rootPath)
+            {
+                return pNode;
+            }
+
+            continue;
+        }
+
+        // 根目录本身, 允许不带结尾的'/'
+        if (path.compare(0, rootPath.length() - 1, rootPath, 0, rootPath.length() - 1) != 0)
+        {
+            continue;
+        }
+
+        if (path.length() == rootPath.length() - 1)
+        {
+            return pNode;
+        }
+
+        if (path[rootPath.length() - 1] != '/')
+        {
+            continue;
+        }
+
+        std::string_view remain(path);
+        remain.remove_prefix(rootPath.length());
+        while (pNode != nullptr && !remain.empty())
+        {
+            size_t pos = remain.find('/');
+            std::string_view component = remain.substr(0, pos);
+            remain.remove_prefix(pos == std::string_view::npos ? remain.length() : pos + 1);
+            if (component.empty())
+            {
+                continue;
+            }
+
+            pNode = child(pNode, component);
+        }
+
+        if (pNode != nullptr)
+        {
+            return pNode;
+        }
+    }
+
+    return nullptr;
+}
+
+WatchNode *WatchTree::child(const WatchNode *parent, std::string_view name) const
+{
+    if (parent == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto it = parent->children.find(name);
+    if (it == parent->children.end())
+    {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
+void WatchTree::move(WatchNode *node, WatchNode *newParent, const std::string &newName)
+{
+    if (node == nullptr || newParent == nullptr)
+    {
+        return;
+    }
+
+    if (node->parent == nullptr)
+    {
+        m_rootMap.erase(node->name);
+    }
+    else
+    {
+        node->parent->children.erase(node->name);
+    }
+
+    // 目标位置已有同名节点(被覆盖的空目录), 其监视已失效
+    WatchNode *pOld = child(newParent, newName);
+    if (pOld != nullptr && pOld != node)
+    {
+        erase(pOld);
+    }
+
+    node->name = newName;
+    node->parent = newParent;
+    newParent->children[node->name] = node;
+
+    // 移动到其他根目录下, 子树改用新根目录的忽略规则
+    if (node->ignore != newParent->ignore)
+    {
+        std::function<void(WatchNode *)> setIgnore = [&] (WatchNode *pNode) {
+            pNode->ignore = newParent->ignore;
+            for (const auto &it : pNode->children)
+            {
+                setIgnore(it.second);
+            }
+        };
+        setIgnore(node);
+    }
+}
+
+void WatchTree::erase(WatchNode *node, std::vector<int32_t> *subWdVec)
+{
+    if (node == nullptr)
+    {
+        return;
+    }
+
+    if (node->parent == nullptr)
+    {
+        m_rootMap.erase(node->name);
+    }
+    else
+    {
+        node->parent->children.erase(node->name);
+    }
+
+    std::vector<int32_t> wdVec;
+    _collect(node, wdVec);
+    for (int32_t wd : wdVec)
+    {
+        m_wdMap.erase(wd);
+    }
+
+    if (subWdVec != nullptr)
+    {
+        // 第一个为node自身
+        subWdVec->insert(subWdVec->end(), wdVec.begin() + 1, wdVec.end());
+    }
+}
+
+std::string WatchTree::path(const WatchNode *node) const
+{
+    std::string fullPath;
+    appendPath(node, fullPath);
+    return fullPath;
+}
+
+void WatchTree::appendPath(const WatchNode *node, std::string &out) const
+{
+    if (node == nullptr)
+    {
+        return;
+    }
+
+    // 目录层级通常不深, 使用栈上数组避免分配
+    const WatchNode *stack[64];
+    std::vector<const WatchNode *> deepStack;
+    size_t depth = 0;
+    for (const WatchNode *pNode = node; pNode != nullptr; pNode = pNode->parent)
+    {
+        if (depth < sizeof(stack) / sizeof(stack[0]))
+        {
+            stack[depth] = pNode;
+        }
+        else
+        {
+            if (deepStack.empty())
+            {
+                deepStack.assign(stack, stack + depth);
+            }
+            deepStack.push_back(pNode);
+        }
+        ++depth;
+    }
+
+    for (size_t i = depth; i > 0; --i)
+    {
+        const WatchNode *pNode = deepStack.empty() ? stack[i - 1] : deepStack[i - 1];
+        out.append(pNode->name);
+        if (pNode->parent != nullptr && pNode->isDir)
+        {
+            out.push_back('/');
+        }
+    }
+}
+
+void WatchTree::foreach(const std::function<void(const WatchNode *)> &cb) const
+{
+    for (const auto &it : m_wdMap)
+    {
+        cb(it.second.get());
+    }
+}
+
+void WatchTree::foreach(const std::function<void(WatchNode *)> &cb)
+{
+    for (const auto &it : m_wdMap)
+    {
+        cb(it.second.get());
+    }
+}
+
+void WatchTree::clear()
+{
+    m_rootMap.clear();
+    m_wdMap.clear();
+}
+
+void WatchTree::_collect(WatchNode *node, std::vector<int32_t> &wdVec)
+{
+    wdVec.push_back(node->info.wd);
+    for (const auto &it : node->children)
+    {
+        _collect(it.second, wdVec);
+    }
+}
+
+} // namespace eular
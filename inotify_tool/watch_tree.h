@@ -0,0 +1,162 @@
+/*************************************************************************
+    > File Name: watch_tree.h
+    > Author: hsz
+    > Brief: 以路径分量组织的wd索引
+    > Created Time: 2026年10月17日 星期六 11时03分18秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_WATCH_TREE_H__
+#define __INOTIFY_WATCH_TREE_H__
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+
+#include "inotify_tool/inotify_tool_p.h"
+#include "inotify_tool/dir_snapshot.h"
+
+namespace eular {
+
+class IgnoreMatcher;
+
+/**
+ * @brief 监视节点. 根节点的name为完整路径(目录以'/'结尾), 其他节点的name为目录名.
+ * 完整路径只在需要时由父节点链拼接, 目录重命名只需修改一个节点
+ */
+struct WatchNode
+{
+    InotifyInfo     info;               // wd, 事件, 是否递归
+    bool            isDir = true;       // 是否目录
+    WatchNode *     parent = nullptr;   // 父节点, 根节点为nullptr
+    std::string     name;               // 节点名
+    std::unordered_map<std::string_view, WatchNode *> children; // key指向子节点自身的name
+    DirSnapshot     snapshot;           // 目录快照, 随事件增量更新
+    const IgnoreMatcher *ignore = nullptr; // 所属根目录的忽略规则, 子节点继承父节点
+};
+
+/**
+ * @brief 递归监视过程中收集的监视项, 监视完成后统一合并到WatchTree中
+ */
+struct WatchEntry
+{
+    int32_t         parentWd;   // 父目录wd, 根目录为-1
+    std::string     name;       // 根目录为完整路径, 其他为目录名
+    InotifyInfo     info;
+    DirSnapshot     snapshot;   // 遍历时建立的目录快照
+    const IgnoreMatcher *ignore = nullptr; // 根目录的忽略规则, 非根目录继承父节点
+};
+
+class WatchTree
+{
+public:
+    WatchTree() = default;
+    ~WatchTree() = default;
+
+    WatchTree(const WatchTree &) = delete;
+    WatchTree &operator=(const WatchTree &) = delete;
+
+    /**
+     * @brief 插入节点, wd已存在时返回已有节点
+     *
+     * @param parent 父节点, nullptr表示插入根节点
+     * @param name 根节点为完整路径, 其他为目录名
+     * @param info 监视信息
+     * @param isDir 是否目录
+     * @return WatchNode* 插入的节点
+     */
+    WatchNode *insert(WatchNode *parent, const std::string &name, const InotifyInfo &info, bool isDir = true);
+
+    /**
+     * @brief 按顺序合并监视项, 父目录需在子目录之前. 监视项中的快照被移动到节点
+     *
+     * @param entryList 监视项
+     */
+    void merge(std::list<WatchEntry> &entryList);
+
+    /**
+     * @brief 根据wd查找节点
+     *
+     * @param wd 监视描述符
+     * @return WatchNode* 不存在返回nullptr
+     */
+    WatchNode *find(int32_t wd) const;
+
+    /**
+     * @brief 根据完整路径查找节点
+     *
+     * @param path 绝对路径
+     * @return WatchNode* 不存在返回nullptr
+     */
+    WatchNode *find(const std::string &path) const;
+
+    /**
+     * @brief 查找子节点
+     *
+     * @param parent 父节点
+     * @param name 子目录名
+     * @return WatchNode* 不存在返回nullptr
+     */
+    WatchNode *child(const WatchNode *parent, std::string_view name) const;
+
+    /**
+     * @brief 移动节点到新的父节点下并重命名, 子树随之移动
+     *
+     * @param node 节点
+     * @param newParent 新的父节点
+     * @param newName 新的名字
+     */
+    void move(WatchNode *node, WatchNode *newParent, const std::string &newName);
+
+    /**
+     * @brief 删除节点及其子树
+     *
+     * @param node 节点
+     * @param subWdVec 输出子树中除node外的wd, 需要调用者解除监视
+     */
+    void erase(WatchNode *node, std::vector<int32_t> *subWdVec = nullptr);
+
+    /**
+     * @brief 拼接节点的完整路径, 目录以'/'结尾
+     *
+     * @param node 节点
+     * @return std::string
+     */
+    std::string path(const WatchNode *node) const;
+
+    /**
+     * @brief 将节点的完整路径追加到out
+     *
+     * @param node 节点
+     * @param out 输出
+     */
+    void appendPath(const WatchNode *node, std::string &out) const;
+
+    /**
+     * @brief 遍历所有节点
+     *
+     * @param cb 回调
+     */
+    void foreach(const std::function<void(const WatchNode *)> &cb) const;
+    void foreach(const std::function<void(WatchNode *)> &cb);
+
+    size_t size() const { return m_wdMap.size(); }
+    bool empty() const { return m_wdMap.empty(); }
+    void clear();
+
+private:
+    void _collect(WatchNode *node, std::vector<int32_t> &wdVec);
+
+private:
+    std::unordered_map<int32_t, std::unique_ptr<WatchNode>> m_wdMap;   // wd -> 节点
+    std::map<std::string, WatchNode *>                      m_rootMap; // 根路径 -> 根节点
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_WATCH_TREE_H__
@@ -0,0 +1,27 @@
+/*************************************************************************
+    > File Name: watcher_backend.cpp
+    > Author: hsz
+    > Brief:
+    > Created Time: 2026年10月17日 星期六 15时02分17秒
+ ************************************************************************/
+
+#include "inotify_tool/watcher_backend.h"
+#include "inotify_tool/inotify_tool.h"
+#include "inotify_tool/fanotify_tool.h"
+
+namespace eular {
+
+WatcherBackend::Ptr WatcherBackend::Create(WatcherBackendType type)
+{
+    switch (type) {
+    case WatcherBackendType::FANOTIFY:
+        return WatcherBackend::Ptr(new FanotifyTool());
+    case WatcherBackendType::INOTIFY:
+    default:
+        break;
+    }
+
+    return WatcherBackend::Ptr(new InotifyTool());
+}
+
+} // namespace eular
@@ -0,0 +1,143 @@
+/*************************************************************************
+    > File Name: watcher_backend.h
+    > Author: hsz
+    > Brief: 文件监控后端接口
+    > Created Time: 2026年10月17日 星期六 15时02分11秒
+ ************************************************************************/
+
+#ifndef __INOTIFY_WATCHER_BACKEND_H__
+#define __INOTIFY_WATCHER_BACKEND_H__
+
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <vector>
+#include <memory>
+#include <functional>
+
+struct InotifyEventItem;
+
+namespace eular {
+
+enum class WatcherBackendType : uint32_t {
+    INOTIFY,    // 每个目录一个inotify watch
+    FANOTIFY,   // 文件系统级fanotify mark(FAN_REPORT_DFID_NAME), 需要CAP_SYS_ADMIN
+};
+
+/**
+ * @brief 文件监控后端. 不同后端产生相同的InotifyEventItem事件流, 上层无需关心具体实现
+ */
+class WatcherBackend
+{
+public:
+    typedef std::shared_ptr<WatcherBackend> SP;
+    typedef std::unique_ptr<WatcherBackend> Ptr;
+    typedef std::function<void(std::list<InotifyEventItem> &)> EventCallback;
+
+    virtual ~WatcherBackend() = default;
+
+    /**
+     * @brief 创建后端
+     *
+     * @param type 后端类型
+     * @return Ptr
+     */
+    static Ptr Create(WatcherBackendType type);
+
+    /**
+     * @brief 后端类型
+     *
+     * @return WatcherBackendType
+     */
+    virtual WatcherBackendType type() const = 0;
+
+    /**
+     * @brief 创建内核句柄
+     *
+     * @return true 成功
+     * @return false 失败
+     */
+    virtual bool create() noexcept = 0;
+
+    /**
+     * @brief 销毁内核句柄及所有监视
+     *
+     */
+    virtual void destroy() = 0;
+
+    /**
+     * @brief 获取内核句柄, 可注册到epoll/hv::EventLoop中
+     *
+     * @return int32_t
+     */
+    virtual int32_t fd() const = 0;
+
+    /**
+     * @brief 距离下一次定时任务(如轮询扫描)的毫秒数, 事件驱动模式下到期后应调用processEvent
+     *
+     * @return int64_t 没有定时任务时返回-1
+     */
+    virtual int64_t nextTimeout() const { return -1; }
+
+    /**
+     * @brief 递归监视目录
+     *
+     * @param paths 目录路径(绝对路径)数组
+     * @param ev 事件
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    virtual int32_t watchRecursive(const std::vector<std::string> &paths, uint32_t ev) = 0;
+
+    /**
+     * @brief 递归监视目录
+     *
+     * @param path 目录路径(绝对路径)
+     * @param ev 事件
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    int32_t watchRecursive(const std::string &path, uint32_t ev)
+    {
+        std::vector<std::string> paths = { path };
+        return watchRecursive(paths, ev);
+    }
+
+    /**
+     * @brief 等待事件
+     *
+     * @param timeout 超时时间(毫秒), 0表示一直等待
+     * @return int32_t 成功返回0, 超时返回TIMED_OUT, 失败返回其他负值
+     */
+    virtual int32_t waitCompleteEvent(uint32_t timeout) = 0;
+
+    /**
+     * @brief 设置事件回调
+     *
+     * @param cb 回调
+     */
+    virtual void setEventCallback(EventCallback cb) = 0;
+
+    /**
+     * @brief 非阻塞读取并解析当前所有可读事件
+     *
+     * @return int32_t 成功返回0, 失败返回负值
+     */
+    virtual int32_t processEvent() = 0;
+
+    /**
+     * @brief 获取产生的事件
+     *
+     * @param eventItemVec
+     */
+    virtual void getEventItem(std::list<InotifyEventItem> &eventItemVec) = 0;
+
+    /**
+     * @brief 获取错误码
+     *
+     * @return int32_t
+     */
+    virtual int32_t getLastError() = 0;
+};
+
+} // namespace eular
+
+#endif // __INOTIFY_WATCHER_BACKEND_H__